@@ -38,6 +38,11 @@ int parse_modbus_tcp(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t*
     yaml_node_t* p = ymap_get(d, conn_map, "params");
     return parse_modbus_tcp_params(d, p, &out->u.modbus_tcp);
 }
+int parse_modbus_server(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
+    out->kind = KIND_MODBUS_SERVER;
+    yaml_node_t* p = ymap_get(d, conn_map, "params");
+    return parse_modbus_server_params(d, p, &out->u.modbus_server);
+}
 int parse_uart(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
     out->kind = KIND_UART;
     yaml_node_t* p = ymap_get(d, conn_map, "params");
@@ -49,3 +54,21 @@ int parse_spi(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
     yaml_node_t* p=ymap_get(d, conn_map, "params");
     return parse_spi_params(d,p,&out->u.spi);
 }
+
+int parse_i2c(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
+    out->kind=KIND_I2C;
+    yaml_node_t* p=ymap_get(d, conn_map, "params");
+    return parse_i2c_params(d,p,&out->u.i2c);
+}
+
+int parse_socketcan(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
+    out->kind=KIND_SOCKETCAN;
+    yaml_node_t* p=ymap_get(d, conn_map, "params");
+    return parse_socketcan_params(d,p,&out->u.socketcan);
+}
+
+int parse_onewire(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out){
+    out->kind=KIND_ONEWIRE;
+    yaml_node_t* p=ymap_get(d, conn_map, "params");
+    return parse_onewire_params(d,p,&out->u.onewire);
+}
@@ -1,6 +1,7 @@
 // src/app.c
 #include "app.h"
 #include "bridge.h"
+#include "rt_sched.h"
 #include "config_loader.h"
 #include "config_types.h"
 
@@ -40,6 +41,7 @@ static int start_all_bridges(const config_t *cfg, const char *topic_prefix,
         } else {
             fprintf(stderr, "[bridge:%s] skip (pair %d→%d not supported yet)\n",
                     br->name, (int)arr[n].from->kind, (int)arr[n].to->kind);
+            gw_bridge_stop(&arr[n]);   // libère ce que prepare a alloué (sinks, threads)
         }
     }
 
@@ -76,6 +78,9 @@ load_and_run:
         return 1;
     }
 
+    // gateway.realtime : mémoire verrouillée avant de lancer les threads d'acquisition
+    (void)rt_sched_process_init(&cfg.gateway.realtime);
+
     const char *topic_prefix = "ingest";
     if (start_all_bridges(&cfg, topic_prefix, &running, &running_count) != 0) {
         config_free(&cfg);
@@ -90,6 +95,7 @@ load_and_run:
     }
 
     // Service loop
+    unsigned ticks = 0;
     while (!app->stop) {
         if (app->reload) {
             app->reload = 0;
@@ -100,6 +106,8 @@ load_and_run:
             goto load_and_run;
         }
         sleep(1);
+        if (++ticks % 60 == 0)
+            for (size_t i = 0; i < running_count; ++i) gw_bridge_report(&running[i]);
     }
 
     stop_all_bridges(running, running_count);
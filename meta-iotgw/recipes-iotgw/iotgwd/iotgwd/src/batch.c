@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include "batch.h"
+#include "log.h"
+
+#ifdef IOTGWD_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef IOTGWD_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define BATCH_HDR_MAX   (4 + 10 + 10)   // magic/version/codec + 2 varints
+#define BATCH_SAMPLE_OVERHEAD 30        // dt (10) + topic (10) + len (10)
+
+static size_t put_varint(uint8_t* p, uint64_t v){
+    size_t n = 0;
+    while(v >= 0x80){ p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint64_t zigzag(int64_t v){ return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+
+static int64_t now_us_realtime(void){
+    struct timespec ts; clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static size_t compress_bound(batch_compress_t codec, size_t n){
+    switch(codec){
+#ifdef IOTGWD_HAVE_LZ4
+    case BATCH_COMPRESS_LZ4:  return (size_t)LZ4_compressBound((int)n);
+#endif
+#ifdef IOTGWD_HAVE_ZSTD
+    case BATCH_COMPRESS_ZSTD: return ZSTD_compressBound(n);
+#endif
+    default: return n;
+    }
+}
+
+/* Retour : taille compressée, 0 = pas de gain / échec (=> envoi en clair) */
+static size_t compress_body(batch_sink_t* s, const uint8_t* src, size_t n, uint8_t* dst, size_t cap){
+    switch(s->codec){
+#ifdef IOTGWD_HAVE_LZ4
+    case BATCH_COMPRESS_LZ4: {
+        int r = LZ4_compress_default((const char*)src, (char*)dst, (int)n, (int)cap);
+        return (r > 0 && (size_t)r < n) ? (size_t)r : 0;
+    }
+#endif
+#ifdef IOTGWD_HAVE_ZSTD
+    case BATCH_COMPRESS_ZSTD: {
+        size_t r = ZSTD_compressCCtx((ZSTD_CCtx*)s->zctx, dst, cap, src, n, 3);
+        return (!ZSTD_isError(r) && r < n) ? r : 0;
+    }
+#endif
+    default:
+        (void)src; (void)n; (void)dst; (void)cap;
+        return 0;
+    }
+}
+
+static int ensure_out(batch_sink_t* s, size_t raw_len){
+    size_t need = BATCH_HDR_MAX + compress_bound(s->codec, raw_len);
+    if(need < BATCH_HDR_MAX + raw_len) need = BATCH_HDR_MAX + raw_len;
+    if(need <= s->out_cap) return 0;
+    uint8_t* p = realloc(s->out, need);
+    if(!p) return -1;
+    s->out = p; s->out_cap = need;
+    return 0;
+}
+
+static int grow(uint8_t** buf, size_t* cap, size_t need){
+    if(need <= *cap) return 0;
+    size_t n = *cap ? *cap : 64;
+    while(n < need) n *= 2;
+    uint8_t* p = realloc(*buf, n);
+    if(!p) return -1;
+    *buf = p; *cap = n;
+    return 0;
+}
+
+static uint32_t topic_hash(const char* t, size_t n){
+    uint32_t h = 2166136261u;                       // FNV-1a
+    for(size_t i = 0; i < n; ++i){ h ^= (uint8_t)t[i]; h *= 16777619u; }
+    return h;
+}
+
+/* ---- fenêtres (sous mu) ---- */
+
+static void win_free(batch_win_t* w){
+    if(!w) return;
+    free(w->rec); free(w->tab); free(w);
+}
+
+static batch_win_t* win_get(batch_sink_t* s){
+    batch_win_t* w = s->free_list;
+    if(w){
+        s->free_list = w->next;
+    } else {
+        w = calloc(1, sizeof(*w));
+        if(!w || grow(&w->rec, &w->rec_cap, s->max_bytes + BATCH_SAMPLE_OVERHEAD + 10) != 0){
+            win_free(w);
+            return NULL;
+        }
+    }
+    w->next = NULL;
+    w->rec_len = w->tab_len = 0;
+    w->ntopics = w->last_topic = w->count = 0;
+    return w;
+}
+
+static void win_recycle(batch_sink_t* s, batch_win_t* w){
+    w->next = s->free_list;
+    s->free_list = w;
+}
+
+static bool topic_eq(const batch_win_t* w, size_t i, const char* t, size_t n){
+    const uint8_t* e = w->tab + w->toff[i];
+    size_t off = 0, l = 0;
+    int sh = 0;
+    do { l |= (size_t)(e[off] & 0x7F) << sh; sh += 7; } while(e[off++] & 0x80);
+    return l == n && memcmp(e + off, t, n) == 0;
+}
+
+static long find_topic(batch_win_t* w, const char* t, size_t n, uint32_t h){
+    // le plus souvent : même topic que l'échantillon précédent
+    if(w->ntopics && w->thash[w->last_topic] == h && topic_eq(w, w->last_topic, t, n))
+        return (long)w->last_topic;
+    for(size_t i = 0; i < w->ntopics; ++i){
+        if(w->thash[i] == h && topic_eq(w, i, t, n)){ w->last_topic = i; return (long)i; }
+    }
+    return -1;
+}
+
+static long add_topic(batch_win_t* w, const char* t, size_t n, uint32_t h){
+    if(w->ntopics == BATCH_TOPICS_MAX || grow(&w->tab, &w->tab_cap, w->tab_len + n + 10) != 0)
+        return -1;
+    size_t i = w->ntopics++;
+    w->toff[i] = (uint32_t)w->tab_len;
+    w->thash[i] = h;
+    w->tab_len += put_varint(w->tab + w->tab_len, n);
+    memcpy(w->tab + w->tab_len, t, n);
+    w->tab_len += n;
+    w->last_topic = i;
+    return (long)i;
+}
+
+/* Ferme la fenêtre ouverte : file du thread timer */
+static void seal(batch_sink_t* s){
+    batch_win_t* w = s->cur;
+    if(!w) return;
+    s->cur = NULL;
+    if(!w->count){ win_recycle(s, w); return; }
+    if(s->tail) s->tail->next = w; else s->head = w;
+    s->tail = w;
+    if(++s->queued > BATCH_QUEUE_MAX){
+        batch_win_t* old = s->head;             // publication bloquée : la plus ancienne
+        s->head = old->next;
+        s->queued--;
+        s->dropped += old->count;
+        win_recycle(s, old);
+    }
+    pthread_cond_signal(&s->cv);
+}
+
+/* Encode + publie une fenêtre close (hors mu) */
+static int send_win(batch_sink_t* s, const batch_win_t* w){
+    pthread_mutex_lock(&s->send_mu);
+    int rc = -1;
+    size_t raw_len = 0;
+    if(grow(&s->body, &s->body_cap, 20 + w->tab_len + w->rec_len) == 0){
+        uint8_t* b = s->body;
+        raw_len += put_varint(b, (uint64_t)w->t0_us);
+        raw_len += put_varint(b + raw_len, w->ntopics);
+        memcpy(b + raw_len, w->tab, w->tab_len);  raw_len += w->tab_len;
+        memcpy(b + raw_len, w->rec, w->rec_len);  raw_len += w->rec_len;
+    }
+    if(raw_len && ensure_out(s, raw_len) == 0){
+        uint8_t* o = s->out;
+        size_t n = 0;
+        o[n++] = 'G'; o[n++] = 'B'; o[n++] = 2;
+        size_t codec_at = n++;
+        n += put_varint(o + n, w->count);
+        n += put_varint(o + n, raw_len);
+        size_t z = compress_body(s, s->body, raw_len, o + n, s->out_cap - n);
+        if(z){ o[codec_at] = (uint8_t)s->codec; n += z; }
+        else { o[codec_at] = 0; memcpy(o + n, s->body, raw_len); n += raw_len; }
+
+        gw_msg_t m;
+        memset(&m, 0, sizeof(m));
+        m.protocole = KIND_MQTT;
+        m.pl.topic = s->topic;
+        m.pl.data = o;
+        m.pl.len = n;
+        m.pl.content_type = "application/vnd.iotgw.batch";
+        rc = s->inner_send(&m, s->inner_ctx);
+
+        s->batches++;
+        s->samples += w->count;
+        s->raw_bytes += raw_len;
+        s->wire_bytes += n;
+    }
+    if(rc != 0) s->send_errors++;
+    pthread_mutex_unlock(&s->send_mu);
+    return rc;
+}
+
+/* Publie les fenêtres closes ; ferme la fenêtre ouverte à son échéance */
+static void* timer_thread(void* arg){
+    batch_sink_t* s = (batch_sink_t*)arg;
+    pthread_mutex_lock(&s->mu);
+    while(s->running){
+        if(s->head){
+            batch_win_t* w = s->head;
+            s->head = w->next;
+            if(!s->head) s->tail = NULL;
+            s->queued--;
+            pthread_mutex_unlock(&s->mu);
+            (void)send_win(s, w);
+            pthread_mutex_lock(&s->mu);
+            win_recycle(s, w);
+            continue;
+        }
+        if(!s->cur || s->cur->count == 0){
+            pthread_cond_wait(&s->cv, &s->mu);
+            continue;
+        }
+        struct timespec opened = s->cur->opened;
+        struct timespec dl = opened;
+        dl.tv_sec  += s->max_ms / 1000;
+        dl.tv_nsec += (long)(s->max_ms % 1000) * 1000000L;
+        if(dl.tv_nsec >= 1000000000L){ dl.tv_sec++; dl.tv_nsec -= 1000000000L; }
+        int rc = pthread_cond_timedwait(&s->cv, &s->mu, &dl);
+        /* fenêtre close (taille) et rouverte pendant l'attente : nouvelle échéance */
+        bool same = s->cur && opened.tv_sec == s->cur->opened.tv_sec &&
+                    opened.tv_nsec == s->cur->opened.tv_nsec;
+        if(rc == ETIMEDOUT && s->running && same && s->cur->count > 0){
+            s->timer_flushes++;
+            seal(s);
+        }
+    }
+    pthread_mutex_unlock(&s->mu);
+    return NULL;
+}
+
+int batch_sink_init(batch_sink_t* s, const bridge_batch_t* cfg, const char* topic_prefix,
+                    gw_send_fn inner_send, void* inner_ctx)
+{
+    if(!s || !cfg || !inner_send) return -1;
+    memset(s, 0, sizeof(*s));
+    s->inner_send = inner_send;
+    s->inner_ctx  = inner_ctx;
+    s->max_ms     = cfg->has_max_ms && cfg->max_ms > 0 ? cfg->max_ms : 100;
+    s->max_bytes  = cfg->has_max_bytes && cfg->max_bytes > 0 ? (size_t)cfg->max_bytes : 8192;
+    s->codec      = cfg->compress;
+    snprintf(s->topic, sizeof(s->topic), "%s/batch",
+             topic_prefix && topic_prefix[0] ? topic_prefix : "ingest");
+
+#ifndef IOTGWD_HAVE_LZ4
+    if(s->codec == BATCH_COMPRESS_LZ4){
+        log_warn("batch: lz4 not compiled in, sending uncompressed batches");
+        s->codec = BATCH_COMPRESS_NONE;
+    }
+#endif
+#ifndef IOTGWD_HAVE_ZSTD
+    if(s->codec == BATCH_COMPRESS_ZSTD){
+        log_warn("batch: zstd not compiled in, sending uncompressed batches");
+        s->codec = BATCH_COMPRESS_NONE;
+    }
+#else
+    if(s->codec == BATCH_COMPRESS_ZSTD && !(s->zctx = ZSTD_createCCtx())) return -1;
+#endif
+
+    size_t raw = s->max_bytes + BATCH_SAMPLE_OVERHEAD + 32;
+    if(grow(&s->body, &s->body_cap, raw) != 0 || ensure_out(s, raw) != 0) goto fail;
+    /* deux fenêtres d'avance : en régime établi, le producteur ne fait que copier */
+    for(int i = 0; i < 2; ++i){
+        batch_win_t* w = win_get(s);
+        if(!w) goto fail;
+        win_recycle(s, w);
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&s->mu, NULL);
+    pthread_mutex_init(&s->send_mu, NULL);
+
+    s->running = true;
+    if(pthread_create(&s->timer, NULL, timer_thread, s) != 0){
+        s->running = false;
+        pthread_cond_destroy(&s->cv);
+        pthread_mutex_destroy(&s->mu);
+        pthread_mutex_destroy(&s->send_mu);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    while(s->free_list){ batch_win_t* w = s->free_list; s->free_list = w->next; win_free(w); }
+    free(s->body); free(s->out);
+#ifdef IOTGWD_HAVE_ZSTD
+    ZSTD_freeCCtx((ZSTD_CCtx*)s->zctx);
+#endif
+    memset(s, 0, sizeof(*s));
+    return -1;
+}
+
+int batch_flush(batch_sink_t* s)
+{
+    if(!s) return -1;
+    pthread_mutex_lock(&s->mu);
+    seal(s);
+    batch_win_t* w = s->head;
+    s->head = s->tail = NULL;
+    s->queued = 0;
+    pthread_mutex_unlock(&s->mu);
+
+    int rc = 0;
+    while(w){
+        batch_win_t* next = w->next;
+        if(send_win(s, w) != 0) rc = -1;
+        pthread_mutex_lock(&s->mu);
+        win_recycle(s, w);
+        pthread_mutex_unlock(&s->mu);
+        w = next;
+    }
+    return rc;
+}
+
+int batch_send_adapter(const gw_msg_t* msg, void* ctx)
+{
+    batch_sink_t* s = (batch_sink_t*)ctx;
+    if(!s || !msg) return -1;
+
+    const char* topic = (msg->pl.topic && msg->pl.topic[0]) ? msg->pl.topic : "ingest";
+    size_t tlen = strnlen(topic, BATCH_TOPIC_MAX - 1);
+    uint32_t h = topic_hash(topic, tlen);
+    size_t len = msg->pl.len;
+    int64_t ts = msg->timestamp > 0 ? (int64_t)(msg->timestamp * 1e6) : now_us_realtime();
+
+    pthread_mutex_lock(&s->mu);
+    batch_win_t* w = s->cur;
+    long ti = w ? find_topic(w, topic, tlen, h) : -1;
+    if(w && w->count > 0){
+        size_t cost = len + BATCH_SAMPLE_OVERHEAD + (ti < 0 ? tlen + 10 : 0);
+        if(w->rec_len + w->tab_len + cost > s->max_bytes ||
+           (ti < 0 && w->ntopics == BATCH_TOPICS_MAX)){
+            /* fenêtre pleine : close, publiée par le thread timer */
+            s->size_flushes++;
+            seal(s);
+            w = NULL;
+        }
+    }
+    if(!w){
+        if(!(w = win_get(s))){ pthread_mutex_unlock(&s->mu); return -1; }
+        s->cur = w;
+        clock_gettime(CLOCK_MONOTONIC, &w->opened);
+        w->t0_us = w->prev_us = ts;
+        ti = -1;
+        pthread_cond_signal(&s->cv);   // arme le timer
+    }
+    if(ti < 0) ti = add_topic(w, topic, tlen, h);
+    /* un échantillon seul plus gros que max_bytes part quand même, seul */
+    if(ti < 0 || grow(&w->rec, &w->rec_cap, w->rec_len + len + BATCH_SAMPLE_OVERHEAD) != 0){
+        pthread_mutex_unlock(&s->mu);
+        return -1;
+    }
+    uint8_t* p = w->rec + w->rec_len;
+    p += put_varint(p, zigzag(ts - w->prev_us));
+    p += put_varint(p, (uint64_t)ti);
+    p += put_varint(p, len);
+    if(len) memcpy(p, msg->pl.data, len);
+    w->rec_len = (size_t)(p - w->rec) + len;
+    w->prev_us = ts;
+    w->count++;
+    if(w->rec_len + w->tab_len >= s->max_bytes){
+        s->size_flushes++;
+        seal(s);
+    }
+    pthread_mutex_unlock(&s->mu);
+    return 0;
+}
+
+void batch_sink_shutdown(batch_sink_t* s)
+{
+    if(!s || !s->out) return;
+    pthread_mutex_lock(&s->mu);
+    s->running = false;
+    pthread_cond_signal(&s->cv);
+    pthread_mutex_unlock(&s->mu);
+    pthread_join(s->timer, NULL);
+
+    (void)batch_flush(s);
+    if(s->batches)
+        log_info("batch: %lu batches, %lu samples, %llu -> %llu bytes (timer %lu, size %lu, errors %lu, dropped %lu)",
+                 s->batches, s->samples, s->raw_bytes, s->wire_bytes,
+                 s->timer_flushes, s->size_flushes, s->send_errors, s->dropped);
+
+    pthread_cond_destroy(&s->cv);
+    pthread_mutex_destroy(&s->mu);
+    pthread_mutex_destroy(&s->send_mu);
+    while(s->free_list){ batch_win_t* w = s->free_list; s->free_list = w->next; win_free(w); }
+    free(s->body); free(s->out);
+#ifdef IOTGWD_HAVE_ZSTD
+    ZSTD_freeCCtx((ZSTD_CCtx*)s->zctx);
+#endif
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,102 @@
+#pragma once
+/**
+ * @file batch.h
+ * @brief Sink "batch" : accumule les échantillons d'un bridge et publie une
+ *        seule enveloppe (optionnellement compressée) par fenêtre.
+ *
+ * Enveloppe (octets, varints LEB128), publiée sur "<topic_prefix>/batch" :
+ *   'G' 'B' <version=2> <codec 0=none 1=lz4 2=zstd>
+ *   varint count          nombre d'échantillons
+ *   varint raw_len        taille du corps décompressé
+ *   corps (compressé selon codec) :
+ *     varint t0_us        timestamp du premier échantillon (µs epoch)
+ *     varint ntopics      table des topics de la fenêtre
+ *     ntopics × { varint len, len octets }
+ *     count × { zigzag varint dt_us (vs échantillon précédent), varint topic
+ *               (index dans la table), varint len, len octets }
+ *
+ * Les échantillons de topics différents (un par identifiant CAN, unité
+ * Modbus, sonde...) partagent la fenêtre. Elle est close quand max_bytes est
+ * atteint, quand la table est pleine (BATCH_TOPICS_MAX), ou au plus tard
+ * max_ms après son premier échantillon. Les fenêtres closes sont compressées
+ * et publiées par le thread timer : le producteur ne fait que copier. Au-delà
+ * de BATCH_QUEUE_MAX fenêtres en attente (publication bloquée), la plus
+ * ancienne est abandonnée (dropped).
+ * Si la compression ne fait pas gagner de place, le corps part en clair (codec 0).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "gw_msg.h"
+#include "config_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATCH_TOPIC_MAX  256
+#define BATCH_TOPICS_MAX 256     // topics distincts par fenêtre
+#define BATCH_QUEUE_MAX  8       // fenêtres closes en attente de publication
+
+typedef struct batch_win {
+    struct batch_win* next;
+    uint8_t* rec;  size_t rec_len, rec_cap;      // échantillons
+    uint8_t* tab;  size_t tab_len, tab_cap;      // table des topics
+    uint32_t toff[BATCH_TOPICS_MAX];             // offset du topic dans tab
+    uint32_t thash[BATCH_TOPICS_MAX];
+    size_t   ntopics, last_topic;
+    size_t   count;
+    int64_t  t0_us, prev_us;
+    struct timespec opened;      // CLOCK_MONOTONIC du premier échantillon
+} batch_win_t;
+
+typedef struct {
+    gw_send_fn inner_send;       // publication réelle (ex: mqtt_send_adapter)
+    void*      inner_ctx;
+    int        max_ms;
+    size_t     max_bytes;
+    batch_compress_t codec;      // effectif (retombe sur none si non compilé)
+    char       topic[BATCH_TOPIC_MAX];
+
+    pthread_mutex_t mu;          // fenêtres
+    pthread_mutex_t send_mu;     // sérialise encodage + envoi
+    pthread_cond_t  cv;
+    pthread_t       timer;
+    bool            running;
+
+    /* sous mu */
+    batch_win_t* cur;            // fenêtre ouverte (NULL : aucune)
+    batch_win_t* head;           // fenêtres closes, FIFO
+    batch_win_t* tail;
+    size_t       queued;
+    batch_win_t* free_list;      // fenêtres recyclées
+
+    /* encodage (sous send_mu) */
+    uint8_t* body;  size_t body_cap;
+    uint8_t* out;   size_t out_cap;
+    void*    zctx;               // ZSTD_CCtx* réutilisé
+
+    /* stats */
+    unsigned long batches, samples, timer_flushes, size_flushes, send_errors, dropped;
+    unsigned long long raw_bytes, wire_bytes;
+} batch_sink_t;
+
+/* Retour 0 = OK. cfg->max_ms/max_bytes absents => 100 ms / 8192 octets.
+ * topic_prefix : enveloppes publiées sur "<topic_prefix>/batch". */
+int  batch_sink_init(batch_sink_t* s, const bridge_batch_t* cfg, const char* topic_prefix,
+                     gw_send_fn inner_send, void* inner_ctx);
+
+/* gw_send_fn : ajoute msg->pl (topic + octets, copiés) à la fenêtre ouverte */
+int  batch_send_adapter(const gw_msg_t* msg, void* ctx);
+
+/* Ferme la fenêtre ouverte et publie, sur le thread appelant, toutes les
+ * fenêtres en attente. Retour 0 = OK/rien à publier. */
+int  batch_flush(batch_sink_t* s);
+
+/* Arrêt du timer + flush final + libération */
+void batch_sink_shutdown(batch_sink_t* s);
+
+#ifdef __cplusplus
+}
+#endif
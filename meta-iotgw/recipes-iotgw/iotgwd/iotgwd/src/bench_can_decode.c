@@ -0,0 +1,298 @@
+// bench_can_decode.c — décodage de signaux CAN : table compilée vs décodage naïf
+//
+// Hors binaire du service, comme bench_decode.c :
+//   gcc -O2 -std=gnu11 -o bench_can_decode bench_can_decode.c can_decode.c log.c -lm
+//   ./bench_can_decode [candump.log] [passes]
+//
+// Rejoue à pleine vitesse un enregistrement "candump -L" (lignes
+// "(ts) can0 123#DEADBEEF", "can0 12345678##1..." en CAN FD), sinon un trafic
+// synthétique de 16 000 trames aux charges utiles lentement variables.
+// 200 messages (11 et 29 bits) de 6 signaux chacun, little/big endian, signés,
+// factor/offset, sont décodés sur les identifiants présents ; la référence
+// cherche le message par parcours linéaire, extrait les signaux bit à bit et
+// rend chaque trame en JSON. Les valeurs des deux chemins sont comparées avant
+// la mesure. Le décodage naïf seul est comparé à l'extraction compilée seule
+// (can_decoder_extract), le JSON systématique au chemin du service
+// (publication sur changement).
+#include "can_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define NMSG 200
+#define NSIG 6
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct { struct canfd_frame f; double ts; } rec_t;
+
+static int hexv(int c){
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "(1700000000.123456) can0 123#1122" / "... 1234ABCD##3AABB" ; 0 si ignorée
+static int parse_line(const char* l, rec_t* r){
+    memset(r, 0, sizeof(*r));
+    if (*l == '(') r->ts = strtod(l + 1, NULL);
+    const char* p = strchr(l, '#');
+    if (!p) return 0;
+    const char* id = p;
+    while (id > l && id[-1] != ' ') --id;
+    size_t idlen = (size_t)(p - id);
+    canid_t cid = (canid_t)strtoul(id, NULL, 16);
+    r->f.can_id = idlen > 3 ? (cid & CAN_EFF_MASK) | CAN_EFF_FLAG : cid & CAN_SFF_MASK;
+    ++p;
+    if (*p == 'R') return 0;                            // remote frame
+    if (*p == '#') p += 2;                              // CAN FD : "##<flags>"
+    size_t n = 0;
+    while (n < CANFD_MAX_DLEN) {
+        int h = hexv(p[0]), lo = h < 0 ? -1 : hexv(p[1]);
+        if (lo < 0) break;
+        r->f.data[n++] = (uint8_t)(h << 4 | lo);
+        p += 2;
+        if (*p == '.') ++p;
+    }
+    r->f.len = (uint8_t)n;
+    return 1;
+}
+
+static uint32_t rng = 0x12345678u;
+static uint32_t rnd(void){ rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; }
+
+// Référence : bit à bit, selon la numérotation DBC
+static double naive_signal(const socketcan_signal_t* s, const uint8_t* d){
+    uint64_t v = 0;
+    if (s->byte_order == CAN_SIG_BIG_ENDIAN) {
+        unsigned bit = s->start;
+        for (unsigned i = 0; i < s->length; ++i) {
+            v = (v << 1) | ((d[bit / 8] >> (bit % 8)) & 1u);
+            if (bit % 8 == 0) bit += 15; else bit--;    // msb de l'octet suivant
+        }
+    } else {
+        for (unsigned i = 0; i < s->length; ++i) {
+            unsigned bit = s->start + i;
+            v |= (uint64_t)((d[bit / 8] >> (bit % 8)) & 1u) << i;
+        }
+    }
+    double x;
+    if (s->is_signed && s->length < 64 && (v >> (s->length - 1)) & 1u)
+        x = (double)(int64_t)(v | ~((1ull << s->length) - 1));
+    else if (s->is_signed)
+        x = (double)(int64_t)v;
+    else
+        x = (double)v;
+    return x * s->factor + s->offset;
+}
+
+static double metric_value(const gw_metric_t* m){
+    switch (m->type) {
+    case GW_VAL_I64: return (double)m->v.i64;
+    case GW_VAL_U64: return (double)m->v.u64;
+    default:         return m->v.f64;
+    }
+}
+
+// Messages + signaux tirés au hasard, tous contenus dans 8 octets
+static void make_messages(socketcan_params_t* p, const canid_t* ids, size_t nids){
+    static char names[NMSG][NSIG][12];
+    p->messages_count = nids < NMSG ? nids : NMSG;
+    p->messages = calloc(p->messages_count, sizeof(*p->messages));
+    for (size_t i = 0; i < p->messages_count; ++i) {
+        socketcan_message_t* m = &p->messages[i];
+        m->extended = (ids[i] & CAN_EFF_FLAG) != 0;
+        m->id = ids[i] & (m->extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+        m->signals_count = NSIG;
+        m->signals = calloc(NSIG, sizeof(*m->signals));
+        for (size_t k = 0; k < NSIG; ++k) {
+            socketcan_signal_t* s = &m->signals[k];
+            snprintf(names[i][k], sizeof(names[i][k]), "s%zu", k);
+            s->name = names[i][k];
+            s->length = (uint8_t)(1 + rnd() % 32);
+            s->byte_order = (rnd() & 1) ? CAN_SIG_BIG_ENDIAN : CAN_SIG_LITTLE_ENDIAN;
+            unsigned first = rnd() % (64 - s->length + 1);     // position séquentielle
+            s->start = s->byte_order == CAN_SIG_BIG_ENDIAN
+                     ? (uint16_t)((first / 8) * 8 + (7 - first % 8)) : (uint16_t)first;
+            s->is_signed = (rnd() % 3) == 0;
+            s->factor = (rnd() & 1) ? 0.1 * (1 + rnd() % 10) : 1.0;
+            s->offset = (rnd() % 4) == 0 ? -40.0 : 0.0;
+        }
+    }
+}
+
+static const socketcan_message_t* naive_lookup(const socketcan_params_t* p, canid_t id){
+    bool ext = (id & CAN_EFF_FLAG) != 0;
+    uint32_t raw = id & (ext ? CAN_EFF_MASK : CAN_SFF_MASK);
+    for (size_t i = 0; i < p->messages_count; ++i)
+        if (p->messages[i].id == raw && p->messages[i].extended == ext) return &p->messages[i];
+    return NULL;
+}
+
+typedef struct { const rec_t* rec; const socketcan_params_t* p; size_t bad, checked; } check_t;
+
+static void on_check(const char* message, const gw_metric_t* metrics, size_t n,
+                     const char* json, size_t json_len, double ts, void* user){
+    (void)message; (void)json; (void)json_len; (void)ts;
+    check_t* c = (check_t*)user;
+    const socketcan_message_t* m = naive_lookup(c->p, c->rec->f.can_id);
+    if (!m || m->signals_count != n) { c->bad++; return; }
+    for (size_t k = 0; k < n; ++k) {
+        double ref = naive_signal(&m->signals[k], c->rec->f.data), got = metric_value(&metrics[k]);
+        if (fabs(ref - got) > 1e-9 * (1 + fabs(ref))) {
+            if (c->bad < 5)
+                fprintf(stderr, "mismatch %s.%s: %g != %g\n", message, m->signals[k].name, got, ref);
+            c->bad++;
+        }
+    }
+    c->checked++;
+}
+
+static unsigned long published;
+static void on_count(const char* message, const gw_metric_t* metrics, size_t n,
+                     const char* json, size_t json_len, double ts, void* user){
+    (void)message; (void)metrics; (void)n; (void)json; (void)ts; (void)user;
+    published += json_len != 0;
+}
+
+int main(int argc, char** argv){
+    size_t passes = argc > 2 ? strtoul(argv[2], NULL, 10) : 50;
+    size_t cap = 1 << 16, nrec = 0;
+    rec_t* recs = calloc(cap, sizeof(*recs));
+    if (!recs) return 1;
+
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+        FILE* fp = fopen(argv[1], "r");
+        if (!fp) { perror(argv[1]); return 1; }
+        char line[512];
+        while (fgets(line, sizeof(line), fp)) {
+            if (nrec == cap) { cap *= 2; recs = realloc(recs, cap * sizeof(*recs)); if (!recs) return 1; }
+            if (parse_line(line, &recs[nrec])) nrec++;
+        }
+        fclose(fp);
+    } else {
+        canid_t ids[NMSG + 40];
+        for (size_t i = 0; i < NMSG + 40; ++i)                // 40 identifiants non décodés
+            ids[i] = (i % 3) ? rnd() % 0x800 : ((rnd() & CAN_EFF_MASK) | CAN_EFF_FLAG);
+        // Bus réaliste : chaque identifiant garde sa charge utile, un octet
+        // change une fois sur huit
+        static uint8_t payload[NMSG + 40][8];
+        for (size_t i = 0; i < NMSG + 40; ++i)
+            for (int b = 0; b < 8; ++b) payload[i][b] = (uint8_t)rnd();
+        nrec = 16000;
+        for (size_t i = 0; i < nrec; ++i) {
+            size_t k = rnd() % (NMSG + 40);
+            if (rnd() % 8 == 0) payload[k][rnd() % 8] = (uint8_t)rnd();
+            recs[i].f.can_id = ids[k];
+            recs[i].f.len = 8;
+            memcpy(recs[i].f.data, payload[k], 8);
+            recs[i].ts = 1700000000.0 + i * 0.00025;
+        }
+    }
+    if (!nrec) { fprintf(stderr, "no frames\n"); return 1; }
+
+    // Messages : les premiers identifiants distincts de l'enregistrement
+    canid_t ids[NMSG];
+    size_t nids = 0;
+    for (size_t i = 0; i < nrec && nids < NMSG; ++i) {
+        bool dup = false;
+        for (size_t k = 0; k < nids && !dup; ++k) dup = ids[k] == recs[i].f.can_id;
+        if (!dup) ids[nids++] = recs[i].f.can_id;
+    }
+    socketcan_params_t p;
+    memset(&p, 0, sizeof(p));
+    make_messages(&p, ids, nids);
+    for (size_t i = 0; i < nrec; ++i)                  // signaux dans 8 octets
+        if (recs[i].f.len < 8) recs[i].f.len = 8;
+
+    can_decoder_t* d = calloc(1, sizeof(*d));
+    if (!d || can_decoder_init(d, &p) != 0) return 1;
+
+    // Vérification : toutes les trames publiées (valeurs changées) contre la référence
+    check_t c = { NULL, &p, 0, 0 };
+    for (size_t i = 0; i < nrec; ++i) {
+        c.rec = &recs[i];
+        can_decoder_feed(d, &recs[i].f, recs[i].ts, on_check, &c);
+    }
+    // Extraction seule : toutes les trames décodées
+    double vals[NSIG];
+    size_t xchecked = 0;
+    for (size_t i = 0; i < nrec; ++i) {
+        int nv = can_decoder_extract(d, &recs[i].f, vals, NSIG);
+        const socketcan_message_t* m = naive_lookup(&p, recs[i].f.can_id);
+        if (nv < 0) { c.bad += m != NULL; continue; }
+        xchecked++;
+        for (int k = 0; k < nv; ++k) {
+            double ref = naive_signal(&m->signals[k], recs[i].f.data);
+            if (fabs(ref - vals[k]) > 1e-9 * (1 + fabs(ref))) c.bad++;
+        }
+    }
+    printf("%zu frames, %zu messages x %d signals, %zu publications + %zu extractions checked, %zu mismatch(es)\n",
+           nrec, p.messages_count, NSIG, c.checked, xchecked, c.bad);
+    if (c.bad) return 1;
+
+    // Naïf : parcours linéaire + bit à bit, conversion de chaque signal ;
+    // puis idem avec rendu JSON de chaque trame (publication systématique)
+    volatile double sink = 0;
+    char js[512];
+    uint64_t t0 = now_ns();
+    for (size_t r = 0; r < passes; ++r)
+        for (size_t i = 0; i < nrec; ++i) {
+            const socketcan_message_t* m = naive_lookup(&p, recs[i].f.can_id);
+            if (!m) continue;
+            for (size_t k = 0; k < m->signals_count; ++k) sink += naive_signal(&m->signals[k], recs[i].f.data);
+        }
+    uint64_t tj = now_ns();
+    for (size_t r = 0; r < passes; ++r)
+        for (size_t i = 0; i < nrec; ++i) {
+            const socketcan_message_t* m = naive_lookup(&p, recs[i].f.can_id);
+            if (!m) continue;
+            size_t k = 0;
+            js[k++] = '{';
+            for (size_t s = 0; s < m->signals_count && k < sizeof(js) - 40; ++s)
+                k += (size_t)snprintf(js + k, sizeof(js) - k, "%s\"%s\":%.9g", s ? "," : "",
+                                      m->signals[s].name, naive_signal(&m->signals[s], recs[i].f.data));
+            js[k++] = '}';
+            sink += js[1];
+        }
+    uint64_t t1 = now_ns();
+
+    // Compilé, extraction seule (lookup + extraction + conversion de chaque
+    // signal) : même travail que le décodage naïf seul
+    for (size_t r = 0; r < passes; ++r)
+        for (size_t i = 0; i < nrec; ++i) {
+            int nv = can_decoder_extract(d, &recs[i].f, vals, NSIG);
+            for (int k = 0; k < nv; ++k) sink += vals[k];
+        }
+    uint64_t t2 = now_ns();
+
+    // Compilé, chemin du service : publication sur changement, rendu compris
+    for (size_t r = 0; r < passes; ++r)
+        for (size_t i = 0; i < nrec; ++i)
+            can_decoder_feed(d, &recs[i].f, recs[i].ts, on_count, NULL);
+    uint64_t t3 = now_ns();
+
+    // Les ratios comparent un travail équivalent ; "on change" ne rend que
+    // les trames modifiées, son écart au JSON systématique mêle le gain de
+    // la table compilée et celui de la politique de publication
+    double n = (double)passes * (double)nrec;
+    printf("naive decode        : %8.1f ns/frame\n", (tj - t0) / n);
+    printf("compiled extract    : %8.1f ns/frame (x%.1f vs naive decode)\n",
+           (t2 - t1) / n, (double)(tj - t0) / (double)(t2 - t1));
+    printf("naive decode + json : %8.1f ns/frame (every frame)\n", (t1 - tj) / n);
+    printf("compiled, on change : %8.1f ns/frame (%lu publications, %lu unknown-id frames)\n",
+           (t3 - t2) / n, published, d->unknown);
+    printf("service path        : x%.1f vs naive decode + json (includes publish-on-change)\n",
+           (double)(t1 - tj) / (double)(t3 - t2));
+    (void)sink;
+    can_decoder_free(d);
+    free(d);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// bench_decode.c — décodage d'une map de registres : point par point vs plan groupé
+//
+// Hors binaire du service, comme demo_spi.c :
+//   gcc -O2 -std=c11 -D_GNU_SOURCE -o bench_decode bench_decode.c decode.c log.c -lm
+//   ./bench_decode [points] [itérations]
+//
+// Map type Modbus : blocs de registres u16/s16 (scale 0.1), u32, float en
+// ordre "CDAB", quelques s32 isolés ; le chemin naïf est l'ancien décodage
+// champ par champ, les deux résultats sont comparés avant la mesure.
+#include "decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static size_t field_len(spi_field_type_t t){
+    switch (t) {
+    case SPI_FIELD_U16: case SPI_FIELD_S16: return 2;
+    default: return 4;
+    }
+}
+
+// Référence : un champ à la fois, registres big-endian (format modbus_plan_t.image)
+static double naive_one(const spi_field_t* f, const uint8_t* b){
+    const uint8_t* at = b + f->offset;
+    uint64_t raw = 0;
+    for (size_t i = 0; i < field_len(f->type); ++i) raw = (raw << 8) | at[i];
+    if (f->word_swap) raw = ((raw & 0xFFFFu) << 16) | (raw >> 16);
+    double d;
+    switch (f->type) {
+    case SPI_FIELD_S16: d = (int16_t)raw; break;
+    case SPI_FIELD_S32: d = (int32_t)raw; break;
+    case SPI_FIELD_FLOAT: { uint32_t u = (uint32_t)raw; float x; memcpy(&x, &u, 4); d = x; break; }
+    default: d = (double)raw; break;
+    }
+    return f->has_scale ? d * f->scale : d;
+}
+
+static double metric_value(const gw_metric_t* m){
+    switch (m->type) {
+    case GW_VAL_I64: return (double)m->v.i64;
+    case GW_VAL_U64: return (double)m->v.u64;
+    default:         return m->v.f64;
+    }
+}
+
+int main(int argc, char** argv){
+    size_t npts  = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000;
+    size_t iters = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000;
+
+    spi_field_t* fields = calloc(npts, sizeof(*fields));
+    char (*names)[24]   = malloc(npts * sizeof(*names));
+    if (!fields || !names) return 1;
+
+    size_t off = 0;
+    for (size_t i = 0; i < npts; ++i) {
+        spi_field_t* f = &fields[i];
+        snprintf(names[i], sizeof(names[i]), "p%zu", i);
+        f->name = names[i];
+        switch ((i / 64) % 5) {              // blocs de 64 points du même type
+        case 0: f->type = SPI_FIELD_U16; break;
+        case 1: f->type = SPI_FIELD_S16; f->scale = 0.1; f->has_scale = true; break;
+        case 2: f->type = SPI_FIELD_U32; f->scale = 0.01; f->has_scale = true; break;
+        case 3: f->type = SPI_FIELD_FLOAT; f->word_swap = true; break;
+        default: f->type = (i % 3) ? SPI_FIELD_S32 : SPI_FIELD_U16; f->scale = 2.0; f->has_scale = true; break;
+        }
+        f->offset = (uint16_t)off;
+        off += field_len(f->type);
+        if (off > 65535 - 8) { npts = i + 1; break; }
+    }
+    size_t len = off;
+
+    uint8_t* frame = malloc(len);
+    if (!frame) return 1;
+    srand(1);
+    for (size_t i = 0; i < len; ++i) frame[i] = (uint8_t)rand();
+
+    decode_plan_t plan;
+    if (decode_plan_compile(&plan, fields, npts, len, 8) != 0) { fprintf(stderr, "compile failed\n"); return 1; }
+    printf("%zu points, %zu octets, %zu groupes\n", npts, len, plan.ngroups);
+
+    double* ref = malloc(npts * sizeof(*ref));
+    if (!ref) return 1;
+    decode_plan_run(&plan, frame, len);
+    for (size_t i = 0; i < npts; ++i) {
+        ref[i] = naive_one(&fields[i], frame);
+        double v = metric_value(&plan.metrics[i]);
+        if (!(v == ref[i] || (isnan(v) && isnan(ref[i])))) {
+            fprintf(stderr, "mismatch %s: %.17g != %.17g\n", fields[i].name, v, ref[i]);
+            return 1;
+        }
+    }
+
+    volatile double sink = 0;
+    uint64_t t0 = now_ns();
+    for (size_t k = 0; k < iters; ++k) {
+        for (size_t i = 0; i < npts; ++i) ref[i] = naive_one(&fields[i], frame);
+        sink += ref[k % npts];
+    }
+    uint64_t t1 = now_ns();
+    for (size_t k = 0; k < iters; ++k) {
+        decode_plan_run(&plan, frame, len);
+        sink += plan.metrics[k % npts].v.f64;
+    }
+    uint64_t t2 = now_ns();
+    (void)sink;
+
+    double naive = (double)(t1 - t0) / (double)(iters * npts);
+    double plan_ns = (double)(t2 - t1) / (double)(iters * npts);
+    printf("naïf  : %.2f ns/point\nplan  : %.2f ns/point (x%.1f)\n", naive, plan_ns, naive / plan_ns);
+
+    decode_plan_free(&plan);
+    free(ref); free(frame); free(names); free(fields);
+    return 0;
+}
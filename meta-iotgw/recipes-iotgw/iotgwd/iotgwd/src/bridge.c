@@ -18,7 +18,18 @@
 #include "conn_http_server.h"   // http runtime API + on_http_rx
 #include "conn_mqtt.h"          // mqtt_send_adapter + http_to_mqtt_default
 
+#include "conn_mqtt_multi.h"    // params.brokers[] => sink multi-broker
 #include "conn_spi.h"
+#include "sparkplug.h"
+#include "batch.h"
+#include "uart_port.h"
+#include "modbus_rtu.h"
+#include "modbus_tcp.h"
+#include "modbus_server.h"
+#include "modbus_write.h"
+#include "conn_i2c.h"
+#include "conn_can.h"
+#include "conn_onewire.h"
  
 /* Callback SPI -> bridge: transforme/forward vers send_fn.
  * ATTENTION: le buffer rx fourni par le driver est libéré après le callback;
@@ -36,6 +47,9 @@ int spi_to_mqtt_default(const gw_msg_t* in, gw_msg_t* out, void* user){
 
     out->protocole = KIND_MQTT;         // destination
     out->pl = in->pl;                    // réutilise le payload tel quel
+    out->timestamp = in->timestamp;
+    out->metrics = in->metrics;
+    out->metrics_count = in->metrics_count;
     out->pl.topic = rt->topic_prefix[0] 
                     ? rt->topic_prefix 
                     : "ingest/spi/read";          
@@ -45,6 +59,97 @@ int spi_to_mqtt_default(const gw_msg_t* in, gw_msg_t* out, void* user){
 
 
 
+// UART -> MQTT : trame brute, topic = préfixe du bridge
+int uart_to_mqtt_default(const gw_msg_t* in, gw_msg_t* out, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!in || !out || !rt) return -1;
+
+    *out = *in;
+    out->protocole = KIND_MQTT;
+    out->pl.topic = rt->topic_prefix[0] ? rt->topic_prefix : "ingest/uart";
+    return 0;
+}
+
+// Modbus/I2C/CAN/1-Wire -> MQTT : topic "<prefix>/<unit|device|id>" posé par on_modbus_data /
+// on_i2c_data / on_can_rx / on_onewire_data
+int modbus_to_mqtt_default(const gw_msg_t* in, gw_msg_t* out, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!in || !out || !rt) return -1;
+
+    *out = *in;
+    out->protocole = KIND_MQTT;
+    if (!out->pl.topic) out->pl.topic = rt->topic_prefix[0] ? rt->topic_prefix : "ingest/modbus";
+    return 0;
+}
+
+// MQTT (topics[] souscrits) -> send_fn, ex: commandes vers un port série
+static void on_mqtt_rx(const char* topic, const void* payload, int payloadlen, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || payloadlen < 0) return;
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_MQTT;
+    in.pl.data = (const uint8_t*)payload;
+    in.pl.len = (size_t)payloadlen;
+    in.pl.topic = topic;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
+
+/* Confirmation d'une commande d'écriture Modbus (thread du maître, ou celui de
+ * la source si la commande est rejetée) : JSON publié par la source MQTT sur
+ * mapping.topic, sinon "<topic de la commande>/ack". */
+static void on_modbus_write_done(const modbus_cmd_t* c, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !c) return;
+
+    char json[512], topic[256];
+    if (modbus_cmd_json(c, json, sizeof(json)) < 0) return;
+    const char* cmd_topic = modbus_cmd_topic(c);
+    if (rt->cfg && rt->cfg->mapping.topic && rt->cfg->mapping.topic[0])
+        snprintf(topic, sizeof(topic), "%s", rt->cfg->mapping.topic);
+    else
+        snprintf(topic, sizeof(topic), "%s/ack", cmd_topic ? cmd_topic : rt->topic_prefix);
+
+    if (rt->from && rt->from->kind == KIND_MQTT && rt->source_ctx)
+        (void)mqtt_publish_text((mqtt_runtime_t*)rt->source_ctx, topic, json, 1, false);
+    else
+        log_info("[%s] %s %s", rt->id[0] ? rt->id : "bridge", topic, json);
+}
+
+/* Réarmement du will Sparkplug (NDEATH du bdSeq suivant) */
+static int sparkplug_will_mqtt(void* ctx, const char* topic, const void* payload, int len){
+    return mqtt_set_will((mqtt_runtime_t*)ctx, topic, payload, len, 0, false);
+}
+
+static int sparkplug_will_multi(void* ctx, const char* topic, const void* payload, int len){
+    return mqtt_multi_set_will((mqtt_multi_t*)ctx, topic, payload, len, 0, false);
+}
+
+/* (Re)connexion (loop thread mosquitto) : NBIRTH/DBIRTH sans attendre une donnée */
+static void sparkplug_on_mqtt_state(void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (((mqtt_runtime_t*)rt->dest_ctx)->connected)
+        (void)sparkplug_sink_session((sparkplug_sink_t*)rt->sink_ctx);
+}
+
+static void sparkplug_on_multi_session(void* user){
+    (void)sparkplug_sink_session((sparkplug_sink_t*)user);
+}
+
+/* NCMD reçu (user = sparkplug_sink_t*) : Node Control/Rebirth */
+static void sparkplug_on_mqtt_cmd(const char* topic, const void* payload, int len, void* user){
+    (void)sparkplug_sink_command((sparkplug_sink_t*)user, topic, payload, len);
+}
+
 /* Fill every field of gw_bridge_runtime_t here. Do NOT start anything. */
 int prepare_bridge_runtime_t(const config_t* cfg,
                              const char* topic_prefix,
@@ -66,6 +171,10 @@ int prepare_bridge_runtime_t(const config_t* cfg,
         return -1;
     }
 
+    // Bridge entry (mapping, ...) — optional
+    rt->cfg = config_find_bridge(cfg, bridge_id);
+    rt->realtime = &cfg->gateway.realtime;
+
     // Copy identifiers (safe)
     if (bridge_id && bridge_id[0])
         strncpy(rt->id, bridge_id, sizeof(rt->id)-1);
@@ -76,13 +185,111 @@ int prepare_bridge_runtime_t(const config_t* cfg,
     // Allocate/assign DEST runtime + default sender
     switch (rt->to->kind) {
     case KIND_MQTT: {
-        mqtt_runtime_t* mqtt = (mqtt_runtime_t*)calloc(1, sizeof(*mqtt));
-        if (!mqtt) return -1;
-        rt->dest_ctx = mqtt;
+        gw_send_fn mqtt_send = mqtt_send_adapter;
+        const volatile unsigned* session_gen = NULL;
+        if (rt->to->u.mqtt.params.brokers_count > 0) {
+            mqtt_multi_t* multi = (mqtt_multi_t*)calloc(1, sizeof(*multi));
+            if (!multi) return -1;
+            if (mqtt_multi_init(multi, &rt->to->u.mqtt) != 0) { free(multi); return -1; }
+            rt->dest_ctx = multi;
+            mqtt_send    = mqtt_multi_send_adapter;
+            session_gen  = &multi->connect_gen;
+        } else {
+            mqtt_runtime_t* mqtt = (mqtt_runtime_t*)calloc(1, sizeof(*mqtt));
+            if (!mqtt) return -1;
+            rt->dest_ctx = mqtt;
+            session_gen  = &mqtt->connect_gen;
+        }
 
         // Default sender for MQTT
-        rt->send_fn  = mqtt_send_adapter;
-        rt->send_ctx = mqtt;
+        rt->send_fn  = mqtt_send;
+        rt->send_ctx = rt->dest_ctx;
+
+        // mapping.format: sparkplug => encodeur intercalé devant le sender MQTT
+        if (rt->cfg && rt->cfg->mapping.format == MAP_FMT_SPARKPLUG) {
+            const bridge_sparkplug_t* sp = &rt->cfg->mapping.sparkplug;
+            sparkplug_sink_t* sink = (sparkplug_sink_t*)calloc(1, sizeof(*sink));
+            if (!sink) return -1;
+            if (sparkplug_sink_init(sink,
+                                    sp->group_id,
+                                    sp->edge_node_id ? sp->edge_node_id : cfg->gateway.name,
+                                    sp->device_id ? sp->device_id : rt->from->name,
+                                    rt->cfg->mapping.fields_count ? rt->cfg->mapping.fields[0] : NULL,
+                                    mqtt_send, rt->dest_ctx, session_gen) != 0) {
+                free(sink);
+                return -1;
+            }
+            sparkplug_sink_set_will_fn(sink,
+                rt->to->u.mqtt.params.brokers_count > 0 ? sparkplug_will_multi : sparkplug_will_mqtt,
+                rt->dest_ctx);
+
+            // NCMD souscrit et NBIRTH publié à chaque (re)connexion
+            char ncmd[256];
+            sparkplug_sink_ncmd_topic(sink, ncmd, sizeof(ncmd));
+            if (rt->to->u.mqtt.params.brokers_count > 0) {
+                mqtt_multi_t* multi = (mqtt_multi_t*)rt->dest_ctx;
+                (void)mqtt_multi_add_subscription(multi, ncmd, 1);
+                multi->on_session   = sparkplug_on_multi_session;
+                multi->session_user = sink;
+            } else {
+                mqtt_runtime_t* mqtt = (mqtt_runtime_t*)rt->dest_ctx;
+                (void)mqtt_add_subscription(mqtt, ncmd, 1);
+                mqtt->on_state   = sparkplug_on_mqtt_state;
+                mqtt->state_user = rt;
+            }
+            rt->sink_ctx = sink;
+            rt->send_fn  = sparkplug_send_adapter;
+            rt->send_ctx = sink;
+        }
+
+        // batch: enveloppe multi-échantillons (N ms / M octets) devant le sender
+        if (rt->cfg && rt->cfg->batch.present) {
+            if (rt->sink_ctx) {
+                log_warn("[%s] batch ignored with sparkplug format", rt->id[0] ? rt->id : "bridge");
+            } else {
+                batch_sink_t* batch = (batch_sink_t*)calloc(1, sizeof(*batch));
+                if (!batch) return -1;
+                if (batch_sink_init(batch, &rt->cfg->batch, rt->topic_prefix, rt->send_fn, rt->send_ctx) != 0) {
+                    free(batch);
+                    return -1;
+                }
+                rt->batch_ctx = batch;
+                rt->send_fn   = batch_send_adapter;
+                rt->send_ctx  = batch;
+            }
+        }
+        break;
+    }
+    case KIND_UART: {
+        uart_port_t* port = (uart_port_t*)calloc(1, sizeof(*port));
+        if (!port) return -1;
+        port->fd = port->efd = -1;          // gw_bridge_stop sans open : rien à fermer
+        rt->dest_ctx = port;
+        rt->send_fn  = uart_send_adapter;   // file d'écriture non bloquante
+        rt->send_ctx = port;
+        break;
+    }
+    case KIND_MODBUS_SERVER: {
+        // Serveur partagé par bind : les maîtres alimentent l'image des registres
+        modbus_server_t* srv = modbus_server_attach(&rt->to->u.modbus_server.params, rt->realtime);
+        if (!srv) return -1;
+        rt->dest_ctx = srv;
+        rt->send_fn  = modbus_server_send_adapter;
+        rt->send_ctx = srv;
+        break;
+    }
+    case KIND_MODBUS_RTU:
+    case KIND_MODBUS_TCP: {
+        // Commandes -> écritures, via le maître du bridge qui scrute ce connecteur
+        const void* target = rt->to->kind == KIND_MODBUS_RTU
+            ? (const void*)&rt->to->u.modbus_rtu.params
+            : (const void*)&rt->to->u.modbus_tcp.params;
+        modbus_writer_t* w = (modbus_writer_t*)calloc(1, sizeof(*w));
+        if (!w) return -1;
+        if (modbus_writer_init(w, target, on_modbus_write_done, rt) != 0) { free(w); return -1; }
+        rt->dest_ctx = w;
+        rt->send_fn  = modbus_write_send_adapter;
+        rt->send_ctx = w;
         break;
     }
     case KIND_HTTP_SERVER:
@@ -92,18 +299,64 @@ int prepare_bridge_runtime_t(const config_t* cfg,
         break;
     }
 
-    // Allocate/assign SOURCE runtime
+    /* Allocate/assign SOURCE runtime. Descripteurs à -1 dès l'allocation :
+     * un bridge dont le démarrage échoue est arrêté (gw_bridge_stop) sans
+     * que sa source ait été ouverte, *_close ne doit pas fermer le fd 0. */
     switch (rt->from->kind) {
     case KIND_SPI: {
         spi_runtime_t* spi = (spi_runtime_t*)calloc(1, sizeof(*spi));
         if (!spi) return -1;
+        spi->fd = -1;
         rt->source_ctx = spi;
         break;
     }
-    case KIND_MODBUS_RTU:
-    case KIND_MODBUS_TCP:
-    case KIND_UART:
-    case KIND_I2C:
+    case KIND_UART: {
+        uart_port_t* port = (uart_port_t*)calloc(1, sizeof(*port));
+        if (!port) return -1;
+        port->fd = port->efd = -1;
+        rt->source_ctx = port;
+        break;
+    }
+    case KIND_MQTT: {
+        mqtt_runtime_t* sub = (mqtt_runtime_t*)calloc(1, sizeof(*sub));
+        if (!sub) return -1;
+        rt->source_ctx = sub;
+        break;
+    }
+    case KIND_MODBUS_RTU: {
+        modbus_rtu_t* mb = (modbus_rtu_t*)calloc(1, sizeof(*mb));
+        if (!mb) return -1;
+        mb->fd = -1;
+        rt->source_ctx = mb;
+        break;
+    }
+    case KIND_MODBUS_TCP: {
+        modbus_tcp_t* mb = (modbus_tcp_t*)calloc(1, sizeof(*mb));
+        if (!mb) return -1;
+        mb->fd = mb->efd = -1;
+        rt->source_ctx = mb;
+        break;
+    }
+    case KIND_I2C: {
+        i2c_runtime_t* i2c = (i2c_runtime_t*)calloc(1, sizeof(*i2c));
+        if (!i2c) return -1;
+        i2c->fd = -1;
+        rt->source_ctx = i2c;
+        break;
+    }
+    case KIND_SOCKETCAN: {
+        can_runtime_t* can = (can_runtime_t*)calloc(1, sizeof(*can));
+        if (!can) return -1;
+        can->fd = can->efd = -1;
+        rt->source_ctx = can;
+        break;
+    }
+    case KIND_ONEWIRE: {
+        ow_runtime_t* ow = (ow_runtime_t*)calloc(1, sizeof(*ow));
+        if (!ow) return -1;
+        rt->source_ctx = ow;
+        break;
+    }
     default:
         // leave source_ctx as-is (unsupported will be caught in start)
         break;
@@ -117,6 +370,17 @@ int prepare_bridge_runtime_t(const config_t* cfg,
         rt->transform      = spi_to_mqtt_default; // <-- this wires it
         rt->transform_user = rt;                  // so the transform can read topic_prefix, etc.
     }
+    if (!rt->transform && rt->from->kind == KIND_UART && rt->to->kind == KIND_MQTT) {
+        rt->transform      = uart_to_mqtt_default;
+        rt->transform_user = rt;
+    }
+    if (!rt->transform && (rt->from->kind == KIND_MODBUS_RTU || rt->from->kind == KIND_MODBUS_TCP ||
+                           rt->from->kind == KIND_I2C || rt->from->kind == KIND_SOCKETCAN ||
+                           rt->from->kind == KIND_ONEWIRE) &&
+        rt->to->kind == KIND_MQTT) {
+        rt->transform      = modbus_to_mqtt_default;
+        rt->transform_user = rt;
+    }
 
     /* Pas de transform par défaut pour SPI:
      * - Soit tu laisses brut (topic "<prefix>/spi/<op>")
@@ -139,17 +403,55 @@ int gw_bridge_start(gw_bridge_runtime_t* rt)
                     rt->id[0] ? rt->id : "bridge");
             return -1;
         }
-        int rc = mqtt_connect_from_config(&rt->to->u.mqtt,
-                                          (mqtt_runtime_t*)rt->dest_ctx,
-                                          /*on_mqtt_msg*/NULL, /*user*/NULL);
+        const bool multi = rt->to->u.mqtt.params.brokers_count > 0;
+        if (rt->sink_ctx && rt->cfg && rt->cfg->mapping.format == MAP_FMT_SPARKPLUG) {
+            // NDEATH (bdSeq) comme will : publié par le broker si on disparaît
+            char topic[256]; uint8_t buf[256]; size_t len = 0;
+            if (sparkplug_encode_ndeath((sparkplug_sink_t*)rt->sink_ctx, topic, sizeof(topic),
+                                        buf, sizeof(buf), &len) == 0) {
+                if (multi) (void)mqtt_multi_set_will((mqtt_multi_t*)rt->dest_ctx, topic, buf, (int)len, 0, false);
+                else       (void)mqtt_set_will((mqtt_runtime_t*)rt->dest_ctx, topic, buf, (int)len, 0, false);
+            }
+        }
+        // Sparkplug : messages reçus = NCMD (rebirth)
+        mqtt_msg_cb on_msg = rt->sink_ctx ? sparkplug_on_mqtt_cmd : NULL;
+        int rc = multi
+            ? mqtt_multi_connect((mqtt_multi_t*)rt->dest_ctx, on_msg, rt->sink_ctx)
+            : mqtt_connect_from_config(&rt->to->u.mqtt,
+                                       (mqtt_runtime_t*)rt->dest_ctx,
+                                       on_msg, rt->sink_ctx);
         if (rc != 0) {
             fprintf(stderr, "[%s] mqtt connect failed\n", rt->id[0] ? rt->id : "bridge");
             return -1;
         }
-
     
         break;
     }
+    case KIND_UART: {
+        int rc = rt->dest_ctx
+            ? uart_port_open((uart_port_t*)rt->dest_ctx, &rt->to->u.uart.params, NULL, NULL, NULL)
+            : -1;
+        if (rc != 0) {
+            fprintf(stderr, "[%s] uart open failed (%d)\n", rt->id[0] ? rt->id : "bridge", rc);
+            return -1;
+        }
+        break;
+    }
+    case KIND_MODBUS_SERVER: {
+        // seules les sources Modbus recopient leurs blocs dans l'image
+        if (!rt->dest_ctx ||
+            (rt->from->kind != KIND_MODBUS_RTU && rt->from->kind != KIND_MODBUS_TCP)) {
+            fprintf(stderr, "[%s] modbus-tcp-server needs a modbus-rtu/modbus-tcp source\n",
+                    rt->id[0] ? rt->id : "bridge");
+            return -2;
+        }
+        break;
+    }
+    case KIND_MODBUS_RTU:
+    case KIND_MODBUS_TCP:
+        // rien à ouvrir : le maître appartient au bridge qui scrute ce connecteur
+        if (!rt->dest_ctx) return -1;
+        break;
     case KIND_HTTP_SERVER:
     case KIND_COAP:
 
@@ -175,23 +477,112 @@ int gw_bridge_start(gw_bridge_runtime_t* rt)
             fprintf(stderr, "[%s] spi open failed\n", rt->id[0] ? rt->id : "bridge");
             return -1;
         }
+        ((spi_runtime_t*)rt->source_ctx)->realtime = rt->realtime;
+
         // One initial pass (optional)
         (void)spi_run_transactions((spi_runtime_t*)rt->source_ctx);
 
-        // Start periodic polling (1000 ms or read from config if you added poll_ms)
-        rc = spi_start_polling((spi_runtime_t*)rt->source_ctx, /*poll_ms=*/1000);
+        // Start periodic polling (params.poll_ms / transactions[].period_ms, défaut 1000 ms)
+        rc = spi_start_polling((spi_runtime_t*)rt->source_ctx, /*poll_ms: config*/0);
         if (rc != 0) { fprintf(stderr, "[%s] spi_start_polling failed\n",
                                 rt->id[0] ? rt->id : "bridge"); return -1; }
 
-        //printf("[bridge:%s] SPI(%s) → %s(%s) [prefix=%s] [poll=1000ms]\n", "");
         return 0;
     }
 
-    case KIND_MODBUS_RTU:
-    case KIND_MODBUS_TCP:
-    case KIND_UART:
-    case KIND_I2C:
+    case KIND_UART: {
+        if (!rt->source_ctx) return -1;
+        // Thread I/O du port : read() non bloquants, toutes les trames d'un réveil
+        int rc = uart_port_open((uart_port_t*)rt->source_ctx, &rt->from->u.uart.params,
+                                rt->realtime, on_uart_rx, rt);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] uart open failed (%d)\n", rt->id[0] ? rt->id : "bridge", rc);
+            return -1;
+        }
+        return 0;
+    }
+
+    case KIND_MQTT: {
+        if (!rt->source_ctx) return -1;
+        int rc = mqtt_connect_from_config(&rt->from->u.mqtt, (mqtt_runtime_t*)rt->source_ctx,
+                                          on_mqtt_rx, rt);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] mqtt (source) connect failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
+
+    case KIND_MODBUS_RTU: {
+        if (!rt->source_ctx) return -1;
+        // Thread de scrutation du bus : requêtes coalescées, t3.5 entre trames
+        // destination modbus-tcp-server : les blocs lus alimentent son image
+        modbus_image_t* img = rt->to->kind == KIND_MODBUS_SERVER
+            ? modbus_server_image((modbus_server_t*)rt->dest_ctx) : NULL;
+        int rc = modbus_rtu_open((modbus_rtu_t*)rt->source_ctx, &rt->from->u.modbus_rtu.params,
+                                 rt->realtime, on_modbus_data, rt, img, rt->from->name);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] modbus-rtu open failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
+
+    case KIND_MODBUS_TCP: {
+        if (!rt->source_ctx) return -1;
+        // Requêtes pipelinées (identifiants MBAP), reconnexion gérée par le thread
+        modbus_image_t* img = rt->to->kind == KIND_MODBUS_SERVER
+            ? modbus_server_image((modbus_server_t*)rt->dest_ctx) : NULL;
+        int rc = modbus_tcp_open((modbus_tcp_t*)rt->source_ctx, &rt->from->u.modbus_tcp.params,
+                                 rt->realtime, on_modbus_data, rt, img, rt->from->name);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] modbus-tcp open failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
+
+    case KIND_I2C: {
+        if (!rt->source_ctx) return -1;
+        // Blocs de registres de tous les devices échus : un ioctl(I2C_RDWR) par cycle
+        int rc = i2c_open((i2c_runtime_t*)rt->source_ctx, &rt->from->u.i2c.params,
+                          rt->realtime, on_i2c_data, rt);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] i2c open failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
 
+    case KIND_SOCKETCAN: {
+        if (!rt->source_ctx) return -1;
+        // CAN_RAW filtré par le noyau, lots recvmmsg horodatés (SO_TIMESTAMP),
+        // signaux décodés par message si messages[], PDU ISO-TP/J1939 complets
+        int rc = can_open((can_runtime_t*)rt->source_ctx, &rt->from->u.socketcan.params,
+                          rt->realtime, on_can_rx, on_can_data, on_can_pdu, rt);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] socketcan open failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
+
+    case KIND_ONEWIRE: {
+        if (!rt->source_ctx) return -1;
+        if (rt->from->u.onewire.params.backend != ONEWIRE_SYSFS) {
+            fprintf(stderr, "[%s] onewire: only the sysfs backend is supported\n",
+                    rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        // Conversion simultanée (therm_bulk_read) puis lectures parallèles
+        int rc = ow_open((ow_runtime_t*)rt->source_ctx, &rt->from->u.onewire.params.u.sysfs,
+                         rt->realtime, on_onewire_data, rt);
+        if (rc != 0) {
+            fprintf(stderr, "[%s] onewire open failed\n", rt->id[0] ? rt->id : "bridge");
+            return -1;
+        }
+        return 0;
+    }
 
     default:
         fprintf(stderr, "[%s] source kind=%d not supported yet\n",
@@ -204,6 +595,10 @@ int gw_bridge_stop(gw_bridge_runtime_t* rt)
 {
     if (!rt) return -1;
 
+    // Écritures Modbus : confirmations en cours publiées avant l'arrêt de la source
+    if (rt->to && (rt->to->kind == KIND_MODBUS_RTU || rt->to->kind == KIND_MODBUS_TCP) && rt->dest_ctx)
+        modbus_writer_close((modbus_writer_t*)rt->dest_ctx);
+
     // Stop source
     if (rt->from) {
         switch (rt->from->kind) {
@@ -215,6 +610,55 @@ int gw_bridge_stop(gw_bridge_runtime_t* rt)
                 rt->source_ctx = NULL;
             }
             break;
+        case KIND_UART:
+            if (rt->source_ctx) {
+                uart_port_close((uart_port_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_MQTT:
+            if (rt->source_ctx) {
+                mqtt_close((mqtt_runtime_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_MODBUS_RTU:
+            if (rt->source_ctx) {
+                modbus_rtu_close((modbus_rtu_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_MODBUS_TCP:
+            if (rt->source_ctx) {
+                modbus_tcp_close((modbus_tcp_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_I2C:
+            if (rt->source_ctx) {
+                i2c_close((i2c_runtime_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_SOCKETCAN:
+            if (rt->source_ctx) {
+                can_close((can_runtime_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
+        case KIND_ONEWIRE:
+            if (rt->source_ctx) {
+                ow_close((ow_runtime_t*)rt->source_ctx);
+                free(rt->source_ctx);
+                rt->source_ctx = NULL;
+            }
+            break;
         default: break;
         }
     }
@@ -223,15 +667,123 @@ int gw_bridge_stop(gw_bridge_runtime_t* rt)
     if (rt->to) {
         switch (rt->to->kind) {
         case KIND_MQTT:
-            if (rt->dest_ctx) {
+            if (rt->batch_ctx) {
+                batch_sink_shutdown((batch_sink_t*)rt->batch_ctx);   // flush final
+                free(rt->batch_ctx);
+                rt->batch_ctx = NULL;
+            }
+            if (rt->sink_ctx)
+                sparkplug_sink_shutdown((sparkplug_sink_t*)rt->sink_ctx);   // DDEATH + NDEATH
+            if (rt->dest_ctx && rt->to->u.mqtt.params.brokers_count > 0) {
+                mqtt_multi_close((mqtt_multi_t*)rt->dest_ctx);
+                free(rt->dest_ctx);
+                rt->dest_ctx = NULL;
+            } else if (rt->dest_ctx) {
                 mqtt_close((mqtt_runtime_t*)rt->dest_ctx);
                 free(rt->dest_ctx);
                 rt->dest_ctx = NULL;
             }
+            if (rt->sink_ctx) {
+                // après l'arrêt des loop threads : plus de callback vers le sink
+                sparkplug_sink_free((sparkplug_sink_t*)rt->sink_ctx);
+                free(rt->sink_ctx);
+                rt->sink_ctx = NULL;
+            }
+            break;
+        case KIND_UART:
+            if (rt->dest_ctx) {
+                uart_port_close((uart_port_t*)rt->dest_ctx);   // vide la file au mieux
+                free(rt->dest_ctx);
+                rt->dest_ctx = NULL;
+            }
+            break;
+        case KIND_MODBUS_SERVER:
+            modbus_server_detach((modbus_server_t*)rt->dest_ctx);
+            rt->dest_ctx = NULL;
+            break;
+        case KIND_MODBUS_RTU:
+        case KIND_MODBUS_TCP:
+            free(rt->dest_ctx);                 // writer fermé en tête de gw_bridge_stop
+            rt->dest_ctx = NULL;
             break;
         default: break;
         }
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/* Débits de scrutation RTU (configuré / atteint) publiés à chaque rapport sur
+ * "<prefix>/<unit>/poll_rate", par le sender MQTT de base : ni Sparkplug ni
+ * batch, ce ne sont pas des données du slave. */
+static void publish_rtu_rates(gw_bridge_runtime_t* rt)
+{
+    if (!rt->to || rt->to->kind != KIND_MQTT) return;
+    gw_send_fn send = rt->to->u.mqtt.params.brokers_count > 0 ? mqtt_multi_send_adapter
+                                                               : mqtt_send_adapter;
+    modbus_rtu_t* m = (modbus_rtu_t*)rt->source_ctx;
+    modbus_rtu_rate_t* rates = (modbus_rtu_rate_t*)calloc(m->nslaves ? m->nslaves : 1, sizeof(*rates));
+    if (!rates) return;
+    size_t n = modbus_rtu_get_rates(m, rates, m->nslaves);
+    for (size_t i = 0; i < n; ++i) {
+        char topic[160], json[128];
+        snprintf(topic, sizeof(topic), "%s/%u/poll_rate",
+                 rt->topic_prefix[0] ? rt->topic_prefix : "ingest", (unsigned)rates[i].unit);
+        int jl = snprintf(json, sizeof(json),
+                          "{\"configured_hz\":%.3f,\"achieved_hz\":%.3f,\"offline\":%s}",
+                          rates[i].configured_hz, rates[i].achieved_hz,
+                          rates[i].offline ? "true" : "false");
+        gw_msg_t msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.protocole = KIND_MQTT;
+        msg.pl.topic = topic;
+        msg.pl.data = (const uint8_t*)json;
+        msg.pl.len = (size_t)jl;
+        msg.pl.is_text = 1;
+        msg.pl.content_type = "application/json";
+        (void)send(&msg, rt->dest_ctx);
+    }
+    free(rates);
+}
+
+void gw_bridge_report(gw_bridge_runtime_t* rt)
+{
+    if (!rt || !rt->to || !rt->dest_ctx) return;
+    const char* tag = rt->id[0] ? rt->id : "bridge";
+
+    if (rt->from && rt->from->kind == KIND_SPI && rt->source_ctx)
+        spi_log_stats((spi_runtime_t*)rt->source_ctx, tag);
+    if (rt->from && rt->from->kind == KIND_UART && rt->source_ctx)
+        uart_port_log_stats((uart_port_t*)rt->source_ctx, tag);
+    if (rt->from && rt->from->kind == KIND_MODBUS_RTU && rt->source_ctx) {
+        modbus_rtu_log_stats((modbus_rtu_t*)rt->source_ctx, tag);
+        publish_rtu_rates(rt);
+    }
+    if (rt->from && rt->from->kind == KIND_MODBUS_TCP && rt->source_ctx)
+        modbus_tcp_log_stats((modbus_tcp_t*)rt->source_ctx, tag);
+    if (rt->from && rt->from->kind == KIND_I2C && rt->source_ctx)
+        i2c_log_stats((i2c_runtime_t*)rt->source_ctx, tag);
+    if (rt->from && rt->from->kind == KIND_SOCKETCAN && rt->source_ctx)
+        can_log_stats((can_runtime_t*)rt->source_ctx, tag);
+    if (rt->from && rt->from->kind == KIND_ONEWIRE && rt->source_ctx)
+        ow_log_stats((ow_runtime_t*)rt->source_ctx, tag);
+    if (rt->to->kind == KIND_UART)
+        uart_port_log_stats((uart_port_t*)rt->dest_ctx, tag);
+    if (rt->to->kind == KIND_MODBUS_SERVER)
+        modbus_server_log_stats((modbus_server_t*)rt->dest_ctx, tag);
+    if (rt->to->kind == KIND_MODBUS_RTU || rt->to->kind == KIND_MODBUS_TCP)
+        modbus_writer_log_stats((modbus_writer_t*)rt->dest_ctx, tag);
+
+    if (rt->to->kind == KIND_MQTT) {
+        if (rt->to->u.mqtt.params.brokers_count > 0) {
+            mqtt_multi_report((mqtt_multi_t*)rt->dest_ctx, tag);
+        } else {
+            mqtt_runtime_t* m = (mqtt_runtime_t*)rt->dest_ctx;
+            mqtt_broker_stats_t st;
+            mqtt_get_stats(m, &st);
+            log_info("[%s] mqtt %s conn=%lu disc=%lu pub=%lu fail=%lu ack_ms avg=%.1f max=%.1f",
+                     tag, m->connected ? "UP" : "DOWN", st.connects, st.disconnects,
+                     st.pub_ok, st.pub_fail, st.ack_ms_ewma, st.ack_ms_max);
+        }
+    }
+}
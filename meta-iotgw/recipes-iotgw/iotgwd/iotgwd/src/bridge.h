@@ -30,6 +30,8 @@ typedef struct {
     char id[128];
     const connector_any_t* from;   // source connector (config)
     const connector_any_t* to;     // destination connector (config)
+    const bridge_t*        cfg;    // entrée "bridges:" (mapping, ...), peut être NULL
+    const gateway_realtime_t* realtime; // gateway.realtime (threads d'acquisition)
 
     char topic_prefix[128];
 
@@ -43,6 +45,10 @@ typedef struct {
 
     gw_send_fn      send_fn;       // e.g. mqtt_send_adapter
     void*           send_ctx;      // usually == dest_ctx
+
+    // Encodage de sortie optionnel intercalé devant send_fn (ex: Sparkplug B)
+    void*           sink_ctx;      // e.g. sparkplug_sink_t*
+    void*           batch_ctx;     // batch_sink_t* si "batch:" (devant send_fn)
 } gw_bridge_runtime_t;
 
 /**
@@ -67,6 +73,11 @@ int gw_bridge_start(gw_bridge_runtime_t* out);
 int gw_bridge_stop(gw_bridge_runtime_t* b);
 
 
+/**
+ * @brief Journalise l'état du bridge (santé/latence MQTT par broker, ...).
+ *        Appelé périodiquement par la boucle de service.
+ */
+void gw_bridge_report(gw_bridge_runtime_t* b);
 
 /* Prepare runtime from config: resolve connectors, fill ids/prefix, pick defaults.
  * protocol_src / protocol_dst are CONNECTOR NAMES from YAML (e.g. "http1", "mqtt1"). */
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <string.h>
+#include "buf_pool.h"
+
+int buf_pool_init(buf_pool_t* p, size_t block_size, size_t blocks)
+{
+    if (!p || block_size == 0 || blocks == 0) return -1;
+    memset(p, 0, sizeof(*p));
+
+    p->arena = (uint8_t*)malloc(block_size * blocks);
+    p->free_list = (uint8_t**)calloc(blocks, sizeof(uint8_t*));
+    if (!p->arena || !p->free_list) {
+        free(p->arena); free(p->free_list);
+        memset(p, 0, sizeof(*p));
+        return -1;
+    }
+    for (size_t i = 0; i < blocks; ++i)
+        p->free_list[i] = p->arena + i * block_size;
+    p->free_count = blocks;
+    p->block_size = block_size;
+    p->blocks     = blocks;
+    pthread_mutex_init(&p->mu, NULL);
+    return 0;
+}
+
+void buf_pool_destroy(buf_pool_t* p)
+{
+    if (!p || !p->arena) return;
+    pthread_mutex_destroy(&p->mu);
+    free(p->free_list);
+    free(p->arena);
+    memset(p, 0, sizeof(*p));
+}
+
+static int in_arena(const buf_pool_t* p, const uint8_t* b)
+{
+    return b >= p->arena && b < p->arena + p->block_size * p->blocks;
+}
+
+uint8_t* buf_pool_get(buf_pool_t* p)
+{
+    if (!p || !p->arena) return NULL;
+    pthread_mutex_lock(&p->mu);
+    uint8_t* b = p->free_count ? p->free_list[--p->free_count] : NULL;
+    if (!b) p->misses++;
+    pthread_mutex_unlock(&p->mu);
+    return b ? b : (uint8_t*)malloc(p->block_size);
+}
+
+void buf_pool_put(buf_pool_t* p, uint8_t* b)
+{
+    if (!p || !b) return;
+    if (!in_arena(p, b)) { free(b); return; }
+    pthread_mutex_lock(&p->mu);
+    p->free_list[p->free_count++] = b;
+    pthread_mutex_unlock(&p->mu);
+}
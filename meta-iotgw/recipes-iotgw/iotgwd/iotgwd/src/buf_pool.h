@@ -0,0 +1,38 @@
+#pragma once
+/**
+ * @file buf_pool.h
+ * @brief Pool de buffers de taille fixe (pré-alloués) pour les encodeurs.
+ *
+ * Les blocs viennent d'une arène allouée une seule fois ; quand le pool est
+ * vide, buf_pool_get() retombe sur malloc() (compté dans `misses`) et
+ * buf_pool_put() libère ces blocs hors-arène.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    pthread_mutex_t mu;
+    uint8_t*  arena;        // blocks * block_size octets
+    uint8_t** free_list;    // pile des blocs libres
+    size_t    free_count;
+    size_t    block_size;
+    size_t    blocks;
+    unsigned long misses;   // allocations hors arène (pool épuisé)
+} buf_pool_t;
+
+/* Retour 0 = OK, -1 = erreur d'allocation. */
+int      buf_pool_init(buf_pool_t* p, size_t block_size, size_t blocks);
+void     buf_pool_destroy(buf_pool_t* p);
+
+/* Renvoie un bloc de p->block_size octets (NULL si plus de mémoire). */
+uint8_t* buf_pool_get(buf_pool_t* p);
+void     buf_pool_put(buf_pool_t* p, uint8_t* b);
+
+#ifdef __cplusplus
+}
+#endif
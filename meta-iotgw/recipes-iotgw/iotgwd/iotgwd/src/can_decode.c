@@ -0,0 +1,315 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <endian.h>
+#include "can_decode.h"
+#include "log.h"
+
+enum {
+    CAN_OP_BE     = 1u << 0,        // Motorola : msb en premier
+    CAN_OP_SIGNED = 1u << 1,
+    CAN_OP_SLOW   = 1u << 2,        // hors fenêtre de 8 octets
+    CAN_OP_SCALED = 1u << 3,        // factor/offset => F64
+};
+
+#define CAN_DATA_MAX 64             // canfd_frame.data
+
+static uint32_t eff_hash(uint32_t key){ return key * 0x9E3779B1u; }
+
+/* Signal -> opération. DBC : en little_endian, start = lsb, bits numérotés
+ * octet * 8 + bit ; en big_endian, start = msb du signal (même numérotation),
+ * les bits suivants descendent dans l'octet puis passent au msb de l'octet
+ * suivant, soit une position séquentielle p = octet * 8 + (7 - bit). */
+static int compile_signal(const socketcan_signal_t* s, can_sig_op_t* op, uint8_t* need){
+    memset(op, 0, sizeof(*op));
+    unsigned len = s->length, first, last_byte;
+    op->len = (uint8_t)len;
+    op->start = s->start;
+    op->mask = len >= 64 ? ~0ull : ((1ull << len) - 1);
+    op->factor = s->factor;
+    op->offset = s->offset;
+    if (s->is_signed) op->flags |= CAN_OP_SIGNED;
+    if (s->factor != 1.0 || s->offset != 0.0) op->flags |= CAN_OP_SCALED;
+
+    if (s->byte_order == CAN_SIG_BIG_ENDIAN) {
+        op->flags |= CAN_OP_BE;
+        first = (s->start / 8u) * 8u + (7u - s->start % 8u);    // position séquentielle du msb
+        if (first + len > CAN_DATA_MAX * 8) return -1;
+        unsigned base = first / 8u > CAN_DATA_MAX - 8 ? CAN_DATA_MAX - 8 : first / 8u;
+        unsigned rel = first - base * 8u;
+        if (rel + len > 64) op->flags |= CAN_OP_SLOW;
+        else op->shift = (uint8_t)(64u - rel - len);
+        op->base = (uint8_t)base;
+        last_byte = (first + len - 1) / 8u;
+    } else {
+        first = s->start;
+        if (first + len > CAN_DATA_MAX * 8) return -1;
+        unsigned base = first / 8u > CAN_DATA_MAX - 8 ? CAN_DATA_MAX - 8 : first / 8u;
+        unsigned rel = first - base * 8u;
+        if (rel + len > 64) op->flags |= CAN_OP_SLOW;
+        else op->shift = (uint8_t)rel;
+        op->base = (uint8_t)base;
+        last_byte = (first + len - 1) / 8u;
+    }
+    if (last_byte + 1 > *need) *need = (uint8_t)(last_byte + 1);
+    return 0;
+}
+
+// Chemin lent : bit par bit (signaux > 57 bits non alignés)
+static uint64_t extract_slow(const can_sig_op_t* op, const uint8_t* d){
+    uint64_t v = 0;
+    if (op->flags & CAN_OP_BE) {
+        unsigned p = (op->start / 8u) * 8u + (7u - op->start % 8u);
+        for (unsigned i = 0; i < op->len; ++i, ++p)
+            v = (v << 1) | ((d[p / 8u] >> (7u - p % 8u)) & 1u);
+    } else {
+        for (unsigned i = 0; i < op->len; ++i) {
+            unsigned b = op->start + i;
+            v |= (uint64_t)((d[b / 8u] >> (b % 8u)) & 1u) << i;
+        }
+    }
+    return v;
+}
+
+static inline uint64_t extract(const can_sig_op_t* op, const uint8_t* d){
+    uint64_t w;
+    if (__builtin_expect(op->flags & CAN_OP_SLOW, 0)) {
+        w = extract_slow(op, d);
+    } else {
+        memcpy(&w, d + op->base, sizeof(w));
+        w = (op->flags & CAN_OP_BE) ? be64toh(w) : le64toh(w);
+        w = (w >> op->shift) & op->mask;
+    }
+    if ((op->flags & CAN_OP_SIGNED) && op->len < 64 && (w >> (op->len - 1)) & 1u)
+        w |= ~op->mask;
+    return w;
+}
+
+// "nom": avec " et \ échappés (comme decode_plan_json)
+static char* make_key(const char* name){
+    size_t n = strlen(name), k = 0;
+    char* s = (char*)malloc(2 * n + 4);
+    if (!s) return NULL;
+    s[k++] = '"';
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)name[i];
+        if (c == '"' || c == '\\') s[k++] = '\\';
+        s[k++] = (c < 0x20) ? '_' : (char)c;
+    }
+    s[k++] = '"';
+    s[k++] = ':';
+    s[k] = '\0';
+    return s;
+}
+
+static int compile_message(can_msg_dec_t* m, const socketcan_message_t* c){
+    memset(m, 0, sizeof(*m));
+    m->cfg = c;
+    if (c->name) snprintf(m->label, sizeof(m->label), "%s", c->name);
+    else snprintf(m->label, sizeof(m->label), c->extended ? "%08X" : "%03X", (unsigned)c->id);
+    m->period_ns = (uint64_t)c->rate_ms * 1000000ull;
+
+    size_t n = c->signals_count;
+    m->ops = (can_sig_op_t*)calloc(n ? n : 1, sizeof(*m->ops));
+    m->raw = (uint64_t*)calloc(n ? n : 1, sizeof(*m->raw));
+    m->last = (uint64_t*)calloc(n ? n : 1, sizeof(*m->last));
+    m->metrics = (gw_metric_t*)calloc(n ? n : 1, sizeof(*m->metrics));
+    m->keys = (char**)calloc(n ? n : 1, sizeof(*m->keys));
+    if (!m->ops || !m->raw || !m->last || !m->metrics || !m->keys) return -1;
+
+    size_t cap = 3;
+    for (size_t i = 0; i < n; ++i) {
+        const socketcan_signal_t* s = &c->signals[i];
+        if (compile_signal(s, &m->ops[m->nops], &m->need) != 0) {
+            log_warn("socketcan message %s: signal %s beyond 64 bytes, ignored", m->label, s->name);
+            continue;
+        }
+        m->keys[m->nops] = make_key(s->name);
+        if (!m->keys[m->nops]) return -1;
+        m->metrics[m->nops].name = s->name;
+        cap += strlen(m->keys[m->nops]) + 32;   // valeur %.9g / %lld + ','
+        m->nops++;
+    }
+    m->json = (char*)malloc(cap);
+    if (!m->json) return -1;
+    m->json_cap = cap;
+    return 0;
+}
+
+static void free_message(can_msg_dec_t* m){
+    for (size_t i = 0; i < m->nops; ++i) free(m->keys[i]);
+    free(m->keys);
+    free(m->ops); free(m->raw); free(m->last); free(m->metrics); free(m->json);
+}
+
+static int eff_insert(can_decoder_t* d, uint32_t key, uint16_t idx){
+    for (uint32_t h = eff_hash(key) & d->eff_mask;; h = (h + 1) & d->eff_mask) {
+        if (d->eff_keys[h] == key) return -1;           // doublon
+        if (!d->eff_keys[h]) { d->eff_keys[h] = key; d->eff_idx[h] = idx; return 0; }
+    }
+}
+
+static inline can_msg_dec_t* lookup(can_decoder_t* d, canid_t id){
+    if (!(id & CAN_EFF_FLAG)) {
+        uint16_t i = d->sff[id & CAN_SFF_MASK];
+        return i ? &d->msgs[i - 1] : NULL;
+    }
+    if (!d->eff_keys) return NULL;
+    uint32_t key = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    for (uint32_t h = eff_hash(key) & d->eff_mask;; h = (h + 1) & d->eff_mask) {
+        if (d->eff_keys[h] == key) return &d->msgs[d->eff_idx[h]];
+        if (!d->eff_keys[h]) return NULL;
+    }
+}
+
+int can_decoder_init(can_decoder_t* d, const socketcan_params_t* cfg){
+    if (!d || !cfg) return -1;
+    memset(d, 0, sizeof(*d));
+    size_t n = cfg->messages_count;
+    if (!n) return 0;
+    if (n > UINT16_MAX - 1) n = UINT16_MAX - 1;
+
+    size_t neff = 0;
+    for (size_t i = 0; i < n; ++i) neff += cfg->messages[i].extended;
+    if (neff) {
+        uint32_t cap = 16;
+        while (cap < 2 * neff) cap <<= 1;               // charge <= 1/2
+        d->eff_keys = (uint32_t*)calloc(cap, sizeof(*d->eff_keys));
+        d->eff_idx = (uint16_t*)calloc(cap, sizeof(*d->eff_idx));
+        if (!d->eff_keys || !d->eff_idx) goto fail;
+        d->eff_mask = cap - 1;
+    }
+
+    d->msgs = (can_msg_dec_t*)calloc(n, sizeof(*d->msgs));
+    if (!d->msgs) goto fail;
+    for (size_t i = 0; i < n; ++i) {
+        const socketcan_message_t* c = &cfg->messages[i];
+        can_msg_dec_t* m = &d->msgs[d->nmsgs];
+        if (compile_message(m, c) != 0) { d->nmsgs++; goto fail; }
+        int dup = 0;
+        if (c->extended) {
+            dup = eff_insert(d, (c->id & CAN_EFF_MASK) | CAN_EFF_FLAG, (uint16_t)d->nmsgs);
+        } else if (c->id > CAN_SFF_MASK || d->sff[c->id]) {
+            dup = -1;
+        } else {
+            d->sff[c->id] = (uint16_t)(d->nmsgs + 1);
+        }
+        if (dup) {
+            log_warn("socketcan message 0x%X: duplicate or invalid id, ignored", (unsigned)c->id);
+            free_message(m);
+            continue;
+        }
+        d->nmsgs++;
+    }
+    return 0;
+
+fail:
+    can_decoder_free(d);
+    return -1;
+}
+
+// Valeur physique d'une valeur brute
+static inline double phys(const can_sig_op_t* op, uint64_t r){
+    double v = (op->flags & CAN_OP_SIGNED) ? (double)(int64_t)r : (double)r;
+    return (op->flags & CAN_OP_SCALED) ? v * op->factor + op->offset : v;
+}
+
+// Conversion + metrics + JSON des valeurs courantes
+static size_t render(can_msg_dec_t* m){
+    char* o = m->json;
+    size_t cap = m->json_cap, k = 0;
+    o[k++] = '{';
+    for (size_t i = 0; i < m->nops; ++i) {
+        const can_sig_op_t* op = &m->ops[i];
+        gw_metric_t* mt = &m->metrics[i];
+        uint64_t r = m->raw[i];
+        if (i) o[k++] = ',';
+        size_t kl = strlen(m->keys[i]);
+        memcpy(o + k, m->keys[i], kl);
+        k += kl;
+        int w;
+        if (op->flags & CAN_OP_SCALED) {
+            double v = phys(op, r);
+            mt->type = GW_VAL_F64;
+            mt->v.f64 = v;
+            w = isfinite(v) ? snprintf(o + k, cap - k, "%.9g", v) : snprintf(o + k, cap - k, "null");
+        } else if (op->flags & CAN_OP_SIGNED) {
+            mt->type = GW_VAL_I64;
+            mt->v.i64 = (int64_t)r;
+            w = snprintf(o + k, cap - k, "%lld", (long long)(int64_t)r);
+        } else {
+            mt->type = GW_VAL_U64;
+            mt->v.u64 = r;
+            w = snprintf(o + k, cap - k, "%llu", (unsigned long long)r);
+        }
+        if (w > 0) k += (size_t)w;
+    }
+    o[k++] = '}';
+    o[k] = '\0';
+    return k;
+}
+
+int can_decoder_feed(can_decoder_t* d, const struct canfd_frame* f, double ts,
+                     can_data_cb cb, void* user){
+    if (!d || !f || (f->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) return -1;
+    can_msg_dec_t* m = lookup(d, f->can_id);
+    if (!m) { d->unknown++; return -1; }
+    m->frames++;
+    if (f->len < m->need) { m->short_frames++; return 0; }
+
+    // Fenêtres de 8 octets : data[] fait 64 octets, les octets au-delà de len
+    // sont masqués (need couvre tous les signaux)
+    bool changed = !m->seen;
+    for (size_t i = 0; i < m->nops; ++i) {
+        uint64_t v = extract(&m->ops[i], f->data);
+        changed |= v != m->last[i];
+        m->raw[i] = v;
+    }
+
+    if (m->period_ns) {
+        uint64_t t = (uint64_t)(ts * 1e9);
+        if (m->seen && t < m->next_ns) return 0;
+        m->next_ns = t + m->period_ns;
+    } else if (!changed) {
+        return 0;
+    }
+    m->seen = true;
+    memcpy(m->last, m->raw, m->nops * sizeof(*m->raw));
+    m->published++;
+    size_t jl = render(m);
+    if (cb) cb(m->label, m->metrics, m->nops, m->json, jl, ts, user);
+    return 1;
+}
+
+int can_decoder_extract(can_decoder_t* d, const struct canfd_frame* f,
+                        double* out, size_t max){
+    if (!d || !f || (f->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG))) return -1;
+    const can_msg_dec_t* m = lookup(d, f->can_id);
+    if (!m) return -1;
+    if (f->len < m->need) return 0;
+    size_t n = m->nops < max ? m->nops : max;
+    for (size_t i = 0; i < n; ++i) out[i] = phys(&m->ops[i], extract(&m->ops[i], f->data));
+    return (int)n;
+}
+
+void can_decoder_log_stats(const can_decoder_t* d, const char* tag){
+    if (!d || !d->nmsgs) return;
+    log_info("[%s] can decode: %zu message(s), %lu frame(s) with unknown id",
+             tag ? tag : "can", d->nmsgs, d->unknown);
+    for (size_t i = 0; i < d->nmsgs; ++i) {
+        const can_msg_dec_t* m = &d->msgs[i];
+        log_info("[%s]   %s: %zu signal(s), %lu frames, %lu published, %lu too short",
+                 tag ? tag : "can", m->label, m->nops, m->frames, m->published, m->short_frames);
+    }
+}
+
+void can_decoder_free(can_decoder_t* d){
+    if (!d) return;
+    for (size_t i = 0; i < d->nmsgs; ++i) free_message(&d->msgs[i]);
+    free(d->msgs);
+    free(d->eff_keys);
+    free(d->eff_idx);
+    memset(d, 0, sizeof(*d));
+}
@@ -0,0 +1,98 @@
+#pragma once
+/**
+ * @file can_decode.h
+ * @brief Décodage des signaux CAN (à la DBC) d'un connecteur socketcan.
+ *
+ * messages[] est compilé une fois à l'ouverture :
+ *   - table de dispatch dense par identifiant : 2048 entrées pour les 11 bits
+ *     (un accès indexé), table de hachage à adressage ouvert pour les 29 bits ;
+ *   - chaque signal devient une opération fixe : chargement de 8 octets à un
+ *     octet de base, décalage, masque (+ bswap en big_endian/Motorola),
+ *     extension de signe. Les signaux qui débordent d'une fenêtre de 8 octets
+ *     (longueur > 57 non alignée) passent par une boucle bit à bit.
+ *
+ * Par trame : lookup, extraction des valeurs brutes, comparaison à la
+ * dernière valeur. La conversion (factor/offset), les metrics et le JSON ne
+ * sont produits qu'à la publication : sur changement d'au moins un signal,
+ * ou, si rate_ms est posé, au plus une fois par rate_ms (dernières valeurs,
+ * cadencé par les horodatages des trames reçues).
+ *
+ * Un décodeur n'est pas thread-safe : un seul thread de réception.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <linux/can.h>
+#include "gw_msg.h"
+#include "connectors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t  base;                  // premier octet de la fenêtre de 8 octets
+    uint8_t  shift;                 // position du lsb dans la fenêtre
+    uint8_t  len;
+    uint8_t  flags;                 // CAN_OP_*
+    uint16_t start;                 // bit DBC (chemin lent)
+    uint64_t mask;
+    double   factor, offset;
+} can_sig_op_t;
+
+typedef struct {
+    const socketcan_message_t* cfg;
+    char          label[40];        // name, sinon id hexa (topic)
+    can_sig_op_t* ops;
+    size_t        nops;
+    uint8_t       need;             // octets de données requis
+    uint64_t*     raw;              // valeurs courantes
+    uint64_t*     last;             // valeurs publiées
+    bool          seen;
+    uint64_t      period_ns;        // rate_ms
+    uint64_t      next_ns;
+
+    gw_metric_t*  metrics;
+    char**        keys;             // "nom": échappé, précalculé
+    char*         json;
+    size_t        json_cap;
+
+    unsigned long frames, published, short_frames;
+} can_msg_dec_t;
+
+/* Messages décodés (valides pendant l'appel seulement) : metrics[n] + JSON
+ * {"signal":valeur,...}, ts = horodatage de la trame. */
+typedef void (*can_data_cb)(const char* message, const gw_metric_t* metrics, size_t n,
+                            const char* json, size_t json_len, double ts, void* user);
+
+typedef struct {
+    can_msg_dec_t* msgs;
+    size_t         nmsgs;
+    uint16_t       sff[CAN_SFF_MASK + 1];   // index + 1, 0 = non décodé
+    uint32_t*      eff_keys;                // id | CAN_EFF_FLAG, 0 = libre
+    uint16_t*      eff_idx;
+    uint32_t       eff_mask;                // capacité - 1 (puissance de 2)
+    unsigned long  unknown;
+} can_decoder_t;
+
+// Compile cfg->messages. Retour 0 (y compris sans messages), -1.
+int  can_decoder_init(can_decoder_t* d, const socketcan_params_t* cfg);
+
+/* Une trame : 1 = publiée via cb, 0 = inchangée/hors cadence/trop courte,
+ * -1 = identifiant non décodé. */
+int  can_decoder_feed(can_decoder_t* d, const struct canfd_frame* f, double ts,
+                      can_data_cb cb, void* user);
+
+/* Extraction seule (mesure, diagnostic) : valeurs physiques des signaux de la
+ * trame dans out[max], sans mise à jour de l'état ni publication. Retour
+ * nombre de valeurs, 0 si trame trop courte, -1 = identifiant non décodé. */
+int  can_decoder_extract(can_decoder_t* d, const struct canfd_frame* f,
+                         double* out, size_t max);
+
+void can_decoder_log_stats(const can_decoder_t* d, const char* tag);
+
+void can_decoder_free(can_decoder_t* d);
+
+#ifdef __cplusplus
+}
+#endif
@@ -88,6 +88,16 @@ static void free_bridge_mapping(bridge_mapping_t* m){
     free(m->topic);
     for(size_t i=0;i<m->fields_count;i++) free(m->fields[i]);
     free(m->fields);
+    free(m->sparkplug.group_id);
+    free(m->sparkplug.edge_node_id);
+    free(m->sparkplug.device_id);
+}
+
+// Type chargé par fill_opaque_params() (pas de parser enregistré)
+static bool kind_is_opaque(kind_t k){
+    for(size_t i=0;i<CONNECTOR_REGISTRY_LEN;i++)
+        if(CONNECTOR_REGISTRY[i].kind==k) return CONNECTOR_REGISTRY[i].parse==NULL;
+    return true;
 }
 
 /* Public cleanup */
@@ -110,7 +120,8 @@ void config_free(config_t* cfg){
         free(c->tags);
 
         // If connector was loaded via opaque fallback, free JSON blob
-        if (c->u.opaque.json_params) {
+        // (u est une union : seulement pour les types sans parser)
+        if (kind_is_opaque(c->kind) && c->u.opaque.json_params) {
             free(c->u.opaque.json_params);
         }
 
@@ -206,12 +217,19 @@ static map_format_t parse_format(const char* s){
     if(!s) return MAP_FMT_JSON;
     if(strcmp(s,"json")==0) return MAP_FMT_JSON;
     if(strcmp(s,"kv")==0)   return MAP_FMT_KV;
+    if(strcmp(s,"sparkplug")==0) return MAP_FMT_SPARKPLUG;
     return MAP_FMT_RAW;
 }
 static buffer_policy_t parse_policy(const char* s){
     return (s && strcmp(s,"drop_new")==0) ? BUF_DROP_NEW : BUF_DROP_OLDEST;
 }
 
+static batch_compress_t parse_compress(const char* s){
+    if(s && strcmp(s,"lz4")==0)  return BATCH_COMPRESS_LZ4;
+    if(s && strcmp(s,"zstd")==0) return BATCH_COMPRESS_ZSTD;
+    return BATCH_COMPRESS_NONE;
+}
+
 static int parse_gateway(yaml_document_t* doc, yaml_node_t* gw_map, gateway_cfg_t* gw){
     if(!gw_map || gw_map->type!=YAML_MAPPING_NODE) return -1;
     const char* s;
@@ -221,6 +239,28 @@ static int parse_gateway(yaml_document_t* doc, yaml_node_t* gw_map, gateway_cfg_
     s = yscalar_str( ymap_get(doc, gw_map, "logfile") );  gw->logfile  = s? xstrdup(s): NULL;
     int ok=0; long mp = yscalar_int( ymap_get(doc, gw_map, "metrics_port"), &ok );
     if(ok){ gw->metrics_port = (int)mp; gw->metrics_port_set = true; }
+
+    yaml_node_t* rtm = ymap_get(doc, gw_map, "realtime");
+    if(rtm && rtm->type==YAML_MAPPING_NODE){
+        gateway_realtime_t* r = &gw->realtime;
+        r->enabled = true;
+        r->priority = 50;
+        r->lock_memory = true;
+        r->stack_prefault_kb = 64;
+        ok=0; long prio = yscalar_int( ymap_get(doc, rtm, "priority"), &ok );
+        if(ok) r->priority = (int)prio;
+        s = yscalar_str( ymap_get(doc, rtm, "lock_memory") );
+        if(s) r->lock_memory = (!strcmp(s,"true")||!strcmp(s,"1"));
+        ok=0; long kb = yscalar_int( ymap_get(doc, rtm, "stack_prefault_kb"), &ok );
+        if(ok) r->stack_prefault_kb = (int)kb;
+        yaml_node_t* cpus = ymap_get(doc, rtm, "cpus");
+        if(cpus && cpus->type==YAML_SEQUENCE_NODE){
+            for(yaml_node_item_t* it = cpus->data.sequence.items.start; it < cpus->data.sequence.items.top; ++it){
+                ok=0; long c = yscalar_int( yaml_document_get_node(doc, *it), &ok );
+                if(ok && c>=0 && c<64) r->cpu_mask |= (uint64_t)1 << c;
+            }
+        }
+    }
     return 0;
 }
 
@@ -258,6 +298,14 @@ static int parse_bridge_one(yaml_document_t* doc, const char* name, yaml_node_t*
         }
         const char* ts = yscalar_str( ymap_get(doc, m, "timestamp") );
         if(ts){ out->mapping.timestamp = (!strcmp(ts,"true")||!strcmp(ts,"1")); out->mapping.timestamp_set=true; }
+        yaml_node_t* sp = ymap_get(doc, m, "sparkplug");
+        if(sp && sp->type==YAML_MAPPING_NODE){
+            bridge_sparkplug_t* spc = &out->mapping.sparkplug;
+            spc->present = true;
+            s = yscalar_str( ymap_get(doc, sp, "group_id") );     if(s) spc->group_id     = xstrdup(s);
+            s = yscalar_str( ymap_get(doc, sp, "edge_node_id") ); if(s) spc->edge_node_id = xstrdup(s);
+            s = yscalar_str( ymap_get(doc, sp, "device_id") );    if(s) spc->device_id    = xstrdup(s);
+        }
     }
 
     yaml_node_t* t = ymap_get(doc, bmap, "transform");
@@ -287,6 +335,17 @@ static int parse_bridge_one(yaml_document_t* doc, const char* name, yaml_node_t*
         out->buffer.policy = parse_policy( yscalar_str( ymap_get(doc, buf, "policy") ) );
         out->buffer.has_policy = (ymap_get(doc, buf, "policy") != NULL);
     }
+
+    yaml_node_t* bt = ymap_get(doc, bmap, "batch");
+    if(bt && bt->type==YAML_MAPPING_NODE){
+        out->batch.present = true;
+        int ok=0; long ms = yscalar_int( ymap_get(doc, bt, "max_ms"), &ok );
+        if(ok){ out->batch.max_ms = (int)ms; out->batch.has_max_ms = true; }
+        ok=0; long mb = yscalar_int( ymap_get(doc, bt, "max_bytes"), &ok );
+        if(ok){ out->batch.max_bytes = (int)mb; out->batch.has_max_bytes = true; }
+        out->batch.compress = parse_compress( yscalar_str( ymap_get(doc, bt, "compress") ) );
+        out->batch.has_compress = (ymap_get(doc, bt, "compress") != NULL);
+    }
     return 0;
 }
 
@@ -421,3 +480,11 @@ const connector_any_t* config_find_connector(const config_t* cfg, const char* na
             return &cfg->connectors.items[i];
     return NULL;
 }
+
+const bridge_t* config_find_bridge(const config_t* cfg, const char* name){
+    if(!name) return NULL;
+    for(size_t i=0;i<cfg->bridges.count;i++)
+        if(cfg->bridges.items[i].name && strcmp(cfg->bridges.items[i].name, name)==0)
+            return &cfg->bridges.items[i];
+    return NULL;
+}
@@ -6,3 +6,4 @@
 int  config_load_file(const char* path, config_t* cfg);
 void config_free(config_t* cfg);
 const connector_any_t* config_find_connector(const config_t* cfg, const char* name);
+const bridge_t* config_find_bridge(const config_t* cfg, const char* name);
@@ -26,6 +26,7 @@ typedef struct {
         mqtt_connector_t          mqtt;
         modbus_rtu_connector_t    modbus_rtu;
         modbus_tcp_connector_t    modbus_tcp;
+        modbus_server_connector_t modbus_server;
         http_server_connector_t   http_server;
         uart_connector_t          uart;
         spi_connector_t           spi;
@@ -46,6 +47,15 @@ typedef struct {
     size_t count;
 } connectors_table_t;
 
+/* gateway.realtime : threads d'acquisition (pollers SPI, lecteurs UART, ...) */
+typedef struct {
+    bool     enabled;           // section présente
+    int      priority;          // SCHED_FIFO 1..99 (défaut 50), 0 = pas de SCHED_FIFO
+    uint64_t cpu_mask;          // bit n = CPU n (0 = pas d'affinité)
+    bool     lock_memory;       // mlockall(MCL_CURRENT|MCL_FUTURE), défaut true
+    int      stack_prefault_kb; // pile pré-touchée à l'entrée du thread (défaut 64)
+} gateway_realtime_t;
+
 /* Gateway (per schema) */
 typedef struct {
     char *name;
@@ -54,6 +64,7 @@ typedef struct {
     char *logfile;
     int   metrics_port;
     bool  metrics_port_set;
+    gateway_realtime_t realtime;
 } gateway_cfg_t;
 
 typedef struct {
@@ -62,11 +73,20 @@ typedef struct {
 } include_list_t;
 
 /* Bridges (per schema) */
-typedef enum { MAP_FMT_JSON, MAP_FMT_KV, MAP_FMT_RAW } map_format_t;
+typedef enum { MAP_FMT_JSON, MAP_FMT_KV, MAP_FMT_RAW, MAP_FMT_SPARKPLUG } map_format_t;
+
+/* Sparkplug B identity (topic spBv1.0/<group_id>/<type>/<edge_node_id>[/<device_id>]) */
+typedef struct {
+    char *group_id;      // default "iotgw"
+    char *edge_node_id;  // default gateway.name
+    char *device_id;     // default: source connector name
+    bool  present;
+} bridge_sparkplug_t;
 
 typedef struct {
     char   *topic;
     map_format_t format;
+    bridge_sparkplug_t sparkplug;  // only used when format == MAP_FMT_SPARKPLUG
     char **fields;
     size_t fields_count;
     bool   timestamp;
@@ -85,6 +105,16 @@ typedef struct {
     buffer_policy_t policy;  bool has_policy;
 } bridge_buffer_t;
 
+/* Enveloppe batch : échantillons accumulés max_ms / max_bytes puis un seul publish */
+typedef enum { BATCH_COMPRESS_NONE, BATCH_COMPRESS_LZ4, BATCH_COMPRESS_ZSTD } batch_compress_t;
+
+typedef struct {
+    int max_ms;                 bool has_max_ms;      // default 100
+    int max_bytes;              bool has_max_bytes;   // default 8192
+    batch_compress_t compress;  bool has_compress;    // default none
+    bool present;
+} bridge_batch_t;
+
 typedef struct {
     char *name;
     char *from;
@@ -93,6 +123,7 @@ typedef struct {
     char **transform; size_t transform_count;
     bridge_rate_limit_t rate_limit;
     bridge_buffer_t buffer;
+    bridge_batch_t batch;
 } bridge_t;
 
 typedef struct {
@@ -0,0 +1,680 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <linux/can/raw.h>
+#include <linux/can/error.h>
+#include <linux/can/isotp.h>
+#include <linux/can/j1939.h>
+#include "conn_can.h"
+#include "bridge.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#define CAN_RCVBUF (1024 * 1024)    // absorbe les rafales pendant un cycle du sink
+#define CAN_REBIND_MIN_MS 500       // interface retirée : back-off de re-bind
+#define CAN_REBIND_MAX_MS 30000
+
+static double tv_s(const struct timeval* tv){ return tv->tv_sec + tv->tv_usec / 1e6; }
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* filters[] -> can_filter : identifiant étendu si id ou mask dépasse 11 bits ;
+ * EFF/RTR dans le masque pour ne pas mélanger trames standard/étendues et
+ * écarter les remote frames. Sans filters[] mais avec messages[] : un filtre
+ * exact par message, le décodeur ne voit que ses identifiants. */
+static int set_filters(can_runtime_t* m){
+    const socketcan_params_t* c = m->cfg;
+    size_t n = c->filters_count ? c->filters_count : c->messages_count;
+    if (!n) return 0;                       // pas de filtre : tout est reçu
+    struct can_filter* f = (struct can_filter*)calloc(n, sizeof(*f));
+    if (!f) return -1;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t id, mask;
+        bool ext;
+        if (c->filters_count) {
+            id = c->filters[i].id;
+            mask = c->filters[i].mask;
+            ext = id > CAN_SFF_MASK || mask > CAN_SFF_MASK;
+        } else {
+            id = c->messages[i].id;
+            ext = c->messages[i].extended;
+            mask = ext ? CAN_EFF_MASK : CAN_SFF_MASK;
+        }
+        canid_t idm = ext ? CAN_EFF_MASK : CAN_SFF_MASK;
+        f[i].can_id = (id & idm) | (ext ? CAN_EFF_FLAG : 0);
+        f[i].can_mask = (mask & idm) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+    }
+    int rc = setsockopt(m->fd, SOL_CAN_RAW, CAN_RAW_FILTER, f, (socklen_t)(n * sizeof(*f)));
+    free(f);
+    return rc;
+}
+
+// Prépare les mmsghdr (longueurs remises à zéro par le noyau à chaque appel)
+static void arm_msgs(can_runtime_t* m){
+    for (size_t i = 0; i < CAN_RX_BATCH; ++i) {
+        struct msghdr* h = &m->msgs[i].msg_hdr;
+        m->iov[i].iov_base = &m->rxbuf[i];
+        m->iov[i].iov_len = sizeof(m->rxbuf[i]);
+        h->msg_name = NULL;
+        h->msg_namelen = 0;
+        h->msg_iov = &m->iov[i];
+        h->msg_iovlen = 1;
+        h->msg_control = m->ctrl + i * m->ctrl_len;
+        h->msg_controllen = m->ctrl_len;
+        h->msg_flags = 0;
+    }
+}
+
+// Un lot reçu : horodatage/pertes (cmsg), trames d'erreur comptées, données remises
+static void deliver(can_runtime_t* m, int n){
+    size_t k = 0;
+    for (int i = 0; i < n; ++i) {
+        struct msghdr* h = &m->msgs[i].msg_hdr;
+        size_t len = m->msgs[i].msg_len;
+        if (len != CAN_MTU && len != CANFD_MTU) continue;
+
+        double ts = 0;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(h); cm; cm = CMSG_NXTHDR(h, cm)) {
+            if (cm->cmsg_level != SOL_SOCKET) continue;
+            if (cm->cmsg_type == SCM_TIMESTAMP) {
+                struct timeval tv;
+                memcpy(&tv, CMSG_DATA(cm), sizeof(tv));
+                ts = tv_s(&tv);
+            } else if (cm->cmsg_type == SO_RXQ_OVFL) {
+                memcpy(&m->dropped, CMSG_DATA(cm), sizeof(m->dropped));
+            }
+        }
+
+        const struct canfd_frame* f = &m->rxbuf[i];
+        if (f->can_id & CAN_ERR_FLAG) {
+            m->err_frames++;
+            if (f->can_id & CAN_ERR_BUSOFF) m->bus_off++;
+            continue;
+        }
+        can_rx_t* o = &m->out[k++];
+        o->frame = *f;
+        o->fd = len == CANFD_MTU;
+        if (o->fd) m->fd_frames++;
+        else if (o->frame.len > CAN_MAX_DLEN) o->frame.len = CAN_MAX_DLEN;
+        o->ts = ts ? ts : now_s();
+    }
+    m->frames += k;
+    if (!k) return;
+    if (m->dec) {
+        for (size_t i = 0; i < k; ++i)
+            (void)can_decoder_feed(m->dec, &m->out[i].frame, m->out[i].ts, m->on_data, m->user);
+    } else if (m->on_rx) {
+        m->on_rx(m->out, k, m->user);
+    }
+}
+
+// Erreur asynchrone d'un socket (POLLERR) : lue et remise à zéro
+static int sock_error(int fd){
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) return errno;
+    return err;
+}
+
+/* ENETDOWN (ip link set down : bitrate, reprise de bus-off) : les sockets
+ * restent liés et recevront de nouveau après le "up", on continue d'attendre.
+ * ENODEV (interface retirée) : sockets à recréer (m->gone). */
+static void link_event(can_runtime_t* m, int err){
+    if (err == ENODEV) {
+        if (!m->gone) log_warn("socketcan %s: interface removed, waiting for it to reappear",
+                               m->cfg->ifname);
+        m->gone = true;
+    } else if (err == ENETDOWN) {
+        if (!m->link_down) {
+            m->link_downs++;
+            log_warn("socketcan %s: interface down, waiting for it to come back up", m->cfg->ifname);
+        }
+        m->link_down = true;
+    } else if (err) {
+        log_warn("socketcan %s: socket error: %s", m->cfg->ifname, strerror(err));
+    }
+}
+
+static void link_alive(can_runtime_t* m){
+    if (!m->link_down) return;
+    m->link_down = false;
+    log_info("socketcan %s: interface up, receiving again", m->cfg->ifname);
+}
+
+// PDU reçus d'un socket CAN_ISOTP/CAN_J1939, jusqu'à EAGAIN
+static void drain_tp(can_runtime_t* m, can_tp_sock_t* t){
+    for (;;) {
+        struct sockaddr_can sa;
+        union { struct cmsghdr align; uint8_t buf[128]; } ctrl;
+        struct iovec iov = { m->pdubuf, CAN_PDU_MAX };
+        struct msghdr h;
+        memset(&h, 0, sizeof(h));
+        memset(&sa, 0, sizeof(sa));
+        h.msg_name = &sa;
+        h.msg_namelen = sizeof(sa);
+        h.msg_iov = &iov;
+        h.msg_iovlen = 1;
+        h.msg_control = ctrl.buf;
+        h.msg_controllen = sizeof(ctrl.buf);
+
+        ssize_t n = recvmsg(t->fd, &h, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR) continue;
+            if (errno == ENETDOWN || errno == ENODEV) { link_event(m, errno); return; }
+            // Erreur de protocole (timeout N_Cr/T1, séquence, abort TP) : un
+            // transfert perdu, le socket reste utilisable
+            if (t->errors++ == 0)
+                log_warn("socketcan %s: %s: %s", m->cfg->ifname, t->label, strerror(errno));
+            return;
+        }
+        link_alive(m);
+        if (h.msg_flags & MSG_TRUNC) { t->truncated++; continue; }
+
+        can_pdu_t pdu;
+        memset(&pdu, 0, sizeof(pdu));
+        pdu.proto = t->proto;
+        pdu.channel = t->label;
+        pdu.data = m->pdubuf;
+        pdu.len = (size_t)n;
+        pdu.da = J1939_NO_ADDR;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&h); cm; cm = CMSG_NXTHDR(&h, cm)) {
+            if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMP) {
+                struct timeval tv;
+                memcpy(&tv, CMSG_DATA(cm), sizeof(tv));
+                pdu.ts = tv_s(&tv);
+            } else if (cm->cmsg_level == SOL_CAN_J1939) {
+                if (cm->cmsg_type == SCM_J1939_DEST_ADDR) pdu.da = *CMSG_DATA(cm);
+                else if (cm->cmsg_type == SCM_J1939_PRIO) pdu.prio = *CMSG_DATA(cm);
+            }
+        }
+        if (!pdu.ts) pdu.ts = now_s();
+        if (t->proto == CAN_PDU_J1939) {
+            pdu.pgn = sa.can_addr.j1939.pgn;
+            pdu.sa = sa.can_addr.j1939.addr;
+            pdu.src_name = sa.can_addr.j1939.name;
+        } else {
+            pdu.rx_id = t->isotp->rx_id;
+        }
+
+        t->pdus++;
+        t->bytes += (unsigned long)n;
+        if ((unsigned long)n > t->max_len) t->max_len = (unsigned long)n;
+        if (m->on_pdu) m->on_pdu(&pdu, m->user);
+    }
+}
+
+static void close_sockets(can_runtime_t* m);
+static int  reopen_sockets(can_runtime_t* m);
+
+static void* can_thread(void* arg){
+    can_runtime_t* m = (can_runtime_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-can");
+
+    // [0] arrêt, [1] CAN_RAW (ignoré si -1), [2..] isotp/j1939
+    size_t npf = 2 + m->ntp;
+    struct pollfd* pf = (struct pollfd*)calloc(npf, sizeof(*pf));
+    if (!pf) return NULL;
+    pf[0].fd = m->efd;
+    for (size_t i = 0; i < npf; ++i) pf[i].events = POLLIN;
+
+    int backoff_ms = CAN_REBIND_MIN_MS;
+    while (!m->stop) {
+        if (m->gone) {
+            // interface retirée : sockets fermés, nouvelle tentative après back-off
+            close_sockets(m);
+            struct pollfd pe = { .fd = m->efd, .events = POLLIN };
+            if (poll(&pe, 1, backoff_ms) > 0) break;   // arrêt
+            if (reopen_sockets(m) != 0) {
+                backoff_ms = backoff_ms * 2 > CAN_REBIND_MAX_MS ? CAN_REBIND_MAX_MS : backoff_ms * 2;
+                continue;
+            }
+            m->gone = m->link_down = false;
+            m->rebinds++;
+            backoff_ms = CAN_REBIND_MIN_MS;
+            log_info("socketcan %s: interface back (ifindex %d), sockets re-bound",
+                     m->cfg->ifname, m->ifindex);
+        }
+        pf[1].fd = m->fd;
+        for (size_t i = 0; i < m->ntp; ++i) pf[2 + i].fd = m->tp[i].fd;
+
+        int r = poll(pf, (nfds_t)npf, -1);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            log_err("socketcan %s: poll: %s", m->cfg->ifname, strerror(errno));
+            break;
+        }
+        if (pf[0].revents) break;           // arrêt
+        m->wakeups++;
+
+        // isotp/j1939 : POLLERR = erreur de transfert ou de lien, lue par recvmsg
+        for (size_t i = 0; i < m->ntp; ++i)
+            if (pf[2 + i].revents & (POLLIN | POLLERR)) drain_tp(m, &m->tp[i]);
+
+        // CAN_RAW : SO_ERROR lu (et remis à zéro), sinon POLLERR resterait signalé
+        if (pf[1].revents & (POLLERR | POLLHUP | POLLNVAL))
+            link_event(m, (pf[1].revents & POLLNVAL) ? ENODEV : sock_error(m->fd));
+        if (m->gone || !(pf[1].revents & POLLIN)) continue;
+
+        // Tout ce qui est en file, par lots
+        for (;;) {
+            arm_msgs(m);
+            int n = recvmmsg(m->fd, m->msgs, CAN_RX_BATCH, MSG_DONTWAIT, NULL);
+            if (n <= 0) {
+                if (n < 0 && (errno == ENETDOWN || errno == ENODEV))
+                    link_event(m, errno);
+                else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    log_warn("socketcan %s: recvmmsg: %s", m->cfg->ifname, strerror(errno));
+                break;
+            }
+            link_alive(m);
+            m->batches++;
+            if ((unsigned long)n > m->max_batch) m->max_batch = (unsigned long)n;
+            deliver(m, n);
+            if (n < CAN_RX_BATCH) break;
+        }
+    }
+    free(pf);
+    return NULL;
+}
+
+// UP, MTU CAN FD : ioctl sur n'importe quel socket de la famille
+static void check_iface(const can_runtime_t* m, int sfd){
+    const socketcan_params_t* cfg = m->cfg;
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", cfg->ifname);
+    if (ioctl(sfd, SIOCGIFFLAGS, &ifr) == 0 && !(ifr.ifr_flags & IFF_UP))
+        log_warn("socketcan %s: interface is down (bitrate/restart_ms are set by ip link)", cfg->ifname);
+    if (!cfg->fd) return;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", cfg->ifname);
+    if (ioctl(sfd, SIOCGIFMTU, &ifr) == 0 && ifr.ifr_mtu != CANFD_MTU)
+        log_warn("socketcan %s: fd: true but interface MTU is %d (classic CAN only)",
+                 cfg->ifname, ifr.ifr_mtu);
+}
+
+static int open_raw(can_runtime_t* m){
+    const socketcan_params_t* cfg = m->cfg;
+    m->fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (m->fd < 0) {
+        log_err("socketcan %s: socket: %s", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    if (set_filters(m) != 0) {
+        log_err("socketcan %s: CAN_RAW_FILTER: %s", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    can_err_mask_t em = CAN_ERR_BUSOFF | CAN_ERR_CRTL | CAN_ERR_RESTARTED;
+    (void)setsockopt(m->fd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &em, sizeof(em));
+    int on = 1, rcvbuf = CAN_RCVBUF;
+    if (cfg->fd && setsockopt(m->fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on)) != 0)
+        log_warn("socketcan %s: CAN FD not supported by the kernel", cfg->ifname);
+    (void)setsockopt(m->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+    (void)setsockopt(m->fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+    (void)setsockopt(m->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = m->ifindex;
+    if (bind(m->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_err("socketcan %s: bind: %s", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Un canal ISO-TP : rx_id/tx_id liés au socket, flow control émis par le noyau
+static int open_isotp(can_runtime_t* m, can_tp_sock_t* t, const socketcan_isotp_t* c){
+    const socketcan_params_t* cfg = m->cfg;
+    t->proto = CAN_PDU_ISOTP;
+    t->isotp = c;
+    if (c->name) snprintf(t->label, sizeof(t->label), "%s", c->name);
+    else snprintf(t->label, sizeof(t->label), c->extended ? "%08X" : "%03X", (unsigned)c->rx_id);
+
+    t->fd = socket(PF_CAN, SOCK_DGRAM | SOCK_CLOEXEC, CAN_ISOTP);
+    if (t->fd < 0) {
+        log_err("socketcan %s: isotp socket: %s (can-isotp module?)", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    if (cfg->fd) {
+        struct can_isotp_ll_options ll = { .mtu = CANFD_MTU, .tx_dl = CANFD_MAX_DLEN, .tx_flags = 0 };
+        if (setsockopt(t->fd, SOL_CAN_ISOTP, CAN_ISOTP_LL_OPTS, &ll, sizeof(ll)) != 0)
+            log_warn("socketcan %s: isotp %s: CAN FD link layer refused", cfg->ifname, t->label);
+    }
+    int on = 1, rcvbuf = CAN_RCVBUF;
+    (void)setsockopt(t->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+    (void)setsockopt(t->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    canid_t flag = c->extended ? CAN_EFF_FLAG : 0, idm = c->extended ? CAN_EFF_MASK : CAN_SFF_MASK;
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = m->ifindex;
+    addr.can_addr.tp.rx_id = (c->rx_id & idm) | flag;
+    addr.can_addr.tp.tx_id = (c->tx_id & idm) | flag;
+    if (bind(t->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_err("socketcan %s: isotp %s: bind: %s", cfg->ifname, t->label, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* J1939 : SO_BROADCAST pour recevoir les PGN diffusés, PROMISC pour ceux
+ * adressés aux autres noeuds, pgns[] en SO_J1939_FILTER (noyau). */
+static int open_j1939(can_runtime_t* m, can_tp_sock_t* t){
+    const socketcan_params_t* cfg = m->cfg;
+    const socketcan_j1939_t* j = &cfg->j1939;
+    t->proto = CAN_PDU_J1939;
+    snprintf(t->label, sizeof(t->label), "j1939");
+
+    t->fd = socket(PF_CAN, SOCK_DGRAM | SOCK_CLOEXEC, CAN_J1939);
+    if (t->fd < 0) {
+        log_err("socketcan %s: j1939 socket: %s (can-j1939 module?)", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    int on = 1, rcvbuf = CAN_RCVBUF;
+    (void)setsockopt(t->fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    (void)setsockopt(t->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+    (void)setsockopt(t->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (j->promisc && setsockopt(t->fd, SOL_CAN_J1939, SO_J1939_PROMISC, &on, sizeof(on)) != 0)
+        log_warn("socketcan %s: j1939: SO_J1939_PROMISC: %s", cfg->ifname, strerror(errno));
+    if (j->pgns_count) {
+        struct j1939_filter* f = (struct j1939_filter*)calloc(j->pgns_count, sizeof(*f));
+        if (!f) return -1;
+        for (size_t i = 0; i < j->pgns_count; ++i) {
+            f[i].pgn = j->pgns[i];
+            f[i].pgn_mask = J1939_PGN_MAX;
+        }
+        int rc = setsockopt(t->fd, SOL_CAN_J1939, SO_J1939_FILTER, f,
+                            (socklen_t)(j->pgns_count * sizeof(*f)));
+        free(f);
+        if (rc != 0) {
+            log_err("socketcan %s: j1939: SO_J1939_FILTER: %s", cfg->ifname, strerror(errno));
+            return -1;
+        }
+    }
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = m->ifindex;
+    addr.can_addr.j1939.name = J1939_NO_NAME;
+    addr.can_addr.j1939.pgn = J1939_NO_PGN;
+    addr.can_addr.j1939.addr = j->addr_set ? (uint8_t)j->addr : J1939_NO_ADDR;
+    if (bind(t->fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_err("socketcan %s: j1939: bind: %s", cfg->ifname, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static void close_sockets(can_runtime_t* m){
+    if (m->fd >= 0) close(m->fd);
+    m->fd = -1;
+    for (size_t i = 0; i < m->ntp; ++i) {
+        if (m->tp[i].fd >= 0) close(m->tp[i].fd);
+        m->tp[i].fd = -1;
+    }
+}
+
+// Interface réapparue (nouvel ifindex) : mêmes sockets qu'à l'ouverture
+static int reopen_sockets(can_runtime_t* m){
+    const socketcan_params_t* cfg = m->cfg;
+    int idx = (int)if_nametoindex(cfg->ifname);
+    if (!idx) return -1;
+    m->ifindex = idx;
+    if (m->rxbuf && open_raw(m) != 0) goto fail;
+    for (size_t i = 0; i < cfg->isotp_count; ++i)
+        if (open_isotp(m, &m->tp[i], &cfg->isotp[i]) != 0) goto fail;
+    if (cfg->j1939.enabled && open_j1939(m, &m->tp[m->ntp - 1]) != 0) goto fail;
+    return 0;
+fail:
+    close_sockets(m);
+    return -1;
+}
+
+static void release(can_runtime_t* m){
+    if (m->fd >= 0) close(m->fd);
+    if (m->efd >= 0) close(m->efd);
+    for (size_t i = 0; i < m->ntp; ++i)
+        if (m->tp[i].fd >= 0) close(m->tp[i].fd);
+    free(m->tp);
+    free(m->pdubuf);
+    free(m->rxbuf); free(m->msgs); free(m->iov); free(m->ctrl); free(m->out);
+    if (m->dec) { can_decoder_free(m->dec); free(m->dec); }
+    memset(m, 0, sizeof(*m));
+    m->fd = m->efd = -1;
+}
+
+int can_open(can_runtime_t* m, const socketcan_params_t* cfg,
+             const gateway_realtime_t* realtime, can_rx_cb on_rx,
+             can_data_cb on_data, can_pdu_cb on_pdu, void* user){
+    if (!m || !cfg || !cfg->ifname) return -1;
+    memset(m, 0, sizeof(*m));
+    m->fd = m->efd = -1;
+    m->cfg = cfg;
+    m->realtime = realtime;
+    m->on_rx = on_rx;
+    m->on_data = on_data;
+    m->on_pdu = on_pdu;
+    m->user = user;
+
+    m->ifindex = (int)if_nametoindex(cfg->ifname);
+    if (!m->ifindex) {
+        log_err("socketcan %s: no such interface", cfg->ifname);
+        return -1;
+    }
+
+    if (cfg->messages_count) {
+        m->dec = (can_decoder_t*)calloc(1, sizeof(*m->dec));
+        if (!m->dec || can_decoder_init(m->dec, cfg) != 0) {
+            log_err("socketcan %s: cannot compile messages", cfg->ifname);
+            free(m->dec);
+            m->dec = NULL;
+            return -1;
+        }
+    }
+
+    // Trames brutes : par défaut, ou si filters[]/messages[] à côté des transports
+    size_t ntp = cfg->isotp_count + (cfg->j1939.enabled ? 1 : 0);
+    bool raw = !ntp || cfg->filters_count || cfg->messages_count;
+
+    if (raw) {
+        m->ctrl_len = CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(uint32_t));
+        m->rxbuf = (struct canfd_frame*)calloc(CAN_RX_BATCH, sizeof(*m->rxbuf));
+        m->msgs = (struct mmsghdr*)calloc(CAN_RX_BATCH, sizeof(*m->msgs));
+        m->iov = (struct iovec*)calloc(CAN_RX_BATCH, sizeof(*m->iov));
+        m->ctrl = (uint8_t*)calloc(CAN_RX_BATCH, m->ctrl_len);
+        m->out = (can_rx_t*)calloc(CAN_RX_BATCH, sizeof(*m->out));
+        if (!m->rxbuf || !m->msgs || !m->iov || !m->ctrl || !m->out) goto fail;
+        if (open_raw(m) != 0) goto fail;
+    }
+    if (ntp) {
+        m->tp = (can_tp_sock_t*)calloc(ntp, sizeof(*m->tp));
+        m->pdubuf = (uint8_t*)malloc(CAN_PDU_MAX);
+        if (!m->tp || !m->pdubuf) goto fail;
+        for (size_t i = 0; i < ntp; ++i) m->tp[i].fd = -1;
+        for (size_t i = 0; i < cfg->isotp_count; ++i) {
+            m->ntp++;
+            if (open_isotp(m, &m->tp[i], &cfg->isotp[i]) != 0) goto fail;
+        }
+        if (cfg->j1939.enabled) {
+            m->ntp++;
+            if (open_j1939(m, &m->tp[m->ntp - 1]) != 0) goto fail;
+        }
+    }
+    check_iface(m, raw ? m->fd : m->tp[0].fd);
+
+    m->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m->efd < 0) goto fail;
+    m->running = true;
+    if (pthread_create(&m->thread, NULL, can_thread, m) != 0) {
+        perror("pthread_create(can_thread)");
+        m->running = false;
+        goto fail;
+    }
+    if (raw)
+        log_info("socketcan %s: %zu kernel filter(s)%s, recvmmsg batches of %d, %zu decoded message(s)",
+                 cfg->ifname, cfg->filters_count ? cfg->filters_count : cfg->messages_count,
+                 cfg->fd ? ", CAN FD" : "", CAN_RX_BATCH, m->dec ? m->dec->nmsgs : 0);
+    if (ntp)
+        log_info("socketcan %s: %zu isotp channel(s)%s", cfg->ifname, cfg->isotp_count,
+                 cfg->j1939.enabled ? (cfg->j1939.addr_set ? ", j1939" : ", j1939 (listen only)") : "");
+    return 0;
+
+fail:
+    release(m);
+    return -1;
+}
+
+void can_log_stats(can_runtime_t* m, const char* tag){
+    if (!m || !m->running) return;
+    if (m->rxbuf)
+        log_info("[%s] socketcan %s: %lu frames (%lu fd) in %lu batches / %lu wakeups, max batch %lu, "
+                 "kernel drops %u, error frames %lu, bus-off %lu",
+                 tag ? tag : "can", m->cfg->ifname, m->frames, m->fd_frames, m->batches, m->wakeups,
+                 m->max_batch, (unsigned)m->dropped, m->err_frames, m->bus_off);
+    if (m->link_downs || m->rebinds || m->gone)
+        log_info("[%s] socketcan %s: link %s, %lu down event(s), %lu re-bind(s)",
+                 tag ? tag : "can", m->cfg->ifname,
+                 m->gone ? "removed" : m->link_down ? "down" : "up", m->link_downs, m->rebinds);
+    for (size_t i = 0; i < m->ntp; ++i) {
+        const can_tp_sock_t* t = &m->tp[i];
+        log_info("[%s] socketcan %s: %s: %lu PDU(s), %lu bytes, max %lu, %lu error(s), %lu truncated",
+                 tag ? tag : "can", m->cfg->ifname, t->label, t->pdus, t->bytes, t->max_len,
+                 t->errors, t->truncated);
+    }
+    can_decoder_log_stats(m->dec, tag);
+}
+
+void can_close(can_runtime_t* m){
+    if (!m) return;
+    if (m->running) {
+        m->stop = 1;
+        uint64_t one = 1;
+        ssize_t w = write(m->efd, &one, sizeof(one));
+        (void)w;
+        pthread_join(m->thread, NULL);
+        m->running = false;
+    }
+    release(m);
+}
+
+void on_can_rx(const can_rx_t* frames, size_t n, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !frames) return;
+
+    const char* prefix = rt->topic_prefix[0] ? rt->topic_prefix : "ingest";
+    for (size_t i = 0; i < n; ++i) {
+        const struct canfd_frame* f = &frames[i].frame;
+        char topic[160];
+        if (f->can_id & CAN_EFF_FLAG)
+            snprintf(topic, sizeof(topic), "%s/%08X", prefix, (unsigned)(f->can_id & CAN_EFF_MASK));
+        else
+            snprintf(topic, sizeof(topic), "%s/%03X", prefix, (unsigned)(f->can_id & CAN_SFF_MASK));
+
+        gw_msg_t in;
+        memset(&in, 0, sizeof(in));
+        in.protocole = KIND_SOCKETCAN;
+        in.pl.data = f->data;
+        in.pl.len = f->len;
+        in.pl.content_type = "application/octet-stream";
+        in.pl.topic = topic;
+        in.timestamp = frames[i].ts;
+
+        if (rt->transform) {
+            gw_msg_t out;
+            memset(&out, 0, sizeof(out));
+            int trc = rt->transform(&in, &out, rt->transform_user);
+            rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+        } else {
+            rt->send_fn(&in, rt->send_ctx);
+        }
+    }
+}
+
+void on_can_data(const char* message, const gw_metric_t* metrics, size_t n,
+                 const char* json, size_t json_len, double ts, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !json) return;
+
+    char topic[192];
+    snprintf(topic, sizeof(topic), "%s/%s", rt->topic_prefix[0] ? rt->topic_prefix : "ingest",
+             message ? message : "can");
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_SOCKETCAN;
+    in.pl.data = (const uint8_t*)json;
+    in.pl.len = json_len;
+    in.pl.is_text = 1;
+    in.pl.content_type = "application/json";
+    in.pl.topic = topic;
+    in.timestamp = ts;
+    in.metrics = metrics;
+    in.metrics_count = n;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
+
+void on_can_pdu(const can_pdu_t* pdu, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !pdu) return;
+
+    const char* prefix = rt->topic_prefix[0] ? rt->topic_prefix : "ingest";
+    char topic[192];
+    gw_metric_t mt[4];
+    size_t nm = 0;
+    memset(mt, 0, sizeof(mt));
+    if (pdu->proto == CAN_PDU_J1939) {
+        snprintf(topic, sizeof(topic), "%s/j1939/%05X/%02X", prefix, (unsigned)pdu->pgn, (unsigned)pdu->sa);
+        mt[nm].name = "pgn";  mt[nm].type = GW_VAL_U64; mt[nm++].v.u64 = pdu->pgn;
+        mt[nm].name = "sa";   mt[nm].type = GW_VAL_U64; mt[nm++].v.u64 = pdu->sa;
+        mt[nm].name = "da";   mt[nm].type = GW_VAL_U64; mt[nm++].v.u64 = pdu->da;
+        mt[nm].name = "prio"; mt[nm].type = GW_VAL_U64; mt[nm++].v.u64 = pdu->prio;
+    } else {
+        snprintf(topic, sizeof(topic), "%s/isotp/%s", prefix, pdu->channel ? pdu->channel : "isotp");
+        mt[nm].name = "rx_id"; mt[nm].type = GW_VAL_U64; mt[nm++].v.u64 = pdu->rx_id;
+    }
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_SOCKETCAN;
+    in.pl.data = pdu->data;
+    in.pl.len = pdu->len;
+    in.pl.content_type = "application/octet-stream";
+    in.pl.topic = topic;
+    in.timestamp = pdu->ts;
+    in.metrics = mt;
+    in.metrics_count = nm;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
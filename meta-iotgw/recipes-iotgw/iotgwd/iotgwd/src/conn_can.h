@@ -0,0 +1,156 @@
+#pragma once
+/**
+ * @file conn_can.h
+ * @brief Réception SocketCAN (CAN_RAW) d'un connecteur socketcan.
+ *
+ * Les filters[] du connecteur sont installés par CAN_RAW_FILTER : le noyau
+ * écarte les identifiants inutiles avant la file du socket, ils ne coûtent ni
+ * réveil ni copie. Un thread par interface, piloté par poll() : sur POLLIN,
+ * recvmmsg() par lots de CAN_RX_BATCH trames jusqu'à EAGAIN, chaque lot remis
+ * d'un coup à on_rx (un bus 500 kbit/s chargé, ~4000 trames/s, tient en
+ * quelques réveils par seconde au lieu d'un read() par trame).
+ *
+ * Chaque trame porte l'horodatage de réception du noyau (SO_TIMESTAMP), pas
+ * celui du passage en espace utilisateur. Les trames perdues par débordement
+ * de la file du socket sont comptées (SO_RXQ_OVFL), les trames d'erreur du
+ * contrôleur (bus-off, error passive, redémarrage) aussi, sans être remises.
+ *
+ * messages[] : les trames sont décodées en signaux (can_decode.h) et remises
+ * à on_data, les identifiants non décodés sont écartés ; sans filters[], un
+ * filtre noyau exact par message est installé. Sans messages[], les trames
+ * brutes vont à on_rx.
+ *
+ * isotp[] / j1939 : un socket CAN_ISOTP par canal, un socket CAN_J1939 ; la
+ * segmentation (flow control, TP.CM/TP.DT, BAM, ETP) est traitée par le noyau,
+ * le thread ne reçoit que des PDU complets (un recvmsg par PDU au lieu d'un
+ * réveil par trame), remis à on_pdu avec leurs métadonnées (PGN, adresses,
+ * priorité). Le socket CAN_RAW n'est alors ouvert qu'avec filters[] ou
+ * messages[]. J1939 : transferts BAM et ceux adressés à addr (sans addr,
+ * écoute seule : les transferts point à point des autres noeuds ne sont pas
+ * réassemblés, faute de CTS).
+ *
+ * fd: true => CAN_RAW_FD_FRAMES : trames classiques et CAN FD (64 octets).
+ * bitrate/sample_point/restart_ms sont appliqués à l'interface par le système
+ * (ip link, systemd-networkd) : le connecteur vérifie seulement qu'elle est UP.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "can_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_RX_BATCH 64
+#define CAN_PDU_MAX  (64 * 1024)   // PDU ISO-TP/J1939 le plus long accepté
+
+typedef struct {
+    struct canfd_frame frame;       // can_id avec drapeaux CAN_EFF_FLAG/CAN_RTR_FLAG, len, data
+    bool   fd;                      // reçue en CAN FD (CANFD_MTU)
+    double ts;                      // SO_TIMESTAMP (epoch s)
+} can_rx_t;
+
+// Lot de trames d'un réveil (valide pendant l'appel seulement)
+typedef void (*can_rx_cb)(const can_rx_t* frames, size_t n, void* user);
+
+typedef enum { CAN_PDU_ISOTP, CAN_PDU_J1939 } can_pdu_proto_t;
+
+typedef struct {
+    can_pdu_proto_t proto;
+    const char*     channel;        // isotp : name, sinon rx_id hexa ; "j1939"
+    const uint8_t*  data;
+    size_t          len;
+    uint32_t        rx_id;          // isotp
+    uint32_t        pgn;            // j1939 (PDU1 : PS à 0)
+    uint8_t         sa, da, prio;   // j1939, da = J1939_NO_ADDR en broadcast
+    uint64_t        src_name;       // j1939 : NAME de l'émetteur, 0 inconnu
+    double          ts;
+} can_pdu_t;
+
+// PDU complet (valide pendant l'appel seulement)
+typedef void (*can_pdu_cb)(const can_pdu_t* pdu, void* user);
+
+typedef struct {
+    int                      fd;
+    can_pdu_proto_t          proto;
+    const socketcan_isotp_t* isotp;
+    char                     label[40];
+    unsigned long            pdus, bytes, max_len, errors, truncated;
+} can_tp_sock_t;
+
+typedef struct {
+    const socketcan_params_t* cfg;
+    int fd;
+    int efd;                        // eventfd : arrêt
+    int ifindex;
+    const gateway_realtime_t* realtime;
+
+    can_rx_cb      on_rx;
+    can_data_cb    on_data;
+    can_pdu_cb     on_pdu;
+    can_decoder_t* dec;             // messages[] (NULL sinon)
+    void*          user;
+
+    // isotp[] puis j1939 ; fd == -1 : pas de socket CAN_RAW
+    can_tp_sock_t* tp;
+    size_t         ntp;
+    uint8_t*       pdubuf;          // CAN_PDU_MAX
+
+    // recvmmsg : CAN_RX_BATCH trames, contrôle (timestamp + compteur de pertes)
+    struct canfd_frame* rxbuf;
+    struct mmsghdr*     msgs;
+    struct iovec*       iov;
+    uint8_t*            ctrl;
+    size_t              ctrl_len;   // par message
+    can_rx_t*           out;
+
+    pthread_t    thread;
+    volatile int stop;
+    bool         running;
+
+    // état du lien (thread de réception)
+    bool          link_down;        // ENETDOWN reçu, pas de trame depuis
+    bool          gone;             // ENODEV : sockets à recréer
+
+    // stats (thread de réception)
+    unsigned long frames, fd_frames, batches, wakeups, max_batch;
+    unsigned long err_frames, bus_off, link_downs, rebinds;
+    uint32_t      dropped;          // SO_RXQ_OVFL : pertes noyau cumulées
+} can_runtime_t;
+
+/* Ouvre les sockets de cfg->ifname (CAN_RAW : filtres, FD, horodatage ;
+ * CAN_ISOTP, CAN_J1939), compile messages[] et lance le thread de réception.
+ * Interface arrêtée (ENETDOWN : ip link set down pour changer le bitrate,
+ * reprise après bus-off) : les sockets restent liés, la réception reprend
+ * seule. Interface retirée (ENODEV) : sockets recréés avec back-off dès
+ * qu'elle réapparaît. Retour 0, -1. */
+int  can_open(can_runtime_t* m, const socketcan_params_t* cfg,
+              const gateway_realtime_t* realtime, can_rx_cb on_rx,
+              can_data_cb on_data, can_pdu_cb on_pdu, void* user);
+
+void can_log_stats(can_runtime_t* m, const char* tag);
+
+void can_close(can_runtime_t* m);
+
+// Callback bridge : une trame -> transform -> send_fn, topic "<prefix>/<id hex>",
+// payload = données brutes (user = gw_bridge_runtime_t*)
+void on_can_rx(const can_rx_t* frames, size_t n, void* user);
+
+// Callback bridge : signaux décodés -> JSON + metrics, topic "<prefix>/<message>"
+void on_can_data(const char* message, const gw_metric_t* metrics, size_t n,
+                 const char* json, size_t json_len, double ts, void* user);
+
+// Callback bridge : PDU brut + métadonnées en metrics, topic
+// "<prefix>/isotp/<canal>" ou "<prefix>/j1939/<PGN>/<SA>" (hexa)
+void on_can_pdu(const can_pdu_t* pdu, void* user);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,516 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include "conn_i2c.h"
+#include "bridge.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#define I2C_MAX_MSGS       I2C_RDWR_IOCTL_MAX_MSGS   // segments par ioctl(I2C_RDWR)
+#define I2C_BACKOFF_MAX_MS 30000u
+#define I2C_NAME_LEN       12                        // "reg_0xNN"
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns){
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    return ts;
+}
+
+static int64_t ts_diff_ns(const struct timespec* a, const struct timespec* b){
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static spi_field_type_t field_type(i2c_point_type_t t){
+    switch (t) {
+    case I2C_TYPE_U8:    return SPI_FIELD_U8;
+    case I2C_TYPE_S8:    return SPI_FIELD_S8;
+    case I2C_TYPE_U16:   return SPI_FIELD_U16;
+    case I2C_TYPE_S16:   return SPI_FIELD_S16;
+    case I2C_TYPE_U24:   return SPI_FIELD_U24;
+    case I2C_TYPE_U32:   return SPI_FIELD_U32;
+    case I2C_TYPE_S32:   return SPI_FIELD_S32;
+    case I2C_TYPE_FLOAT: return SPI_FIELD_FLOAT;
+    default:             return SPI_FIELD_BYTES;
+    }
+}
+
+// Octets lus pour un point : len, au moins la taille du type
+static unsigned point_span(const i2c_map_point_t* pt){
+    unsigned t;
+    switch (pt->type) {
+    case I2C_TYPE_U8: case I2C_TYPE_S8:   t = 1; break;
+    case I2C_TYPE_U16: case I2C_TYPE_S16: t = 2; break;
+    case I2C_TYPE_U24:                    t = 3; break;
+    case I2C_TYPE_BYTES:                  t = 1; break;
+    default:                              t = 4; break;
+    }
+    return pt->len > t ? pt->len : t;
+}
+
+// Temps bus d'une lecture combinée : S + adr/W + reg + Sr + adr/R + n octets + P (9 bits par octet)
+static uint64_t xfer_bits(unsigned n){ return 1 + 9 + 9 + 1 + 9 + 9ull * n + 1; }
+
+// qsort_r : indices de map triés par reg, ordre de la map à reg égal (arg = map du device)
+static int cmp_reg(const void* a, const void* b, void* arg){
+    const i2c_map_point_t* map = (const i2c_map_point_t*)arg;
+    const i2c_map_point_t* pa = &map[*(const size_t*)a];
+    const i2c_map_point_t* pb = &map[*(const size_t*)b];
+    if (pa->reg != pb->reg) return pa->reg < pb->reg ? -1 : 1;
+    return *(const size_t*)a < *(const size_t*)b ? -1 : 1;
+}
+
+static void dev_free(i2c_dev_t* d){
+    decode_plan_free(&d->plan);
+    free(d->blocks);
+    free(d->msgs);
+    free(d->image);
+    free(d->fields);
+    free(d->names);
+    d->blocks = NULL; d->msgs = NULL; d->image = NULL; d->fields = NULL; d->names = NULL;
+    d->nblocks = d->image_len = 0;
+}
+
+/* Compile la map : blocs de registres (tri par reg, fusion des plages à
+ * max_gap octets près), image, segments I2C_RDWR et plan de décodage. */
+static int dev_compile(i2c_dev_t* d, int max_gap){
+    const i2c_device_t* c = d->cfg;
+    size_t n = c->map_count;
+    size_t* order = (size_t*)calloc(n, sizeof(*order));
+    size_t* blk_of = (size_t*)calloc(n, sizeof(*blk_of));
+    d->blocks = (i2c_block_t*)calloc(n, sizeof(*d->blocks));
+    d->fields = (spi_field_t*)calloc(n, sizeof(*d->fields));
+    d->names = (char*)calloc(n, I2C_NAME_LEN);
+    if (!order || !blk_of || !d->blocks || !d->fields || !d->names) goto fail;
+
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+        if (c->map[i].reg + point_span(&c->map[i]) > 256) {
+            log_err("i2c 0x%02x: reg 0x%02x + %u bytes beyond register space",
+                    (unsigned)c->addr, (unsigned)c->map[i].reg, point_span(&c->map[i]));
+            goto fail;
+        }
+    }
+    qsort_r(order, n, sizeof(*order), cmp_reg, (void*)c->map);
+
+    bool merge = !c->auto_increment_set || c->auto_increment;
+    size_t off = 0;
+    for (size_t k = 0; k < n; ++k) {
+        const i2c_map_point_t* pt = &c->map[order[k]];
+        unsigned end = pt->reg + point_span(pt);
+        i2c_block_t* b = d->nblocks ? &d->blocks[d->nblocks - 1] : NULL;
+        if (b && merge && pt->reg <= (unsigned)b->reg + b->len + (unsigned)max_gap) {
+            if (end > (unsigned)b->reg + b->len) b->len = (uint16_t)(end - b->reg);
+        } else {
+            b = &d->blocks[d->nblocks++];
+            b->reg = pt->reg;
+            b->len = (uint16_t)(end - pt->reg);
+        }
+        blk_of[order[k]] = d->nblocks - 1;
+    }
+    for (size_t b = 0; b < d->nblocks; ++b) {
+        d->blocks[b].img_off = off;
+        off += d->blocks[b].len;
+    }
+    d->image_len = off;
+    d->image = (uint8_t*)calloc(off ? off : 1, 1);
+    d->msgs = (struct i2c_msg*)calloc(2 * d->nblocks, sizeof(*d->msgs));
+    if (!d->image || !d->msgs) goto fail;
+
+    // Écriture du registre puis lecture (START répété) : deux segments par bloc
+    for (size_t b = 0; b < d->nblocks; ++b) {
+        i2c_block_t* blk = &d->blocks[b];
+        struct i2c_msg* w = &d->msgs[2 * b];
+        w[0].addr = c->addr;
+        w[0].flags = 0;
+        w[0].len = 1;
+        w[0].buf = &blk->reg;
+        w[1].addr = c->addr;
+        w[1].flags = I2C_M_RD;
+        w[1].len = blk->len;
+        w[1].buf = d->image + blk->img_off;
+    }
+
+    // Un champ par point, dans l'ordre de la map (JSON/metrics dans l'ordre du YAML)
+    for (size_t i = 0; i < n; ++i) {
+        const i2c_map_point_t* pt = &c->map[i];
+        const i2c_block_t* b = &d->blocks[blk_of[i]];
+        spi_field_t* f = &d->fields[i];
+        if (pt->name) {
+            f->name = pt->name;
+        } else {
+            f->name = d->names + i * I2C_NAME_LEN;
+            snprintf(f->name, I2C_NAME_LEN, "reg_0x%02x", (unsigned)pt->reg);
+        }
+        f->offset = (uint16_t)(b->img_off + (pt->reg - b->reg));
+        f->type = field_type(pt->type);
+        f->len = (uint8_t)point_span(pt);
+        f->endianness = pt->endianness == I2C_LE ? SPI_LE : SPI_BE;
+        f->endianness_set = pt->endianness_set;
+        f->scale = pt->scale;
+        f->has_scale = pt->has_scale;
+    }
+    if (decode_plan_compile(&d->plan, d->fields, n, d->image_len, 8) != 0) goto fail;
+
+    free(order);
+    free(blk_of);
+    return 0;
+
+fail:
+    free(order);
+    free(blk_of);
+    dev_free(d);
+    return -1;
+}
+
+static int rdwr(i2c_runtime_t* m, struct i2c_msg* msgs, size_t n){
+    struct i2c_rdwr_ioctl_data io = { .msgs = msgs, .nmsgs = (uint32_t)n };
+    uint64_t t0 = mono_ns();
+    int rc = ioctl(m->fd, I2C_RDWR, &io);
+    m->busy_ns += mono_ns() - t0;
+    m->ioctls++;
+    m->msgs += n;
+    if (rc != (int)n) return -1;
+    for (size_t i = 0; i < n; ++i)
+        if (msgs[i].flags & I2C_M_RD) m->bytes_rx += msgs[i].len;
+    return 0;
+}
+
+// Adaptateur SMBus : un bloc en lectures I2C_SMBUS_I2C_BLOCK_DATA de 32 octets
+static int smbus_read(i2c_runtime_t* m, const i2c_block_t* b, uint8_t* dst){
+    for (unsigned off = 0; off < b->len; ) {
+        unsigned chunk = b->len - off > I2C_SMBUS_BLOCK_MAX ? I2C_SMBUS_BLOCK_MAX : b->len - off;
+        union i2c_smbus_data data;
+        data.block[0] = (uint8_t)chunk;
+        struct i2c_smbus_ioctl_data a = {
+            .read_write = I2C_SMBUS_READ,
+            .command = (uint8_t)(b->reg + off),
+            .size = I2C_SMBUS_I2C_BLOCK_DATA,
+            .data = &data,
+        };
+        uint64_t t0 = mono_ns();
+        int rc = ioctl(m->fd, I2C_SMBUS, &a);
+        m->busy_ns += mono_ns() - t0;
+        m->ioctls++;
+        m->msgs += 2;
+        if (rc < 0 || data.block[0] < chunk) return -1;
+        memcpy(dst + off, &data.block[1], chunk);
+        m->bytes_rx += chunk;
+        off += chunk;
+    }
+    return 0;
+}
+
+/* Lit un device seul (hors lot) : hors ligne (probe = premier bloc seulement),
+ * adaptateur SMBus, ou trop de segments pour un ioctl. Retour 0, -1. */
+static int read_alone(i2c_runtime_t* m, i2c_dev_t* d, bool probe){
+    size_t nb = probe ? (d->nblocks ? 1 : 0) : d->nblocks;
+    if (!m->rdwr) {
+        if (ioctl(m->fd, I2C_SLAVE, (unsigned long)d->cfg->addr) < 0) return -1;
+        for (size_t b = 0; b < nb; ++b)
+            if (smbus_read(m, &d->blocks[b], d->image + d->blocks[b].img_off) != 0) return -1;
+        return 0;
+    }
+    for (size_t b = 0; b < nb; ) {
+        size_t k = nb - b > I2C_MAX_MSGS / 2 ? I2C_MAX_MSGS / 2 : nb - b;
+        if (rdwr(m, &d->msgs[2 * b], 2 * k) != 0) return -1;
+        b += k;
+    }
+    return 0;
+}
+
+// Résultat d'une scrutation : publication, puis échéance suivante ou back-off
+static void finish(i2c_runtime_t* m, i2c_dev_t* d, int rc, bool complete, uint64_t now){
+    if (rc == 0 && complete) {
+        d->ok++;
+        int nm = decode_plan_run(&d->plan, d->image, d->image_len);
+        int jl = nm > 0 ? decode_plan_json(&d->plan) : -1;
+        if (jl > 0 && m->on_data)
+            m->on_data(d->label, d->plan.metrics, (size_t)nm, d->plan.json, (size_t)jl, now_s(), m->user);
+    }
+    if (rc != 0) d->errors++;
+
+    pthread_mutex_lock(&m->mu);
+    if (rc != 0) {
+        if (!d->backoff_ms) {
+            d->backoffs++;
+            d->backoff_ms = (uint32_t)(d->period_ns / 1000000ULL);
+            log_warn("i2c %s: device %s (0x%02x) not responding, backing off",
+                     m->path, d->label, (unsigned)d->cfg->addr);
+        }
+        d->backoff_ms = d->backoff_ms > I2C_BACKOFF_MAX_MS / 2 ? I2C_BACKOFF_MAX_MS : 2 * d->backoff_ms;
+        d->due_ns = now + (uint64_t)d->backoff_ms * 1000000ULL;
+    } else {
+        if (d->backoff_ms) {
+            log_info("i2c %s: device %s back online", m->path, d->label);
+            d->backoff_ms = 0;
+            d->due_ns = now;                    // lecture complète au prochain cycle
+        } else {
+            d->due_ns += d->period_ns;
+            if (d->due_ns < now) {              // période manquée : pas de rafale de rattrapage
+                d->overruns++;
+                d->due_ns = now;
+            }
+        }
+    }
+    pthread_mutex_unlock(&m->mu);
+}
+
+/* Un ioctl pour le lot ; en cas d'échec (NACK d'un device), chaque device du
+ * lot est relu seul pour ne pénaliser que le fautif. */
+static void flush_batch(i2c_runtime_t* m, size_t nsel, size_t nmsg, uint64_t now){
+    if (!nsel) return;
+    if (rdwr(m, m->batch, nmsg) == 0) {
+        for (size_t i = 0; i < nsel; ++i) finish(m, &m->devs[m->sel[i]], 0, true, now);
+        return;
+    }
+    if (nsel == 1) {
+        finish(m, &m->devs[m->sel[0]], -1, true, now);
+        return;
+    }
+    m->isolations++;
+    for (size_t i = 0; i < nsel; ++i) {
+        i2c_dev_t* d = &m->devs[m->sel[i]];
+        finish(m, d, read_alone(m, d, false), true, now);
+    }
+}
+
+// Tous les devices échus : en ligne groupés par ioctl, les autres seuls
+static void run_cycle(i2c_runtime_t* m, uint64_t now){
+    size_t nsel = 0, nmsg = 0;
+    m->cycles++;
+    for (size_t i = 0; i < m->ndevs; ++i) {
+        i2c_dev_t* d = &m->devs[i];
+        pthread_mutex_lock(&m->mu);
+        bool due = d->due_ns <= now;
+        bool offline = d->backoff_ms != 0;
+        pthread_mutex_unlock(&m->mu);
+        if (!due) continue;
+        d->polls++;
+
+        size_t need = 2 * d->nblocks;
+        if (offline || !m->rdwr || need > I2C_MAX_MSGS) {
+            finish(m, d, read_alone(m, d, offline), !offline, now);
+            continue;
+        }
+        if (nmsg + need > I2C_MAX_MSGS) {
+            flush_batch(m, nsel, nmsg, now);
+            nsel = nmsg = 0;
+        }
+        memcpy(&m->batch[nmsg], d->msgs, need * sizeof(*d->msgs));
+        nmsg += need;
+        m->sel[nsel++] = i;
+    }
+    flush_batch(m, nsel, nmsg, now);
+}
+
+static void* i2c_thread(void* arg){
+    i2c_runtime_t* m = (i2c_runtime_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-i2c");
+
+    pthread_mutex_lock(&m->mu);
+    while (!m->stop) {
+        uint64_t next = UINT64_MAX;
+        for (size_t i = 0; i < m->ndevs; ++i)
+            if (m->devs[i].due_ns < next) next = m->devs[i].due_ns;
+        uint64_t now = mono_ns();
+        if (next > now) {
+            struct timespec wake = ns_to_ts(next);
+            pthread_cond_timedwait(&m->cv, &m->mu, &wake);
+            continue;                           // arrêt ou échéance : on réévalue
+        }
+        pthread_mutex_unlock(&m->mu);
+        run_cycle(m, now);
+        pthread_mutex_lock(&m->mu);
+    }
+    pthread_mutex_unlock(&m->mu);
+    return NULL;
+}
+
+int i2c_open(i2c_runtime_t* m, const i2c_params_t* cfg,
+             const gateway_realtime_t* realtime, i2c_data_cb on_data, void* user){
+    if (!m || !cfg || cfg->devices_count == 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+    m->cfg = cfg;
+    m->realtime = realtime;
+    m->on_data = on_data;
+    m->user = user;
+    snprintf(m->path, sizeof(m->path), "/dev/i2c-%d", cfg->bus);
+
+    m->devs = (i2c_dev_t*)calloc(cfg->devices_count, sizeof(*m->devs));
+    m->sel = (size_t*)calloc(cfg->devices_count, sizeof(*m->sel));
+    m->batch = (struct i2c_msg*)calloc(I2C_MAX_MSGS, sizeof(*m->batch));
+    if (!m->devs || !m->sel || !m->batch) goto fail;
+
+    uint32_t def_ms = cfg->poll_ms ? cfg->poll_ms : 1000;
+    size_t npoints = 0, nblocks = 0;
+    uint64_t bits_blocks = 0, bits_points = 0;
+    for (size_t i = 0; i < cfg->devices_count; ++i) {
+        const i2c_device_t* c = &cfg->devices[i];
+        if (c->map_count == 0) {
+            log_warn("i2c %s: device 0x%02x has no map, not polled", m->path, (unsigned)c->addr);
+            continue;
+        }
+        i2c_dev_t* d = &m->devs[m->ndevs];
+        d->cfg = c;
+        if (c->name) snprintf(d->label, sizeof(d->label), "%s", c->name);
+        else         snprintf(d->label, sizeof(d->label), "0x%02x", (unsigned)c->addr);
+        d->period_ns = (uint64_t)(c->poll_ms ? c->poll_ms : def_ms) * 1000000ULL;
+        if (dev_compile(d, cfg->max_gap) != 0) {
+            log_err("i2c %s: invalid map for device %s", m->path, d->label);
+            goto fail;
+        }
+        m->ndevs++;
+        npoints += c->map_count;
+        nblocks += d->nblocks;
+        for (size_t b = 0; b < d->nblocks; ++b) bits_blocks += xfer_bits(d->blocks[b].len);
+        for (size_t p = 0; p < c->map_count; ++p) bits_points += xfer_bits(point_span(&c->map[p]));
+    }
+    if (!m->ndevs) goto fail;
+
+    m->fd = open(m->path, O_RDWR | O_CLOEXEC);
+    if (m->fd < 0) {
+        log_err("i2c %s: open failed: %s", m->path, strerror(errno));
+        goto fail;
+    }
+    unsigned long funcs = 0;
+    if (ioctl(m->fd, I2C_FUNCS, &funcs) < 0) {
+        log_err("i2c %s: I2C_FUNCS failed: %s", m->path, strerror(errno));
+        goto fail;
+    }
+    m->rdwr = (funcs & I2C_FUNC_I2C) != 0;
+    if (!m->rdwr && !(funcs & I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        log_err("i2c %s: adapter supports neither I2C_RDWR nor SMBus block reads", m->path);
+        goto fail;
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&m->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&m->mu, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &m->started);
+    uint64_t t0 = mono_ns();
+    for (size_t i = 0; i < m->ndevs; ++i) m->devs[i].due_ns = t0;
+    m->running = true;
+    if (pthread_create(&m->thread, NULL, i2c_thread, m) != 0) {
+        perror("pthread_create(i2c_thread)");
+        m->running = false;
+        pthread_cond_destroy(&m->cv);
+        pthread_mutex_destroy(&m->mu);
+        goto fail;
+    }
+
+    // speed_hz : fixée par le device tree, sert ici à estimer l'occupation du bus
+    double hz = cfg->speed_set && cfg->speed_hz > 0 ? (double)cfg->speed_hz : 100000.0;
+    log_info("i2c %s: %zu device(s), %zu point(s) in %zu block read(s) via %s; "
+             "~%.0f us/cycle at %.0f kHz (%.0f us reading point by point)",
+             m->path, m->ndevs, npoints, nblocks, m->rdwr ? "I2C_RDWR" : "SMBus",
+             (double)bits_blocks * 1e6 / hz, hz / 1000.0, (double)bits_points * 1e6 / hz);
+    return 0;
+
+fail:
+    if (m->fd >= 0) close(m->fd);
+    m->fd = -1;
+    for (size_t i = 0; i < m->ndevs; ++i) dev_free(&m->devs[i]);
+    free(m->devs);
+    free(m->sel);
+    free(m->batch);
+    m->devs = NULL;
+    m->sel = NULL;
+    m->batch = NULL;
+    m->ndevs = 0;
+    return -1;
+}
+
+void i2c_log_stats(i2c_runtime_t* m, const char* tag){
+    if (!m || !m->running) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double win = (double)ts_diff_ns(&now, &m->started);
+    log_info("[%s] i2c %s: %lu cycles, %lu ioctls (%.1f segments/ioctl), rx %lu bytes, "
+             "isolations %lu, bus util=%.2f%%",
+             tag ? tag : "i2c", m->path, m->cycles, m->ioctls,
+             m->ioctls ? (double)m->msgs / (double)m->ioctls : 0.0, m->bytes_rx, m->isolations,
+             win > 0 ? 100.0 * (double)m->busy_ns / win : 0.0);
+
+    pthread_mutex_lock(&m->mu);
+    for (size_t i = 0; i < m->ndevs; ++i) {
+        const i2c_dev_t* d = &m->devs[i];
+        log_info("[%s]   %s (0x%02x): %zu block(s), %lu polls, %lu ok, errors %lu, overruns %lu, back-offs %lu%s",
+                 tag ? tag : "i2c", d->label, (unsigned)d->cfg->addr, d->nblocks, d->polls, d->ok,
+                 d->errors, d->overruns, d->backoffs, d->backoff_ms ? " (offline)" : "");
+    }
+    pthread_mutex_unlock(&m->mu);
+}
+
+void i2c_close(i2c_runtime_t* m){
+    if (!m) return;
+    if (m->running) {
+        pthread_mutex_lock(&m->mu);
+        m->stop = 1;
+        pthread_cond_broadcast(&m->cv);
+        pthread_mutex_unlock(&m->mu);
+        pthread_join(m->thread, NULL);
+        pthread_cond_destroy(&m->cv);
+        pthread_mutex_destroy(&m->mu);
+        m->running = false;
+    }
+    if (m->fd >= 0) close(m->fd);
+    for (size_t i = 0; i < m->ndevs; ++i) dev_free(&m->devs[i]);
+    free(m->devs);
+    free(m->sel);
+    free(m->batch);
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+}
+
+void on_i2c_data(const char* device, const gw_metric_t* metrics, size_t n,
+                 const char* json, size_t json_len, double ts, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !json) return;
+
+    char topic[192];
+    snprintf(topic, sizeof(topic), "%s/%s", rt->topic_prefix[0] ? rt->topic_prefix : "ingest",
+             device ? device : "i2c");
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_I2C;
+    in.pl.data = (const uint8_t*)json;
+    in.pl.len = json_len;
+    in.pl.is_text = 1;
+    in.pl.content_type = "application/json";
+    in.pl.topic = topic;
+    in.timestamp = ts;
+    in.metrics = metrics;
+    in.metrics_count = n;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+/**
+ * @file conn_i2c.h
+ * @brief Scrutation des devices d'un connecteur i2c (/dev/i2c-N, i2c-dev).
+ *
+ * À l'ouverture, la map de chaque device est compilée : points triés par
+ * registre, plages [reg, reg+len) adjacentes (ou séparées de max_gap octets au
+ * plus) fusionnées en blocs, lus d'une traite grâce à l'auto-incrément du
+ * pointeur de registre (auto_increment: false = un bloc par point). Chaque bloc
+ * est une transaction combinée : écriture du numéro de registre, START répété,
+ * lecture ; les octets arrivent dans l'image du device, décodée par un
+ * decode_plan_t (type, endianness, scale) vers metrics/JSON.
+ *
+ * Un thread par bus. À chaque réveil, les blocs de tous les devices échus
+ * partent dans un seul ioctl(I2C_RDWR) (I2C_RDWR_IOCTL_MAX_MSGS segments au
+ * plus, sinon plusieurs) : un appel système et un passage dans le driver
+ * d'adaptateur par cycle au lieu d'un par registre. Un NACK fait échouer tout
+ * l'ioctl : le lot est alors rejoué device par device pour isoler le fautif,
+ * qui passe hors ligne (sondé seul, intervalle doublé jusqu'à 30 s).
+ *
+ * Adaptateurs SMBus seulement (sans I2C_FUNC_I2C, p.ex. le module i2c-stub) :
+ * mêmes blocs, lus par I2C_SMBUS_I2C_BLOCK_DATA (32 octets par lecture).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <linux/i2c.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t  reg;                   // premier registre (écrit avant la lecture)
+    uint16_t len;                   // octets lus
+    size_t   img_off;               // début du bloc dans l'image
+} i2c_block_t;
+
+typedef struct {
+    const i2c_device_t* cfg;
+    char            label[40];      // name, sinon "0xNN" (topic)
+    i2c_block_t*    blocks;
+    size_t          nblocks;
+    struct i2c_msg* msgs;           // 2 segments par bloc, prêts pour I2C_RDWR
+    uint8_t*        image;
+    size_t          image_len;
+    spi_field_t*    fields;         // un champ par point (offset dans l'image)
+    char*           names;          // noms par défaut "reg_0xNN"
+    decode_plan_t   plan;
+
+    uint64_t        due_ns;         // prochaine scrutation (CLOCK_MONOTONIC)
+    uint64_t        period_ns;
+    uint32_t        backoff_ms;     // 0 = en ligne
+
+    unsigned long polls, ok, errors, overruns, backoffs;
+} i2c_dev_t;
+
+/* Valeurs décodées d'un device (valides pendant l'appel seulement) :
+ * metrics[n] + rendu JSON {"nom":valeur,...}, ts = epoch s de l'acquisition. */
+typedef void (*i2c_data_cb)(const char* device, const gw_metric_t* metrics, size_t n,
+                            const char* json, size_t json_len, double ts, void* user);
+
+typedef struct {
+    const i2c_params_t* cfg;
+    char path[24];
+    int  fd;
+    bool rdwr;                      // I2C_FUNC_I2C : I2C_RDWR, sinon SMBus
+    const gateway_realtime_t* realtime;
+
+    i2c_data_cb on_data;
+    void*       user;
+
+    i2c_dev_t*      devs;
+    size_t          ndevs;
+    struct i2c_msg* batch;          // segments d'un ioctl (préalloué)
+    size_t*         sel;            // devices du lot
+
+    pthread_t       thread;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;             // CLOCK_MONOTONIC : attente d'échéance / arrêt
+    bool            running;
+    volatile int    stop;
+
+    unsigned long   cycles, ioctls, msgs, bytes_rx, isolations;
+    uint64_t        busy_ns;        // temps passé dans les ioctl
+    struct timespec started;
+} i2c_runtime_t;
+
+/* Ouvre /dev/i2c-<bus>, compile les maps et lance le thread de scrutation.
+ * Retour 0, -1. */
+int  i2c_open(i2c_runtime_t* m, const i2c_params_t* cfg,
+              const gateway_realtime_t* realtime, i2c_data_cb on_data, void* user);
+
+// Journalise bus (segments par ioctl, occupation) + devices
+void i2c_log_stats(i2c_runtime_t* m, const char* tag);
+
+void i2c_close(i2c_runtime_t* m);
+
+// Callback bridge : JSON + metrics -> transform -> send_fn, topic "<prefix>/<device>"
+// (user = gw_bridge_runtime_t*)
+void on_i2c_data(const char* device, const gw_metric_t* metrics, size_t n,
+                 const char* json, size_t json_len, double ts, void* user);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <mosquitto.h>
 #include "conn_mqtt.h"
 #include "log.h"
@@ -16,56 +17,131 @@ static char* xstrndup(const char* s, size_t n){ char* p=malloc(n+1); if(p){ memc
 #define strndup xstrndup
 
 /* --- petits helpers --- */
-static int parse_mqtt_url(const char* url, char** scheme, char** host, int* port){
-    /* Supporte mqtt://host:port et mqtts://host:port */
-    if(!url) return -1;
+int mqtt_parse_url(const char* url, char** scheme, char** host, int* port){
+    /* Supporte mqtt://host:port, mqtts://host:port et host[:port] ; port 0 = défaut du schéma */
+    if(!url || !scheme || !host || !port) return -1;
+    *scheme = NULL; *host = NULL; *port = 0;
     const char* p = strstr(url, "://");
-    if(!p) return -1;
-    *scheme = strndup(url, (size_t)(p - url));
-    const char* h = p + 3;
+    const char* h = url;
+    if(p){
+        *scheme = strndup(url, (size_t)(p - url));
+        h = p + 3;
+    }
     const char* colon = strrchr(h, ':');
     if(colon){
         *host = strndup(h, (size_t)(colon - h));
         *port = atoi(colon+1);
     }else{
         *host = strdup(h);
-        *port = 1883;
     }
-    return 0;
+    return *host ? 0 : -1;
 }
 
-/* glue pour callbacks */
-typedef struct {
-    mqtt_msg_cb on_msg;
-    void* user;
-    mqtt_runtime_t* rt;
-} cb_glue_t;
+static double ts_ms(const struct timespec* t){ return t->tv_sec*1e3 + t->tv_nsec/1e6; }
 
 static void on_connect(struct mosquitto* m, void* ud, int rc){
+    mqtt_runtime_t* rt = (mqtt_runtime_t*)ud;
+    if(rc != 0){
+        log_warn("MQTT CONNACK refused rc=%d", rc);
+        return;
+    }
+    /* (Re)souscriptions à chaque connexion : une session propre côté broker les aurait perdues */
+    if(rt->cfg){
+        const mqtt_params_t* p = &rt->cfg->params;
+        for(size_t i=0;i<p->topics_count;i++){
+            const char* t = p->topics[i].topic;
+            int qos = p->topics[i].qos_set ? p->topics[i].qos : (p->qos_set ? p->qos : 0);
+            if(t && *t){
+                int rc2 = mosquitto_subscribe(m, NULL, t, qos);
+                if(rc2 != MOSQ_ERR_SUCCESS) fprintf(stderr, "subscribe '%s' rc=%d\n", t, rc2);
+            }
+        }
+    }
+    if(rt->extra_sub){
+        int rc2 = mosquitto_subscribe(m, NULL, rt->extra_sub, rt->extra_qos);
+        if(rc2 != MOSQ_ERR_SUCCESS) log_warn("MQTT subscribe '%s' rc=%d", rt->extra_sub, rc2);
+    }
+    pthread_mutex_lock(&rt->stats_mu);
+    rt->stats.connects++;
+    pthread_mutex_unlock(&rt->stats_mu);
+    rt->connected = 1;
+    rt->connect_gen++;
+    if(rt->on_state) rt->on_state(rt->state_user);
+}
+
+static void on_disconnect(struct mosquitto* m, void* ud, int rc){
+    mqtt_runtime_t* rt = (mqtt_runtime_t*)ud;
+    rt->connected = 0;
+    pthread_mutex_lock(&rt->stats_mu);
+    rt->stats.disconnects++;
+    /* Will réarmé pendant la session : le loop thread ne se reconnecte qu'après ce callback */
+    if(rt->will_dirty && rt->will.topic){
+        int rc2 = mosquitto_will_set(m, rt->will.topic, rt->will.len,
+                                     rt->will.payload, rt->will.qos, rt->will.retain);
+        if(rc2 != MOSQ_ERR_SUCCESS) log_warn("MQTT will_set rc=%d", rc2);
+    }
+    rt->will_dirty = 0;
+    pthread_mutex_unlock(&rt->stats_mu);
+    if(rc != 0) log_warn("MQTT connection lost rc=%d (%s)", rc, mosquitto_strerror(rc));
+    if(rt->on_state) rt->on_state(rt->state_user);
+}
+
+static void on_publish(struct mosquitto* m, void* ud, int mid){
     (void)m;
-    cb_glue_t* g = (cb_glue_t*)ud;
-    if(rc==0) g->rt->connected = 1;
+    mqtt_runtime_t* rt = (mqtt_runtime_t*)ud;
+    struct timespec now; clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&rt->stats_mu);
+    unsigned slot = (unsigned)mid % MQTT_INFLIGHT_TRACK;
+    if(rt->inflight[slot].mid == mid){
+        double ms = ts_ms(&now) - ts_ms(&rt->inflight[slot].t);
+        mqtt_broker_stats_t* st = &rt->stats;
+        st->ack_ms_ewma = st->acks ? st->ack_ms_ewma + (ms - st->ack_ms_ewma) / 8.0 : ms;
+        if(ms > st->ack_ms_max) st->ack_ms_max = ms;
+        st->acks++;
+        rt->inflight[slot].mid = 0;
+    }
+    pthread_mutex_unlock(&rt->stats_mu);
 }
 
 static void on_message(struct mosquitto* m, void* ud, const struct mosquitto_message* msg){
     (void)m;
-    cb_glue_t* g = (cb_glue_t*)ud;
-    if(g->on_msg) g->on_msg(msg->topic, msg->payload, msg->payloadlen, g->user);
+    mqtt_runtime_t* rt = (mqtt_runtime_t*)ud;
+    if(rt->on_msg) rt->on_msg(msg->topic, msg->payload, msg->payloadlen, rt->user);
 }
 
-int mqtt_connect_from_config(const mqtt_connector_t* cfg,
-                             mqtt_runtime_t* rt,
-                             mqtt_msg_cb on_msg,
-                             void* user)
+/* Crée le client et applique les options communes (will, auth, TLS, callbacks).
+ * Le runtime est remis à zéro sauf le will déjà posé. */
+static int mqtt_setup(const mqtt_connector_t* cfg, const char* client_id,
+                      mqtt_runtime_t* rt, mqtt_msg_cb on_msg, void* user)
 {
-    if(!cfg || !rt) return -1;
+    mqtt_will_t will = rt->will;   // survit au reset du runtime
+    char* extra_sub = rt->extra_sub;
+    int   extra_qos = rt->extra_qos;
+    void (*on_state)(void*) = rt->on_state;
+    void* state_user = rt->state_user;
     memset(rt, 0, sizeof(*rt));
+    rt->will = will;
+    rt->extra_sub = extra_sub;
+    rt->extra_qos = extra_qos;
+    rt->on_state = on_state;
+    rt->state_user = state_user;
+    rt->cfg = cfg;
+    rt->on_msg = on_msg;
+    rt->user = user;
+    pthread_mutex_init(&rt->stats_mu, NULL);
+    rt->stats_mu_init = 1;
     mosquitto_lib_init();
 
-    const char* client_id = cfg->params.client_id ? cfg->params.client_id : "iotgw";
-    rt->mosq = mosquitto_new(client_id, cfg->params.clean_session_set ? cfg->params.clean_session : true, NULL);
+    rt->mosq = mosquitto_new(client_id, cfg->params.clean_session_set ? cfg->params.clean_session : true, rt);
     if(!rt->mosq) return -1;
 
+    /* Will (LWT) */
+    if(rt->will.topic){
+        int rc = mosquitto_will_set(rt->mosq, rt->will.topic, rt->will.len,
+                                    rt->will.payload, rt->will.qos, rt->will.retain);
+        if(rc != MOSQ_ERR_SUCCESS){ fprintf(stderr, "mqtt will_set=%d\n", rc); }
+    }
+
     /* user/pass */
     if(cfg->params.username || cfg->params.password){
         mosquitto_username_pw_set(rt->mosq,
@@ -88,19 +164,34 @@ int mqtt_connect_from_config(const mqtt_connector_t* cfg,
     }
 
     /* Callbacks */
-    static cb_glue_t glue;
-    glue.on_msg = on_msg;
-    glue.user   = user;
-    glue.rt     = rt;
     mosquitto_connect_callback_set(rt->mosq, on_connect);
+    mosquitto_disconnect_callback_set(rt->mosq, on_disconnect);
+    mosquitto_publish_callback_set(rt->mosq, on_publish);
     mosquitto_message_callback_set(rt->mosq, on_message);
-    mosquitto_user_data_set(rt->mosq, &glue);
+    mosquitto_reconnect_delay_set(rt->mosq, 1, 30, true);
+    return 0;
+}
+
+static void mqtt_teardown(mqtt_runtime_t* rt){
+    if(rt->mosq){ mosquitto_destroy(rt->mosq); rt->mosq=NULL; }
+    mosquitto_lib_cleanup();
+}
+
+int mqtt_connect_from_config(const mqtt_connector_t* cfg,
+                             mqtt_runtime_t* rt,
+                             mqtt_msg_cb on_msg,
+                             void* user)
+{
+    if(!cfg || !rt) return -1;
+
+    const char* client_id = cfg->params.client_id ? cfg->params.client_id : "iotgw";
+    if(mqtt_setup(cfg, client_id, rt, on_msg, user) != 0) return -1;
 
     /* Host/port */
     char *scheme=NULL,*host=NULL;
     int port = 0;
     if(cfg->params.url){
-        parse_mqtt_url(cfg->params.url, &scheme, &host, &port);
+        mqtt_parse_url(cfg->params.url, &scheme, &host, &port);
         if(port==0) port = (!scheme || strcmp(scheme,"mqtt")==0) ? 1883 : 8883;
     }else{
         host = cfg->params.host ? strdup(cfg->params.host) : strdup("localhost");
@@ -112,33 +203,87 @@ int mqtt_connect_from_config(const mqtt_connector_t* cfg,
     free(scheme); free(host);
     if(rc != MOSQ_ERR_SUCCESS){
         fprintf(stderr, "mosquitto_connect rc=%d\n", rc);
-        mosquitto_destroy(rt->mosq); rt->mosq=NULL;
-        mosquitto_lib_cleanup();
+        mqtt_teardown(rt);
         return -1;
     }
 
-    /* Souscriptions */
-    for(size_t i=0;i<cfg->params.topics_count;i++){
-        const char* t = cfg->params.topics[i].topic;
-        int qos = cfg->params.topics[i].qos_set ? cfg->params.topics[i].qos : (cfg->params.qos_set ? cfg->params.qos : 0);
-        if(t && *t){
-            int rc2 = mosquitto_subscribe(rt->mosq, NULL, t, qos);
-            if(rc2 != MOSQ_ERR_SUCCESS) fprintf(stderr, "subscribe '%s' rc=%d\n", t, rc2);
-        }
+    /* Thread loop (souscriptions faites dans on_connect) */
+    rc = mosquitto_loop_start(rt->mosq);
+    if(rc != MOSQ_ERR_SUCCESS){
+        fprintf(stderr, "loop_start rc=%d\n", rc);
+        mosquitto_disconnect(rt->mosq);
+        mqtt_teardown(rt);
+        return -1;
     }
+    return 0;
+}
 
-    /* Thread loop */
+int mqtt_connect_broker(const mqtt_connector_t* cfg,
+                        const char* host, int port,
+                        const char* client_suffix,
+                        mqtt_runtime_t* rt,
+                        mqtt_msg_cb on_msg,
+                        void* user)
+{
+    if(!cfg || !rt || !host) return -1;
+
+    /* client_id distinct par broker : un même id sur deux brokers pontés se ferait éjecter */
+    char client_id[128];
+    snprintf(client_id, sizeof(client_id), "%s%s",
+             cfg->params.client_id ? cfg->params.client_id : "iotgw",
+             client_suffix ? client_suffix : "");
+    if(mqtt_setup(cfg, client_id, rt, on_msg, user) != 0) return -1;
+
+    int keepalive = cfg->params.keepalive_set ? cfg->params.keepalive_s : 60;
+    int rc = mosquitto_connect_async(rt->mosq, host, port, keepalive);
+    if(rc != MOSQ_ERR_SUCCESS){
+        /* broker injoignable (DNS, refus, ...) : le loop thread retentera */
+        log_warn("MQTT %s:%d not reachable yet rc=%d (%s)", host, port, rc, mosquitto_strerror(rc));
+    }
     rc = mosquitto_loop_start(rt->mosq);
     if(rc != MOSQ_ERR_SUCCESS){
         fprintf(stderr, "loop_start rc=%d\n", rc);
-        mosquitto_disconnect(rt->mosq);
-        mosquitto_destroy(rt->mosq); rt->mosq=NULL;
-        mosquitto_lib_cleanup();
+        mqtt_teardown(rt);
         return -1;
     }
     return 0;
 }
-//MODIFIED__
+
+int mqtt_publish_raw(mqtt_runtime_t* rt, const char* topic,
+                     const void* payload, int len, int qos, bool retain)
+{
+    if(!rt || !rt->mosq || !topic || len < 0) return -1;
+    if(qos < 0) qos = 0; else if(qos > 2) qos = 2;
+
+    struct timespec t0; clock_gettime(CLOCK_MONOTONIC, &t0);
+    int mid = 0;
+    int rc = mosquitto_publish(rt->mosq, &mid, topic,
+                               payload ? len : 0,
+                               payload ? payload : "",
+                               qos, retain);
+    /* Pas de verrou pendant le publish (on_publish peut être rappelé par libmosquitto) ;
+     * un ack arrivé avant l'enregistrement ci-dessous fait simplement perdre l'échantillon. */
+    pthread_mutex_lock(&rt->stats_mu);
+    if(rc == MOSQ_ERR_SUCCESS){
+        rt->stats.pub_ok++;
+        unsigned slot = (unsigned)mid % MQTT_INFLIGHT_TRACK;
+        rt->inflight[slot].mid = mid;
+        rt->inflight[slot].t   = t0;
+    }else{
+        rt->stats.pub_fail++;
+    }
+    pthread_mutex_unlock(&rt->stats_mu);
+    return rc == MOSQ_ERR_SUCCESS ? 0 : -1;
+}
+
+void mqtt_get_stats(mqtt_runtime_t* rt, mqtt_broker_stats_t* out){
+    if(!rt || !out) return;
+    if(!rt->stats_mu_init){ memset(out, 0, sizeof(*out)); return; }
+    pthread_mutex_lock(&rt->stats_mu);
+    *out = rt->stats;
+    pthread_mutex_unlock(&rt->stats_mu);
+}
+
 int mqtt_publish_text(mqtt_runtime_t* rt,
                       const char* topic,
                       const char* payload,
@@ -162,17 +307,63 @@ int mqtt_publish_text(mqtt_runtime_t* rt,
 }
 
 
+int mqtt_set_will(mqtt_runtime_t* rt, const char* topic,
+                  const void* payload, int len, int qos, bool retain)
+{
+    if(!rt || !topic || len < 0) return -1;
+    mqtt_will_t w = {0};
+    w.topic = strdup(topic);
+    w.payload = len ? malloc((size_t)len) : NULL;
+    if(!w.topic || (len && !w.payload)){
+        free(w.topic); free(w.payload);
+        return -1;
+    }
+    if(len) memcpy(w.payload, payload, (size_t)len);
+    w.len = len;
+    w.qos = qos;
+    w.retain = retain;
+
+    /* Avant la connexion le mutex n'existe pas encore (créé par mqtt_setup) */
+    const int locked = rt->stats_mu_init;
+    if(locked) pthread_mutex_lock(&rt->stats_mu);
+    free(rt->will.topic); free(rt->will.payload);
+    rt->will = w;
+    if(rt->mosq) rt->will_dirty = 1;
+    if(locked) pthread_mutex_unlock(&rt->stats_mu);
+    return 0;
+}
+
+int mqtt_add_subscription(mqtt_runtime_t* rt, const char* topic, int qos){
+    if(!rt || !topic || rt->mosq) return -1;
+    char* t = strdup(topic);
+    if(!t) return -1;
+    free(rt->extra_sub);
+    rt->extra_sub = t;
+    rt->extra_qos = qos < 0 ? 0 : qos > 2 ? 2 : qos;
+    return 0;
+}
+
 void mqtt_close(mqtt_runtime_t* rt){
-    if(!rt || !rt->mosq) return;
-    mosquitto_loop_stop(rt->mosq, true);
-    mosquitto_disconnect(rt->mosq);
-    mosquitto_destroy(rt->mosq);
-    mosquitto_lib_cleanup();
-    rt->mosq = NULL;
+    if(!rt) return;
+    if(rt->mosq){
+        mosquitto_loop_stop(rt->mosq, true);
+        mosquitto_disconnect(rt->mosq);
+        mosquitto_destroy(rt->mosq);
+        mosquitto_lib_cleanup();
+        rt->mosq = NULL;
+        rt->connected = 0;
+    }
+    /* will libéré après l'arrêt du loop thread (on_disconnect le lit) */
+    free(rt->will.topic); free(rt->will.payload);
+    memset(&rt->will, 0, sizeof(rt->will));
+    rt->will_dirty = 0;
+    free(rt->extra_sub);
+    rt->extra_sub = NULL;
+    if(rt->stats_mu_init){ pthread_mutex_destroy(&rt->stats_mu); rt->stats_mu_init = 0; }
 }
 
 
-int mqtt_send_adapter(void* ctx, const gw_msg_t* msg)
+int mqtt_send_adapter(const gw_msg_t* msg, void* ctx)
 {
     mqtt_runtime_t* rt = (mqtt_runtime_t*)ctx;
     if (!rt || !rt->mosq || !msg) return -1;
@@ -184,13 +375,13 @@ int mqtt_send_adapter(void* ctx, const gw_msg_t* msg)
     int         qos     = 0;
     bool        retain  = false;
 
-    int rc = mosquitto_publish(rt->mosq, NULL, topic,
-                               payload ? len : 0,
-                               payload ? payload : "",
-                               qos, retain);
-    if (rc != MOSQ_ERR_SUCCESS) {
-        fprintf(stderr, "[mqtt] publish FAIL rc=%d (%s) topic=%s len=%d\n",
-                rc, mosquitto_strerror(rc), topic, len);
+    if (rt->cfg) {
+        if (rt->cfg->params.qos_set)    qos    = rt->cfg->params.qos;
+        if (rt->cfg->params.retain_set) retain = rt->cfg->params.retain;
+    }
+
+    if (mqtt_publish_raw(rt, topic, payload, len, qos, retain) != 0) {
+        fprintf(stderr, "[mqtt] publish FAIL topic=%s len=%d\n", topic, len);
         return -1;
     }
     fprintf(stderr, "[mqtt] publish OK topic=%s len=%d\n", topic, len);
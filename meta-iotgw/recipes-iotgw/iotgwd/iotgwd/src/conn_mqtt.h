@@ -1,5 +1,7 @@
 #pragma once
 #include <mosquitto.h>
+#include <pthread.h>
+#include <time.h>
 #include "connectors.h"   // contient mqtt_connector_t
 #include "gw_msg.h"
 #include "bridge.h"
@@ -9,21 +11,81 @@
 
 
 
+/* Message "will" (LWT) optionnel, enregistré à la connexion */
 typedef struct {
-    struct mosquitto *mosq;
-    int connected;
-} mqtt_runtime_t;
+    char*    topic;
+    uint8_t* payload;
+    int      len;
+    int      qos;
+    bool     retain;
+} mqtt_will_t;
 
 /* Callback message utilisateur: (topic, payload, payloadlen, user) */
 typedef void (*mqtt_msg_cb)(
     const char* topic, const void* payload, int payloadlen, void* user);
 
+/* Santé/latence d'un broker (mises à jour depuis le thread mosquitto et l'appelant) */
+#define MQTT_INFLIGHT_TRACK 32
+typedef struct {
+    unsigned long connects;
+    unsigned long disconnects;
+    unsigned long pub_ok;
+    unsigned long pub_fail;
+    unsigned long acks;            // PUBACK/PUBCOMP reçus (QoS>0) ou envois QoS0
+    double        ack_ms_ewma;     // latence publish -> on_publish, lissée (alpha 1/8)
+    double        ack_ms_max;
+} mqtt_broker_stats_t;
+
+typedef struct {
+    struct mosquitto *mosq;
+    volatile int connected;
+    volatile unsigned connect_gen;  // +1 à chaque CONNACK OK (re-birth Sparkplug, ...)
+    mqtt_will_t will;               // posé via mqtt_set_will() (sous stats_mu une fois connecté)
+    int         will_dirty;         // will changé en cours de session : appliqué à la déconnexion
+    char*       extra_sub;          // souscription posée par le code (NCMD Sparkplug), refaite à chaque connexion
+    int         extra_qos;
+
+    /* callbacks (user_data mosquitto = le runtime lui-même) */
+    const mqtt_connector_t* cfg;
+    mqtt_msg_cb on_msg;
+    void*       user;
+    void      (*on_state)(void* state_user);   // appelé à chaque (dé)connexion
+    void*       state_user;
+
+    /* suivi de latence : mid -> t_envoi (anneau, les plus anciens sont écrasés) */
+    pthread_mutex_t stats_mu;
+    int             stats_mu_init;
+    struct { int mid; struct timespec t; } inflight[MQTT_INFLIGHT_TRACK];
+    mqtt_broker_stats_t stats;
+} mqtt_runtime_t;
+
 /* Initialise, configure et lance le loop thread. Retour 0 = OK. */
 int mqtt_connect_from_config(const mqtt_connector_t* cfg,
                              mqtt_runtime_t* rt,
                              mqtt_msg_cb on_msg,
                              void* user);
 
+/* Connexion non bloquante à un broker explicite (host/port), options (auth, TLS,
+ * keepalive, will) reprises de cfg. client_id = cfg client_id + suffix.
+ * Le thread mosquitto se reconnecte seul ; un broker absent au démarrage n'est
+ * donc pas une erreur. Retour 0 = OK (runtime prêt), -1 = erreur locale. */
+int mqtt_connect_broker(const mqtt_connector_t* cfg,
+                        const char* host, int port,
+                        const char* client_suffix,
+                        mqtt_runtime_t* rt,
+                        mqtt_msg_cb on_msg,
+                        void* user);
+
+/* Publication brute (binaire) avec suivi santé/latence. Retour 0 = OK. */
+int mqtt_publish_raw(mqtt_runtime_t* rt, const char* topic,
+                     const void* payload, int len, int qos, bool retain);
+
+/* Décompose "mqtt[s]://host[:port]" (host/scheme alloués). Retour 0 = OK. */
+int mqtt_parse_url(const char* url, char** scheme, char** host, int* port);
+
+/* Copie cohérente des stats d'un broker */
+void mqtt_get_stats(mqtt_runtime_t* rt, mqtt_broker_stats_t* out);
+
 /* Publier un texte (UTF-8) avec QoS/retain. Retour 0 = OK. */
 int mqtt_publish_text(mqtt_runtime_t* rt,
                       const char* topic,
@@ -31,11 +93,21 @@ int mqtt_publish_text(mqtt_runtime_t* rt,
                       int qos,
                       bool retain);
 
+/* Enregistre un will (copié). Avant mqtt_connect_from_config() : utilisé dès la
+ * première connexion ; ensuite : appliqué depuis le loop thread à la prochaine
+ * déconnexion, donc pour la reconnexion suivante (bdSeq Sparkplug). */
+int mqtt_set_will(mqtt_runtime_t* rt, const char* topic,
+                  const void* payload, int len, int qos, bool retain);
+
+/* Ajoute une souscription (copiée) aux topics de cfg, refaite à chaque
+ * connexion. Avant mqtt_connect_from_config()/mqtt_connect_broker(). */
+int mqtt_add_subscription(mqtt_runtime_t* rt, const char* topic, int qos);
+
 /* S’arrête proprement. */
 void mqtt_close(mqtt_runtime_t* rt);
 
 
-int mqtt_send_adapter(void* ctx, const gw_msg_t* msg);
+int mqtt_send_adapter(const gw_msg_t* msg, void* ctx);   // gw_send_fn
 int http_to_mqtt_default(const gw_msg_t* in, gw_msg_t* out, void* user);
 
 
@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "conn_mqtt_multi.h"
+#include "log.h"
+
+static uint32_t fnv1a(const char* s){
+    uint32_t h = 2166136261u;
+    while(*s){ h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+/* Clé de répartition (spread) : le topic, ou <group>/<node> pour Sparkplug */
+static uint32_t spread_key(const char* topic){
+    static const char sp[] = "spBv1.0/";
+    if(strncmp(topic, sp, sizeof(sp)-1) != 0) return fnv1a(topic);
+    const char* group = topic + sizeof(sp)-1;
+    const char* type  = strchr(group, '/');
+    const char* node  = type ? strchr(type+1, '/') : NULL;
+    if(!node) return fnv1a(topic);   // STATE/<host>, topic tronqué...
+    node++;
+    const char* end = strchr(node, '/');
+    size_t nlen = end ? (size_t)(end - node) : strlen(node);
+
+    uint32_t h = 2166136261u;
+    for(const char* c=group; c<=type; c++){ h ^= (uint8_t)*c; h *= 16777619u; }   // "<group>/"
+    for(size_t i=0;i<nlen;i++){ h ^= (uint8_t)node[i]; h *= 16777619u; }
+    return h;
+}
+
+static int first_connected(const mqtt_multi_t* m){
+    for(size_t i=0;i<m->n;i++) if(m->b[i].connected) return (int)i;
+    return -1;
+}
+
+/* Appelé depuis les loop threads mosquitto à chaque (dé)connexion d'un broker */
+static void on_broker_state(void* user){
+    mqtt_multi_t* m = (mqtt_multi_t*)user;
+    pthread_mutex_lock(&m->mu);
+    unsigned gen = m->connect_gen;
+    if(m->strategy == MQTT_STRATEGY_FAILOVER){
+        int now = first_connected(m);
+        if(now != m->active){
+            if(m->active >= 0 && now >= 0) m->failovers++;
+            log_info("MQTT multi: active broker %s -> %s",
+                     m->active >= 0 ? m->label[m->active] : "none",
+                     now >= 0 ? m->label[now] : "none");
+            m->active = now;
+            if(now >= 0) m->connect_gen++;
+        }
+    }else{
+        /* spread : tout broker (re)connecté doit recevoir l'état initial */
+        m->active = first_connected(m);
+        m->connect_gen++;
+    }
+    bool changed = gen != m->connect_gen && m->active >= 0;
+    pthread_mutex_unlock(&m->mu);
+    // ex. NBIRTH Sparkplug : publié via mqtt_multi_send_adapter, qui reprend mu
+    if(changed && m->on_session) m->on_session(m->session_user);
+}
+
+int mqtt_multi_init(mqtt_multi_t* m, const mqtt_connector_t* cfg){
+    if(!m || !cfg || cfg->params.brokers_count == 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->cfg = cfg;
+    m->strategy = cfg->params.strategy_set ? cfg->params.strategy : MQTT_STRATEGY_FAILOVER;
+    m->n = cfg->params.brokers_count;
+    m->active = -1;
+    m->b = (mqtt_runtime_t*)calloc(m->n, sizeof(*m->b));
+    m->label = (char**)calloc(m->n, sizeof(*m->label));
+    if(!m->b || !m->label){ free(m->b); free(m->label); return -1; }
+    pthread_mutex_init(&m->mu, NULL);
+    for(size_t i=0;i<m->n;i++){
+        m->b[i].on_state   = on_broker_state;
+        m->b[i].state_user = m;
+    }
+    return 0;
+}
+
+int mqtt_multi_set_will(mqtt_multi_t* m, const char* topic,
+                        const void* payload, int len, int qos, bool retain){
+    if(!m) return -1;
+    for(size_t i=0;i<m->n;i++)
+        if(mqtt_set_will(&m->b[i], topic, payload, len, qos, retain) != 0) return -1;
+    return 0;
+}
+
+int mqtt_multi_add_subscription(mqtt_multi_t* m, const char* topic, int qos){
+    if(!m) return -1;
+    for(size_t i=0;i<m->n;i++)
+        if(mqtt_add_subscription(&m->b[i], topic, qos) != 0) return -1;
+    return 0;
+}
+
+int mqtt_multi_connect(mqtt_multi_t* m, mqtt_msg_cb on_msg, void* user){
+    if(!m || !m->b) return -1;
+    int started = 0;
+    for(size_t i=0;i<m->n;i++){
+        const mqtt_broker_t* br = &m->cfg->params.brokers[i];
+        char *scheme=NULL, *host=NULL;
+        int port = 0;
+        if(br->url){
+            mqtt_parse_url(br->url, &scheme, &host, &port);
+            if(port==0) port = (!scheme || strcmp(scheme,"mqtt")==0) ? 1883 : 8883;
+        }else{
+            host = br->host ? strdup(br->host) : NULL;
+            port = br->port ? br->port : 1883;
+        }
+        if(!host){ free(scheme); log_err("MQTT multi: broker #%zu has no host", i); continue; }
+
+        char label[160];
+        snprintf(label, sizeof(label), "%s:%d", host, port);
+        m->label[i] = strdup(label);
+
+        char suffix[24];
+        snprintf(suffix, sizeof(suffix), "-b%zu", i);
+        if(mqtt_connect_broker(m->cfg, host, port, suffix, &m->b[i], on_msg, user) == 0) started++;
+        else log_err("MQTT multi: client setup failed for %s", label);
+        free(scheme); free(host);
+    }
+    return started ? 0 : -1;
+}
+
+int mqtt_multi_send_adapter(const gw_msg_t* msg, void* ctx){
+    mqtt_multi_t* m = (mqtt_multi_t*)ctx;
+    if(!m || !msg || msg->protocole != KIND_MQTT) return -1;
+
+    const char* topic = (msg->pl.topic && msg->pl.topic[0]) ? msg->pl.topic : "ingest";
+    int  qos    = m->cfg->params.qos_set    ? m->cfg->params.qos    : 0;
+    bool retain = m->cfg->params.retain_set ? m->cfg->params.retain : false;
+
+    /* Point de départ : broker actif (failover) ou hash du topic (spread),
+     * puis sondage dans l'ordre si la publication échoue (broker tombé entre-temps). */
+    size_t start;
+    if(m->strategy == MQTT_STRATEGY_SPREAD){
+        start = spread_key(topic) % m->n;
+    }else{
+        pthread_mutex_lock(&m->mu);
+        int a = m->active;
+        pthread_mutex_unlock(&m->mu);
+        start = a >= 0 ? (size_t)a : 0;
+    }
+
+    for(size_t k=0;k<m->n;k++){
+        size_t i = (start + k) % m->n;
+        mqtt_runtime_t* b = &m->b[i];
+        if(!b->mosq || !b->connected) continue;
+        if(mqtt_publish_raw(b, topic, msg->pl.data, (int)msg->pl.len, qos, retain) == 0) return 0;
+    }
+    pthread_mutex_lock(&m->mu);
+    m->no_broker++;
+    pthread_mutex_unlock(&m->mu);
+    return -1;
+}
+
+void mqtt_multi_report(mqtt_multi_t* m, const char* tag){
+    if(!m) return;
+    pthread_mutex_lock(&m->mu);
+    int active = m->active;
+    unsigned long failovers = m->failovers, no_broker = m->no_broker;
+    pthread_mutex_unlock(&m->mu);
+
+    log_info("[%s] mqtt %s: active=%s failovers=%lu dropped(no broker)=%lu",
+             tag ? tag : "bridge",
+             m->strategy == MQTT_STRATEGY_SPREAD ? "spread" : "failover",
+             active >= 0 ? m->label[active] : "none", failovers, no_broker);
+    for(size_t i=0;i<m->n;i++){
+        mqtt_broker_stats_t st;
+        mqtt_get_stats(&m->b[i], &st);
+        log_info("[%s]   %-24s %s conn=%lu disc=%lu pub=%lu fail=%lu ack=%lu ack_ms avg=%.1f max=%.1f",
+                 tag ? tag : "bridge", m->label[i] ? m->label[i] : "?",
+                 m->b[i].connected ? "UP  " : "DOWN",
+                 st.connects, st.disconnects, st.pub_ok, st.pub_fail,
+                 st.acks, st.ack_ms_ewma, st.ack_ms_max);
+    }
+}
+
+void mqtt_multi_close(mqtt_multi_t* m){
+    if(!m || !m->b) return;
+    for(size_t i=0;i<m->n;i++){
+        m->b[i].on_state = NULL;      // plus de callbacks vers m pendant la fermeture
+        mqtt_close(&m->b[i]);
+        free(m->label[i]);
+    }
+    free(m->b); free(m->label);
+    m->b = NULL; m->label = NULL;
+    pthread_mutex_destroy(&m->mu);
+}
@@ -0,0 +1,60 @@
+#pragma once
+/**
+ * @file conn_mqtt_multi.h
+ * @brief Sink MQTT multi-broker (params.brokers[]).
+ *
+ * Une connexion (client + loop thread) par broker, toutes ouvertes au démarrage :
+ *  - failover : publie sur le premier broker connecté dans l'ordre de la liste.
+ *               Les suivants sont des standbys déjà connectés, la bascule est
+ *               immédiate (pas de reconnexion à attendre) et on revient sur le
+ *               primaire dès qu'il est de nouveau là.
+ *  - spread   : hash FNV-1a du topic -> broker ; un topic reste sur le même
+ *               broker (ordre conservé), on sonde le suivant s'il est tombé.
+ *               Topics Sparkplug (spBv1.0/<group>/<type>/<node>[/<device>]) :
+ *               hash de <group>/<node> seulement, NBIRTH/DBIRTH/DDATA/NDEATH
+ *               d'une même session restent ensemble sur un broker.
+ */
+#include <stdbool.h>
+#include <pthread.h>
+#include "conn_mqtt.h"
+#include "gw_msg.h"
+
+typedef struct {
+    const mqtt_connector_t* cfg;
+    mqtt_strategy_t strategy;
+
+    size_t          n;
+    mqtt_runtime_t* b;              // n runtimes, ordre = priorité
+    char**          label;          // "host:port" pour les logs
+
+    pthread_mutex_t mu;
+    int             active;         // failover : index publié (-1 = aucun), sous mu
+    volatile unsigned connect_gen;  // +1 quand la destination effective change (re-birth, ...)
+    void          (*on_session)(void* user);  // après chaque +1 de connect_gen, hors mu (loop thread)
+    void*           session_user;
+    unsigned long   failovers;      // changements de broker actif
+    unsigned long   no_broker;      // envois sans aucun broker connecté
+} mqtt_multi_t;
+
+/* Alloue les runtimes (rien n'est connecté). Retour 0 = OK. */
+int  mqtt_multi_init(mqtt_multi_t* m, const mqtt_connector_t* cfg);
+
+/* Will identique posé sur chaque broker : avant mqtt_multi_connect(), ou en
+ * cours de session pour les reconnexions suivantes (cf. mqtt_set_will). */
+int  mqtt_multi_set_will(mqtt_multi_t* m, const char* topic,
+                         const void* payload, int len, int qos, bool retain);
+
+/* Souscription identique sur chaque broker, refaite à chaque connexion
+ * (cf. mqtt_add_subscription). Avant mqtt_multi_connect(). */
+int  mqtt_multi_add_subscription(mqtt_multi_t* m, const char* topic, int qos);
+
+/* Lance toutes les connexions (asynchrones). Retour 0 si au moins un client a démarré. */
+int  mqtt_multi_connect(mqtt_multi_t* m, mqtt_msg_cb on_msg, void* user);
+
+/* gw_send_fn : msg->pl.topic / pl.data vers le broker choisi par la stratégie */
+int  mqtt_multi_send_adapter(const gw_msg_t* msg, void* ctx);
+
+/* Journalise santé/latence par broker */
+void mqtt_multi_report(mqtt_multi_t* m, const char* tag);
+
+void mqtt_multi_close(mqtt_multi_t* m);
@@ -0,0 +1,399 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "conn_onewire.h"
+#include "bridge.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#define OW_CONV_MAX_MS   1000u      // 750 ms en 12 bits + marge
+#define OW_CONV_STEP_MS  50u
+#define OW_POWER_ON_MDEG 85000      // registre non converti (mise sous tension)
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns){
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    return ts;
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* "28-00000abcdef0" / "2800000ABCDEF0" -> nom du répertoire sysfs
+ * ("%02x-%012llx", minuscules). */
+static void sysfs_id(const char* id, char* out, size_t outsz){
+    size_t k = 0;
+    for (size_t i = 0; id[i] && k + 1 < outsz; ++i) {
+        if (id[i] == '-') continue;
+        if (k == 2 && k + 2 < outsz) out[k++] = '-';
+        out[k++] = (char)tolower((unsigned char)id[i]);
+    }
+    out[k] = '\0';
+}
+
+// temperature (millidegrés), sinon w1_slave
+static int dev_open(ow_dev_t* d){
+    char path[512];
+    snprintf(path, sizeof(path), "%s/temperature", d->dir);
+    d->fd = open(path, O_RDONLY | O_CLOEXEC);
+    d->legacy = false;
+    if (d->fd < 0) {
+        snprintf(path, sizeof(path), "%s/w1_slave", d->dir);
+        d->fd = open(path, O_RDONLY | O_CLOEXEC);
+        d->legacy = true;
+    }
+    return d->fd < 0 ? -1 : 0;
+}
+
+// Un lecteur : pread du descripteur en cache, conversion en millidegrés
+static void read_dev(ow_dev_t* d){
+    d->reads++;
+    d->rc = 0;
+    if (d->fd < 0 && dev_open(d) != 0) {
+        d->missing++;
+        d->rc = ENOENT;
+        return;
+    }
+    char buf[128];
+    ssize_t n = pread(d->fd, buf, sizeof(buf) - 1, 0);
+    if (n < 0) {
+        d->rc = errno;
+        d->errors++;
+        if (errno == ENODEV || errno == ENOENT || errno == ESTALE) {   // sonde retirée
+            close(d->fd);
+            d->fd = -1;
+        }
+        return;
+    }
+    buf[n] = '\0';
+
+    const char* t = buf;
+    if (d->legacy) {
+        // "72 01 4b 46 7f ff 0e 10 57 : crc=57 YES\n72 01 ... t=23125\n"
+        const char* nl = strchr(buf, '\n');
+        const char* yes = strstr(buf, "YES");
+        t = strstr(buf, "t=");
+        if (!nl || !yes || yes > nl || !t) { d->rc = EBADMSG; d->bad++; return; }
+        t += 2;
+    }
+    char* end = NULL;
+    long v = strtol(t, &end, 10);
+    if (end == t || v == OW_POWER_ON_MDEG) { d->rc = EBADMSG; d->bad++; return; }
+    d->mdeg = (int32_t)v;
+    d->ok++;
+}
+
+static void* ow_reader(void* arg){
+    ow_runtime_t* m = (ow_runtime_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-w1-rd");
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&m->mu);
+    for (;;) {
+        while (!m->stop && m->gen == seen) pthread_cond_wait(&m->work_cv, &m->mu);
+        if (m->stop) break;
+        seen = m->gen;
+        pthread_mutex_unlock(&m->mu);
+
+        for (;;) {
+            size_t i = __atomic_fetch_add(&m->next, 1, __ATOMIC_RELAXED);
+            if (i >= m->ndevs) break;
+            read_dev(&m->devs[i]);
+        }
+
+        pthread_mutex_lock(&m->mu);
+        if (--m->pending == 0) pthread_cond_signal(&m->done_cv);
+    }
+    pthread_mutex_unlock(&m->mu);
+    return NULL;
+}
+
+// Attente interrompue par l'arrêt ; mu tenu. Retour 0, -1 si arrêt.
+static int wait_until(ow_runtime_t* m, uint64_t deadline){
+    struct timespec wake = ns_to_ts(deadline);
+    while (!m->stop && mono_ns() < deadline)
+        pthread_cond_timedwait(&m->cv, &m->mu, &wake);
+    return m->stop ? -1 : 0;
+}
+
+/* therm_bulk_read : déclenchement sur tous les maîtres, puis attente de fin de
+ * conversion ("-1" = en cours). Retour -1 si arrêt. */
+static int bulk_convert(ow_runtime_t* m){
+    size_t armed = 0;
+    for (size_t i = 0; i < m->nmasters; ++i) {
+        ow_master_t* w = &m->masters[i];
+        if (pwrite(w->fd, "trigger\n", 8, 0) == 8) { w->triggers++; armed++; }
+    }
+    if (!armed) return 0;
+
+    uint64_t t0 = mono_ns(), limit = t0 + (uint64_t)OW_CONV_MAX_MS * 1000000ULL;
+    bool busy = true;
+    while (busy) {
+        pthread_mutex_lock(&m->mu);
+        int rc = wait_until(m, mono_ns() + (uint64_t)OW_CONV_STEP_MS * 1000000ULL);
+        pthread_mutex_unlock(&m->mu);
+        if (rc != 0) return -1;
+        busy = false;
+        for (size_t i = 0; i < m->nmasters; ++i) {
+            char st[16];
+            ssize_t n = pread(m->masters[i].fd, st, sizeof(st) - 1, 0);
+            if (n <= 0) continue;
+            st[n] = '\0';
+            if (strtol(st, NULL, 10) < 0) busy = true;
+        }
+        if (busy && mono_ns() >= limit) {
+            // les lectures attendront la fin dans le noyau
+            for (size_t i = 0; i < m->nmasters; ++i) m->masters[i].timeouts++;
+            break;
+        }
+    }
+    m->conv_ns += mono_ns() - t0;
+    return 0;
+}
+
+// Lecture de toutes les sondes par les lecteurs ; retour -1 si arrêt
+static int read_all(ow_runtime_t* m){
+    uint64_t t0 = mono_ns();
+    pthread_mutex_lock(&m->mu);
+    __atomic_store_n(&m->next, 0, __ATOMIC_RELAXED);
+    m->pending = m->nreaders;
+    m->gen++;
+    pthread_cond_broadcast(&m->work_cv);
+    while (m->pending && !m->stop) pthread_cond_wait(&m->done_cv, &m->mu);
+    int rc = m->stop ? -1 : 0;
+    pthread_mutex_unlock(&m->mu);
+    m->read_ns += mono_ns() - t0;
+    return rc;
+}
+
+static void publish(ow_runtime_t* m){
+    double ts = now_s();
+    for (size_t i = 0; i < m->ndevs; ++i) {
+        const ow_dev_t* d = &m->devs[i];
+        if (d->rc != 0 || !m->on_data) continue;
+        gw_metric_t mt;
+        memset(&mt, 0, sizeof(mt));
+        mt.name = "temperature";
+        mt.type = GW_VAL_F64;
+        mt.v.f64 = d->mdeg / 1000.0;
+        char json[64];
+        int n = snprintf(json, sizeof(json), "{\"temperature\":%.3f}", mt.v.f64);
+        m->on_data(d->label, &mt, 1, json, (size_t)n, ts, m->user);
+    }
+}
+
+static void* ow_thread(void* arg){
+    ow_runtime_t* m = (ow_runtime_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-w1");
+
+    uint64_t period = (uint64_t)(m->cfg->poll_ms > 0 ? m->cfg->poll_ms : 1000) * 1000000ULL;
+    uint64_t due = mono_ns();
+    for (;;) {
+        pthread_mutex_lock(&m->mu);
+        int rc = wait_until(m, due);
+        pthread_mutex_unlock(&m->mu);
+        if (rc != 0) break;
+
+        uint64_t t0 = mono_ns();
+        if (bulk_convert(m) != 0 || read_all(m) != 0) break;
+        publish(m);
+        m->cycles++;
+
+        uint64_t now = mono_ns();
+        if (now - t0 > m->max_cycle_ns) m->max_cycle_ns = now - t0;
+        due += period;
+        if (due < now) {                    // cycle plus long que poll_ms
+            m->overruns++;
+            due = now;
+        }
+    }
+    return NULL;
+}
+
+// w1_bus_master*/therm_bulk_read (noyau >= 5.10)
+static void find_masters(ow_runtime_t* m){
+    DIR* dir = opendir(m->cfg->sysfs_path);
+    if (!dir) return;
+    struct dirent* e;
+    while ((e = readdir(dir)) != NULL) {
+        if (strncmp(e->d_name, "w1_bus_master", 13) != 0) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s/therm_bulk_read", m->cfg->sysfs_path, e->d_name);
+        int fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            log_warn("onewire %s: %s has no therm_bulk_read, sensors convert one by one",
+                     m->cfg->sysfs_path, e->d_name);
+            continue;
+        }
+        ow_master_t* w = (ow_master_t*)realloc(m->masters, (m->nmasters + 1) * sizeof(*w));
+        if (!w) { close(fd); break; }
+        m->masters = w;
+        memset(&w[m->nmasters], 0, sizeof(*w));
+        w[m->nmasters].fd = fd;
+        w[m->nmasters].path = strdup(path);
+        m->nmasters++;
+    }
+    closedir(dir);
+}
+
+static void release(ow_runtime_t* m){
+    for (size_t i = 0; i < m->ndevs; ++i) {
+        if (m->devs[i].fd >= 0) close(m->devs[i].fd);
+        free(m->devs[i].dir);
+    }
+    for (size_t i = 0; i < m->nmasters; ++i) {
+        close(m->masters[i].fd);
+        free(m->masters[i].path);
+    }
+    free(m->devs);
+    free(m->masters);
+    memset(m, 0, sizeof(*m));
+}
+
+int ow_open(ow_runtime_t* m, const onewire_sysfs_params_t* cfg,
+            const gateway_realtime_t* realtime, ow_data_cb on_data, void* user){
+    if (!m || !cfg || !cfg->sysfs_path || cfg->devices_count == 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->cfg = cfg;
+    m->realtime = realtime;
+    m->on_data = on_data;
+    m->user = user;
+
+    m->devs = (ow_dev_t*)calloc(cfg->devices_count, sizeof(*m->devs));
+    if (!m->devs) return -1;
+    size_t present = 0;
+    for (size_t i = 0; i < cfg->devices_count; ++i) {
+        const onewire_sysfs_device_t* c = &cfg->devices[i];
+        if (!c->id) continue;
+        ow_dev_t* d = &m->devs[m->ndevs++];
+        d->cfg = c;
+        d->fd = -1;
+        char id[32];
+        sysfs_id(c->id, id, sizeof(id));
+        snprintf(d->label, sizeof(d->label), "%s", c->name ? c->name : id);
+        if (asprintf(&d->dir, "%s/%s", cfg->sysfs_path, id) < 0) { d->dir = NULL; goto fail; }
+        if (dev_open(d) == 0) present++;
+        else log_warn("onewire %s: sensor %s not found (yet)", cfg->sysfs_path, id);
+    }
+    if (!m->ndevs) goto fail;
+    if (cfg->bulk_read) find_masters(m);
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&m->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_cond_init(&m->work_cv, NULL);
+    pthread_cond_init(&m->done_cv, NULL);
+    pthread_mutex_init(&m->mu, NULL);
+
+    size_t want = m->ndevs < OW_READERS_MAX ? m->ndevs : OW_READERS_MAX;
+    for (; m->nreaders < want; ++m->nreaders)
+        if (pthread_create(&m->readers[m->nreaders], NULL, ow_reader, m) != 0) break;
+    m->running = true;
+    if (!m->nreaders || pthread_create(&m->thread, NULL, ow_thread, m) != 0) {
+        perror("pthread_create(ow_thread)");
+        pthread_mutex_lock(&m->mu);
+        m->stop = 1;
+        pthread_cond_broadcast(&m->work_cv);
+        pthread_mutex_unlock(&m->mu);
+        for (size_t i = 0; i < m->nreaders; ++i) pthread_join(m->readers[i], NULL);
+        pthread_cond_destroy(&m->cv);
+        pthread_cond_destroy(&m->work_cv);
+        pthread_cond_destroy(&m->done_cv);
+        pthread_mutex_destroy(&m->mu);
+        m->running = false;
+        goto fail;
+    }
+
+    log_info("onewire %s: %zu sensor(s) (%zu present), %zu reader(s), bulk conversion on %zu master(s), every %d ms",
+             cfg->sysfs_path, m->ndevs, present, m->nreaders, m->nmasters,
+             cfg->poll_ms > 0 ? cfg->poll_ms : 1000);
+    return 0;
+
+fail:
+    release(m);
+    return -1;
+}
+
+void ow_log_stats(ow_runtime_t* m, const char* tag){
+    if (!m || !m->running) return;
+    double c = m->cycles ? (double)m->cycles : 1.0;
+    log_info("[%s] onewire %s: %lu cycles, conversion %.1f ms, reads %.1f ms avg, max cycle %.1f ms, overruns %lu",
+             tag ? tag : "w1", m->cfg->sysfs_path, m->cycles, (double)m->conv_ns / c / 1e6,
+             (double)m->read_ns / c / 1e6, (double)m->max_cycle_ns / 1e6, m->overruns);
+    for (size_t i = 0; i < m->nmasters; ++i)
+        log_info("[%s]   %s: %lu trigger(s), %lu timeout(s)", tag ? tag : "w1",
+                 m->masters[i].path, m->masters[i].triggers, m->masters[i].timeouts);
+    for (size_t i = 0; i < m->ndevs; ++i) {
+        const ow_dev_t* d = &m->devs[i];
+        log_info("[%s]   %s: %lu reads, %lu ok, errors %lu, bad %lu, missing %lu%s",
+                 tag ? tag : "w1", d->label, d->reads, d->ok, d->errors, d->bad, d->missing,
+                 d->legacy ? " (w1_slave)" : "");
+    }
+}
+
+void ow_close(ow_runtime_t* m){
+    if (!m) return;
+    if (m->running) {
+        pthread_mutex_lock(&m->mu);
+        m->stop = 1;
+        pthread_cond_broadcast(&m->cv);
+        pthread_cond_broadcast(&m->work_cv);
+        pthread_cond_broadcast(&m->done_cv);
+        pthread_mutex_unlock(&m->mu);
+        pthread_join(m->thread, NULL);
+        for (size_t i = 0; i < m->nreaders; ++i) pthread_join(m->readers[i], NULL);
+        pthread_cond_destroy(&m->cv);
+        pthread_cond_destroy(&m->work_cv);
+        pthread_cond_destroy(&m->done_cv);
+        pthread_mutex_destroy(&m->mu);
+        m->running = false;
+    }
+    release(m);
+}
+
+void on_onewire_data(const char* device, const gw_metric_t* metrics, size_t n,
+                     const char* json, size_t json_len, double ts, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !json) return;
+
+    char topic[192];
+    snprintf(topic, sizeof(topic), "%s/%s", rt->topic_prefix[0] ? rt->topic_prefix : "ingest",
+             device ? device : "w1");
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_ONEWIRE;
+    in.pl.data = (const uint8_t*)json;
+    in.pl.len = json_len;
+    in.pl.is_text = 1;
+    in.pl.content_type = "application/json";
+    in.pl.topic = topic;
+    in.timestamp = ts;
+    in.metrics = metrics;
+    in.metrics_count = n;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
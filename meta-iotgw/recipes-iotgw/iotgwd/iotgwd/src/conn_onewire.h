@@ -0,0 +1,110 @@
+#pragma once
+/**
+ * @file conn_onewire.h
+ * @brief Scrutation des sondes de température 1-Wire par le sysfs du noyau (w1).
+ *
+ * Une conversion DS18B20 dure jusqu'à 750 ms (12 bits) : lues l'une après
+ * l'autre, 40 sondes prennent ~30 s. À chaque cycle (poll_ms) :
+ *   1. bulk_read : "trigger" écrit dans therm_bulk_read de chaque
+ *      w1_bus_master* de sysfs_path, toutes les sondes du bus convertissent en
+ *      même temps ; attente de la fin (lecture != -1, 1 s au plus) ;
+ *   2. les fichiers temperature (w1_slave sur les noyaux sans cet attribut)
+ *      sont lus en parallèle par OW_READERS_MAX lecteurs au plus, chacun
+ *      prenant la sonde suivante ; descripteurs ouverts une fois, relus par
+ *      pread(fd, 0), rouverts seulement si la sonde disparaît ;
+ *   3. une publication par sonde, depuis le thread de scrutation.
+ * Le noyau sérialise les transactions d'un même maître : le parallélisme
+ * recouvre les conversions individuelles (sans therm_bulk_read, noyaux
+ * < 5.10) et les lectures de maîtres différents.
+ *
+ * Une lecture en échec (CRC "NO", valeur de mise sous tension 85000, EIO)
+ * n'est pas publiée. sysfs_path peut désigner une arborescence de test :
+ * <sysfs_path>/<id>/temperature contenant des millidegrés suffit.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "gw_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OW_READERS_MAX 8
+
+typedef struct {
+    const onewire_sysfs_device_t* cfg;
+    char    label[40];              // name, sinon id (topic)
+    char*   dir;                    // <sysfs_path>/<id>
+    int     fd;                     // -1 : rouvert au cycle suivant
+    bool    legacy;                 // w1_slave ("crc=.. YES" / "t=")
+
+    // résultat du cycle, écrit par un lecteur
+    int     rc;                     // 0, sinon errno
+    int32_t mdeg;
+
+    unsigned long reads, ok, errors, bad, missing;
+} ow_dev_t;
+
+typedef struct {
+    char* path;                     // .../w1_bus_masterN/therm_bulk_read
+    int   fd;
+    unsigned long triggers, timeouts;
+} ow_master_t;
+
+/* Température d'une sonde (valide pendant l'appel seulement) : metrics[n] +
+ * JSON {"temperature":..}, ts = epoch s de la lecture. */
+typedef void (*ow_data_cb)(const char* device, const gw_metric_t* metrics, size_t n,
+                           const char* json, size_t json_len, double ts, void* user);
+
+typedef struct {
+    const onewire_sysfs_params_t* cfg;
+    const gateway_realtime_t* realtime;
+
+    ow_data_cb on_data;
+    void*      user;
+
+    ow_dev_t*    devs;
+    size_t       ndevs;
+    ow_master_t* masters;
+    size_t       nmasters;
+
+    pthread_t       thread;
+    pthread_t       readers[OW_READERS_MAX];
+    size_t          nreaders;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;             // CLOCK_MONOTONIC : échéance, conversion, arrêt
+    pthread_cond_t  work_cv;        // nouveau cycle pour les lecteurs
+    pthread_cond_t  done_cv;        // lecteurs terminés
+    uint64_t        gen;            // numéro de cycle
+    size_t          next;           // prochaine sonde à lire (atomique)
+    size_t          pending;        // lecteurs encore actifs sur le cycle
+    bool            running;
+    volatile int    stop;
+
+    unsigned long   cycles, overruns;
+    uint64_t        conv_ns, read_ns, max_cycle_ns;
+} ow_runtime_t;
+
+/* Résout les sondes et maîtres de cfg->sysfs_path, lance la scrutation et les
+ * lecteurs. Retour 0, -1. */
+int  ow_open(ow_runtime_t* m, const onewire_sysfs_params_t* cfg,
+             const gateway_realtime_t* realtime, ow_data_cb on_data, void* user);
+
+// Journalise cycles (conversion/lecture) + sondes
+void ow_log_stats(ow_runtime_t* m, const char* tag);
+
+void ow_close(ow_runtime_t* m);
+
+// Callback bridge : JSON + metrics -> transform -> send_fn, topic "<prefix>/<device>"
+// (user = gw_bridge_runtime_t*)
+void on_onewire_data(const char* device, const gw_metric_t* metrics, size_t n,
+                     const char* json, size_t json_len, double ts, void* user);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,9 +10,11 @@
 
 #include "connector_registry.h"
 #include "conn_spi.h"
+#include "spi_bus.h"
 #include "bridge.h"
 #include "log.h"
 #include <time.h>
+#include <errno.h>
 
 /*
 la chaîne complète
@@ -29,7 +31,8 @@ spi_sync() → appelle master->transfer_one()
 4. Driver du contrôleur SPI (ex: spi-bcm2835.c sur Raspberry Pi) :
 Écrit dans les registres matériels du contrôleur SPI, déclenche l’horloge, gère MOSI/MISO/CS.
 */
-// ---- SPI trace helpers (unconditional to stderr) ----
+// ---- SPI trace helpers (stderr, compilés seulement avec -DIOTGWD_SPI_TRACE) ----
+#ifdef IOTGWD_SPI_TRACE
 static inline void dump_hex_stderr(const uint8_t* b, size_t n) {
     for (size_t i = 0; i < n; ++i) fprintf(stderr, " %02X", b[i]);
     fputc('\n', stderr);
@@ -48,6 +51,11 @@ static inline const char* op_str(int op){
     struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); \
     fprintf(stderr, "[spi %.3f] " fmt "\n", ts.tv_sec + ts.tv_nsec/1e9, ##__VA_ARGS__); \
 } while(0)
+#define SPI_DUMP(tag, b, n) do { fprintf(stderr, "[spi] " tag ":"); dump_hex_stderr((b), (n)); } while(0)
+#else
+#define SPI_T(fmt, ...)     do { } while(0)
+#define SPI_DUMP(tag, b, n) do { (void)(b); (void)(n); } while(0)
+#endif
 //------------ Helpers --------------
 
 //renvoie true si c'est un hex digit
@@ -125,64 +133,321 @@ static int parse_hex_bytes(const char* s,
 // Cast portable pour tx_buf/rx_buf (__u64 côté kernel)
 #define PTR_TO_U64(p) ((uintptr_t)(p))
 
+// ------------------ Programme compilé ------------------
+
+// Longueurs effectives d'une transaction (TX = len, RX selon op/rx_len)
+static int spi_txn_sizes(const spi_transaction_t* t, size_t* tx_len, size_t* rx_len)
+{
+    if (t->len == 0 || t->len > 4096) return -1;
+    if (t->has_rx_len && (t->rx_len == 0 || t->rx_len > 4096)) return -1;
+    *tx_len = t->len;
+    *rx_len = (t->op == SPI_OP_WRITE) ? 0 : (t->has_rx_len ? t->rx_len : t->len);
+    return 0;
+}
+
+// Décode le champ tx (hex) dans tx_buf (déjà à zéro). Pour un read pur on transmet des 0x00.
+static void spi_fill_tx(const spi_transaction_t* t, uint8_t* tx_buf, size_t tx_len)
+{
+    if (t->op == SPI_OP_READ || !t->has_tx || !t->tx) return;
+    size_t parsed = 0;
+    if (parse_hex_bytes(t->tx, tx_buf, tx_len, &parsed) != 0) {
+        // si parsing échoue, on tente copie binaire tronquée (pragmatique)
+        size_t src_len = strnlen(t->tx, tx_len);
+        memcpy(tx_buf, t->tx, src_len);
+    }
+    // si la chaîne ne fournit pas assez d'octets, le reste reste à 0x00
+}
+
+/* Prépare les segments d'une transaction :
+ * - rx_len == 0      : TX seul
+ * - rx_len == len    : un seul segment full-duplex
+ * - sinon            : TX commande puis RX (TX = dummy 0x00), CS tenu entre les deux.
+ * cs_change (config) ne s'applique qu'au dernier segment : CS laissé actif après
+ * la transaction. Entre segments d'une même transaction il reste à 0 (CS tenu). */
+static void spi_build_txn(spi_prog_txn_t* pt, const spi_transaction_t* t,
+                          uint8_t* tx, size_t tx_len, uint8_t* rx, size_t rx_len,
+                          const uint8_t* dummy, bool keep_cs, uint32_t speed_hz, uint8_t bpw)
+{
+    memset(pt, 0, sizeof(*pt));
+    pt->src    = t;
+    pt->rx     = rx_len ? rx : NULL;
+    pt->rx_len = rx_len;
+
+    struct spi_ioc_transfer* x = pt->xfer;
+    x[0].tx_buf        = PTR_TO_U64(tx);
+    x[0].len           = (uint32_t)tx_len;
+    x[0].speed_hz      = speed_hz;
+    x[0].bits_per_word = bpw;
+
+    if (rx_len == 0) {
+        pt->nxfer = 1;
+    } else if (rx_len == tx_len) {
+        x[0].rx_buf = PTR_TO_U64(rx);
+        pt->nxfer = 1;
+    } else {
+        x[1].tx_buf        = PTR_TO_U64(dummy);
+        x[1].rx_buf        = PTR_TO_U64(rx);
+        x[1].len           = (uint32_t)rx_len;
+        x[1].speed_hz      = speed_hz;
+        x[1].bits_per_word = bpw;
+        pt->nxfer = 2;
+    }
+    x[pt->nxfer - 1].cs_change = (uint8_t)keep_cs;
+}
+
+static void spi_program_free(spi_program_t* p)
+{
+    free(p->bx);
+    free(p->groups);
+    free(p->sel);
+    free(p->sub_bx);
+    free(p->sub_groups);
+    free(p->sub_sel);
+    for (size_t i = 0; p->txns && i < p->count; ++i) decode_plan_free(&p->txns[i].plan);
+    free(p->due);
+    free(p->rx_off);
+    free(p->txns);
+    free(p->arena);
+    free(p->dummy);
+    memset(p, 0, sizeof(*p));
+}
+
+// Limite d'octets TX (et RX) par message imposée par spidev
+static size_t spidev_bufsiz(void)
+{
+    size_t v = 4096;   // défaut du module
+    FILE* f = fopen("/sys/module/spidev/parameters/bufsiz", "r");
+    if (f) {
+        unsigned long x;
+        if (fscanf(f, "%lu", &x) == 1 && x > 0) v = (size_t)x;
+        fclose(f);
+    }
+    return v;
+}
+
+/* Met bout à bout les segments des transactions sel[0..nsel) et les découpe en
+ * groupes tenant chacun dans un SPI_IOC_MESSAGE(N). Pas d'allocation : bx,
+ * groups sont dimensionnés pour la liste complète. Retour : nombre de groupes. */
+static size_t spi_pack(const spi_program_t* p, const size_t* sel, size_t nsel,
+                       struct spi_ioc_transfer* bx, spi_batch_group_t* groups, bool keep_cs)
+{
+    size_t ng = 0, x = 0, tx_bytes = 0, rx_bytes = 0;
+    spi_batch_group_t* g = NULL;
+
+    for (size_t s = 0; s < nsel; ++s) {
+        const spi_prog_txn_t* pt = &p->txns[sel[s]];
+        size_t ttx = 0, trx = 0;
+        for (uint8_t k = 0; k < pt->nxfer; ++k) {
+            if (pt->xfer[k].tx_buf) ttx += pt->xfer[k].len;
+            if (pt->xfer[k].rx_buf) trx += pt->xfer[k].len;
+        }
+        if (!g || g->nxfer + pt->nxfer > SPI_BATCH_MAX_XFERS ||
+            tx_bytes + ttx > p->bufsiz || rx_bytes + trx > p->bufsiz) {
+            if (g) bx[x - 1].cs_change = (uint8_t)keep_cs;   // fin de message
+            g = &groups[ng++];
+            g->first_xfer = x;
+            g->first_sel  = s;
+            g->nxfer = g->ntxn = 0;
+            tx_bytes = rx_bytes = 0;
+        }
+        memcpy(&bx[x], pt->xfer, pt->nxfer * sizeof(*pt->xfer));
+        x += pt->nxfer;
+        // CS relâché entre transactions d'un même message
+        bx[x - 1].cs_change = 1;
+        g->nxfer += pt->nxfer;
+        g->ntxn++;
+        tx_bytes += ttx;
+        rx_bytes += trx;
+    }
+    // dernier segment du message : cs_change de la config (garder CS ou non)
+    if (g) bx[x - 1].cs_change = (uint8_t)keep_cs;
+    return ng;
+}
+
+// Prépare le mode batched : groupes statiques pour la liste complète + scratch pour les sous-ensembles
+static int spi_program_batch(spi_runtime_t* rt)
+{
+    spi_program_t* p = &rt->prog;
+    size_t nx = 0;
+    for (size_t i = 0; i < p->count; ++i) nx += p->txns[i].nxfer;
+
+    p->bx         = (struct spi_ioc_transfer*)calloc(nx, sizeof(*p->bx));
+    p->sub_bx     = (struct spi_ioc_transfer*)calloc(nx, sizeof(*p->sub_bx));
+    p->groups     = (spi_batch_group_t*)calloc(p->count, sizeof(*p->groups));  // <= 1 groupe / txn
+    p->sub_groups = (spi_batch_group_t*)calloc(p->count, sizeof(*p->sub_groups));
+    p->sel        = (size_t*)calloc(p->count, sizeof(*p->sel));
+    p->sub_sel    = (size_t*)calloc(p->count, sizeof(*p->sub_sel));
+    if (!p->bx || !p->sub_bx || !p->groups || !p->sub_groups || !p->sel || !p->sub_sel) return -1;
+
+    for (size_t i = 0; i < p->count; ++i) p->sel[i] = i;
+    p->bufsiz = spidev_bufsiz();
+    bool keep_cs = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+    p->groups_count = spi_pack(p, p->sel, p->count, p->bx, p->groups, keep_cs);
+
+    log_info("spi %s: batched %zu transaction(s) into %zu ioctl(s) per cycle (bufsiz=%zu)",
+             rt->cfg.device, p->count, p->groups_count, p->bufsiz);
+    return 0;
+}
+
+// Compile rt->cfg.transactions[] dans rt->prog (une seule arène TX/RX).
+static int spi_program_compile(spi_runtime_t* rt)
+{
+    spi_program_t* p = &rt->prog;
+    size_t n = rt->cfg.transactions ? rt->cfg.transactions_count : 0;
+    memset(p, 0, sizeof(*p));
+    if (n == 0) return 0;
+
+    size_t total = 0, max_rx = 0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t tl, rl;
+        if (spi_txn_sizes(&rt->cfg.transactions[i], &tl, &rl) != 0) {
+            log_err("spi: transaction %zu has invalid len/rx_len", i);
+            return -1;
+        }
+        total += tl + rl;
+        if (rl != tl && rl > max_rx) max_rx = rl;
+    }
+
+    p->txns  = (spi_prog_txn_t*)calloc(n, sizeof(*p->txns));
+    p->due   = (uint8_t*)calloc(n, 1);
+    p->rx_off = (size_t*)calloc(n, sizeof(*p->rx_off));
+    p->arena = (uint8_t*)calloc(total, 1);
+    p->dummy = max_rx ? (uint8_t*)calloc(max_rx, 1) : NULL;
+    if (!p->txns || !p->due || !p->rx_off || !p->arena || (max_rx && !p->dummy)) {
+        spi_program_free(p);
+        return -1;
+    }
+
+    bool keep_cs = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+    uint8_t* cur = p->arena;
+    for (size_t i = 0; i < n; ++i) {
+        const spi_transaction_t* t = &rt->cfg.transactions[i];
+        size_t tl = 0, rl = 0;
+        (void)spi_txn_sizes(t, &tl, &rl);
+        uint8_t* tx = cur;       cur += tl;
+        uint8_t* rx = cur;       cur += rl;
+        spi_fill_tx(t, tx, tl);
+        spi_build_txn(&p->txns[i], t, tx, tl, rx, rl, p->dummy,
+                      keep_cs, rt->speed_hz, rt->bits_per_word);
+        p->txns[i].period_ticks = 1;
+        p->rx_off[i] = p->rx_total;
+        p->rx_total += rl;
+    }
+    p->count = n;
+
+    for (size_t i = 0; i < n; ++i) {
+        const spi_transaction_t* t = &rt->cfg.transactions[i];
+        if (!t->fields_count) continue;
+        if (decode_plan_compile(&p->txns[i].plan, t->fields, t->fields_count,
+                                p->txns[i].rx_len, rt->bits_per_word) != 0) {
+            log_err("spi: transaction %zu: invalid fields", i);
+            spi_program_free(p);
+            return -1;
+        }
+    }
+
+    if (rt->cfg.batched_set && rt->cfg.batched && spi_program_batch(rt) != 0) {
+        spi_program_free(p);
+        return -1;
+    }
+    return 0;
+}
+
+// Horodatage de la trame en cours de dispatch (0 = appel inline, horodaté à la réception)
+static __thread double t_rx_ts;
+
+/* Remet le RX d'une transaction : copie dans la trame en cours d'écriture quand le
+ * dispatch est actif (thread de poll), sinon callback inline (passe initiale, ad-hoc). */
+static void spi_deliver(spi_runtime_t* rt, spi_prog_txn_t* pt)
+{
+    if (!pt->rx_len || !rt->on_rx) return;
+    spi_program_t* p = &rt->prog;
+    if (rt->dispatching && rt->writing >= 0 && pt >= p->txns && pt < p->txns + p->count) {
+        size_t i = (size_t)(pt - p->txns);
+        spi_frame_t* f = &rt->frames[rt->writing];
+        memcpy(f->rx + p->rx_off[i], pt->rx, pt->rx_len);
+        f->ran[i] = 1;
+        return;
+    }
+    rt->on_rx(pt->rx, pt->rx_len, rt->user, pt->src);
+}
+
+// Hot path : ioctl + remise du RX, aucune allocation
+static int spi_exec_compiled(spi_runtime_t* rt, spi_prog_txn_t* pt)
+{
+    rt_hot_enter();
+    int r = ioctl(rt->fd, SPI_IOC_MESSAGE(pt->nxfer), pt->xfer);
+    rt_hot_leave();
+    if (r < 0) return -1;
+    SPI_T("done op=%s rx_len=%zu", op_str(pt->src ? (int)pt->src->op : -1), pt->rx_len);
+    if (pt->rx_len) SPI_DUMP("RX", pt->rx, pt->rx_len);
+    spi_deliver(rt, pt);
+    return 0;
+}
+
 // ------------------ API ------------------
 
-//MODIFIED__
 // callback function
 void on_spi_rx(const uint8_t* rx, size_t rx_len, void* user, const spi_transaction_t* t)
 {
     SPI_T("on_spi_rx invoked, rx_len=%zu (t=%p)", rx_len, (void*)t);
-    if (rx && rx_len) { fprintf(stderr, "[spi] RX(cb):"); dump_hex_stderr(rx, rx_len); }
-    
+
     gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
     if (!rt || !rx || rx_len == 0) return;
 
-    // 1) Dupliquer le buffer RX (le driver le libère après le callback)
-    uint8_t* dup = (uint8_t*)malloc(rx_len);
-    if (!dup) return;
-    memcpy(dup, rx, rx_len);
-
-    // 2) Construire le message "in" conforme à TES structures
-    // Zero-init correct pour une struct C avec union :
+    // Le buffer RX (trame ou programme compilé) reste valide et inchangé pendant
+    // tout le callback : send_fn/transform doivent copier s'ils gardent les données
+    // (mosquitto_publish et le sink batch copient).
     gw_msg_t in;
     memset(&in, 0, sizeof(in));
 
     in.protocole = KIND_SPI;                 // source = SPI
-    in.pl.data = dup;                        // payload binaire
+    in.pl.data = rx;                         // payload binaire
     in.pl.len  = rx_len;
     in.pl.is_text = 0;                       // binaire
     in.pl.content_type = "application/octet-stream";  // hint utile pour le transform
 
-    // 3) Appliquer transform (si présent), sinon passer brut
+    // fields{} : valeurs typées (Sparkplug) + payload JSON à la place du RX brut
+    const spi_runtime_t* srt = (const spi_runtime_t*)rt->source_ctx;
+    if (srt && t && srt->cfg.transactions &&
+        t >= srt->cfg.transactions && t < srt->cfg.transactions + srt->prog.count) {
+        decode_plan_t* plan = &srt->prog.txns[t - srt->cfg.transactions].plan;
+        int n;
+        if (plan->count && (n = decode_plan_run(plan, rx, rx_len)) > 0) {
+            in.metrics = plan->metrics;
+            in.metrics_count = (size_t)n;
+            int jl = decode_plan_json(plan);
+            if (jl > 0) {
+                in.pl.data = (const uint8_t*)plan->json;
+                in.pl.len  = (size_t)jl;
+                in.pl.is_text = 1;
+                in.pl.content_type = "application/json";
+            }
+        }
+    }
+    if (t_rx_ts > 0) {
+        in.timestamp = t_rx_ts;              // instant d'acquisition, pas de dispatch
+    } else {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        in.timestamp = now.tv_sec + now.tv_nsec / 1e9;
+    }
+
+    // Appliquer transform (si présent), sinon passer brut
     if (rt->transform) {
         gw_msg_t out;
         memset(&out, 0, sizeof(out));
         int trc = rt->transform(&in, &out, rt->transform_user);
-        if (trc == 0) {
-            // NOTE: si ta transform ne copie pas le payload, elle peut réutiliser in.pl.*
-            // à toi de décider la convention. Ici on envoie 'out' s’il est rempli, sinon 'in'.
-            rt->send_fn(rt->send_ctx, &out);
-        } else {
-            // fallback: brut
-            rt->send_fn(rt->send_ctx, &in);
-        }
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
     } else {
-        // Pas de transform -> envoi brut
-        rt->send_fn(rt->send_ctx, &in);
+        rt->send_fn(&in, rt->send_ctx);
     }
-
-    log_err("dehors on_spi_rx");
-
-    // 4) Libère la copie locale (si send_fn/transform ne la garde pas)
-    // Si ton send_fn/transform ne copie PAS, remplace par une file/buffer persistant.
-    free(dup);
 }
 
 
-// Ouvre/configure le périphérique selon cfg. Copie cfg dans le runtime.
-// Retour 0 si OK, -1 sinon.
+// Ouvre/configure le périphérique selon cfg. Copie cfg dans le runtime et
+// compile la liste de transactions. Retour 0 si OK, -1 sinon.
 int spi_open_from_config(const spi_connector_t* cfg, spi_runtime_t* rt, spi_msg_cb on_rx, void* user) {
-    log_err("Dans spi_open_from_config");
     if (!cfg || !rt || !cfg->params.device) return -1;
     memset(rt, 0, sizeof(*rt));
 
@@ -202,6 +467,9 @@ int spi_open_from_config(const spi_connector_t* cfg, spi_runtime_t* rt, spi_msg_
     uint8_t bpw  = (uint8_t)(rt->cfg.bpw_set ? rt->cfg.bits_per_word : 8); // 8/16/32
     uint32_t hz  = (uint32_t)(rt->cfg.speed_set ? rt->cfg.speed_hz : 1000000); // 1 MHz
     uint8_t lsb  = (uint8_t)(rt->cfg.lsb_first_set && rt->cfg.lsb_first ? 1 : 0);
+    rt->speed_hz = hz;
+    rt->bits_per_word = bpw;
+    rt->priority = rt->cfg.priority_set ? rt->cfg.priority : 0;
 
     // Appliquer mode (legacy 8-bit suffit pour 0..3)
     SPI_TRY_SET(rt->fd, SPI_IOC_WR_MODE, SPI_IOC_RD_MODE, &mode);
@@ -223,7 +491,13 @@ int spi_open_from_config(const spi_connector_t* cfg, spi_runtime_t* rt, spi_msg_
 #else
     (void)lsb; // si pas supporté par l’en-tête
 #endif
-    log_err("dehors spi_open_from_config");
+
+    if (spi_program_compile(rt) != 0) {
+        close(rt->fd);
+        rt->fd = -1;
+        return -1;
+    }
+
     SPI_T("open OK fd=%d dev=%s mode=%u bpw=%u speed=%u lsb=%u txns=%zu",
      rt->fd,
      rt->cfg.device ? rt->cfg.device : "(null)",
@@ -233,276 +507,363 @@ int spi_open_from_config(const spi_connector_t* cfg, spi_runtime_t* rt, spi_msg_
     return 0;
 }
 
-// Envoie un “paquet” SPI simple :
-// - si rx_len == 0 : juste TX (write)
-// - si rx_len > 0 et (rx_len != len) : on fait 2 transfers (TX commande, puis RX lecture) avec CS tenu
-// - si rx_len > 0 et rx_len == len : un seul transfer full-duplex
-// keep_cs (cs_change) ne s’applique qu’entre segments.
-static int spi_send_once(spi_runtime_t* rt,
-                         const uint8_t* tx, size_t len,
-                         uint8_t* rx, size_t rx_len,
-                         bool keep_cs, uint32_t speed_hz, uint8_t bpw)
-{
-    if (!rt || rt->fd < 0) return -1;
-
-    int ret = -1;
-
-    if (rx_len == 0) {
-        // TX seulement
-        struct spi_ioc_transfer t = {
-            .tx_buf = PTR_TO_U64(tx),
-            .rx_buf = 0,
-            .len = (uint32_t)len,
-            .speed_hz = speed_hz,
-            .bits_per_word = bpw,
-            .cs_change = (uint8_t)keep_cs
-        };
-        ret = ioctl(rt->fd, SPI_IOC_MESSAGE(1), &t);
-        return (ret < 0) ? -1 : 0;
-    }
-
-    if (rx_len == len) {
-        // Full-duplex 1 segment
-        struct spi_ioc_transfer t = {
-            .tx_buf = PTR_TO_U64(tx),
-            .rx_buf = PTR_TO_U64(rx),
-            .len = (uint32_t)len,
-            .speed_hz = speed_hz,
-            .bits_per_word = bpw,
-            .cs_change = 0
-        };
-        ret = ioctl(rt->fd, SPI_IOC_MESSAGE(1), &t);
-        return (ret < 0) ? -1 : 0;
-    }
-
-    // Lecture taille différente : 2 segments (TX commande, puis RX lecture avec TX=0x00)
-    uint8_t* dummy = NULL;
-    if (rx_len > 0) {
-        dummy = (uint8_t*)calloc(rx_len, 1); // TX dummy = 0x00 pour clocker la lecture
-        if (!dummy) return -1;
-    }
-
-    struct spi_ioc_transfer tr[2];
-    memset(tr, 0, sizeof(tr));
-
-    tr[0].tx_buf = PTR_TO_U64(tx);
-    tr[0].rx_buf = 0;
-    tr[0].len = (uint32_t)len;
-    tr[0].speed_hz = speed_hz;
-    tr[0].bits_per_word = bpw;
-    tr[0].cs_change = 1; // garder CS actif entre les deux segments
-
-    tr[1].tx_buf = PTR_TO_U64(dummy);
-    tr[1].rx_buf = PTR_TO_U64(rx);
-    tr[1].len = (uint32_t)rx_len;
-    tr[1].speed_hz = speed_hz;
-    tr[1].bits_per_word = bpw;
-    tr[1].cs_change = (uint8_t)keep_cs; // si true, CS reste actif après (rarement utile)
-
-    ret = ioctl(rt->fd, SPI_IOC_MESSAGE(2), tr);
-    free(dummy);
-    return (ret < 0) ? -1 : 0;
-}
-
 // Exécute une transaction selon spi_transaction_t et invoque le callback si des RX existent.
+// Les transactions de la liste configurée utilisent le programme compilé ; une
+// transaction ad-hoc est compilée à la volée (chemin lent, hors polling).
 int spi_exec_transaction(spi_runtime_t* rt, const spi_transaction_t* t) {
-    log_err("Dans spi_exec_transaction");
-
-    if (!rt || !t) return -1;
-
-    // Paramètres effectifs (hérités du cfg)
-    uint32_t speed = (uint32_t)(rt->cfg.speed_set ? rt->cfg.speed_hz : 1000000);
-    uint8_t  bpw   = (uint8_t) (rt->cfg.bpw_set   ? rt->cfg.bits_per_word : 8);
-    bool keep_cs   = (rt->cfg.cs_change_set && rt->cfg.cs_change);
-
-    // bornes
-    if (t->len == 0 || t->len > 4096) return -1;
-    if (t->has_rx_len && (t->rx_len == 0 || t->rx_len > 4096)) return -1;
-
-    // Préparation du buffer TX
-    uint8_t* tx_buf = NULL;
-    size_t tx_len = t->len;
+    if (!rt || !t || rt->fd < 0) return -1;
+
+    if (rt->prog.count && t >= rt->cfg.transactions &&
+        t < rt->cfg.transactions + rt->prog.count)
+        return spi_exec_compiled(rt, &rt->prog.txns[t - rt->cfg.transactions]);
+
+    size_t tx_len, rx_len;
+    if (spi_txn_sizes(t, &tx_len, &rx_len) != 0) return -1;
+
+    // tx | rx | dummy dans un seul bloc
+    uint8_t* buf = (uint8_t*)calloc(tx_len + 2 * rx_len, 1);
+    if (!buf) return -1;
+    spi_fill_tx(t, buf, tx_len);
+
+    spi_prog_txn_t pt;
+    bool keep_cs = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+    spi_build_txn(&pt, t, buf, tx_len, buf + tx_len, rx_len, buf + tx_len + rx_len,
+                  keep_cs, rt->speed_hz, rt->bits_per_word);
+    SPI_DUMP("TX", buf, tx_len);
+    int rc = spi_exec_compiled(rt, &pt);
+    free(buf);
+    return rc;
+}
 
-    if (t->op == SPI_OP_READ) {
-        // read pur : on ne “transmet” rien d’utile → on enverra des 0x00
-        tx_buf = (uint8_t*)calloc(tx_len, 1);
-        if (!tx_buf) return -1;
-    } else {
-        // WRITE ou TRANSFER : s’il y a un champ tx, on le parse en hex ; sinon remplissage 0x00
-        tx_buf = (uint8_t*)calloc(tx_len, 1);
-        if (!tx_buf) return -1;
-        if (t->has_tx && t->tx) {
-            size_t parsed = 0;
-            if (parse_hex_bytes(t->tx, tx_buf, tx_len, &parsed) != 0) {
-                // si parsing échoue, on tente copie binaire tronquée (pragmatique)
-                size_t src_len = strnlen(t->tx, tx_len);
-                memcpy(tx_buf, t->tx, src_len);
-            } else if (parsed < tx_len) {
-                // si la chaîne ne fournit pas assez d’octets, le reste reste à 0x00
-            }
+static void spi_exec_groups(spi_runtime_t* rt, struct spi_ioc_transfer* bx,
+                            const spi_batch_group_t* groups, size_t ng, const size_t* sel)
+{
+    spi_program_t* p = &rt->prog;
+    for (size_t gi = 0; gi < ng; ++gi) {
+        const spi_batch_group_t* g = &groups[gi];
+        rt_hot_enter();
+        int r = ioctl(rt->fd, SPI_IOC_MESSAGE(g->nxfer), &bx[g->first_xfer]);
+        rt_hot_leave();
+        if (r < 0) {
+            log_warn("spi batched message %zu (%zu transactions) failed", gi, g->ntxn);
+            continue;
+        }
+        for (size_t s = g->first_sel; s < g->first_sel + g->ntxn; ++s) {
+            spi_prog_txn_t* pt = &p->txns[sel[s]];
+            pt->runs++;
+            spi_deliver(rt, pt);
         }
     }
-
-    // Calcul de la taille RX attendue
-    size_t rx_len = 0;
-    if (t->op == SPI_OP_READ) {
-        rx_len = t->has_rx_len ? t->rx_len : t->len; // par défaut, lire len octets
-    } else if (t->op == SPI_OP_TRANSFER) {
-        rx_len = t->has_rx_len ? t->rx_len : t->len; // idem
-    } else { // WRITE
-        rx_len = 0;
-    }
-
-    //Préparation du buffer RX (si besoin)
-    uint8_t* rx_buf = NULL;
-    if (rx_len > 0) {
-        rx_buf = (uint8_t*)malloc(rx_len);
-        if (!rx_buf) { free(tx_buf); return -1; }
-        memset(rx_buf, 0, rx_len);
-    }
-
-    SPI_T("start op=%s len=%zu rx_len=%zu keep_cs=%d speed=%u bpw=%u", 
-    op_str(t->op), tx_len, rx_len, (int)keep_cs, (unsigned)speed, (unsigned)bpw);
-    if (tx_buf && tx_len) { fprintf(stderr, "[spi] TX(pre):"); dump_hex_stderr(tx_buf, tx_len); }
-    // Exécution selon le type d’opération
-
-    int rc = 0;
-    switch (t->op) {
-        case SPI_OP_WRITE:
-            
-            rc = spi_send_once(rt, tx_buf, tx_len, NULL, 0, keep_cs, speed, bpw);
-            break;
-        case SPI_OP_READ:
-            // ici len = longueur de phase "commande" (souvent 1..x) → on enverra des 0x00
-            rc = spi_send_once(rt, tx_buf, tx_len, rx_buf, rx_len, keep_cs, speed, bpw);
-            SPI_T("done op=%s rc=%d tx_buf=%p rx_buf=%p tx_len=%zu rx_len=%zu",
-            op_str(t->op), rc, (void*)tx_buf, (void*)rx_buf, tx_len, rx_len);
-            if (tx_buf && tx_len) { fprintf(stderr, "[spi] TX:"); dump_hex_stderr(tx_buf, tx_len); }
-            if (rx_buf && rx_len) { fprintf(stderr, "[spi] RX:"); dump_hex_stderr(rx_buf, rx_len); }
-            break;
-        case SPI_OP_TRANSFER:
-            rc = spi_send_once(rt, tx_buf, tx_len, rx_buf, rx_len, keep_cs, speed, bpw);
-            SPI_T("done op=%s rc=%d tx_buf=%p rx_buf=%p tx_len=%zu rx_len=%zu",
-                op_str(t->op), rc, (void*)tx_buf, (void*)rx_buf, tx_len, rx_len);
-            if (tx_buf && tx_len) { fprintf(stderr, "[spi] TX:"); dump_hex_stderr(tx_buf, tx_len); }
-            if (rx_buf && rx_len) { fprintf(stderr, "[spi] RX:"); dump_hex_stderr(rx_buf, rx_len); }
-            break;
-        default:
-            rc = -1;
-            break;
-    }
-    // Callback utilisateur si on a reçu des données
-    if (rc == 0 && rx_len > 0 && rt->on_rx) {
-        rt->on_rx(rx_buf, rx_len, rt->user, t);
-    }
-
-    // Nettoyage et code de retour
-    free(tx_buf);
-    free(rx_buf);
-
-    log_err("Dehors spi_exec_transaction");
-
-    return rc;
 }
 
-//MODIFIED__
-// Exécute la liste de transactions fournie dans cfg->params.transactions
-int spi_run_transactions(spi_runtime_t* rt) {
-    SPI_T("run_transactions: count=%zu", (size_t)rt->cfg.transactions_count);
+// Exécute les transactions dues à ce tick (programme compilé, sans allocation)
+int spi_run_tick(spi_runtime_t* rt, uint64_t tick) {
     if (!rt) return -1;
-    if (!rt->cfg.transactions || rt->cfg.transactions_count == 0) {
-        SPI_T("no transactions configured");
-        return 0;
+    spi_program_t* p = &rt->prog;
+    size_t ndue = 0;
+    for (size_t i = 0; i < p->count; ++i) {
+        p->due[i] = (tick % p->txns[i].period_ticks) == 0;
+        ndue += p->due[i];
     }
+    if (ndue == 0) return 0;
 
-    for (size_t i = 0; i < rt->cfg.transactions_count; ++i) {
-        int rc = spi_exec_transaction(rt, &rt->cfg.transactions[i]);
-        if (rc != 0) {
-            log_warn("spi transaction %zu failed\n", i);
-            //return -1;
-        }else{
-            log_info("SPI transaction %zu succeeded", i);
+    if (p->bx) {
+        if (ndue == p->count) {
+            spi_exec_groups(rt, p->bx, p->groups, p->groups_count, p->sel);
+        } else {
+            size_t nsel = 0;
+            for (size_t i = 0; i < p->count; ++i) if (p->due[i]) p->sub_sel[nsel++] = i;
+            bool keep_cs = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+            size_t ng = spi_pack(p, p->sub_sel, nsel, p->sub_bx, p->sub_groups, keep_cs);
+            spi_exec_groups(rt, p->sub_bx, p->sub_groups, ng, p->sub_sel);
         }
+        return 0;
+    }
+    for (size_t i = 0; i < p->count; ++i) {
+        if (!p->due[i]) continue;
+        if (spi_exec_compiled(rt, &p->txns[i]) != 0)
+            log_warn("spi transaction %zu failed", i);
+        else
+            p->txns[i].runs++;
     }
-    SPI_T("run_transactions done (count=%zu)", (size_t)rt->cfg.transactions_count);
-
-
-
     return 0;
 }
 
+// Exécute toute la liste de transactions
+int spi_run_transactions(spi_runtime_t* rt) {
+    return spi_run_tick(rt, 0);
+}
+
 // Envoi ad-hoc (hors liste), pratique pour un “adapter” style mqtt_send_adapter
 // Si rx_len > 0, on renvoie via callback (si défini).
 int spi_send_adapter(const uint8_t* tx, size_t len, size_t rx_len, void* ctx) {
     spi_runtime_t* rt = (spi_runtime_t*)ctx;
     if (!rt || rt->fd < 0 || !tx || len == 0) return -1;
 
-    uint32_t speed = (uint32_t)(rt->cfg.speed_set ? rt->cfg.speed_hz : 1000000);
-    uint8_t  bpw   = (uint8_t) (rt->cfg.bpw_set   ? rt->cfg.bits_per_word : 8);
-    bool keep_cs   = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+    uint8_t* buf = (uint8_t*)calloc(len + 2 * rx_len, 1);
+    if (!buf) return -1;
+    memcpy(buf, tx, len);
+
+    spi_prog_txn_t pt;
+    bool keep_cs = (rt->cfg.cs_change_set && rt->cfg.cs_change);
+    spi_build_txn(&pt, NULL, buf, len, buf + len, rx_len, buf + len + rx_len,
+                  keep_cs, rt->speed_hz, rt->bits_per_word);
+    // Pas de spi_transaction_t formel ici → on passe NULL
+    int rc = spi_exec_compiled(rt, &pt);
+    free(buf);
+    return rc;
+}
 
-    uint8_t* tx_buf = (uint8_t*)malloc(len);
-    if (!tx_buf) return -1;
-    memcpy(tx_buf, tx, len);
 
-    uint8_t* rx_buf = NULL;
-    if (rx_len > 0) {
-        rx_buf = (uint8_t*)malloc(rx_len);
-        if (!rx_buf) { free(tx_buf); return -1; }
-        memset(rx_buf, 0, rx_len);
-    }
+static uint64_t gcd_u64(uint64_t a, uint64_t b){ while (b) { uint64_t t = a % b; a = b; b = t; } return a; }
 
-    int rc = spi_send_once(rt, tx_buf, len, rx_buf, rx_len, keep_cs, speed, bpw);
+#define SPI_MIN_TICK_NS 100000ULL   // 100 µs : en dessous, PGCD pathologique (périodes non multiples)
 
-    if (rc == 0 && rx_buf && rt->on_rx) {
-        // Pas de spi_transaction_t formel ici → on passe NULL
-        rt->on_rx(rx_buf, rx_len, rt->user, NULL);
+// Tick commun = PGCD des périodes ; chaque transaction tourne tous les period_ticks
+static void spi_schedule(spi_runtime_t* rt, uint64_t poll_ns)
+{
+    spi_program_t* p = &rt->prog;
+    uint64_t tick = poll_ns;
+    for (size_t i = 0; i < p->count; ++i) {
+        const spi_transaction_t* t = p->txns[i].src;
+        uint64_t per = (t && t->has_period) ? (uint64_t)t->period_us * 1000ULL : poll_ns;
+        tick = gcd_u64(tick, per);
+    }
+    if (tick < SPI_MIN_TICK_NS) {
+        log_warn("spi %s: periods share no common tick >= 100us, rounding to 100us",
+                 rt->cfg.device ? rt->cfg.device : "?");
+        tick = SPI_MIN_TICK_NS;
+    }
+    p->tick_ns = tick;
+    for (size_t i = 0; i < p->count; ++i) {
+        const spi_transaction_t* t = p->txns[i].src;
+        uint64_t per = (t && t->has_period) ? (uint64_t)t->period_us * 1000ULL : poll_ns;
+        uint64_t k = (per + tick / 2) / tick;
+        p->txns[i].period_ticks = (uint32_t)(k ? k : 1);
     }
+}
 
-    free(tx_buf);
-    free(rx_buf);
-    return rc;
+static inline void ts_add_ns(struct timespec* t, uint64_t ns){
+    ns += (uint64_t)t->tv_nsec;
+    t->tv_sec += (time_t)(ns / 1000000000ULL);
+    t->tv_nsec = (long)(ns % 1000000000ULL);
 }
 
+static inline int64_t ts_diff_ns(const struct timespec* a, const struct timespec* b){
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
 
-static void* spi_poll_thread(void* arg) {
+// ---- Trames acquisition -> dispatch ----
 
+// Choisit une trame libre pour le tick (jamais celle en cours de dispatch)
+static void spi_frame_begin(spi_runtime_t* rt, uint64_t tick)
+{
+    pthread_mutex_lock(&rt->fmu);
+    int w = rt->reading >= 0 ? 1 - rt->reading : (rt->pending == 0 ? 1 : 0);
+    if (w == rt->pending) {            // dispatch en retard : on écrase la plus ancienne
+        rt->pending = -1;
+        rt->frame_overruns++;
+    }
+    rt->writing = w;
+    pthread_mutex_unlock(&rt->fmu);
+
+    spi_frame_t* f = &rt->frames[w];
+    memset(f->ran, 0, rt->prog.count);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    f->ts   = now.tv_sec + now.tv_nsec / 1e9;
+    f->tick = tick;
+}
+
+// Publie la trame du tick au dispatcher (une trame encore non prise est perdue)
+static void spi_frame_commit(spi_runtime_t* rt)
+{
+    const spi_program_t* p = &rt->prog;
+    const spi_frame_t* f = &rt->frames[rt->writing];
+    bool any = false;
+    for (size_t i = 0; i < p->count && !any; ++i) any = f->ran[i];
+
+    pthread_mutex_lock(&rt->fmu);
+    if (any) {
+        if (rt->pending >= 0) rt->frame_overruns++;
+        rt->pending = rt->writing;
+        pthread_cond_signal(&rt->fcv);
+    }
+    rt->writing = -1;
+    pthread_mutex_unlock(&rt->fmu);
+}
 
+static void* spi_dispatch_thread(void* arg) {
     spi_runtime_t* rt = (spi_runtime_t*)arg;
-    const int sleep_ms = (rt->poll_ms > 0 ? rt->poll_ms : 1000);
+    const spi_program_t* p = &rt->prog;
+    rt_sched_thread_enter(NULL, "iotgw-spi-tx");
+
+    pthread_mutex_lock(&rt->fmu);
+    for (;;) {
+        while (rt->pending < 0 && !rt->dstop)
+            pthread_cond_wait(&rt->fcv, &rt->fmu);
+        if (rt->pending < 0) break;        // arrêt, plus rien à vider
+        rt->reading = rt->pending;
+        rt->pending = -1;
+        pthread_mutex_unlock(&rt->fmu);
+
+        const spi_frame_t* f = &rt->frames[rt->reading];
+        t_rx_ts = f->ts;
+        for (size_t i = 0; i < p->count; ++i) {
+            if (!f->ran[i]) continue;
+            rt->on_rx(f->rx + p->rx_off[i], p->txns[i].rx_len, rt->user, p->txns[i].src);
+        }
+        t_rx_ts = 0;
 
-    SPI_T("poll thread start (period=%d ms)", sleep_ms);
+        pthread_mutex_lock(&rt->fmu);
+        rt->reading = -1;
+        rt->frames_dispatched++;
+    }
+    pthread_mutex_unlock(&rt->fmu);
+    return NULL;
+}
 
-    while (!rt->stop_flag) {
-        // re-run the configured transactions; on_rx() will be invoked for RX
-        (void)spi_run_transactions(rt);
-        if (sleep_ms > 0) usleep(sleep_ms * 1000);
-        else sched_yield();
+static void spi_frames_free(spi_runtime_t* rt) {
+    for (int k = 0; k < SPI_FRAMES; ++k) {
+        free(rt->frames[k].rx);
+        free(rt->frames[k].ran);
+        memset(&rt->frames[k], 0, sizeof(rt->frames[k]));
     }
-    SPI_T("poll thread stop");
+}
 
-    return NULL;
+// Alloue les trames et démarre le dispatcher. Retour 0 = OK (ou rien à dispatcher).
+static int spi_dispatch_start(spi_runtime_t* rt) {
+    const spi_program_t* p = &rt->prog;
+    rt->writing = rt->pending = rt->reading = -1;
+    if (!rt->on_rx || p->rx_total == 0) return 0;
+
+    for (int k = 0; k < SPI_FRAMES; ++k) {
+        rt->frames[k].rx  = (uint8_t*)calloc(p->rx_total, 1);
+        rt->frames[k].ran = (uint8_t*)calloc(p->count, 1);
+        if (!rt->frames[k].rx || !rt->frames[k].ran) { spi_frames_free(rt); return -1; }
+    }
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setprotocol(&ma, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&rt->fmu, &ma);
+    pthread_mutexattr_destroy(&ma);
+    pthread_cond_init(&rt->fcv, NULL);
+    rt->dstop = 0;
+    if (pthread_create(&rt->dispatcher, NULL, spi_dispatch_thread, rt) != 0) {
+        perror("pthread_create(spi_dispatch_thread)");
+        pthread_cond_destroy(&rt->fcv);
+        pthread_mutex_destroy(&rt->fmu);
+        spi_frames_free(rt);
+        return -1;
+    }
+    rt->dispatching = 1;
+    return 0;
+}
+
+// Vide la dernière trame en attente puis arrête le dispatcher (poller déjà arrêté)
+static void spi_dispatch_stop(spi_runtime_t* rt) {
+    if (!rt->dispatching) return;
+    pthread_mutex_lock(&rt->fmu);
+    rt->dstop = 1;
+    pthread_cond_signal(&rt->fcv);
+    pthread_mutex_unlock(&rt->fmu);
+    pthread_join(rt->dispatcher, NULL);
+    rt->dispatching = 0;
+    pthread_cond_destroy(&rt->fcv);
+    pthread_mutex_destroy(&rt->fmu);
+    spi_frames_free(rt);
+}
+
+/* Un tick du device, appelé par le thread du bus quand rt->next est échu :
+ * acquisition, puis échéance suivante sur la grille absolue (jamais "maintenant +
+ * période"). Retour : durée d'occupation du bus (ns). */
+uint64_t spi_poll_due(spi_runtime_t* rt, const struct timespec* now)
+{
+    spi_program_t* p = &rt->prog;
+    const uint64_t tick_ns = p->tick_ns;
+    rt_jitter_add(&rt->jitter, ts_diff_ns(now, &rt->next));
+
+    // Acquisition seule : les RX partent dans une trame, transform/send tournent
+    // dans le thread de dispatch
+    struct timespec t0, t1;
+    rt_hot_enter();
+    if (rt->dispatching) spi_frame_begin(rt, rt->tick);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    (void)spi_run_tick(rt, rt->tick);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (rt->dispatching) spi_frame_commit(rt);
+    rt_hot_leave();
+    rt->cycles++;
+
+    ts_add_ns(&rt->next, tick_ns);
+    uint64_t tick = ++rt->tick;
+    int64_t late = ts_diff_ns(&t1, &rt->next);
+    if (late >= 0) {
+        // Cycle trop long : on saute les échéances passées en restant sur la grille
+        uint64_t skip = (uint64_t)late / tick_ns + 1;
+        rt->overruns++;
+        rt->missed_ticks += skip;
+        for (size_t i = 0; i < p->count; ++i) {
+            uint64_t per = p->txns[i].period_ticks;
+            // échéances de la transaction dans [tick, tick+skip)
+            p->txns[i].missed += (tick + skip - 1) / per - (tick ? (tick - 1) / per : 0)
+                                 + (tick == 0);
+        }
+        rt->tick += skip;
+        ts_add_ns(&rt->next, skip * tick_ns);
+    }
+    return (uint64_t)ts_diff_ns(&t1, &t0);
 }
 
 int spi_start_polling(spi_runtime_t* rt, int poll_ms) {
     if (!rt) return -1;
     if (rt->polling) return 0;
-    rt->poll_ms   = (poll_ms > 0 ? poll_ms : 1000);
-    rt->stop_flag = 0;
-    rt->polling   = 1;
-    if (pthread_create(&rt->thread, NULL, spi_poll_thread, rt) != 0) {
-        perror("pthread_create(spi_poll_thread)");
-        rt->polling = 0;
+    uint64_t poll_ns = poll_ms > 0 ? (uint64_t)poll_ms * 1000000ULL
+                     : rt->cfg.poll_set ? (uint64_t)rt->cfg.poll_us * 1000ULL
+                     : 1000000000ULL;
+    rt->poll_ms   = (int)(poll_ns / 1000000ULL);
+    spi_schedule(rt, poll_ns);
+    if (spi_dispatch_start(rt) != 0) return -1;
+    rt->tick = 0;
+    rt_jitter_reset(&rt->jitter);
+    SPI_T("polling start (tick=%llu ns)", (unsigned long long)rt->prog.tick_ns);
+    // Le thread du bus exécute ce device entrelacé avec les autres CS du même contrôleur
+    if (spi_bus_attach(rt) != 0) {
+        spi_dispatch_stop(rt);
         return -1;
     }
+    rt->polling = 1;
     return 0;
 }
 
+void spi_log_stats(spi_runtime_t* rt, const char* tag) {
+    if (!rt) return;
+    spi_program_t* p = &rt->prog;
+    log_info("[%s] spi %s: tick=%.3f ms cycles=%lu overruns=%lu missed_ticks=%lu",
+             tag ? tag : "spi", rt->cfg.device ? rt->cfg.device : "?",
+             p->tick_ns / 1e6, rt->cycles, rt->overruns, rt->missed_ticks);
+    if (rt->dispatching) {
+        pthread_mutex_lock(&rt->fmu);
+        unsigned long disp = rt->frames_dispatched, drop = rt->frame_overruns;
+        pthread_mutex_unlock(&rt->fmu);
+        log_info("[%s] spi frames: dispatched=%lu overruns(dropped)=%lu",
+                 tag ? tag : "spi", disp, drop);
+    }
+    spi_bus_log_stats(rt, tag);
+    rt_jitter_log(&rt->jitter, tag ? tag : "spi");
+    if (rt_alloc_violations())
+        log_warn("[%s] %lu allocation(s) in realtime hot paths", tag ? tag : "spi", rt_alloc_violations());
+    for (size_t i = 0; i < p->count; ++i)
+        log_info("[%s]   txn %zu: period=%.3f ms runs=%lu missed=%lu",
+                 tag ? tag : "spi", i, p->txns[i].period_ticks * (p->tick_ns / 1e6),
+                 p->txns[i].runs, p->txns[i].missed);
+}
+
 void spi_stop_polling(spi_runtime_t* rt) {
     if (!rt || !rt->polling) return;
-    rt->stop_flag = 1;
-    pthread_join(rt->thread, NULL);
+    spi_bus_detach(rt);
     rt->polling = 0;
+    spi_dispatch_stop(rt);
 }
 
 
@@ -511,5 +872,6 @@ void spi_close(spi_runtime_t* rt) {
     spi_stop_polling(rt);
     if (rt->fd >= 0) close(rt->fd);
     rt->fd = -1;
+    spi_program_free(&rt->prog);
     memset(rt, 0, sizeof(*rt));
 }
\ No newline at end of file
@@ -5,7 +5,12 @@
 #include <stdbool.h>
 #include <stddef.h>   // size_t
 #include <pthread.h>
+#include <time.h>
+#include <linux/spi/spidev.h>
 #include "connectors.h"
+#include "config_types.h"
+#include "rt_sched.h"
+#include "decode.h"
 #include "log.h"
 
 
@@ -16,19 +21,105 @@ typedef void (*spi_msg_cb)(const uint8_t* rx,
                            void* user,
                            const spi_transaction_t* t);
                            
+//------- Programme SPI compilé --------------
+/* Chaque transaction de cfg.transactions[] est "compilée" une fois à
+ * l'ouverture : TX décodé, RX préalloué, spi_ioc_transfer prêts.
+ * Un poll se réduit alors à ioctl() + callback. */
+typedef struct {
+    const spi_transaction_t* src;      // entrée de config (passée à on_rx)
+    struct spi_ioc_transfer xfer[2];   // 1 (write / full-duplex) ou 2 (commande + lecture)
+    uint8_t  nxfer;
+    uint8_t* rx;                       // NULL si write
+    size_t   rx_len;
+    uint32_t period_ticks;             // exécutée quand tick % period_ticks == 0
+    unsigned long runs;                // exécutions
+    unsigned long missed;              // échéances sautées (cycle précédent en retard)
+    decode_plan_t plan;                // fields{} compilés (plan.count == 0 : RX brut)
+} spi_prog_txn_t;
+
+/* Mode batched : segments de toutes les transactions mis bout à bout, découpés en
+ * groupes tenant dans un SPI_IOC_MESSAGE(N) (N <= SPI_BATCH_MAX_XFERS, octets TX
+ * et RX <= bufsiz spidev). cs_change=1 sur le dernier segment de chaque
+ * transaction sauf la dernière du groupe : CS relâché entre transactions. */
+#define SPI_BATCH_MAX_XFERS 511        // taille 14 bits de SPI_IOC_MESSAGE(N)
+
+typedef struct {
+    size_t first_xfer, nxfer;          // tranche du tableau de segments
+    size_t first_sel,  ntxn;           // tranche de sel[] (indices des transactions)
+} spi_batch_group_t;
+
+typedef struct {
+    spi_prog_txn_t* txns;
+    size_t          count;
+    uint8_t*        arena;             // TX + RX de toutes les transactions
+    uint8_t*        dummy;             // zéros, horloge des phases de lecture (partagé)
+
+    struct spi_ioc_transfer* bx;       // mode batched (NULL sinon) : toutes les transactions
+    spi_batch_group_t*       groups;
+    size_t*                  sel;
+    size_t                   groups_count;
+    struct spi_ioc_transfer* sub_bx;   // idem pour un sous-ensemble dû (périodes différentes),
+    spi_batch_group_t*       sub_groups; // reconstruit à chaque tick sans allocation
+    size_t*                  sub_sel;
+    size_t                   bufsiz;   // limite spidev (octets TX / RX par message)
+
+    uint64_t tick_ns;                  // PGCD des périodes
+    uint8_t* due;                      // scratch : transactions dues à ce tick
+    size_t*  rx_off;                   // offset du RX de chaque transaction dans une trame
+    size_t   rx_total;                 // taille d'une trame (somme des rx_len)
+} spi_program_t;
+
+/* Double buffer acquisition -> dispatch : le thread de poll recopie les RX d'un
+ * tick dans une trame libre puis la publie ; le thread de dispatch appelle on_rx
+ * (transform + send) hors du chemin temps réel. Si la trame précédente n'a pas
+ * encore été prise, elle est écrasée et comptée dans frame_overruns : le cycle
+ * bus ne s'allonge jamais à cause d'un sink lent. */
+#define SPI_FRAMES 2
+
+typedef struct {
+    uint8_t* rx;                       // prog.rx_total octets (préalloués)
+    uint8_t* ran;                      // ran[i] : transaction i exécutée dans ce tick
+    double   ts;                       // CLOCK_REALTIME du début du tick
+    uint64_t tick;
+} spi_frame_t;
+
 //------- Runtime SPI--------------
+struct spi_bus;
 
 typedef struct {
     int fd;
     spi_params_t cfg;
     spi_msg_cb on_rx;
     void* user;
-
-    // ---- polling worker (new) ----
-    int poll_ms;                 // how often to re-run the transaction list
+    spi_program_t prog;          // compilé par spi_open_from_config()
+    uint32_t speed_hz;           // valeurs effectives (défauts appliqués)
+    uint8_t  bits_per_word;
+
+    // ---- polling (thread du bus, cf. spi_bus.h) ----
+    int poll_ms;                 // how often to re-run the transaction list (0 => cfg.poll_us)
+    struct spi_bus* bus;         // scheduler du contrôleur (NULL hors polling)
+    int priority;                // params.priority : ordre entre CS échus au même instant
+    struct timespec next;        // prochaine échéance (CLOCK_MONOTONIC, sous bus->mu)
+    uint64_t tick;               // index du prochain tick
+    uint64_t busy_ns;            // temps de bus consommé depuis l'attache (sous bus->mu)
+    struct timespec attached;
+    unsigned long cycles;        // ticks exécutés
+    unsigned long overruns;      // ticks où l'échéance suivante était déjà passée
+    unsigned long missed_ticks;  // ticks sautés pour se recaler sur la grille
+    const gateway_realtime_t* realtime;  // gateway.realtime (NULL = ordonnancement normal)
+    rt_jitter_t jitter;          // latence de réveil vs échéance
     int polling;                 // boolean
-    volatile int stop_flag;      // stop request
-    pthread_t thread;            // worker thread
+
+    // ---- dispatch (thread séparé, priorité normale) ----
+    spi_frame_t frames[SPI_FRAMES];
+    int writing, pending, reading;   // index de trame, -1 = aucune (sous fmu)
+    pthread_mutex_t fmu;             // PTHREAD_PRIO_INHERIT : pas d'inversion de priorité
+    pthread_cond_t  fcv;
+    pthread_t dispatcher;
+    int dispatching;                 // boolean : on_rx passe par les trames
+    int dstop;                       // arrêt demandé au dispatcher (sous fmu)
+    unsigned long frames_dispatched;
+    unsigned long frame_overruns;    // trames écrasées avant d'avoir été dispatchées
 } spi_runtime_t;
 
 
@@ -60,8 +151,20 @@ int spi_send_adapter(const uint8_t* tx,
 // Ferme le périphérique et nettoie le runtime
 void spi_close(spi_runtime_t* rt);
 
-// Start/stop periodic polling
+// Start/stop periodic polling. Échéances absolues (CLOCK_MONOTONIC, TIMER_ABSTIME)
+// sur un tick commun = PGCD des périodes ; poll_ms <= 0 => params.poll_ms (défaut 1000).
+// Pendant le polling, on_rx est appelé depuis le thread de dispatch ("iotgw-spi-tx") ;
+// les ticks sont exécutés par le thread unique du bus (spi_bus.h).
 int  spi_start_polling(spi_runtime_t* rt, int poll_ms);
+
+// Exécute les transactions dues au tick donné (tick 0 = toutes)
+int  spi_run_tick(spi_runtime_t* rt, uint64_t tick);
+
+// Un tick de polling échu (thread du bus) ; avance rt->next. Retour : ns de bus occupé.
+uint64_t spi_poll_due(spi_runtime_t* rt, const struct timespec* now);
+
+// Journalise cycles / échéances manquées
+void spi_log_stats(spi_runtime_t* rt, const char* tag);
 void spi_stop_polling(spi_runtime_t* rt);
 
 #endif // CONN_SPI_H
\ No newline at end of file
@@ -3,8 +3,11 @@
 // ================================
 #define _GNU_SOURCE
 #include "conn_uart.h"
+#include "uart_framer.h"
+#include "uart_termios2.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -12,6 +15,8 @@
 #include <termios.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
+#include <poll.h>
+#include <pthread.h>
 
 
 
@@ -44,8 +49,15 @@ static int set_speed(int fd, int baudrate) {
 #ifdef B921600
         case 921600: spd = B921600; break;
 #endif
-        default:
-            return UART_ERR_BAUD;
+        default: {
+            // Débit hors Bxxx (250000 DMX, 31250 MIDI, 1M/1.5M/3M...) : termios2 BOTHER
+            int actual = 0;
+            int rc = uart_set_baud_other(fd, baudrate, &actual);
+            if (rc != UART_OK) return rc == UART_ERR_UNSUPPORTED ? UART_ERR_BAUD : rc;
+            // le driver arrondit au diviseur le plus proche : au-delà de 3 % la liaison est inutilisable
+            if (actual > 0 && labs((long)actual - baudrate) * 100 > 3L * baudrate) return UART_ERR_BAUD;
+            return UART_OK;
+        }
     }
 
     if (cfsetispeed(&tio, spd) < 0) return UART_ERR_BAUD;
@@ -141,6 +153,8 @@ static int set_bytesize_parity_stop(int fd, const uart_params_t *p) {
     // VTIME is in 100ms ticks. VMIN=0 => return immediately with available bytes, or after timeout.
     tio.c_cc[VMIN]  = 0;
     tio.c_cc[VTIME] = (cc_t)((tmo_ms + 99) / 100); // round up
+    // low_latency: read() never waits, the timeout is handled by poll() (ms granularity)
+    if (p->low_latency) tio.c_cc[VTIME] = 0;
 
     // Local flags
     tio.c_cflag |= (CLOCAL | CREAD);
@@ -149,12 +163,56 @@ static int set_bytesize_parity_stop(int fd, const uart_params_t *p) {
     return UART_OK;
 }
 
+/* Ports en low_latency : VTIME=0, uart_read()/uart_read_packet() attendent par
+ * poll() avec timeout_ms au lieu des pas de 100 ms de VTIME. */
+#define UART_MAX_LOWLAT_FDS 16
+
+static struct { int fd; int timeout_ms; bool used; } g_lowlat[UART_MAX_LOWLAT_FDS];
+static pthread_mutex_t g_lowlat_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static void lowlat_set(int fd, bool on, int timeout_ms) {
+    pthread_mutex_lock(&g_lowlat_mu);
+    int slot = -1;
+    for (int i = 0; i < UART_MAX_LOWLAT_FDS; ++i) {
+        if (g_lowlat[i].used && g_lowlat[i].fd == fd) { slot = i; break; }
+        if (!g_lowlat[i].used && slot < 0) slot = i;
+    }
+    if (slot >= 0) {
+        if (on) { g_lowlat[slot].fd = fd; g_lowlat[slot].timeout_ms = timeout_ms; g_lowlat[slot].used = true; }
+        else if (g_lowlat[slot].fd == fd) g_lowlat[slot].used = false;
+    }
+    pthread_mutex_unlock(&g_lowlat_mu);
+}
+
+// 1 : read() peut être appelé, 0 : timeout, -1 : erreur
+static int wait_readable(int fd) {
+    int tmo = -1;
+    pthread_mutex_lock(&g_lowlat_mu);
+    for (int i = 0; i < UART_MAX_LOWLAT_FDS; ++i)
+        if (g_lowlat[i].used && g_lowlat[i].fd == fd) { tmo = g_lowlat[i].timeout_ms; break; }
+    pthread_mutex_unlock(&g_lowlat_mu);
+    if (tmo < 0) return 1;   // VTIME fait l'attente
+
+    struct pollfd pf = { .fd = fd, .events = POLLIN };
+    for (;;) {
+        int r = poll(&pf, 1, tmo);
+        if (r < 0 && errno == EINTR) continue;
+        return r > 0 ? 1 : r;
+    }
+}
+
 int uart_apply_settings(int fd, const uart_params_t *params) {
     if (!params) return UART_ERR_ARG;
-    int rc = set_speed(fd, params->baudrate);
+    int rc = set_bytesize_parity_stop(fd, params);
     if (rc != UART_OK) return rc;
-    rc = set_bytesize_parity_stop(fd, params);
+    // Après cfmakeraw/tcsetattr : un débit BOTHER (termios2) n'est pas réécrit ensuite
+    rc = set_speed(fd, params->baudrate);
     if (rc != UART_OK) return rc;
+    if (params->low_latency) {
+        // Sans serial_struct (CDC ACM, pty), seul le chemin poll() s'applique
+        (void)uart_set_low_latency(fd, true);
+    }
+    lowlat_set(fd, params->low_latency, params->timeout_set ? params->timeout_ms : 1000);
     return UART_OK;
 }
 
@@ -211,6 +269,8 @@ ssize_t uart_write(int fd, const uint8_t *buf, size_t len, int write_timeout_ms)
 }
 
 ssize_t uart_read(int fd, uint8_t *buf, size_t len) {
+    int rdy = wait_readable(fd);
+    if (rdy <= 0) return rdy;   // 0 on timeout
     for (;;) {
         ssize_t n = read(fd, buf, len);
         if (n < 0) {
@@ -250,98 +310,64 @@ int uart_parse_hex(const char *hex_str, uint8_t *out, size_t max_out) {
 }
 
 // --- Packet read -----------------------------------------------------------
-static inline bool match_tail(const uint8_t *buf, size_t buf_len,
-                            const uint8_t *pat, size_t pat_len) {
-    if (pat_len == 0 || buf_len < pat_len) return false;
-    return memcmp(buf + (buf_len - pat_len), pat, pat_len) == 0;
-}
-
-static int load_delim(const char *hex, uint8_t *buf, size_t *len_io) {
-    if (!hex) { *len_io = 0; return UART_OK; }
-    int n = uart_parse_hex(hex, buf, *len_io);
-    if (n < 0) return n;
-    *len_io = (size_t)n;
-    return UART_OK;
+/* uart_read_packet() garde un framer par fd : les octets reçus après une trame
+ * (même read()) servent à la suivante au lieu d'être perdus. */
+#define UART_MAX_FRAMED_FDS 16
+
+static struct { int fd; uart_framer_t f; } g_framers[UART_MAX_FRAMED_FDS];
+static pthread_mutex_t g_framers_mu = PTHREAD_MUTEX_INITIALIZER;
+
+static uart_framer_t *framer_for(int fd, const uart_params_t *params, int *rc) {
+    uart_framer_t *free_slot = NULL;
+    pthread_mutex_lock(&g_framers_mu);
+    for (size_t i = 0; i < UART_MAX_FRAMED_FDS; ++i) {
+        if (g_framers[i].f.buf && g_framers[i].fd == fd) {
+            pthread_mutex_unlock(&g_framers_mu);
+            return &g_framers[i].f;
+        }
+        if (!g_framers[i].f.buf && !free_slot) free_slot = &g_framers[i].f;
+    }
+    *rc = UART_ERR_ARG;
+    if (free_slot) {
+        *rc = uart_framer_init(free_slot, &params->packet, 0);
+        if (*rc == UART_OK) g_framers[free_slot - &g_framers[0].f].fd = fd;
+        else free_slot = NULL;
+    }
+    pthread_mutex_unlock(&g_framers_mu);
+    return free_slot;
 }
 
 int uart_read_packet(int fd, const uart_params_t *params,
                      uint8_t *out_buf, size_t out_buf_sz, size_t *out_len) {
     if (!params || !params->has_packet || !out_buf || !out_len) return UART_ERR_ARG;
-
-    uint8_t start[32], end[32];
-    size_t start_len = sizeof(start), end_len = sizeof(end);
-
-    int rc = load_delim(params->packet.start, start, &start_len);
-    if (rc < 0) return UART_ERR_PACKET_CFG;
-    rc = load_delim(params->packet.end, end, &end_len);
-    if (rc < 0) return UART_ERR_PACKET_CFG;
-
-    bool use_start = start_len > 0;
-    bool use_end   = end_len > 0;
-    bool use_len   = params->packet.length_set && params->packet.length > 0;
-
-    if (!(use_end || use_len)) {
-        // Must have at least an end delimiter or a fixed length
-        return UART_ERR_PACKET_CFG;
-    }
-
-    size_t pos = 0;
     *out_len = 0;
 
-    
-
-    // 1) Seek start (if any)
-    if (use_start) {
-        uint8_t b;
-        for (;;) {
-            ssize_t n = uart_read(fd, &b, 1);
-            if (n <= 0) return (int)n; // 0 on timeout, <0 on error
-            // shift window
-            if (pos < start_len) {
-                out_buf[pos++] = b;
-            } else {
-                memmove(out_buf, out_buf + 1, start_len - 1);
-                out_buf[start_len - 1] = b;
-            }
-            if (match_tail(out_buf, pos, start, start_len)) {
-                pos = 0; // reset buffer for payload
-                break;
-            }
-        }
-    }
-
-    // 2) Read payload depending on length/end
-    if (use_len && !use_end) {
-        // Read exactly length bytes
-        size_t need = (size_t)params->packet.length;
-        if (need > out_buf_sz) return UART_ERR_ARG;
-        while (pos < need) {
-            ssize_t n = uart_read(fd, out_buf + pos, need - pos);
-            if (n <= 0) return (int)n;
-            pos += (size_t)n;
-        }
-        *out_len = pos;
-        return UART_OK;
-    }
-
-    // With end delimiter (with/without length cap)
-    size_t cap = out_buf_sz;
-    if (use_len && params->packet.length < (int)cap) cap = (size_t)params->packet.length;
-    if (cap == 0) return UART_ERR_ARG;
+    int rc = UART_OK;
+    uart_framer_t *f = framer_for(fd, params, &rc);
+    if (!f) return rc;
 
     for (;;) {
-        uint8_t b;
-        ssize_t n = uart_read(fd, &b, 1);
-        if (n <= 0) return (int)n;
-        if (pos >= cap) return UART_ERR_ARG; // overflow risk
-        out_buf[pos++] = b;
-        if (match_tail(out_buf, pos, end, end_len)) {
-            *out_len = pos - end_len; // exclude end delimiter
+        const uint8_t *frame;
+        size_t len;
+        if (uart_framer_next(f, &frame, &len)) {
+            if (len > out_buf_sz) return UART_ERR_ARG;
+            memcpy(out_buf, frame, len);
+            *out_len = len;
             return UART_OK;
         }
+        // Un read() prend tout ce que le driver a en stock (VTIME/VMIN inchangés)
+        int rdy = wait_readable(fd);
+        if (rdy <= 0) return rdy;
+        ssize_t n = uart_framer_fill(f, fd);
+        if (n <= 0) return (int)n; // 0 on timeout, <0 on error
     }
 }
 
 int uart_close(int fd) {
+    lowlat_set(fd, false, 0);
+    pthread_mutex_lock(&g_framers_mu);
+    for (size_t i = 0; i < UART_MAX_FRAMED_FDS; ++i)
+        if (g_framers[i].f.buf && g_framers[i].fd == fd) uart_framer_free(&g_framers[i].f);
+    pthread_mutex_unlock(&g_framers_mu);
     return close(fd);
 }
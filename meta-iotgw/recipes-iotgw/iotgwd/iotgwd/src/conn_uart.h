@@ -44,7 +44,9 @@ extern "C" {
 int uart_open(const uart_params_t *params, int *out_fd);
 
 
-// Applies termios based on params to an already-open fd.
+// Applies termios based on params to an already-open fd. Rates without a Bxxx
+// constant go through termios2/BOTHER (uart_termios2.c); low_latency also sets
+// ASYNC_LOW_LATENCY when the driver supports it.
 int uart_apply_settings(int fd, const uart_params_t *params);
 
 
@@ -57,12 +59,15 @@ int uart_flush(int fd, bool both);
 ssize_t uart_write(int fd, const uint8_t *buf, size_t len, int write_timeout_ms);
 
 
-// Read up to len bytes honoring the termios VTIME/VMIN configured by params.
+// Read up to len bytes honoring the termios VTIME/VMIN configured by params
+// (with params->low_latency: poll() with timeout_ms, VTIME=0).
 // Returns bytes read, 0 on timeout, or <0 on error.
 ssize_t uart_read(int fd, uint8_t *buf, size_t len);
 
 
-// Read a framed packet based on params->packet.
+// Read a framed packet based on params->packet. Reception is buffered per fd
+// (see uart_framer.h): large read()s, memchr/memmem delimiter search, and bytes
+// following a frame are kept for the next call (released by uart_close()).
 // - If start is set, consume until start sequence is matched (start not included
 // in payload).
 // - If length_set, read exactly `length` bytes of payload (after optional start).
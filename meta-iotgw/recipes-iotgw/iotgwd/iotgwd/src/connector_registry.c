@@ -5,25 +5,30 @@ int parse_mqtt(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 int parse_http_server(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 int parse_modbus_rtu(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 int parse_modbus_tcp(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
+int parse_modbus_server(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 int parse_uart(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 int parse_spi(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
+int parse_i2c(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
+int parse_socketcan(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
+int parse_onewire(yaml_document_t* d, yaml_node_t* conn_map, connector_any_t* out);
 
 /* For not-yet-implemented types, parse = NULL -> opaque blob */
 const connector_registry_entry_t CONNECTOR_REGISTRY[] = {
     {"mqtt",         KIND_MQTT,        parse_mqtt},
     {"modbus-rtu",   KIND_MODBUS_RTU,  parse_modbus_rtu},
     {"modbus-tcp",   KIND_MODBUS_TCP,  parse_modbus_tcp},
+    {"modbus-tcp-server", KIND_MODBUS_SERVER, parse_modbus_server},
     {"http-server",  KIND_HTTP_SERVER, parse_http_server},
     {"uart",         KIND_UART,        parse_uart},
 
     {"spi",          KIND_SPI,         parse_spi},
-    {"i2c",          KIND_I2C,         NULL},
+    {"i2c",          KIND_I2C,         parse_i2c},
     {"ble",          KIND_BLE,         NULL},
     {"coap",         KIND_COAP,        NULL},
     {"lorawan",      KIND_LORAWAN,     NULL},
-    {"onewire",      KIND_ONEWIRE,     NULL},
+    {"onewire",      KIND_ONEWIRE,     parse_onewire},
     {"opcua",        KIND_OPCUA,       NULL},
-    {"socketcan",    KIND_SOCKETCAN,   NULL},
+    {"socketcan",    KIND_SOCKETCAN,   parse_socketcan},
     {"zigbee",       KIND_ZIGBEE,      NULL},
 };
 
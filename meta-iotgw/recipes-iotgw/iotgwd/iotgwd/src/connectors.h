@@ -101,9 +101,11 @@ typedef struct {
  * stopbits: {1,2}
  * timeout_ms: [50..5000]
  * rs485: rts_time_before_ms, rts_time_after_ms (optional, [0..50])
+ * max_gap: [0..32] registres/bits inutilisés lus pour fusionner deux points (def 0)
  * slaves[]: unit_id [1..247], poll_ms [100..60000]
  *   map[]: name (C identifier), func enum, addr [0..65535],
- *          count [1..4], type enum, optional scale, signed
+ *          count [1..4], type enum, optional scale, signed,
+ *          word_swap (u32/s32/float : mot de poids faible en premier, "CDAB")
  */
 typedef enum { MODBUS_FUNC_HOLDING, MODBUS_FUNC_INPUT, MODBUS_FUNC_COIL, MODBUS_FUNC_DISCRETE } modbus_func_t;
 typedef enum { MODBUS_TYPE_U16, MODBUS_TYPE_S16, MODBUS_TYPE_U32, MODBUS_TYPE_S32, MODBUS_TYPE_FLOAT, MODBUS_TYPE_DOUBLE } modbus_datatype_t;
@@ -118,11 +120,14 @@ typedef struct {
     bool     has_scale;
     bool     signed_flag; // optional (schema allows 'signed' boolean)
     bool     has_signed;
+    bool     word_swap;   // optional, 32 bits : mot de poids faible d'abord
 } modbus_point_t;
 
 typedef struct {
     uint8_t unit_id; // 1..247
     uint32_t poll_ms; // 100..60000
+    int32_t timeout_ms; // 20..5000, optional (sinon timeout_ms du connecteur)
+    bool timeout_set;
     size_t map_count;
     modbus_point_t *map;
 } modbus_slave_t;
@@ -140,6 +145,8 @@ typedef struct {
     int32_t stopbits;   // 1|2
     int32_t timeout_ms; // 50..5000
     modbus_rs485_t rs485; // optional (present==true if provided)
+    int32_t max_gap;    // 0..32, default 0 (coalescence : points adjacents seulement)
+    int32_t backoff_max_ms; // 1000..600000, default 30000 (slave muet : back-off plafonné)
     size_t slaves_count;
     modbus_slave_t *slaves; // minItems 1
 } modbus_rtu_params_t;
@@ -158,18 +165,11 @@ typedef struct {
  * timeout_ms: [50..5000]
  * retries: [0..10] default 2
  * map[]: same structure as RTU map
+ * poll_ms: [100..60000] default 1000
+ * max_inflight: [1..32] default 4 (requêtes pipelinées, transaction id MBAP)
+ * max_gap: [0..32] default 0
  */
-typedef struct {
-    char *name;             // ^[a-zA-Z_][a-zA-Z0-9_]*$
-    modbus_func_t func;     // holding|input|coil|discrete
-    uint16_t addr;          // 0..65535
-    uint8_t  count;         // 1..4
-    modbus_datatype_t type; // u16|s16|u32|s32|float|double
-    double   scale;         // optional; has_scale=true if present
-    bool     has_scale;
-    bool     signed_flag;   // optional
-    bool     has_signed;
-} modbus_tcp_point_t;
+typedef modbus_point_t modbus_tcp_point_t;   // même map que RTU (plan de lecture commun)
 
 typedef struct {
     char *host;         // hostname or IPv4
@@ -177,6 +177,9 @@ typedef struct {
     uint8_t  unit_id;   // default 1
     int32_t timeout_ms; // 50..5000
     int32_t retries;    // 0..10 (default 2)
+    uint32_t poll_ms;   // 100..60000 (default 1000)
+    int32_t max_inflight; // 1..32 (default 4)
+    int32_t max_gap;    // 0..32 (default 0)
     size_t map_count;   // minItems 1
     modbus_tcp_point_t *map;
     bool port_set, unit_id_set, retries_set; // to track presence vs defaults
@@ -186,6 +189,28 @@ typedef struct {
     modbus_tcp_params_t params;
 } modbus_tcp_connector_t;
 
+/* =========================
+ * Modbus TCP server (façade)
+ * =========================
+ * Destination de bridges modbus-rtu / modbus-tcp : sert en lecture (FC 1..4)
+ * l'image des registres rafraîchie par les maîtres, sans requête sur le bus.
+ * bind: "[host]:port" (ex ":502")
+ * max_clients: [1..256] default 16
+ * max_age_ms: [0..3600000] default 0 (0 = pas de limite ; au-delà : exception 0x0B)
+ * idle_timeout_s: [0..3600] default 60 (0 = jamais)
+ */
+typedef struct {
+    char *bind;
+    int32_t max_clients;
+    int32_t max_age_ms;
+    int32_t idle_timeout_s;
+    bool idle_timeout_set;
+} modbus_server_params_t;
+
+typedef struct {
+    modbus_server_params_t params;
+} modbus_server_connector_t;
+
 
 /* =========================
  * MQTT connector
@@ -213,11 +238,26 @@ typedef struct {
     bool  qos_set;
 } mqtt_topic_t;
 
+/* brokers[]: liste ordonnée (priorité) pour le sink multi-broker.
+ * strategy: "failover" (premier connecté dans l'ordre, standbys pré-connectés)
+ *           "spread"   (hash du topic sur les brokers connectés) */
+typedef enum { MQTT_STRATEGY_FAILOVER, MQTT_STRATEGY_SPREAD } mqtt_strategy_t;
+
+typedef struct {
+    char *url;    // "mqtt://host:port" / "mqtts://host:port", ou
+    char *host;   // host + port
+    int   port;
+} mqtt_broker_t;
+
 typedef struct {
     // Either url OR (host,port). Support both.
     char *url;         // optional (see schema note)
     char *host;        // optional
     int   port;        // optional
+    size_t brokers_count;     // optional: >0 => sink multi-broker (url/host ignorés)
+    mqtt_broker_t *brokers;
+    mqtt_strategy_t strategy; // default failover
+    bool  strategy_set;
     char *client_id;   // required, 1..64
     bool  clean_session; // default true
     bool  clean_session_set;
@@ -247,18 +287,48 @@ typedef struct {
  * bits_per_word: {8,16,32} (default 8)
  * speed_hz: [1000..50000000] (default 1000000)
  * lsb_first, cs_change: bool (defaults false)
+ * poll_ms: number > 0 (default 1000) — période du cycle, fractions permises (0.5)
+ * batched: bool (default false) — toutes les transactions d'un cycle en un
+ *          seul SPI_IOC_MESSAGE(N) (découpé selon bufsiz spidev)
+ * priority: [0..99] (default 0) — ordre entre CS du même bus échus ensemble
  * transactions[]: op {"read","write","transfer"}, len [1..4096],
- *                 tx hex string (optional), rx_len [1..4096] (optional)
+ *                 tx hex string (optional), rx_len [1..4096] (optional),
+ *                 period_ms number > 0 (optional, default poll_ms),
+ *                 fields{} (optional) : nom -> offset [0..4095] dans le RX, type enum,
+ *                 len (bytes seulement, [1..255]), endianness {be,le}=be, scale?
  */
 typedef enum { SPI_OP_READ, SPI_OP_WRITE, SPI_OP_TRANSFER } spi_op_t;
 
+typedef enum {
+    SPI_FIELD_U8, SPI_FIELD_S8, SPI_FIELD_U16, SPI_FIELD_S16, SPI_FIELD_U24, SPI_FIELD_S24,
+    SPI_FIELD_U32, SPI_FIELD_S32, SPI_FIELD_U64, SPI_FIELD_S64, SPI_FIELD_FLOAT, SPI_FIELD_DOUBLE,
+    SPI_FIELD_BYTES
+} spi_field_type_t;
+typedef enum { SPI_BE, SPI_LE } spi_endianness_t;
+
+typedef struct {
+    char *name;           // clé dans fields{}
+    uint16_t offset;      // octet de début dans le RX (ordre du fil)
+    uint8_t len;          // bytes : [1..255] ; sinon déduit du type
+    spi_field_type_t type;
+    spi_endianness_t endianness; // default BE
+    bool endianness_set;
+    bool word_swap;       // 32 bits : mots de 16 bits inversés (Modbus "CDAB")
+    double scale;         // optional
+    bool has_scale;
+} spi_field_t;
+
 typedef struct {
     spi_op_t op;
     uint16_t len;        // [1..4096]
     char *tx;            // optional hex string "0x..." or raw hex
     uint16_t rx_len;     // optional [1..4096]
+    uint32_t period_us;  // optional, période propre (défaut: poll)
     bool has_tx;
     bool has_rx_len;
+    bool has_period;
+    size_t fields_count; // optional
+    spi_field_t *fields;
 } spi_transaction_t;
 
 typedef struct {
@@ -268,6 +338,12 @@ typedef struct {
     int speed_hz;        // [1000..50000000] (default 1000000)
     bool lsb_first;      // default false
     bool cs_change;      // default false
+    uint32_t poll_us;    // default 1000000 (poll_ms: 1000)
+    bool poll_set;
+    bool batched;        // default false
+    bool batched_set;
+    int priority;        // default 0
+    bool priority_set;
     size_t transactions_count;
     spi_transaction_t *transactions; // optional
     bool mode_set, bpw_set, speed_set, lsb_first_set, cs_change_set;
@@ -316,14 +392,17 @@ typedef struct {
  * =========================
  * bus: [0..32]
  * speed_hz: {100k, 400k, 1M} (optional)
- * devices[]: addr [0x03..0x77], name?, map[]
+ * poll_ms: integer > 0 (optional, default 1000) ; max_gap: [0..16] (default 0)
+ * devices[]: addr [0x03..0x77], name?, poll_ms? (défaut : celui du connecteur),
+ *            auto_increment=true (false : une lecture par point), map[]
  * map[]: reg [0..255], len [1..16], type enum, endianness {be,le}=be,
- *        scale?, writable=false
+ *        scale?, writable=false, name? (défaut "reg_0xNN")
  */
 typedef enum { I2C_TYPE_U8, I2C_TYPE_S8, I2C_TYPE_U16, I2C_TYPE_S16, I2C_TYPE_U24, I2C_TYPE_U32, I2C_TYPE_S32, I2C_TYPE_FLOAT, I2C_TYPE_BYTES } i2c_point_type_t;
 typedef enum { I2C_BE, I2C_LE } i2c_endianness_t;
 
 typedef struct {
+    char *name;           // optional
     uint8_t reg;          // 0..255
     uint8_t len;          // 1..16
     i2c_point_type_t type;
@@ -338,6 +417,9 @@ typedef struct {
 typedef struct {
     uint8_t addr;     // 0x03..0x77
     char *name;       // optional
+    uint32_t poll_ms; // optional (0 = params.poll_ms)
+    bool auto_increment;  // default true : registres lus en bloc
+    bool auto_increment_set;
     size_t map_count; // optional
     i2c_map_point_t *map;
 } i2c_device_t;
@@ -346,6 +428,8 @@ typedef struct {
     int bus;              // 0..32
     int speed_hz;         // enum {100000,400000,1000000}
     bool speed_set;
+    uint32_t poll_ms;     // optional (default 1000)
+    int max_gap;          // octets inutilisés tolérés dans un bloc (default 0)
     size_t devices_count; // >=1
     i2c_device_t *devices;
 } i2c_params_t;
@@ -382,7 +466,8 @@ typedef struct {
  * 1-Wire
  * =========================
  * Deux backends exclusifs:
- *  - sysfs: backend="sysfs", sysfs_path, devices[{id,name?}], poll_ms [200..60000] (def 1000)
+ *  - sysfs: backend="sysfs", sysfs_path, devices[{id,name?}], poll_ms [200..60000] (def 1000),
+ *           bulk_read=true (therm_bulk_read des maîtres w1 avant lecture)
  *  - owfs : backend="owfs", host, port [1..65535](def 4304), devices[strings], poll_ms idem
  * ID regex: ^(10|22|26|28|3B|42|5[0-9A-Fa-f])(-?)[0-9A-Fa-f]{12}$
  */
@@ -400,6 +485,8 @@ typedef struct {
     onewire_sysfs_device_t *devices;
     int poll_ms;               // 200..60000, def 1000
     bool poll_set;
+    bool bulk_read;            // def true
+    bool bulk_read_set;
 } onewire_sysfs_params_t;
 
 typedef struct {
@@ -474,13 +561,62 @@ typedef struct {
  * =========================
  * ifname: "canN" ou "vcanN"
  * bitrate: [10k..1M], sample_point: [0.4..0.9], restart_ms: [0..60000]
- * filters[]: {id, mask} avec étendue 29 bits (0..536870911)
+ *          (appliqués à l'interface par ip link / systemd-networkd)
+ * fd: bool (def false) : réception des trames CAN FD
+ * filters[]: {id, mask} avec étendue 29 bits (0..536870911) ; id ou mask
+ *            au-delà de 0x7FF => identifiant étendu
+ * messages[]: décodage des signaux (à la DBC) : id, extended? (def id > 0x7FF),
+ *             name?, rate_ms? (sinon publication sur changement), signals[] :
+ *             name, start [0..511], length [1..64], byte_order
+ *             {little_endian,big_endian}=little_endian, signed=false,
+ *             factor=1, offset=0
+ * isotp[]: {rx_id, tx_id, extended? (def id > 0x7FF), name?} : PDU ISO 15765-2
+ *          réassemblés par le noyau (CAN_ISOTP)
+ * j1939: {addr? [0..253] (absent = écoute seule), promisc=true, pgns[]?
+ *         [0..0x3FFFF]} : PGN complets (TP/ETP réassemblés par CAN_J1939)
  */
 typedef struct {
     uint32_t id;   // 0..536870911
     uint32_t mask; // 0..536870911
 } socketcan_filter_t;
 
+typedef enum { CAN_SIG_LITTLE_ENDIAN, CAN_SIG_BIG_ENDIAN } can_byte_order_t;
+
+typedef struct {
+    char *name;
+    uint16_t start;      // bit de départ DBC (lsb en little_endian, msb en big_endian)
+    uint8_t length;      // 1..64
+    can_byte_order_t byte_order;
+    bool is_signed;
+    double factor;       // default 1
+    double offset;       // default 0
+} socketcan_signal_t;
+
+typedef struct {
+    uint32_t id;
+    bool extended;       // default: id > 0x7FF
+    char *name;          // optional (topic), default id hexa
+    uint32_t rate_ms;    // optional : au plus une publication par rate_ms ; 0 = sur changement
+    size_t signals_count;
+    socketcan_signal_t *signals;
+} socketcan_message_t;
+
+typedef struct {
+    char *name;          // optional (topic), default rx_id hexa
+    uint32_t rx_id;      // trames du device
+    uint32_t tx_id;      // flow control émis par la passerelle
+    bool extended;       // default: rx_id ou tx_id > 0x7FF
+} socketcan_isotp_t;
+
+typedef struct {
+    bool enabled;        // section j1939 présente
+    int addr;            // optional, adresse propre [0..253]
+    bool addr_set;
+    bool promisc;        // default true : aussi le trafic adressé aux autres
+    size_t pgns_count;   // optional : SO_J1939_FILTER
+    uint32_t *pgns;
+} socketcan_j1939_t;
+
 typedef struct {
     char *ifname;        // ^(can|vcan)\d+$
     int bitrate;         // optional
@@ -489,8 +625,15 @@ typedef struct {
     bool sample_point_set;
     int restart_ms;      // optional
     bool restart_ms_set;
+    bool fd;             // optional, default false
+    bool fd_set;
     size_t filters_count;// optional
     socketcan_filter_t *filters;
+    size_t messages_count;// optional
+    socketcan_message_t *messages;
+    size_t isotp_count;  // optional
+    socketcan_isotp_t *isotp;
+    socketcan_j1939_t j1939; // optional
 } socketcan_params_t;
 
 typedef struct {
@@ -556,25 +699,50 @@ typedef struct {
  * UART / Serial connector
  * =========================
  * port: /dev/ttyS… /dev/ttyUSB… /dev/ttyAMA… /dev/ttyACM… /dev/serial…
- * baudrate: {1200,2400,4800,9600,19200,38400,57600,115200,230400,460800,921600}
+ * baudrate: [50..12000000] (hors Bxxx : termios2 BOTHER)
  * bytesize: {5,6,7,8}, def 8
  * parity: {"N","E","O","M","S"}, def "N"
  * stopbits: {1,1.5,2}, def 1
  * rtscts: bool, def false
  * xonxoff: bool, def false
  * timeout_ms: [0..60000], def 1000
- * packet: optional { start hex, end hex, length [1..2048] }
+ * low_latency: bool, def false (ASYNC_LOW_LATENCY, VTIME=0 + poll())
+ * packet: optional { codec, start hex, end hex, length [1..2048],
+ *                   len_size, len_endian, len_offset, len_adjust, gap_us, crc }
  */
+typedef enum {
+    UART_CODEC_DELIM = 0,   // start/end/length (défaut)
+    UART_CODEC_SLIP,        // RFC 1055 (END 0xC0, ESC 0xDB)
+    UART_CODEC_COBS,        // Consistent Overhead Byte Stuffing, trames terminées par 0x00
+    UART_CODEC_LENGTH,      // en-tête avec champ longueur
+    UART_CODEC_GAP          // silence inter-octets (type Modbus RTU t3.5)
+} uart_codec_kind_t;
+
+typedef enum {
+    UART_CRC_NONE = 0,
+    UART_CRC16_MODBUS,      // poly 0x8005 réfléchi, init 0xFFFF, LSB en premier
+    UART_CRC16_CCITT,       // poly 0x1021, init 0xFFFF, MSB en premier
+    UART_CRC32              // IEEE 802.3, LSB en premier
+} uart_crc_t;
+
 typedef struct {
     char *start;   // hex string (e.g. "0x7E"), optional
     char *end;     // hex string (e.g. "0x7F"), optional
-    int length;    // optional, 1..2048
+    int length;    // optional, 1..2048 (codecs autres que delim : taille max de trame)
     bool length_set;
+
+    uart_codec_kind_t codec;  // default delim
+    int  len_size;      // codec length : 1, 2 ou 4 octets (default 1)
+    bool len_le;        // champ longueur little-endian (default big-endian)
+    int  len_offset;    // position du champ longueur dans la trame (default 0)
+    int  len_adjust;    // octets après le champ = valeur + len_adjust (default 0)
+    int  gap_us;        // codec gap : silence de fin de trame, 0 = 3,5 caractères
+    uart_crc_t crc;     // CRC en fin de trame, vérifié puis retiré (default none)
 } uart_packet_t;
 
 typedef struct {
     char *port;      // device path pattern
-    int baudrate;    // required enum
+    int baudrate;    // required, 50..12000000
     int bytesize;    // 5,6,7,8 (default 8)
     bool bytesize_set;
     char parity;     // 'N','E','O','M','S' (default 'N')
@@ -587,6 +755,7 @@ typedef struct {
     bool xonxoff_set;
     int timeout_ms;  // 0..60000, default 1000
     bool timeout_set;
+    bool low_latency; // default false
     bool has_packet;
     uart_packet_t packet;
 } uart_params_t;
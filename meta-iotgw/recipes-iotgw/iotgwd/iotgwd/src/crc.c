@@ -0,0 +1,47 @@
+// ================================
+// File: crc.c
+// ================================
+#include "crc.h"
+#include <pthread.h>
+
+static uint16_t t_modbus[256];
+static uint16_t t_ccitt[256];
+static uint32_t t_crc32[256];
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (unsigned i = 0; i < 256; ++i) {
+        uint16_t m = (uint16_t)i;
+        uint32_t c = i;
+        uint16_t x = (uint16_t)(i << 8);
+        for (int b = 0; b < 8; ++b) {
+            m = (m & 1) ? (uint16_t)((m >> 1) ^ 0xA001) : (uint16_t)(m >> 1);
+            c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+            x = (x & 0x8000) ? (uint16_t)((x << 1) ^ 0x1021) : (uint16_t)(x << 1);
+        }
+        t_modbus[i] = m;
+        t_crc32[i] = c;
+        t_ccitt[i] = x;
+    }
+}
+
+uint16_t crc16_modbus(const uint8_t* p, size_t n) {
+    pthread_once(&g_once, build_tables);
+    uint16_t crc = 0xFFFF;
+    while (n--) crc = (uint16_t)((crc >> 8) ^ t_modbus[(crc ^ *p++) & 0xFF]);
+    return crc;
+}
+
+uint16_t crc16_ccitt(const uint8_t* p, size_t n) {
+    pthread_once(&g_once, build_tables);
+    uint16_t crc = 0xFFFF;
+    while (n--) crc = (uint16_t)((crc << 8) ^ t_ccitt[((crc >> 8) ^ *p++) & 0xFF]);
+    return crc;
+}
+
+uint32_t crc32_ieee(const uint8_t* p, size_t n) {
+    pthread_once(&g_once, build_tables);
+    uint32_t crc = 0xFFFFFFFFu;
+    while (n--) crc = (crc >> 8) ^ t_crc32[(crc ^ *p++) & 0xFF];
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,30 @@
+// ================================
+// File: crc.h
+// ================================
+#ifndef CRC_H
+#define CRC_H
+
+/*
+ * CRC table-driven (une table de 256 entrées par algorithme, construite au
+ * premier appel) : un accès table + un décalage par octet.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Modbus RTU : poly 0xA001 (réfléchi), init 0xFFFF ; transmis LSB en premier
+uint16_t crc16_modbus(const uint8_t* p, size_t n);
+// CCITT-FALSE : poly 0x1021, init 0xFFFF ; transmis MSB en premier
+uint16_t crc16_ccitt(const uint8_t* p, size_t n);
+// IEEE 802.3 : poly 0xEDB88320 (réfléchi), init/xorout 0xFFFFFFFF ; LSB en premier
+uint32_t crc32_ieee(const uint8_t* p, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC_H
@@ -0,0 +1,475 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "decode.h"
+#include "log.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DECODE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DECODE_SSE2 1
+#endif
+
+static const uint8_t type_len[] = {
+    [SPI_FIELD_U8] = 1,  [SPI_FIELD_S8] = 1,  [SPI_FIELD_U16] = 2, [SPI_FIELD_S16] = 2,
+    [SPI_FIELD_U24] = 3, [SPI_FIELD_S24] = 3, [SPI_FIELD_U32] = 4, [SPI_FIELD_S32] = 4,
+    [SPI_FIELD_U64] = 8, [SPI_FIELD_S64] = 8, [SPI_FIELD_FLOAT] = 4, [SPI_FIELD_DOUBLE] = 8,
+    [SPI_FIELD_BYTES] = 0,
+};
+
+static bool type_signed(spi_field_type_t t){
+    return t == SPI_FIELD_S8 || t == SPI_FIELD_S16 || t == SPI_FIELD_S24 ||
+           t == SPI_FIELD_S32 || t == SPI_FIELD_S64;
+}
+
+static bool host_little_endian(void){
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+// Champ décodable par bloc : entier 16/32 bits ou float
+static uint8_t group_width(const decode_field_t* f){
+    switch (f->type) {
+    case SPI_FIELD_U16: case SPI_FIELD_S16: return 2;
+    case SPI_FIELD_U32: case SPI_FIELD_S32: case SPI_FIELD_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+// Même noyau (type, ordre des octets/mots, scale) : même groupe possible
+static int group_cmp(const decode_field_t* a, const decode_field_t* b){
+    if (a->type != b->type) return a->type < b->type ? -1 : 1;
+    if (a->little != b->little) return a->little ? 1 : -1;
+    if (a->word_swap != b->word_swap) return a->word_swap ? 1 : -1;
+    if (a->has_scale != b->has_scale) return a->has_scale ? 1 : -1;
+    return 0;
+}
+
+static bool field_before(const decode_field_t* a, const decode_field_t* b){
+    bool ga = group_width(a) != 0, gb = group_width(b) != 0;
+    if (ga != gb) return ga;                 // groupes d'abord, champs isolés ensuite
+    int c = ga ? group_cmp(a, b) : 0;
+    return c ? c < 0 : a->offset < b->offset;
+}
+
+/* Tri des champs (type, ordre, scale, offset) puis découpage en suites
+ * contiguës : une suite = un appel de noyau. Tri fusion : maps de milliers
+ * de points. */
+static int build_groups(decode_plan_t* p){
+    size_t n = p->count;
+    p->idx    = (uint32_t*)malloc(n * sizeof(*p->idx));
+    p->gscale = (double*)malloc(n * sizeof(*p->gscale));
+    p->tmp    = (double*)malloc(n * sizeof(*p->tmp));
+    p->groups = (decode_group_t*)calloc(n, sizeof(*p->groups));
+    uint32_t* aux = (uint32_t*)malloc(n * sizeof(*aux));
+    if (!p->idx || !p->gscale || !p->tmp || !p->groups || !aux) { free(aux); return -1; }
+
+    for (size_t i = 0; i < n; ++i) p->idx[i] = (uint32_t)i;
+    for (size_t w = 1; w < n; w *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * w) {
+            size_t mid = lo + w < n ? lo + w : n, hi = lo + 2 * w < n ? lo + 2 * w : n;
+            size_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi)
+                aux[k++] = field_before(&p->fields[p->idx[b]], &p->fields[p->idx[a]]) ? p->idx[b++] : p->idx[a++];
+            while (a < mid) aux[k++] = p->idx[a++];
+            while (b < hi)  aux[k++] = p->idx[b++];
+        }
+        memcpy(p->idx, aux, n * sizeof(*aux));
+    }
+    free(aux);
+
+    bool host_le = host_little_endian();
+    decode_group_t* g = NULL;
+    for (size_t k = 0; k < n; ++k) {
+        const decode_field_t* f = &p->fields[p->idx[k]];
+        uint8_t w = group_width(f);
+        p->gscale[k] = f->has_scale ? f->scale : 1.0;
+        if (w && g && g->width == w && group_cmp(f, &p->fields[p->idx[g->first]]) == 0 &&
+            f->offset == g->offset + g->n * w) {
+            g->n++;
+            continue;
+        }
+        g = &p->groups[p->ngroups++];
+        g->offset    = f->offset;
+        g->width     = w;
+        g->first     = (uint32_t)k;
+        g->n         = 1;
+        g->sign      = type_signed(f->type);
+        g->is_float  = f->type == SPI_FIELD_FLOAT;
+        g->swap      = f->little != host_le;   // ordre du champ != ordre hôte
+        g->word_swap = f->word_swap;
+        g->scaled    = f->has_scale;
+    }
+    return 0;
+}
+
+int decode_plan_compile(decode_plan_t* p, const spi_field_t* fields, size_t n,
+                        size_t frame_len, int bits_per_word)
+{
+    memset(p, 0, sizeof(*p));
+    if (!fields || n == 0) return 0;
+
+    p->fields  = (decode_field_t*)calloc(n, sizeof(*p->fields));
+    p->metrics = (gw_metric_t*)calloc(n, sizeof(*p->metrics));
+    p->scratch = (uint8_t*)malloc(frame_len ? frame_len : 1);
+    if (!p->fields || !p->metrics || !p->scratch) { decode_plan_free(p); return -1; }
+
+    size_t json = 3;
+    for (size_t i = 0; i < n; ++i) {
+        const spi_field_t* f = &fields[i];
+        decode_field_t* d = &p->fields[i];
+        d->name      = f->name;
+        d->offset    = f->offset;
+        d->type      = f->type;
+        d->len       = f->type == SPI_FIELD_BYTES ? f->len : type_len[f->type];
+        d->little    = f->endianness_set && f->endianness == SPI_LE;
+        d->word_swap = f->word_swap && d->len == 4;
+        d->has_scale = f->has_scale;
+        d->scale     = f->scale;
+        if (d->len == 0 || (size_t)d->offset + d->len > frame_len) {
+            log_err("decode: field '%s' (offset %u, %u bytes) outside %zu-byte frame",
+                    f->name ? f->name : "?", (unsigned)d->offset, (unsigned)d->len, frame_len);
+            decode_plan_free(p);
+            return -1;
+        }
+        p->metrics[i].name = d->name;
+        // "nom": valeur,  (nom échappé au pire x2, bytes en hex)
+        json += 2 * strlen(d->name ? d->name : "") + 6 +
+                (d->type == SPI_FIELD_BYTES ? 2u * d->len + 2 : 32);
+    }
+    p->count     = n;
+    p->frame_len = frame_len;
+    p->json_cap  = json;
+    p->json      = (char*)malloc(json);
+    if (!p->json) { decode_plan_free(p); return -1; }
+
+    /* spidev range les mots de 16/32 bits en ordre hôte : sur un hôte little
+     * endian, l'ordre des octets diffère de celui du fil (MSB d'abord) */
+    if (bits_per_word > 8 && host_little_endian() && frame_len % (size_t)(bits_per_word / 8) == 0)
+        p->word_swap = (uint8_t)(bits_per_word / 8);
+
+    if (build_groups(p) != 0) { decode_plan_free(p); return -1; }
+    return 0;
+}
+
+// Swap en bloc, boucles simples que le compilateur vectorise
+static void swap16(uint8_t* dst, const uint8_t* src, size_t n){
+    for (size_t i = 0; i < n; i += 2) {
+        uint16_t w; memcpy(&w, src + i, 2);
+        w = __builtin_bswap16(w);
+        memcpy(dst + i, &w, 2);
+    }
+}
+
+static void swap32(uint8_t* dst, const uint8_t* src, size_t n){
+    for (size_t i = 0; i < n; i += 4) {
+        uint32_t w; memcpy(&w, src + i, 4);
+        w = __builtin_bswap32(w);
+        memcpy(dst + i, &w, 4);
+    }
+}
+
+static uint64_t load_uint(const uint8_t* b, uint8_t len, bool little){
+    uint64_t v = 0;
+    if (little) for (int k = len - 1; k >= 0; --k) v = (v << 8) | b[k];
+    else        for (int k = 0; k < len; ++k)      v = (v << 8) | b[k];
+    return v;
+}
+
+// Champ isolé (types 8/24/64 bits, bytes) : extraction octet par octet
+static void decode_field(const decode_field_t* f, const uint8_t* b, gw_metric_t* m){
+    const uint8_t* at = b + f->offset;
+
+    if (f->type == SPI_FIELD_BYTES) {
+        m->type = GW_VAL_BYTES;
+        m->v.bytes.data = at;
+        m->v.bytes.len  = f->len;
+        return;
+    }
+
+    uint64_t raw = load_uint(at, f->len, f->little);
+    if (f->word_swap) raw = ((raw & 0xFFFFu) << 16) | (raw >> 16);
+    double   d;
+    if (f->type == SPI_FIELD_FLOAT) {
+        uint32_t u = (uint32_t)raw; float x;
+        memcpy(&x, &u, sizeof(x));
+        d = x;
+    } else if (f->type == SPI_FIELD_DOUBLE) {
+        memcpy(&d, &raw, sizeof(d));
+    } else if (type_signed(f->type)) {
+        unsigned sh = 64u - 8u * f->len;                 // extension de signe
+        int64_t s = (int64_t)(raw << sh) >> sh;
+        if (!f->has_scale) { m->type = GW_VAL_I64; m->v.i64 = s; return; }
+        d = (double)s;
+    } else {
+        if (!f->has_scale) { m->type = GW_VAL_U64; m->v.u64 = raw; return; }
+        d = (double)raw;
+    }
+    m->type  = GW_VAL_F64;
+    m->v.f64 = f->has_scale ? d * f->scale : d;
+}
+
+// ---- noyaux par bloc : n valeurs contiguës -> out[] (double) ----
+
+static inline uint32_t fix32(uint32_t u, const decode_group_t* g){
+    if (g->swap)      u = __builtin_bswap32(u);
+    if (g->word_swap) u = (u << 16) | (u >> 16);
+    return u;
+}
+
+static double scalar_at(const uint8_t* src, size_t i, const decode_group_t* g){
+    if (g->width == 2) {
+        uint16_t u; memcpy(&u, src + 2 * i, 2);
+        if (g->swap) u = __builtin_bswap16(u);
+        return g->sign ? (double)(int16_t)u : (double)u;
+    }
+    uint32_t u; memcpy(&u, src + 4 * i, 4);
+    u = fix32(u, g);
+    if (g->is_float) { float x; memcpy(&x, &u, 4); return x; }
+    return g->sign ? (double)(int32_t)u : (double)u;
+}
+
+#if defined(DECODE_SSE2)
+static inline __m128i sse_bswap16(__m128i v){
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i sse_fix32(__m128i v, const decode_group_t* g){
+    if (g->swap) {
+        v = sse_bswap16(v);                                   // octets dans chaque mot
+        v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+    }
+    if (g->word_swap) v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+    return v;
+}
+
+// 4 entiers 32 bits (signés) -> 4 doubles
+static inline void sse_i32_pd(__m128i v, __m128d* lo, __m128d* hi){
+    *lo = _mm_cvtepi32_pd(v);
+    *hi = _mm_cvtepi32_pd(_mm_srli_si128(v, 8));
+}
+
+static size_t kernel_simd(const uint8_t* src, size_t n, const decode_group_t* g,
+                          const double* sc, double* out){
+    size_t i = 0;
+    if (g->width == 2) {
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + 2 * i));
+            if (g->swap) v = sse_bswap16(v);
+            __m128i a, b;
+            if (g->sign) {
+                a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            } else {
+                a = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+                b = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+            }
+            __m128d d[4];
+            sse_i32_pd(a, &d[0], &d[1]);
+            sse_i32_pd(b, &d[2], &d[3]);
+            for (int k = 0; k < 4; ++k) {
+                if (sc) d[k] = _mm_mul_pd(d[k], _mm_loadu_pd(sc + i + 2 * k));
+                _mm_storeu_pd(out + i + 2 * k, d[k]);
+            }
+        }
+        return i;
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = sse_fix32(_mm_loadu_si128((const __m128i*)(src + 4 * i)), g);
+        __m128d d[2];
+        if (g->is_float) {
+            __m128 f = _mm_castsi128_ps(v);
+            d[0] = _mm_cvtps_pd(f);
+            d[1] = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+        } else if (g->sign) {
+            sse_i32_pd(v, &d[0], &d[1]);
+        } else {
+            // u32 : biais 2^31 pour passer par la conversion signée
+            sse_i32_pd(_mm_xor_si128(v, _mm_set1_epi32((int)0x80000000u)), &d[0], &d[1]);
+            d[0] = _mm_add_pd(d[0], _mm_set1_pd(2147483648.0));
+            d[1] = _mm_add_pd(d[1], _mm_set1_pd(2147483648.0));
+        }
+        for (int k = 0; k < 2; ++k) {
+            if (sc) d[k] = _mm_mul_pd(d[k], _mm_loadu_pd(sc + i + 2 * k));
+            _mm_storeu_pd(out + i + 2 * k, d[k]);
+        }
+    }
+    return i;
+}
+#elif defined(DECODE_NEON)
+static inline uint8x16_t neon_fix32(uint8x16_t v, const decode_group_t* g){
+    if (g->swap)      v = vrev32q_u8(v);
+    if (g->word_swap) v = vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(v)));
+    return v;
+}
+
+static inline void neon_store(double* out, const double* sc, size_t i, float64x2_t d){
+    if (sc) d = vmulq_f64(d, vld1q_f64(sc + i));
+    vst1q_f64(out + i, d);
+}
+
+static size_t kernel_simd(const uint8_t* src, size_t n, const decode_group_t* g,
+                          const double* sc, double* out){
+    size_t i = 0;
+    if (g->width == 2) {
+        for (; i + 8 <= n; i += 8) {
+            uint8x16_t b = vld1q_u8(src + 2 * i);
+            if (g->swap) b = vrev16q_u8(b);
+            float64x2_t d[4];
+            if (g->sign) {
+                int16x8_t v = vreinterpretq_s16_u8(b);
+                int32x4_t a = vmovl_s16(vget_low_s16(v)), c = vmovl_high_s16(v);
+                d[0] = vcvtq_f64_s64(vmovl_s32(vget_low_s32(a)));
+                d[1] = vcvtq_f64_s64(vmovl_high_s32(a));
+                d[2] = vcvtq_f64_s64(vmovl_s32(vget_low_s32(c)));
+                d[3] = vcvtq_f64_s64(vmovl_high_s32(c));
+            } else {
+                uint16x8_t v = vreinterpretq_u16_u8(b);
+                uint32x4_t a = vmovl_u16(vget_low_u16(v)), c = vmovl_high_u16(v);
+                d[0] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(a)));
+                d[1] = vcvtq_f64_u64(vmovl_high_u32(a));
+                d[2] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(c)));
+                d[3] = vcvtq_f64_u64(vmovl_high_u32(c));
+            }
+            for (int k = 0; k < 4; ++k) neon_store(out, sc, i + 2 * (size_t)k, d[k]);
+        }
+        return i;
+    }
+    for (; i + 4 <= n; i += 4) {
+        uint8x16_t b = neon_fix32(vld1q_u8(src + 4 * i), g);
+        float64x2_t d0, d1;
+        if (g->is_float) {
+            float32x4_t f = vreinterpretq_f32_u8(b);
+            d0 = vcvt_f64_f32(vget_low_f32(f));
+            d1 = vcvt_high_f64_f32(f);
+        } else if (g->sign) {
+            int32x4_t v = vreinterpretq_s32_u8(b);
+            d0 = vcvtq_f64_s64(vmovl_s32(vget_low_s32(v)));
+            d1 = vcvtq_f64_s64(vmovl_high_s32(v));
+        } else {
+            uint32x4_t v = vreinterpretq_u32_u8(b);
+            d0 = vcvtq_f64_u64(vmovl_u32(vget_low_u32(v)));
+            d1 = vcvtq_f64_u64(vmovl_high_u32(v));
+        }
+        neon_store(out, sc, i, d0);
+        neon_store(out, sc, i + 2, d1);
+    }
+    return i;
+}
+#else
+static size_t kernel_simd(const uint8_t* src, size_t n, const decode_group_t* g,
+                          const double* sc, double* out){
+    (void)src; (void)n; (void)g; (void)sc; (void)out;
+    return 0;
+}
+#endif
+
+static void decode_group(const decode_plan_t* p, const decode_group_t* g, const uint8_t* b){
+    const uint8_t* src = b + g->offset;
+    const uint32_t* idx = p->idx + g->first;
+    gw_metric_t* m = p->metrics;
+
+    // entiers sans scale : valeurs exactes (I64/U64), pas de passage par double
+    if (!g->scaled && !g->is_float) {
+        for (size_t i = 0; i < g->n; ++i) {
+            int64_t v = (int64_t)scalar_at(src, i, g);
+            gw_metric_t* o = &m[idx[i]];
+            if (g->sign) { o->type = GW_VAL_I64; o->v.i64 = v; }
+            else         { o->type = GW_VAL_U64; o->v.u64 = (uint64_t)v; }
+        }
+        return;
+    }
+
+    const double* sc = g->scaled ? p->gscale + g->first : NULL;
+    double* out = p->tmp + g->first;
+    size_t i = kernel_simd(src, g->n, g, sc, out);
+    for (; i < g->n; ++i) out[i] = sc ? scalar_at(src, i, g) * sc[i] : scalar_at(src, i, g);
+    for (i = 0; i < g->n; ++i) {
+        gw_metric_t* o = &m[idx[i]];
+        o->type  = GW_VAL_F64;
+        o->v.f64 = out[i];
+    }
+}
+
+int decode_plan_run(decode_plan_t* p, const uint8_t* frame, size_t len)
+{
+    if (!p || p->count == 0) return 0;
+    if (!frame || len < p->frame_len) return -1;
+
+    const uint8_t* b = frame;
+    if (p->word_swap == 2)      { swap16(p->scratch, frame, p->frame_len); b = p->scratch; }
+    else if (p->word_swap == 4) { swap32(p->scratch, frame, p->frame_len); b = p->scratch; }
+
+    for (size_t k = 0; k < p->ngroups; ++k) {
+        const decode_group_t* g = &p->groups[k];
+        if (g->width) decode_group(p, g, b);
+        else          decode_field(&p->fields[p->idx[g->first]], b, &p->metrics[p->idx[g->first]]);
+    }
+    return (int)p->count;
+}
+
+static size_t put_name(char* o, const char* s){
+    size_t n = 0;
+    o[n++] = '"';
+    for (; s && *s; ++s) {
+        if (*s == '"' || *s == '\\') o[n++] = '\\';
+        o[n++] = *s;
+    }
+    o[n++] = '"';
+    o[n++] = ':';
+    return n;
+}
+
+int decode_plan_json(decode_plan_t* p)
+{
+    static const char hex[] = "0123456789abcdef";
+    if (!p || !p->json) return -1;
+    char* o = p->json;
+    size_t n = 0;
+    o[n++] = '{';
+    for (size_t i = 0; i < p->count; ++i) {
+        const gw_metric_t* m = &p->metrics[i];
+        if (i) o[n++] = ',';
+        n += put_name(o + n, m->name);
+        size_t room = p->json_cap - n;
+        switch (m->type) {
+        case GW_VAL_I64: n += (size_t)snprintf(o + n, room, "%lld", (long long)m->v.i64); break;
+        case GW_VAL_U64: n += (size_t)snprintf(o + n, room, "%llu", (unsigned long long)m->v.u64); break;
+        case GW_VAL_F64:
+            if (isfinite(m->v.f64)) n += (size_t)snprintf(o + n, room, "%.9g", m->v.f64);
+            else { memcpy(o + n, "null", 4); n += 4; }
+            break;
+        case GW_VAL_BYTES:
+            o[n++] = '"';
+            for (size_t k = 0; k < m->v.bytes.len; ++k) {
+                o[n++] = hex[m->v.bytes.data[k] >> 4];
+                o[n++] = hex[m->v.bytes.data[k] & 15];
+            }
+            o[n++] = '"';
+            break;
+        default:
+            memcpy(o + n, "null", 4); n += 4;
+            break;
+        }
+    }
+    o[n++] = '}';
+    o[n] = '\0';
+    return (int)n;
+}
+
+void decode_plan_free(decode_plan_t* p)
+{
+    if (!p) return;
+    free(p->fields);
+    free(p->metrics);
+    free(p->scratch);
+    free(p->groups);
+    free(p->idx);
+    free(p->gscale);
+    free(p->tmp);
+    free(p->json);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,82 @@
+#pragma once
+/**
+ * @file decode.h
+ * @brief Plan de décodage de trames binaires en valeurs typées (gw_metric_t).
+ *
+ * Compilé une fois à l'ouverture du connecteur (offsets/types validés contre la
+ * taille de la trame), puis appliqué à chaque RX sans allocation :
+ *   1. swap des mots en bloc si les mots du bus (bits_per_word 16/32) sont
+ *      rangés en ordre hôte par le driver : on retrouve l'ordre du fil ;
+ *   2. extraction des champs (be/le, mots inversés, signe, scale) vers metrics[] ;
+ *   3. optionnellement, rendu JSON {"nom":valeur,...} dans un buffer du plan.
+ *
+ * Les champs 16/32 bits (entiers, float) sont regroupés à la compilation en
+ * suites contiguës de même type/ordre (indépendamment de l'ordre de la map) ;
+ * chaque suite est décodée d'un bloc : swap, extension, conversion en double
+ * et scale sur 8 (u16) ou 4 (u32/float) valeurs à la fois en NEON (aarch64) ou
+ * SSE2 (x86-64), boucle scalaire sinon. Les autres types sont extraits un à un.
+ *
+ * Un plan n'est pas thread-safe : un seul thread de décodage par plan.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "gw_msg.h"
+#include "connectors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char*      name;
+    uint16_t         offset;
+    uint8_t          len;        // octets lus
+    spi_field_type_t type;
+    bool             little;     // endianness le
+    bool             word_swap;  // 32 bits : mots de 16 bits inversés (CDAB)
+    bool             has_scale;
+    double           scale;
+} decode_field_t;
+
+// Suite de champs contigus de même type décodée d'un bloc
+typedef struct {
+    uint16_t offset;             // premier octet dans la trame
+    uint8_t  width;              // 2 ou 4 ; 0 = champ isolé (fields[idx[first]])
+    bool     sign, is_float, swap, word_swap, scaled;
+    uint32_t first;              // premier indice dans idx[] / scale[]
+    uint32_t n;
+} decode_group_t;
+
+typedef struct {
+    decode_field_t* fields;
+    size_t          count;
+    size_t          frame_len;   // taille attendue de la trame
+    uint8_t         word_swap;   // 0, 2 ou 4 : swap en bloc avant extraction
+    uint8_t*        scratch;     // frame_len octets (trame remise en ordre du fil)
+    decode_group_t* groups;
+    size_t          ngroups;
+    uint32_t*       idx;         // champs dans l'ordre des groupes
+    double*         gscale;      // scale par élément de groupe
+    double*         tmp;         // valeurs d'un groupe avant dispersion dans metrics
+    gw_metric_t*    metrics;     // count valeurs, réécrites à chaque décodage
+    char*           json;        // rendu JSON
+    size_t          json_cap;
+} decode_plan_t;
+
+/* Compile les champs pour une trame de frame_len octets reçue sur un bus de
+ * bits_per_word bits. Retour 0 = OK ; -1 = champ hors trame / allocation. */
+int  decode_plan_compile(decode_plan_t* p, const spi_field_t* fields, size_t n,
+                         size_t frame_len, int bits_per_word);
+
+/* Décode frame dans p->metrics. Retour : nombre de métriques, -1 si trame trop courte. */
+int  decode_plan_run(decode_plan_t* p, const uint8_t* frame, size_t len);
+
+/* Rend p->metrics en JSON dans p->json. Retour : longueur, -1 si erreur. */
+int  decode_plan_json(decode_plan_t* p);
+
+void decode_plan_free(decode_plan_t* p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "connectors.h"
 
 typedef enum {
@@ -18,9 +19,34 @@ typedef enum {
   KIND_ZIGBEE,
   KIND_UART,
   KIND_BLE,
+  KIND_MODBUS_SERVER,
   KIND_UNKNOWN // for showing errors
 } kind_t;
 
+/* Valeur typée (métrique) attachée à un message : produite par les sources
+ * qui savent décoder leurs trames, consommée par les formats structurés
+ * (Sparkplug B, JSON, ...). Les chaînes/octets ne sont pas NUL-terminés. */
+typedef enum {
+  GW_VAL_BOOL,
+  GW_VAL_I64,
+  GW_VAL_U64,
+  GW_VAL_F64,
+  GW_VAL_STR,
+  GW_VAL_BYTES
+} gw_value_type_t;
+
+typedef struct {
+  const char* name;
+  gw_value_type_t type;
+  union {
+    bool     b;
+    int64_t  i64;
+    uint64_t u64;
+    double   f64;
+    struct { const uint8_t* data; size_t len; } bytes;  // GW_VAL_STR / GW_VAL_BYTES
+  } v;
+} gw_metric_t;
+
 typedef struct {
   const uint8_t* data;
   size_t len;            // binaire-safe
@@ -48,6 +74,9 @@ typedef struct {
     ble_params_t         ble;
   } params;
   gw_payload_t pl;        // quoi envoyer
+  double timestamp;       // epoch s (0 = inconnu, le sink prend l'heure courante)
+  const gw_metric_t* metrics;  // optionnel : valeurs décodées
+  size_t metrics_count;
 } gw_msg_t;
 
 typedef int (*gw_send_fn)(const gw_msg_t* out, void* ctx);          
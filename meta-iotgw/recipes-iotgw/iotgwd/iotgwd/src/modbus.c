@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "modbus.h"
+#include "bridge.h"
+#include "crc.h"
+#include "log.h"
+
+static uint8_t func_fc(modbus_func_t f){
+    switch (f) {
+    case MODBUS_FUNC_COIL:     return MODBUS_FC_READ_COILS;
+    case MODBUS_FUNC_DISCRETE: return MODBUS_FC_READ_DISCRETE;
+    case MODBUS_FUNC_INPUT:    return MODBUS_FC_READ_INPUT;
+    default:                   return MODBUS_FC_READ_HOLDING;
+    }
+}
+
+static bool fc_bits(uint8_t fc){ return fc == MODBUS_FC_READ_COILS || fc == MODBUS_FC_READ_DISCRETE; }
+
+static uint16_t type_regs(modbus_datatype_t t){
+    switch (t) {
+    case MODBUS_TYPE_U32: case MODBUS_TYPE_S32: case MODBUS_TYPE_FLOAT: return 2;
+    case MODBUS_TYPE_DOUBLE: return 4;
+    default: return 1;
+    }
+}
+
+uint16_t modbus_point_span(const modbus_point_t* pt){
+    uint16_t c = pt->count ? pt->count : 1;
+    if (fc_bits(func_fc(pt->func))) return c;
+    uint16_t t = type_regs(pt->type);
+    return c > t ? c : t;
+}
+
+// type + signed (l'option signed force le signe du type entier)
+static spi_field_type_t field_type(const modbus_point_t* pt){
+    bool force = pt->has_signed, sgn = pt->signed_flag;
+    switch (pt->type) {
+    case MODBUS_TYPE_U16:    return force && sgn ? SPI_FIELD_S16 : SPI_FIELD_U16;
+    case MODBUS_TYPE_S16:    return force && !sgn ? SPI_FIELD_U16 : SPI_FIELD_S16;
+    case MODBUS_TYPE_U32:    return force && sgn ? SPI_FIELD_S32 : SPI_FIELD_U32;
+    case MODBUS_TYPE_S32:    return force && !sgn ? SPI_FIELD_U32 : SPI_FIELD_S32;
+    case MODBUS_TYPE_FLOAT:  return SPI_FIELD_FLOAT;
+    default:                 return SPI_FIELD_DOUBLE;
+    }
+}
+
+static bool point_before(const modbus_point_t* x, const modbus_point_t* y){
+    uint8_t fx = func_fc(x->func), fy = func_fc(y->func);
+    return fx != fy ? fx < fy : x->addr < y->addr;
+}
+
+int modbus_plan_build(modbus_plan_t* p, const modbus_point_t* pts, size_t n, int max_gap){
+    memset(p, 0, sizeof(*p));
+    if (!pts || n == 0) return 0;
+    if (max_gap < 0) max_gap = 0;
+
+    size_t* order = (size_t*)malloc(n * sizeof(*order));
+    p->blocks = (modbus_block_t*)calloc(n, sizeof(*p->blocks));
+    p->fields = (spi_field_t*)calloc(n, sizeof(*p->fields));
+    size_t* blk_of = (size_t*)malloc(n * sizeof(*blk_of));
+    if (!order || !p->blocks || !p->fields || !blk_of) goto fail;
+
+    // tri par insertion (fonction, adresse) : maps de quelques dizaines de points
+    for (size_t i = 0; i < n; ++i) {
+        size_t k = i;
+        while (k > 0 && point_before(&pts[i], &pts[order[k - 1]])) { order[k] = order[k - 1]; --k; }
+        order[k] = i;
+    }
+
+    // Regroupement glouton : les points triés étendent le bloc courant tant que
+    // le bloc reste dans une PDU et que le trou ne dépasse pas max_gap
+    modbus_block_t* cur = NULL;
+    uint32_t cur_end = 0;
+    for (size_t k = 0; k < n; ++k) {
+        const modbus_point_t* pt = &pts[order[k]];
+        uint8_t  fc   = func_fc(pt->func);
+        uint32_t end  = (uint32_t)pt->addr + modbus_point_span(pt);
+        uint32_t lim  = fc_bits(fc) ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGS;
+        if (end > 65536u) {
+            log_err("modbus: point '%s' (addr %u) past the end of the address space",
+                    pt->name ? pt->name : "?", (unsigned)pt->addr);
+            goto fail;
+        }
+        if (!cur || cur->fc != fc || pt->addr > cur_end + (uint32_t)max_gap ||
+            (end > cur_end ? end : cur_end) - cur->addr > lim) {
+            cur = &p->blocks[p->nblocks++];
+            cur->fc = fc;
+            cur->addr = pt->addr;
+            cur_end = end;
+        } else if (end > cur_end) {
+            cur_end = end;
+        }
+        cur->count = (uint16_t)(cur_end - cur->addr);
+        blk_of[order[k]] = (size_t)(cur - p->blocks);
+    }
+
+    size_t off = 0;
+    for (size_t b = 0; b < p->nblocks; ++b) {
+        p->blocks[b].img_off = off;
+        off += fc_bits(p->blocks[b].fc) ? p->blocks[b].count : 2u * p->blocks[b].count;
+    }
+    p->image_len = off;
+    p->image = (uint8_t*)calloc(off ? off : 1, 1);
+    if (!p->image || off > 65535) goto fail;
+
+    // Un champ par point, dans l'ordre de la map (JSON/metrics dans l'ordre du YAML)
+    for (size_t i = 0; i < n; ++i) {
+        const modbus_point_t* pt = &pts[i];
+        const modbus_block_t* b = &p->blocks[blk_of[i]];
+        spi_field_t* f = &p->fields[i];
+        f->name = pt->name;
+        if (fc_bits(b->fc)) {
+            f->offset = (uint16_t)(b->img_off + (pt->addr - b->addr));
+            f->type = pt->count > 1 ? SPI_FIELD_BYTES : SPI_FIELD_U8;
+            f->len = pt->count > 1 ? pt->count : 1;
+        } else {
+            f->offset = (uint16_t)(b->img_off + 2u * (pt->addr - b->addr));
+            f->type = field_type(pt);
+            f->word_swap = pt->word_swap;
+        }
+        f->scale = pt->scale;
+        f->has_scale = pt->has_scale;
+    }
+    if (decode_plan_compile(&p->plan, p->fields, n, p->image_len, 8) != 0) goto fail;
+    p->points = n;
+
+    free(order);
+    free(blk_of);
+    return 0;
+
+fail:
+    free(order);
+    free(blk_of);
+    modbus_plan_free(p);
+    return -1;
+}
+
+void modbus_plan_free(modbus_plan_t* p){
+    if (!p) return;
+    decode_plan_free(&p->plan);
+    free(p->blocks);
+    free(p->fields);
+    free(p->image);
+    memset(p, 0, sizeof(*p));
+}
+
+size_t modbus_pdu_read(const modbus_block_t* b, uint8_t* pdu){
+    pdu[0] = b->fc;
+    pdu[1] = (uint8_t)(b->addr >> 8);
+    pdu[2] = (uint8_t)b->addr;
+    pdu[3] = (uint8_t)(b->count >> 8);
+    pdu[4] = (uint8_t)b->count;
+    return 5;
+}
+
+size_t modbus_rsp_len(const modbus_block_t* b){
+    size_t bytes = fc_bits(b->fc) ? (b->count + 7u) / 8u : 2u * b->count;
+    return 2 + bytes;   // fc, byte count, données
+}
+
+int modbus_pdu_store(modbus_plan_t* p, const modbus_block_t* b, const uint8_t* pdu, size_t n){
+    if (!p || !b || !pdu || n < 2) return MODBUS_ERR_FRAME;
+    if (pdu[0] == (uint8_t)(b->fc | 0x80)) return pdu[1] ? pdu[1] : MODBUS_ERR_FRAME;
+    if (pdu[0] != b->fc || n != modbus_rsp_len(b) || pdu[1] != n - 2) return MODBUS_ERR_FRAME;
+
+    uint8_t* dst = p->image + b->img_off;
+    const uint8_t* d = pdu + 2;
+    if (fc_bits(b->fc)) {
+        for (uint16_t i = 0; i < b->count; ++i) dst[i] = (uint8_t)((d[i >> 3] >> (i & 7)) & 1u);
+    } else {
+        memcpy(dst, d, 2u * b->count);   // registres big-endian, comme le fil
+    }
+    return MODBUS_OK;
+}
+
+size_t modbus_rtu_adu(uint8_t unit, const uint8_t* pdu, size_t n, uint8_t* adu){
+    adu[0] = unit;
+    memcpy(adu + 1, pdu, n);
+    uint16_t crc = crc16_modbus(adu, n + 1);
+    adu[n + 1] = (uint8_t)crc;          // LSB d'abord
+    adu[n + 2] = (uint8_t)(crc >> 8);
+    return n + 3;
+}
+
+bool modbus_rtu_crc_ok(const uint8_t* adu, size_t n){
+    if (n < 4) return false;
+    uint16_t crc = crc16_modbus(adu, n - 2);
+    return adu[n - 2] == (uint8_t)crc && adu[n - 1] == (uint8_t)(crc >> 8);
+}
+
+size_t modbus_tcp_adu(uint16_t tid, uint8_t unit, const uint8_t* pdu, size_t n, uint8_t* adu){
+    adu[0] = (uint8_t)(tid >> 8);
+    adu[1] = (uint8_t)tid;
+    adu[2] = 0;                          // protocol id : Modbus
+    adu[3] = 0;
+    adu[4] = (uint8_t)((n + 1) >> 8);    // longueur : unit + PDU
+    adu[5] = (uint8_t)(n + 1);
+    adu[6] = unit;
+    memcpy(adu + MODBUS_MBAP_LEN, pdu, n);
+    return MODBUS_MBAP_LEN + n;
+}
+
+size_t modbus_tcp_frame_len(const uint8_t* d, size_t n){
+    if (n < MODBUS_MBAP_LEN) return 0;
+    size_t len = ((size_t)d[4] << 8) | d[5];
+    return 6 + len;
+}
+
+const char* modbus_exception_str(int code){
+    switch (code) {
+    case 1:  return "illegal function";
+    case 2:  return "illegal data address";
+    case 3:  return "illegal data value";
+    case 4:  return "server device failure";
+    case 5:  return "acknowledge";
+    case 6:  return "server device busy";
+    case 8:  return "memory parity error";
+    case 10: return "gateway path unavailable";
+    case 11: return "gateway target failed to respond";
+    case MODBUS_ERR_FRAME:   return "malformed response";
+    case MODBUS_ERR_CRC:     return "bad CRC";
+    case MODBUS_ERR_TIMEOUT: return "timeout";
+    case MODBUS_ERR_IO:      return "I/O error";
+    default: return "unknown";
+    }
+}
+
+// Slave/unit décodé -> gw_msg -> transform -> send_fn (thread de scrutation)
+void on_modbus_data(uint8_t unit, const gw_metric_t* metrics, size_t n,
+                    const char* json, size_t json_len, double ts, void* user){
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !json) return;
+
+    char topic[160];
+    snprintf(topic, sizeof(topic), "%s/%u", rt->topic_prefix[0] ? rt->topic_prefix : "ingest",
+             (unsigned)unit);
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = rt->from ? rt->from->kind : KIND_MODBUS_RTU;
+    in.pl.data = (const uint8_t*)json;
+    in.pl.len = json_len;
+    in.pl.is_text = 1;
+    in.pl.content_type = "application/json";
+    in.pl.topic = topic;
+    in.timestamp = ts;
+    in.metrics = metrics;
+    in.metrics_count = n;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+/**
+ * @file modbus.h
+ * @brief Couche protocole Modbus commune (RTU/TCP) : PDU, ADU RTU/TCP, plan de lecture.
+ *
+ * Plan de lecture : les points d'une map sont triés par fonction/adresse puis
+ * regroupés en blocs contigus (trous <= max_gap registres comblés) dans la
+ * limite d'une PDU (125 registres, 2000 bits). Chaque réponse est recopiée dans
+ * une image (registres big-endian, 1 octet 0/1 par bit), décodée d'un coup par
+ * un decode_plan_t (type, signed, scale) vers metrics/JSON.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "connectors.h"
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MODBUS_MAX_READ_REGS   125
+#define MODBUS_MAX_READ_BITS   2000
+#define MODBUS_MAX_PDU         253
+#define MODBUS_RTU_MAX_ADU     256
+#define MODBUS_MBAP_LEN        7      // transaction, protocole, longueur, unit
+#define MODBUS_TCP_MAX_ADU     (MODBUS_MBAP_LEN + MODBUS_MAX_PDU)
+
+#define MODBUS_FC_READ_COILS           0x01
+#define MODBUS_FC_READ_DISCRETE        0x02
+#define MODBUS_FC_READ_HOLDING         0x03
+#define MODBUS_FC_READ_INPUT           0x04
+#define MODBUS_FC_WRITE_SINGLE_COIL    0x05
+#define MODBUS_FC_WRITE_SINGLE_REG     0x06
+#define MODBUS_FC_WRITE_MULTI_COILS    0x0F
+#define MODBUS_FC_WRITE_MULTI_REGS     0x10
+
+// Retours de modbus_pdu_store() / transactions (>0 : code d'exception Modbus)
+#define MODBUS_OK         0
+#define MODBUS_ERR_FRAME  (-1)   // réponse malformée / inattendue
+#define MODBUS_ERR_CRC    (-2)
+#define MODBUS_ERR_TIMEOUT (-3)
+#define MODBUS_ERR_IO     (-4)
+
+typedef struct {
+    uint8_t  fc;          // 0x01..0x04
+    uint16_t addr;
+    uint16_t count;       // registres ou bits
+    size_t   img_off;     // début du bloc dans l'image
+} modbus_block_t;
+
+typedef struct {
+    modbus_block_t* blocks;
+    size_t          nblocks;
+    uint8_t*        image;
+    size_t          image_len;
+    spi_field_t*    fields;      // un champ par point (offset dans l'image)
+    decode_plan_t   plan;
+    size_t          points;      // points de la map
+} modbus_plan_t;
+
+/* Construit le plan pour n points. max_gap : registres/bits inutilisés tolérés
+ * entre deux points pour les lire dans la même requête (0 = adjacents seulement).
+ * Retour 0, -1 (allocation, point invalide). */
+int  modbus_plan_build(modbus_plan_t* p, const modbus_point_t* pts, size_t n, int max_gap);
+void modbus_plan_free(modbus_plan_t* p);
+
+// Registres lus pour un point (max(count, taille du type))
+uint16_t modbus_point_span(const modbus_point_t* pt);
+
+// PDU de lecture du bloc (5 octets) ; longueur de la PDU de réponse attendue
+size_t modbus_pdu_read(const modbus_block_t* b, uint8_t* pdu);
+size_t modbus_rsp_len(const modbus_block_t* b);
+
+/* Recopie la PDU de réponse du bloc dans l'image. Retour MODBUS_OK,
+ * MODBUS_ERR_FRAME, ou le code d'exception (>0). */
+int  modbus_pdu_store(modbus_plan_t* p, const modbus_block_t* b, const uint8_t* pdu, size_t n);
+
+// ADU RTU : [unit][pdu][crc lo][crc hi]. Retour longueur (n + 3).
+size_t modbus_rtu_adu(uint8_t unit, const uint8_t* pdu, size_t n, uint8_t* adu);
+// Vérifie le CRC d'une ADU RTU complète
+bool modbus_rtu_crc_ok(const uint8_t* adu, size_t n);
+
+// ADU TCP : MBAP [tid][0][len][unit] + pdu. Retour longueur (n + 7).
+size_t modbus_tcp_adu(uint16_t tid, uint8_t unit, const uint8_t* pdu, size_t n, uint8_t* adu);
+/* Longueur totale de l'ADU TCP qui commence en d[0..n) (lue dans le MBAP),
+ * 0 si l'en-tête n'est pas encore complet. */
+size_t modbus_tcp_frame_len(const uint8_t* d, size_t n);
+
+const char* modbus_exception_str(int code);
+
+/* Valeurs décodées d'un slave/unit (valides pendant l'appel seulement) :
+ * metrics[n] + rendu JSON {"nom":valeur,...}, ts = epoch s de l'acquisition. */
+typedef void (*modbus_data_cb)(uint8_t unit, const gw_metric_t* metrics, size_t n,
+                               const char* json, size_t json_len, double ts, void* user);
+
+// Callback bridge : JSON + metrics -> transform -> send_fn, topic "<prefix>/<unit>"
+// (user = gw_bridge_runtime_t*)
+void on_modbus_data(uint8_t unit, const gw_metric_t* metrics, size_t n,
+                    const char* json, size_t json_len, double ts, void* user);
+
+#ifdef __cplusplus
+}
+#endif
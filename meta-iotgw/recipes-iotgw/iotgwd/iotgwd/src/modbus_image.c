@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "modbus_image.h"
+#include "log.h"
+
+#define PAGE_SHIFT 8
+#define PAGE_REGS  (1u << PAGE_SHIFT)
+#define NPAGES     (65536u >> PAGE_SHIFT)
+
+enum { TBL_COILS, TBL_DISCRETE, TBL_HOLDING, TBL_INPUT, TBL_COUNT };
+
+typedef struct {
+    uint16_t val[PAGE_REGS];        // registre, ou 0/1 pour un bit
+    uint64_t ts[PAGE_REGS];         // CLOCK_MONOTONIC de la dernière lecture, 0 = jamais
+} img_page_t;
+
+typedef struct {
+    const char* source;             // connecteur maître propriétaire de l'unit
+    bool        warned;             // conflit déjà journalisé
+    img_page_t* pages[TBL_COUNT][NPAGES];
+} img_unit_t;
+
+struct modbus_image {
+    pthread_rwlock_t lock;
+    img_unit_t*      units[256];
+    unsigned long    conflicts;     // sous lock en écriture
+};
+
+static int table_of(uint8_t fc){
+    switch (fc) {
+    case MODBUS_FC_READ_COILS:    return TBL_COILS;
+    case MODBUS_FC_READ_DISCRETE: return TBL_DISCRETE;
+    case MODBUS_FC_READ_HOLDING:  return TBL_HOLDING;
+    case MODBUS_FC_READ_INPUT:    return TBL_INPUT;
+    default:                      return -1;
+    }
+}
+
+modbus_image_t* modbus_image_new(void){
+    modbus_image_t* img = (modbus_image_t*)calloc(1, sizeof(*img));
+    if (img) pthread_rwlock_init(&img->lock, NULL);
+    return img;
+}
+
+void modbus_image_free(modbus_image_t* img){
+    if (!img) return;
+    for (size_t u = 0; u < 256; ++u) {
+        if (!img->units[u]) continue;
+        for (size_t t = 0; t < TBL_COUNT; ++t)
+            for (size_t p = 0; p < NPAGES; ++p) free(img->units[u]->pages[t][p]);
+        free(img->units[u]);
+    }
+    pthread_rwlock_destroy(&img->lock);
+    free(img);
+}
+
+unsigned long modbus_image_conflicts(modbus_image_t* img){
+    if (!img) return 0;
+    pthread_rwlock_rdlock(&img->lock);
+    unsigned long n = img->conflicts;
+    pthread_rwlock_unlock(&img->lock);
+    return n;
+}
+
+int modbus_image_store(modbus_image_t* img, const char* source, uint8_t unit,
+                       const modbus_block_t* b, const uint8_t* data, uint64_t ts_ns){
+    if (!img) return 0;
+    int t = table_of(b->fc);
+    if (t < 0 || !b->count) return 0;
+    bool bits = (t == TBL_COILS || t == TBL_DISCRETE);
+    if (!source) source = "";
+
+    pthread_rwlock_wrlock(&img->lock);
+    img_unit_t* u = img->units[unit];
+    if (!u) {
+        u = img->units[unit] = (img_unit_t*)calloc(1, sizeof(*u));
+        if (u) u->source = source;
+    } else if (u->source != source && strcmp(u->source, source) != 0) {
+        img->conflicts++;
+        if (!u->warned) {
+            u->warned = true;
+            log_warn("modbus image: unit %u already fed by '%s', blocks from '%s' ignored",
+                     (unsigned)unit, u->source, source);
+        }
+        pthread_rwlock_unlock(&img->lock);
+        return -1;
+    }
+    uint32_t a = b->addr, end = (uint32_t)b->addr + b->count;
+    if (end > 65536) end = 65536;
+    while (u && a < end) {
+        img_page_t** pp = &u->pages[t][a >> PAGE_SHIFT];
+        if (!*pp) *pp = (img_page_t*)calloc(1, sizeof(img_page_t));
+        if (!*pp) break;
+        uint32_t o = a & (PAGE_REGS - 1);
+        uint32_t n = PAGE_REGS - o;
+        if (n > end - a) n = end - a;
+        const uint8_t* src = data + (bits ? (a - b->addr) : 2 * (a - b->addr));
+        for (uint32_t i = 0; i < n; ++i) {
+            (*pp)->val[o + i] = bits ? (uint16_t)(src[i] != 0)
+                                     : (uint16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+            (*pp)->ts[o + i] = ts_ns;
+        }
+        a += n;
+    }
+    pthread_rwlock_unlock(&img->lock);
+    return 0;
+}
+
+int modbus_image_read(modbus_image_t* img, uint8_t unit, uint8_t fc, uint16_t addr,
+                      uint16_t count, uint64_t now_ns, uint64_t max_age_ns, uint8_t* out){
+    int t = table_of(fc);
+    if (t < 0) return -MODBUS_EX_ILLEGAL_FUNCTION;
+    bool bits = (t == TBL_COILS || t == TBL_DISCRETE);
+    if (!count || count > (bits ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGS))
+        return -MODBUS_EX_ILLEGAL_VALUE;
+    if ((uint32_t)addr + count > 65536) return -MODBUS_EX_ILLEGAL_ADDRESS;
+
+    int rc = 0;
+    if (!img) return -MODBUS_EX_GATEWAY_PATH;
+    pthread_rwlock_rdlock(&img->lock);
+    const img_unit_t* u = img->units[unit];
+    if (!u) { pthread_rwlock_unlock(&img->lock); return -MODBUS_EX_GATEWAY_PATH; }
+    if (bits) memset(out, 0, (count + 7u) / 8u);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t a = (uint32_t)addr + i;
+        const img_page_t* pg = u->pages[t][a >> PAGE_SHIFT];
+        uint32_t o = a & (PAGE_REGS - 1);
+        if (!pg || !pg->ts[o]) { rc = -MODBUS_EX_ILLEGAL_ADDRESS; break; }
+        if (max_age_ns && now_ns - pg->ts[o] > max_age_ns) { rc = -MODBUS_EX_GATEWAY_TARGET; break; }
+        if (bits) {
+            if (pg->val[o]) out[i >> 3] |= (uint8_t)(1u << (i & 7));
+        } else {
+            out[2 * i]     = (uint8_t)(pg->val[o] >> 8);
+            out[2 * i + 1] = (uint8_t)pg->val[o];
+        }
+    }
+    pthread_rwlock_unlock(&img->lock);
+    if (rc) return rc;
+    return bits ? (int)((count + 7u) / 8u) : 2 * (int)count;
+}
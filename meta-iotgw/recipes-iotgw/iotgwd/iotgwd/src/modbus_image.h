@@ -0,0 +1,58 @@
+#pragma once
+/**
+ * @file modbus_image.h
+ * @brief Image des registres Modbus d'un serveur, par unit et par table.
+ *
+ * Chaque serveur TCP (modbus_server.h) possède son image ; seuls les maîtres
+ * RTU/TCP des bridges qui ont ce serveur pour destination y recopient leurs
+ * blocs lus avec succès (valeurs brutes, horodatage CLOCK_MONOTONIC par
+ * registre). Le serveur y répond aux lectures sans toucher au bus. Stockage
+ * creux : pages de 256 registres allouées à la première écriture. Un rwlock :
+ * les lectures des clients ne se bloquent pas entre elles.
+ *
+ * Un unit appartient au premier connecteur source qui l'alimente : un même
+ * unit venant d'un autre connecteur (deux bus, RTU + TCP avec unit 1 par
+ * défaut...) est refusé et compté, au lieu d'écraser les registres.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "modbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Codes d'exception propres à une passerelle
+#define MODBUS_EX_ILLEGAL_FUNCTION   0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS    0x02
+#define MODBUS_EX_ILLEGAL_VALUE      0x03
+#define MODBUS_EX_GATEWAY_PATH       0x0A   // unit inconnu
+#define MODBUS_EX_GATEWAY_TARGET     0x0B   // donnée trop ancienne (slave muet)
+
+typedef struct modbus_image modbus_image_t;
+
+// Image vide ; NULL si allocation impossible
+modbus_image_t* modbus_image_new(void);
+void modbus_image_free(modbus_image_t* img);
+
+/* Recopie un bloc lu (données au format de modbus_plan_t.image : registres
+ * big-endian, 1 octet 0/1 par bit) pour unit, horodaté ts_ns. source : nom du
+ * connecteur maître (pointeur de la config, stable). Retour 0, -1 si unit
+ * appartient déjà à une autre source. img NULL : rien (pas de serveur). */
+int  modbus_image_store(modbus_image_t* img, const char* source, uint8_t unit,
+                        const modbus_block_t* b, const uint8_t* data, uint64_t ts_ns);
+
+// Blocs refusés (unit d'une autre source)
+unsigned long modbus_image_conflicts(modbus_image_t* img);
+
+/* Lecture fc (0x01..0x04) de count registres/bits à partir de addr, au format
+ * PDU de réponse (registres big-endian, bits compactés LSB d'abord) dans out.
+ * max_age_ns : 0 = pas de limite. Retour : octets écrits (>= 0) ou -code
+ * d'exception (registre jamais lu : 0x02, unit inconnu : 0x0A, trop ancien : 0x0B). */
+int  modbus_image_read(modbus_image_t* img, uint8_t unit, uint8_t fc, uint16_t addr,
+                       uint16_t count, uint64_t now_ns, uint64_t max_age_ns, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "modbus_rtu.h"
+#include "modbus_image.h"
+#include "conn_uart.h"
+#include "rt_sched.h"
+#include "log.h"
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns){
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    return ts;
+}
+
+static int64_t ts_diff_ns(const struct timespec* a, const struct timespec* b){
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Écrit tout l'ADU avant deadline (fd non bloquant)
+static int write_all(int fd, const uint8_t* d, size_t n, uint64_t deadline){
+    size_t off = 0;
+    while (off < n) {
+        ssize_t w = write(fd, d + off, n - off);
+        if (w > 0) { off += (size_t)w; continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return MODBUS_ERR_IO;
+        uint64_t now = mono_ns();
+        if (now >= deadline) return MODBUS_ERR_TIMEOUT;
+        struct timespec to = ns_to_ts(deadline - now);
+        struct pollfd pf = { .fd = fd, .events = POLLOUT };
+        if (ppoll(&pf, 1, &to, NULL) < 0 && errno != EINTR) return MODBUS_ERR_IO;
+    }
+    return MODBUS_OK;
+}
+
+/* Une transaction maître : requête pdu[n] vers unit, réponse de rsp_len octets
+ * de PDU attendue, au plus timeout_ns après la fin de l'émission. Retour :
+ * longueur de la PDU reçue (copiée dans rsp), ou MODBUS_ERR_*. Thread de
+ * scrutation uniquement. */
+static int rtu_transact(modbus_rtu_t* m, uint8_t unit, const uint8_t* pdu, size_t n,
+                        uint8_t* rsp, size_t rsp_len, uint64_t timeout_ns){
+    uint8_t adu[MODBUS_RTU_MAX_ADU];
+    size_t alen = modbus_rtu_adu(unit, pdu, n, adu);
+    size_t expect = 1 + rsp_len + 2;
+    if (expect > sizeof(adu)) return MODBUS_ERR_FRAME;
+
+    // t3.5 de silence depuis la dernière activité sur la ligne
+    uint64_t now = mono_ns();
+    if (now < m->bus_free_ns) {
+        struct timespec at = ns_to_ts(m->bus_free_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR) {}
+        now = mono_ns();
+    }
+    uint64_t t0 = now;
+    tcflush(m->fd, TCIFLUSH);          // réponse tardive / bruit d'un échange précédent
+
+    uint64_t tx_end = now + (uint64_t)alen * m->char_ns;
+    int rc = write_all(m->fd, adu, alen, tx_end + timeout_ns);
+    m->requests++;
+    if (rc != MODBUS_OK) { m->bus_free_ns = mono_ns() + m->t35_ns; return rc; }
+    m->bytes_tx += alen;
+
+    // réponse : longueur attendue (5 si exception), timeout après la fin de l'émission
+    uint64_t deadline = tx_end + timeout_ns;
+    size_t got = 0;
+    while (got < expect) {
+        now = mono_ns();
+        if (now >= deadline) break;
+        struct timespec to = ns_to_ts(deadline - now);
+        struct pollfd pf = { .fd = m->fd, .events = POLLIN };
+        int r = ppoll(&pf, 1, &to, NULL);
+        if (r < 0) { if (errno == EINTR) continue; rc = MODBUS_ERR_IO; break; }
+        if (r == 0) break;
+        ssize_t k = read(m->fd, adu + got, expect - got);
+        if (k < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            rc = MODBUS_ERR_IO;
+            break;
+        }
+        if (k == 0) { rc = MODBUS_ERR_IO; break; }
+        got += (size_t)k;
+        if (got >= 2 && (adu[1] & 0x80)) expect = 5;
+    }
+    now = mono_ns();
+    m->bus_free_ns = now + m->t35_ns;
+    m->busy_ns += now - t0;
+    m->bytes_rx += got;
+
+    if (rc != MODBUS_OK) return rc;
+    if (got < expect) return got ? MODBUS_ERR_FRAME : MODBUS_ERR_TIMEOUT;
+    if (!modbus_rtu_crc_ok(adu, expect)) return MODBUS_ERR_CRC;
+    if (adu[0] != unit) return MODBUS_ERR_FRAME;
+    memcpy(rsp, adu + 1, expect - 3);
+    return (int)(expect - 3);
+}
+
+static uint64_t unit_timeout(const modbus_rtu_t* m, uint8_t unit){
+    for (size_t i = 0; i < m->nslaves; ++i)
+        if (m->slaves[i].cfg->unit_id == unit) return m->slaves[i].timeout_ns;
+    return m->slaves[0].timeout_ns;
+}
+
+// Vide la file d'écriture : requêtes fusionnées par unit, avant toute lecture
+static void service_writes(modbus_rtu_t* m){
+    modbus_wr_t* list = modbus_wq_take(&m->wq);
+    modbus_wreq_t r;
+    uint8_t rsp[MODBUS_MAX_PDU];
+    while (modbus_wreq_next(&list, &r)) {
+        int rc = rtu_transact(m, r.unit, r.pdu, r.pdu_len, rsp, 5, unit_timeout(m, r.unit));
+        if (rc >= 0) rc = modbus_wreq_check(&r, rsp, (size_t)rc);
+        if (rc != MODBUS_OK)
+            log_warn("modbus-rtu %s: write to unit %u (fc 0x%02x) failed: %s", m->cfg->port,
+                     (unsigned)r.unit, r.pdu[0], modbus_exception_str(rc));
+        modbus_wreq_done(&m->wq, &r, rc);
+    }
+}
+
+// Réveil du thread (nouvelle commande) ; appelé sous le verrou du registre
+static void rtu_kick(void* owner){
+    modbus_rtu_t* m = (modbus_rtu_t*)owner;
+    pthread_mutex_lock(&m->mu);
+    pthread_cond_broadcast(&m->cv);
+    pthread_mutex_unlock(&m->mu);
+}
+
+// ---- tas des échéances (indices de slaves, min sur due_ns) ----
+static bool due_before(const modbus_rtu_t* m, size_t a, size_t b){
+    return m->slaves[a].due_ns < m->slaves[b].due_ns;
+}
+
+static void heap_push(modbus_rtu_t* m, size_t idx){
+    size_t k = m->heap_n++;
+    while (k > 0) {
+        size_t up = (k - 1) / 2;
+        if (!due_before(m, idx, m->heap[up])) break;
+        m->heap[k] = m->heap[up];
+        k = up;
+    }
+    m->heap[k] = idx;
+}
+
+static size_t heap_pop(modbus_rtu_t* m){
+    size_t top = m->heap[0];
+    size_t last = m->heap[--m->heap_n];
+    size_t k = 0;
+    for (;;) {
+        size_t c = 2 * k + 1;
+        if (c >= m->heap_n) break;
+        if (c + 1 < m->heap_n && due_before(m, m->heap[c + 1], m->heap[c])) c++;
+        if (!due_before(m, m->heap[c], last)) break;
+        m->heap[k] = m->heap[c];
+        k = c;
+    }
+    if (m->heap_n) m->heap[k] = last;
+    return top;
+}
+
+/* Lit les blocs d'un slave ; publie si tous ont répondu. Retour 1 = complet,
+ * 0 = le slave répond (exception, CRC, trame), -1 = muet (timeout). */
+static int poll_slave(modbus_rtu_t* m, modbus_rtu_slave_t* s){
+    uint8_t pdu[8], rsp[MODBUS_MAX_PDU];
+    size_t okb = 0;
+    bool answered = false;
+    s->polls++;
+
+    // hors ligne : une seule requête de sonde (le premier bloc)
+    size_t nb = s->backoff_ms ? (s->plan.nblocks ? 1 : 0) : s->plan.nblocks;
+    for (size_t b = 0; b < nb; ++b) {
+        if (modbus_wq_pending(&m->wq)) service_writes(m);   // consignes avant les lectures
+        const modbus_block_t* blk = &s->plan.blocks[b];
+        size_t n = modbus_pdu_read(blk, pdu);
+        int rc = rtu_transact(m, s->cfg->unit_id, pdu, n, rsp, modbus_rsp_len(blk), s->timeout_ns);
+        if (rc >= 0) rc = modbus_pdu_store(&s->plan, blk, rsp, (size_t)rc);
+        if (rc != MODBUS_ERR_TIMEOUT && rc != MODBUS_ERR_IO) answered = true;
+        if (rc == MODBUS_OK) {
+            okb++;
+            if (m->image)
+                (void)modbus_image_store(m->image, m->image_src, s->cfg->unit_id, blk,
+                                         s->plan.image + blk->img_off, mono_ns());
+            continue;
+        }
+
+        if (rc > 0)                        s->exceptions++;
+        else if (rc == MODBUS_ERR_TIMEOUT) s->timeouts++;
+        else if (rc == MODBUS_ERR_CRC)     s->crc_errors++;
+        else                               s->frame_errors++;
+        if (rc == MODBUS_ERR_TIMEOUT) break;   // unit muet : inutile d'attendre les autres blocs
+    }
+    if (!answered) return -1;
+    if (okb != s->plan.nblocks || s->plan.nblocks == 0) return 0;
+    s->ok++;
+
+    int nm = decode_plan_run(&s->plan.plan, s->plan.image, s->plan.image_len);
+    int jl = nm > 0 ? decode_plan_json(&s->plan.plan) : -1;
+    if (jl > 0 && m->on_data)
+        m->on_data(s->cfg->unit_id, s->plan.plan.metrics, (size_t)nm,
+                   s->plan.plan.json, (size_t)jl, now_s(), m->user);
+    return 1;
+}
+
+// Échéance suivante : période normale, ou back-off exponentiel si le slave est muet
+static void reschedule(modbus_rtu_t* m, modbus_rtu_slave_t* s, int st, uint64_t now){
+    if (st < 0) {
+        s->fail_streak++;
+        uint32_t period_ms = (uint32_t)(s->period_ns / 1000000ULL);
+        if (!s->backoff_ms) {
+            s->backoffs++;
+            s->backoff_ms = period_ms;
+            log_warn("modbus-rtu %s: unit %u not responding, backing off",
+                     m->cfg->port, (unsigned)s->cfg->unit_id);
+        }
+        s->backoff_ms = s->backoff_ms > m->backoff_max_ms / 2 ? m->backoff_max_ms : 2 * s->backoff_ms;
+        s->due_ns = now + (uint64_t)s->backoff_ms * 1000000ULL;
+        return;
+    }
+    if (s->backoff_ms) {
+        log_info("modbus-rtu %s: unit %u back online after %u failed poll(s)",
+                 m->cfg->port, (unsigned)s->cfg->unit_id, s->fail_streak);
+        s->backoff_ms = 0;
+        s->due_ns = now;                        // reprend tout de suite, calé sur maintenant
+    }
+    s->fail_streak = 0;
+    s->due_ns += s->period_ns;
+    if (s->due_ns < now) {                      // période manquée : pas de rafale de rattrapage
+        s->overruns++;
+        s->due_ns = now;
+    }
+}
+
+static void* modbus_rtu_thread(void* arg){
+    modbus_rtu_t* m = (modbus_rtu_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-mbrtu");
+
+    pthread_mutex_lock(&m->mu);
+    while (!m->stop && m->heap_n) {
+        if (modbus_wq_pending(&m->wq)) {
+            pthread_mutex_unlock(&m->mu);
+            service_writes(m);
+            pthread_mutex_lock(&m->mu);
+            continue;
+        }
+        modbus_rtu_slave_t* s = &m->slaves[m->heap[0]];
+        uint64_t now = mono_ns();
+        if (s->due_ns > now) {
+            struct timespec wake = ns_to_ts(s->due_ns);
+            pthread_cond_timedwait(&m->cv, &m->mu, &wake);
+            continue;                           // arrêt ou échéance : on réévalue
+        }
+        size_t idx = heap_pop(m);
+        uint64_t late = now - s->due_ns;
+        pthread_mutex_unlock(&m->mu);
+
+        int st = poll_slave(m, s);
+
+        pthread_mutex_lock(&m->mu);
+        if (!s->backoff_ms) {
+            s->late_sum_ns += late;
+            s->late_n++;
+            if (late > s->late_max_ns) s->late_max_ns = late;
+        }
+        if (st > 0) { s->win_ok++; s->rate_ok++; }
+        reschedule(m, s, st, mono_ns());
+        heap_push(m, idx);
+    }
+    pthread_mutex_unlock(&m->mu);
+    return NULL;
+}
+
+int modbus_rtu_open(modbus_rtu_t* m, const modbus_rtu_params_t* cfg,
+                    const gateway_realtime_t* realtime, modbus_data_cb on_data, void* user,
+                    modbus_image_t* image, const char* image_src){
+    if (!m || !cfg || !cfg->port || cfg->slaves_count == 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+    m->cfg = cfg;
+    m->realtime = realtime;
+    m->on_data = on_data;
+    m->user = user;
+    m->image = image;
+    m->image_src = image_src;
+
+    // conn_uart.c : 8 bits, parité/stop du connecteur, low_latency (petites trames)
+    m->uart.port = cfg->port;
+    m->uart.baudrate = cfg->baudrate ? cfg->baudrate : 19200;
+    m->uart.bytesize = 8;                 m->uart.bytesize_set = true;
+    m->uart.parity = cfg->parity ? cfg->parity : 'N'; m->uart.parity_set = true;
+    m->uart.stopbits = cfg->stopbits == 2 ? 2.0 : 1.0; m->uart.stopbits_set = true;
+    m->uart.timeout_ms = cfg->timeout_ms; m->uart.timeout_set = true;
+    m->uart.low_latency = true;
+
+    int bits = 1 + 8 + (m->uart.parity != 'N' ? 1 : 0) + (cfg->stopbits == 2 ? 2 : 1);
+    m->char_ns = ((uint64_t)bits * 1000000000ULL + (uint64_t)m->uart.baudrate - 1) / (uint64_t)m->uart.baudrate;
+    m->t35_ns = m->uart.baudrate > 19200 ? 1750000ULL : m->char_ns * 7 / 2;
+    m->backoff_max_ms = cfg->backoff_max_ms > 0 ? (uint32_t)cfg->backoff_max_ms : 30000;
+    uint32_t tmo_ms = cfg->timeout_ms > 0 ? (uint32_t)cfg->timeout_ms : 200;
+
+    m->slaves = (modbus_rtu_slave_t*)calloc(cfg->slaves_count, sizeof(*m->slaves));
+    m->heap = (size_t*)calloc(cfg->slaves_count, sizeof(*m->heap));
+    m->wmaps = (modbus_wmap_t*)calloc(cfg->slaves_count, sizeof(*m->wmaps));
+    if (!m->slaves || !m->heap || !m->wmaps) {
+        free(m->slaves); free(m->heap); free(m->wmaps);
+        m->slaves = NULL; m->heap = NULL; m->wmaps = NULL;
+        return -1;
+    }
+    m->nslaves = cfg->slaves_count;
+    size_t nblocks = 0, npoints = 0;
+    for (size_t i = 0; i < m->nslaves; ++i) {
+        modbus_rtu_slave_t* s = &m->slaves[i];
+        s->cfg = &cfg->slaves[i];
+        s->period_ns = (uint64_t)(s->cfg->poll_ms ? s->cfg->poll_ms : 1000) * 1000000ULL;
+        s->timeout_ns = (uint64_t)(s->cfg->timeout_ms > 0 ? (uint32_t)s->cfg->timeout_ms : tmo_ms) * 1000000ULL;
+        if (modbus_plan_build(&s->plan, s->cfg->map, s->cfg->map_count, cfg->max_gap) != 0) {
+            log_err("modbus-rtu %s: invalid map for unit %u", cfg->port, (unsigned)s->cfg->unit_id);
+            goto fail;
+        }
+        nblocks += s->plan.nblocks;
+        npoints += s->plan.points;
+        m->wmaps[i].unit = s->cfg->unit_id;
+        m->wmaps[i].map = s->cfg->map;
+        m->wmaps[i].n = s->cfg->map_count;
+    }
+
+    int rc = uart_open(&m->uart, &m->fd);
+    if (rc != UART_OK) {
+        log_err("modbus-rtu %s: open failed (%d)", cfg->port, rc);
+        goto fail;
+    }
+    int fl = fcntl(m->fd, F_GETFL);
+    if (fl < 0 || fcntl(m->fd, F_SETFL, fl | O_NONBLOCK) < 0) goto fail;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&m->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_mutex_init(&m->mu, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &m->started);
+    uint64_t t0 = mono_ns();
+    for (size_t i = 0; i < m->nslaves; ++i) {
+        m->slaves[i].due_ns = t0;
+        m->slaves[i].win_start_ns = m->slaves[i].rate_start_ns = t0;
+        heap_push(m, i);
+    }
+    modbus_wq_init(&m->wq, cfg, m->wmaps, m->nslaves, rtu_kick, m);
+    m->running = true;
+    if (pthread_create(&m->thread, NULL, modbus_rtu_thread, m) != 0) {
+        perror("pthread_create(modbus_rtu_thread)");
+        m->running = false;
+        modbus_wq_close(&m->wq);
+        pthread_cond_destroy(&m->cv);
+        pthread_mutex_destroy(&m->mu);
+        goto fail;
+    }
+    log_info("modbus-rtu %s: %zu slave(s), %zu point(s) in %zu request(s), t3.5=%lu us",
+             cfg->port, m->nslaves, npoints, nblocks, (unsigned long)(m->t35_ns / 1000));
+    return 0;
+
+fail:
+    if (m->fd >= 0) uart_close(m->fd);
+    m->fd = -1;
+    for (size_t i = 0; i < m->nslaves; ++i) modbus_plan_free(&m->slaves[i].plan);
+    free(m->slaves);
+    free(m->heap);
+    free(m->wmaps);
+    m->slaves = NULL;
+    m->heap = NULL;
+    m->wmaps = NULL;
+    m->nslaves = m->heap_n = 0;
+    return -1;
+}
+
+size_t modbus_rtu_get_rates(modbus_rtu_t* m, modbus_rtu_rate_t* out, size_t max){
+    if (!m || !m->running || !out) return 0;
+    uint64_t now = mono_ns();
+    size_t n = 0;
+    pthread_mutex_lock(&m->mu);
+    for (size_t i = 0; i < m->nslaves && n < max; ++i, ++n) {
+        modbus_rtu_slave_t* s = &m->slaves[i];
+        double win = (double)(now - s->rate_start_ns) / 1e9;
+        uint32_t poll_ms = s->cfg->poll_ms ? s->cfg->poll_ms : 1000;
+        out[n].unit = s->cfg->unit_id;
+        out[n].configured_hz = 1000.0 / (double)poll_ms;
+        out[n].achieved_hz = win > 0 ? (double)s->rate_ok / win : 0.0;
+        out[n].offline = s->backoff_ms != 0;
+        s->rate_start_ns = now;
+        s->rate_ok = 0;
+    }
+    pthread_mutex_unlock(&m->mu);
+    return n;
+}
+
+void modbus_rtu_log_stats(modbus_rtu_t* m, const char* tag){
+    if (!m || !m->running) return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double win = (double)ts_diff_ns(&now, &m->started);
+    log_info("[%s] modbus-rtu %s: %lu requests, tx %lu / rx %lu bytes, bus util=%.2f%%",
+             tag ? tag : "modbus", m->cfg->port, m->requests, m->bytes_tx, m->bytes_rx,
+             win > 0 ? 100.0 * (double)m->busy_ns / win : 0.0);
+    modbus_wq_log_stats(&m->wq, tag);
+
+    uint64_t t = mono_ns();
+    pthread_mutex_lock(&m->mu);
+    for (size_t i = 0; i < m->nslaves; ++i) {
+        modbus_rtu_slave_t* s = &m->slaves[i];
+        double w = (double)(t - s->win_start_ns) / 1e9;
+        log_info("[%s]   unit %u: rate %.2f/%.2f Hz%s, late avg %.1f max %.1f ms; %lu polls, %lu ok, "
+                 "timeouts %lu, crc %lu, exceptions %lu, bad frames %lu, overruns %lu, back-offs %lu",
+                 tag ? tag : "modbus", (unsigned)s->cfg->unit_id,
+                 w > 0 ? (double)s->win_ok / w : 0.0, 1e9 / (double)s->period_ns,
+                 s->backoff_ms ? " (offline)" : "",
+                 s->late_n ? (double)s->late_sum_ns / (double)s->late_n / 1e6 : 0.0,
+                 (double)s->late_max_ns / 1e6, s->polls, s->ok, s->timeouts,
+                 s->crc_errors, s->exceptions, s->frame_errors, s->overruns, s->backoffs);
+        s->win_start_ns = t;
+        s->win_ok = 0;
+        s->late_sum_ns = s->late_max_ns = 0;
+        s->late_n = 0;
+    }
+    pthread_mutex_unlock(&m->mu);
+}
+
+void modbus_rtu_close(modbus_rtu_t* m){
+    if (!m) return;
+    if (m->running) {
+        pthread_mutex_lock(&m->mu);
+        m->stop = 1;
+        pthread_cond_broadcast(&m->cv);
+        pthread_mutex_unlock(&m->mu);
+        pthread_join(m->thread, NULL);
+        modbus_wq_close(&m->wq);           // consignes non émises : confirmées en échec
+        pthread_cond_destroy(&m->cv);
+        pthread_mutex_destroy(&m->mu);
+        m->running = false;
+    }
+    if (m->fd >= 0) uart_close(m->fd);
+    for (size_t i = 0; i < m->nslaves; ++i) modbus_plan_free(&m->slaves[i].plan);
+    free(m->slaves);
+    free(m->heap);
+    free(m->wmaps);
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+}
@@ -0,0 +1,127 @@
+#pragma once
+/**
+ * @file modbus_rtu.h
+ * @brief Maître Modbus RTU (polling des slaves[] d'un connecteur modbus-rtu).
+ *
+ * Port ouvert par conn_uart.c (termios, low_latency), fd non bloquant, un
+ * thread par bus. Chaque slave a son plan de lecture (modbus.h : blocs
+ * coalescés <= 125 registres). Une transaction :
+ *   - attend que la ligne soit libre depuis t3.5 (3,5 caractères, 1750 µs
+ *     au-delà de 19200 bauds) ;
+ *   - écrit l'ADU (CRC-16 table), attend la réponse par ppoll() jusqu'à la
+ *     longueur attendue (ou 5 octets si exception) ou timeout_ms après la fin
+ *     estimée de l'émission ;
+ *   - vérifie CRC/adresse/fonction puis recopie les données dans l'image.
+ * Quand tous les blocs d'un slave ont répondu, l'image est décodée
+ * (type/signed/scale) et remise à on_data (metrics + JSON).
+ *
+ * Ordonnancement : tas binaire des échéances des slaves (min-heap sur due_ns).
+ * Le thread dépile le slave le plus en retard, le scrute, le replace à
+ * échéance + poll_ms ; tant que des échéances sont passées, les scrutations
+ * s'enchaînent sans attente (bus occupé en continu). Un slave muet (timeout,
+ * slaves[].timeout_ms ou celui du connecteur) passe hors ligne : une seule
+ * requête de sonde par tentative, intervalle doublé à chaque échec jusqu'à
+ * backoff_max_ms, retour à poll_ms à la première réponse.
+ *
+ * Écritures (modbus_write.h) : les commandes des bridges vers ce connecteur
+ * passent avant la scrutation ; la file est vidée avant chaque requête de
+ * lecture, donc une consigne attend au plus la fin de la transaction en cours.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "modbus.h"
+#include "modbus_write.h"
+#include "modbus_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const modbus_slave_t* cfg;
+    modbus_plan_t   plan;
+    uint64_t        due_ns;         // prochaine scrutation (CLOCK_MONOTONIC)
+    uint64_t        period_ns;      // poll_ms
+    uint64_t        timeout_ns;     // slaves[].timeout_ms, sinon timeout_ms du connecteur
+    uint32_t        backoff_ms;     // 0 = en ligne, sinon intervalle de sonde courant
+    unsigned        fail_streak;
+
+    // fenêtre de mesure du débit atteint (sous mu, remise à zéro par log_stats)
+    uint64_t        win_start_ns;
+    unsigned long   win_ok;
+    // fenêtre propre à modbus_rtu_get_rates() (export), indépendante des logs
+    uint64_t        rate_start_ns;
+    unsigned long   rate_ok;
+    uint64_t        late_sum_ns, late_max_ns;   // retard départ/échéance
+    unsigned long   late_n;
+
+    unsigned long polls, ok, timeouts, crc_errors, exceptions, frame_errors, overruns, backoffs;
+} modbus_rtu_slave_t;
+
+typedef struct {
+    const modbus_rtu_params_t* cfg;
+    uart_params_t uart;             // dérivé de cfg pour conn_uart.c
+    int fd;
+    const gateway_realtime_t* realtime;
+
+    modbus_data_cb on_data;
+    void*          user;
+    modbus_image_t* image;          // image du serveur destination du bridge, NULL sinon
+    const char*     image_src;      // nom du connecteur (propriétaire des units dans l'image)
+
+    modbus_rtu_slave_t* slaves;
+    size_t              nslaves;
+    size_t*             heap;       // indices de slaves, min-heap sur due_ns
+    size_t              heap_n;
+    uint32_t            backoff_max_ms;
+
+    modbus_wq_t         wq;         // commandes d'écriture (prioritaires)
+    modbus_wmap_t*      wmaps;      // une map par slave
+
+    uint64_t char_ns, t35_ns;
+    uint64_t bus_free_ns;           // CLOCK_MONOTONIC : ligne libre (fin d'activité + t3.5)
+
+    pthread_t       thread;
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;             // CLOCK_MONOTONIC : attente d'échéance / arrêt
+    bool            running;
+    volatile int    stop;
+
+    unsigned long   requests;
+    unsigned long   bytes_tx, bytes_rx;
+    uint64_t        busy_ns;        // ligne occupée (requête -> fin de réponse)
+    struct timespec started;
+} modbus_rtu_t;
+
+/* Ouvre le port, construit les plans et lance le thread de scrutation.
+ * max_gap : voir modbus_plan_build(). image (NULL : aucune) reçoit chaque bloc
+ * lu, au nom de image_src. Retour 0, -1. */
+int  modbus_rtu_open(modbus_rtu_t* m, const modbus_rtu_params_t* cfg,
+                     const gateway_realtime_t* realtime, modbus_data_cb on_data, void* user,
+                     modbus_image_t* image, const char* image_src);
+
+typedef struct {
+    uint8_t unit;
+    double  configured_hz;          // 1000 / poll_ms configuré (hors back-off)
+    double  achieved_hz;            // scrutations complètes / s depuis l'appel précédent
+    bool    offline;                // en back-off
+} modbus_rtu_rate_t;
+
+// Débits configurés/atteints par slave, sur une fenêtre propre (depuis l'appel
+// précédent, non touchée par log_stats) qui redémarre. Retour : entrées écrites (<= max).
+size_t modbus_rtu_get_rates(modbus_rtu_t* m, modbus_rtu_rate_t* out, size_t max);
+
+// Journalise bus + slaves (débit atteint/configuré, retard, back-off) et
+// démarre une nouvelle fenêtre de mesure
+void modbus_rtu_log_stats(modbus_rtu_t* m, const char* tag);
+
+void modbus_rtu_close(modbus_rtu_t* m);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,379 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "modbus_server.h"
+#include "modbus_image.h"
+#include "modbus.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#define SRV_TX_CAP (16 * MODBUS_TCP_MAX_ADU)   // réponses en attente par client
+
+typedef struct srv_client {
+    int      fd;
+    uint8_t  rx[2 * MODBUS_TCP_MAX_ADU];
+    size_t   rx_len;
+    uint8_t  tx[SRV_TX_CAP];
+    size_t   tx_len, tx_off;
+    uint64_t last_ns;               // dernière activité (idle_timeout_s)
+    uint32_t events;                // masque epoll courant
+    struct srv_client* dead_next;   // fermé : libéré en fin de lot epoll
+} srv_client_t;
+
+struct modbus_server {
+    char key[64];                   // bind
+    int refs;
+    const modbus_server_params_t* cfg;
+    const gateway_realtime_t* realtime;
+
+    int lfd, efd, epfd;
+    srv_client_t** clients;
+    size_t nclients, max_clients;
+    srv_client_t* dead;             // fermés pendant le lot courant
+    uint64_t max_age_ns, idle_ns;
+    modbus_image_t* image;          // alimentée par les maîtres des bridges de ce serveur
+
+    pthread_t thread;
+    volatile int stop;
+
+    unsigned long accepted, rejected, requests, exceptions, stale, idle_closed;
+    unsigned long bytes_rx, bytes_tx, msgs;
+    struct modbus_server* next;
+};
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static struct modbus_server* g_servers;
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// "[host]:port" -> socket d'écoute non bloquante
+static int listen_on(const char* bind_s){
+    char host[64] = "";
+    const char* c = strrchr(bind_s, ':');
+    if (!c) return -1;
+    size_t hl = (size_t)(c - bind_s);
+    if (hl >= sizeof(host)) return -1;
+    memcpy(host, bind_s, hl);
+    host[hl] = '\0';
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    const char* h = (!host[0] || !strcmp(host, "*")) ? NULL : host;
+    if (!h) hints.ai_family = AF_INET;
+    if (getaddrinfo(h, c + 1, &hints, &res) != 0 || !res) return -1;
+
+    int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, res->ai_addr, res->ai_addrlen) != 0 || listen(fd, 64) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static void client_close(struct modbus_server* s, size_t i){
+    srv_client_t* c = s->clients[i];
+    epoll_ctl(s->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->dead_next = s->dead;         // un événement du même lot peut encore le viser
+    s->dead = c;
+    s->clients[i] = s->clients[--s->nclients];
+}
+
+static void free_dead(struct modbus_server* s){
+    while (s->dead) {
+        srv_client_t* c = s->dead;
+        s->dead = c->dead_next;
+        free(c);
+    }
+}
+
+static size_t client_index(const struct modbus_server* s, const srv_client_t* c){
+    for (size_t i = 0; i < s->nclients; ++i) if (s->clients[i] == c) return i;
+    return s->nclients;
+}
+
+// EPOLLIN tant qu'il reste de la place pour les réponses, EPOLLOUT si envoi en attente
+static void client_rearm(struct modbus_server* s, srv_client_t* c){
+    uint32_t ev = 0;
+    if (SRV_TX_CAP - c->tx_len >= MODBUS_TCP_MAX_ADU) ev |= EPOLLIN;
+    if (c->tx_off < c->tx_len) ev |= EPOLLOUT;
+    if (ev == c->events) return;
+    struct epoll_event e = { .events = ev, .data.ptr = c };
+    epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &e);
+    c->events = ev;
+}
+
+static void do_accept(struct modbus_server* s, uint64_t now){
+    for (;;) {
+        int fd = accept4(s->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;                          // EAGAIN ou erreur transitoire
+        }
+        if (s->nclients >= s->max_clients) { close(fd); s->rejected++; continue; }
+        srv_client_t* c = (srv_client_t*)calloc(1, sizeof(*c));
+        if (!c) { close(fd); s->rejected++; continue; }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        c->fd = fd;
+        c->last_ns = now;
+        c->events = EPOLLIN;
+        struct epoll_event e = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &e) != 0) { close(fd); free(c); continue; }
+        s->clients[s->nclients++] = c;
+        s->accepted++;
+    }
+}
+
+// Une requête (ADU complète) -> réponse ajoutée au tampon d'émission
+static void handle_request(struct modbus_server* s, srv_client_t* c, const uint8_t* f, size_t flen,
+                           uint64_t now){
+    const uint8_t* pdu = f + MODBUS_MBAP_LEN;
+    size_t n = flen - MODBUS_MBAP_LEN;
+    uint8_t unit = f[6], fc = pdu[0];
+    uint8_t rsp[MODBUS_MAX_PDU];
+    size_t rlen;
+    int rc;
+
+    s->requests++;
+    if (fc < MODBUS_FC_READ_COILS || fc > MODBUS_FC_READ_INPUT) rc = -MODBUS_EX_ILLEGAL_FUNCTION;
+    else if (n != 5)                                           rc = -MODBUS_EX_ILLEGAL_VALUE;
+    else {
+        uint16_t addr = (uint16_t)((pdu[1] << 8) | pdu[2]);
+        uint16_t count = (uint16_t)((pdu[3] << 8) | pdu[4]);
+        rc = modbus_image_read(s->image, unit, fc, addr, count, now, s->max_age_ns, rsp + 2);
+    }
+    if (rc >= 0) {
+        rsp[0] = fc;
+        rsp[1] = (uint8_t)rc;
+        rlen = 2 + (size_t)rc;
+    } else {
+        s->exceptions++;
+        if (rc == -MODBUS_EX_GATEWAY_TARGET) s->stale++;
+        rsp[0] = (uint8_t)(fc | 0x80);
+        rsp[1] = (uint8_t)-rc;
+        rlen = 2;
+    }
+    uint16_t tid = (uint16_t)((f[0] << 8) | f[1]);
+    c->tx_len += modbus_tcp_adu(tid, unit, rsp, rlen, c->tx + c->tx_len);
+}
+
+/* Traite toutes les requêtes complètes du tampon (dans la limite du tampon
+ * d'émission). Retour -1 si le flux n'est pas du Modbus TCP. */
+static int client_process(struct modbus_server* s, srv_client_t* c, uint64_t now){
+    size_t off = 0;
+    while (c->rx_len - off >= MODBUS_MBAP_LEN && SRV_TX_CAP - c->tx_len >= MODBUS_TCP_MAX_ADU) {
+        const uint8_t* f = c->rx + off;
+        size_t flen = modbus_tcp_frame_len(f, c->rx_len - off);
+        if (f[2] || f[3] || flen < MODBUS_MBAP_LEN + 1 || flen > MODBUS_TCP_MAX_ADU) return -1;
+        if (c->rx_len - off < flen) break;
+        handle_request(s, c, f, flen, now);
+        off += flen;
+    }
+    if (off) {
+        memmove(c->rx, c->rx + off, c->rx_len - off);
+        c->rx_len -= off;
+    }
+    return 0;
+}
+
+static int client_flush(struct modbus_server* s, srv_client_t* c){
+    while (c->tx_off < c->tx_len) {
+        ssize_t w = send(c->fd, c->tx + c->tx_off, c->tx_len - c->tx_off, MSG_NOSIGNAL);
+        if (w > 0) { c->tx_off += (size_t)w; s->bytes_tx += (unsigned long)w; continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return -1;
+    }
+    if (c->tx_off == c->tx_len) c->tx_off = c->tx_len = 0;
+    else if (c->tx_off > SRV_TX_CAP / 2) {
+        memmove(c->tx, c->tx + c->tx_off, c->tx_len - c->tx_off);
+        c->tx_len -= c->tx_off;
+        c->tx_off = 0;
+    }
+    return 0;
+}
+
+static int client_io(struct modbus_server* s, srv_client_t* c, uint32_t ev, uint64_t now){
+    if (ev & (EPOLLERR | EPOLLHUP)) return -1;
+    if (ev & EPOLLIN) {
+        for (;;) {
+            if (c->rx_len == sizeof(c->rx)) break;      // tampon d'émission plein : on attend
+            ssize_t k = recv(c->fd, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len, 0);
+            if (k > 0) {
+                c->rx_len += (size_t)k;
+                s->bytes_rx += (unsigned long)k;
+                c->last_ns = now;
+                if (client_process(s, c, now) != 0) return -1;
+                continue;
+            }
+            if (k < 0 && errno == EINTR) continue;
+            if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return -1;                                   // EOF ou erreur
+        }
+    }
+    if (client_flush(s, c) != 0) return -1;
+    // place libérée : requêtes restées en attente dans rx
+    if (c->rx_len && client_process(s, c, now) != 0) return -1;
+    if (client_flush(s, c) != 0) return -1;
+    client_rearm(s, c);
+    return 0;
+}
+
+static void* modbus_server_thread(void* arg){
+    struct modbus_server* s = (struct modbus_server*)arg;
+    rt_sched_thread_enter(s->realtime, "iotgw-mbsrv");
+
+    struct epoll_event evs[64];
+    uint64_t last_scan = mono_ns();
+    while (!s->stop) {
+        int n = epoll_wait(s->epfd, evs, 64, s->idle_ns ? 1000 : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_err("modbus-server %s: epoll_wait: %s", s->key, strerror(errno));
+            break;
+        }
+        uint64_t now = mono_ns();
+        for (int i = 0; i < n && !s->stop; ++i) {
+            void* p = evs[i].data.ptr;
+            if (p == &s->efd) continue;
+            if (p == &s->lfd) { do_accept(s, now); continue; }
+            srv_client_t* c = (srv_client_t*)p;
+            size_t idx = client_index(s, c);
+            if (idx == s->nclients) continue;            // fermé plus tôt dans ce lot
+            if (client_io(s, c, evs[i].events, now) != 0) client_close(s, idx);
+        }
+        free_dead(s);
+        if (s->idle_ns && now - last_scan >= 1000000000ULL) {
+            last_scan = now;
+            for (size_t i = s->nclients; i-- > 0;)
+                if (now - s->clients[i]->last_ns > s->idle_ns) { client_close(s, i); s->idle_closed++; }
+            free_dead(s);
+        }
+    }
+    while (s->nclients) client_close(s, s->nclients - 1);
+    free_dead(s);
+    return NULL;
+}
+
+static void server_free(struct modbus_server* s){
+    if (s->epfd >= 0) close(s->epfd);
+    if (s->efd >= 0) close(s->efd);
+    if (s->lfd >= 0) close(s->lfd);
+    free(s->clients);
+    modbus_image_free(s->image);
+    free(s);
+}
+
+modbus_server_t* modbus_server_attach(const modbus_server_params_t* cfg,
+                                      const gateway_realtime_t* realtime){
+    if (!cfg || !cfg->bind) return NULL;
+    pthread_mutex_lock(&g_mu);
+    struct modbus_server* s = g_servers;
+    while (s && strcmp(s->key, cfg->bind) != 0) s = s->next;
+    if (s) {
+        s->refs++;
+        pthread_mutex_unlock(&g_mu);
+        return s;
+    }
+
+    s = (struct modbus_server*)calloc(1, sizeof(*s));
+    if (!s) { pthread_mutex_unlock(&g_mu); return NULL; }
+    snprintf(s->key, sizeof(s->key), "%s", cfg->bind);
+    s->refs = 1;
+    s->cfg = cfg;
+    s->realtime = realtime;
+    s->max_clients = cfg->max_clients > 0 ? (size_t)cfg->max_clients : 16;
+    s->max_age_ns = (uint64_t)(cfg->max_age_ms > 0 ? cfg->max_age_ms : 0) * 1000000ULL;
+    s->idle_ns = (uint64_t)(cfg->idle_timeout_set ? cfg->idle_timeout_s : 60) * 1000000000ULL;
+    s->clients = (srv_client_t**)calloc(s->max_clients, sizeof(*s->clients));
+    s->image = modbus_image_new();
+    s->lfd = listen_on(cfg->bind);
+    s->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (s->lfd < 0) log_err("modbus-server %s: bind/listen failed: %s", cfg->bind, strerror(errno));
+    if (!s->clients || !s->image || s->lfd < 0 || s->efd < 0 || s->epfd < 0) goto fail;
+
+    struct epoll_event el = { .events = EPOLLIN, .data.ptr = &s->lfd };
+    struct epoll_event ee = { .events = EPOLLIN, .data.ptr = &s->efd };
+    if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->lfd, &el) != 0 ||
+        epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->efd, &ee) != 0) goto fail;
+
+    if (pthread_create(&s->thread, NULL, modbus_server_thread, s) != 0) {
+        perror("pthread_create(modbus_server_thread)");
+        goto fail;
+    }
+    s->next = g_servers;
+    g_servers = s;
+    pthread_mutex_unlock(&g_mu);
+    log_info("modbus-server %s: listening, %zu client(s) max, max age %lu ms",
+             s->key, s->max_clients, (unsigned long)(s->max_age_ns / 1000000ULL));
+    return s;
+
+fail:
+    server_free(s);
+    pthread_mutex_unlock(&g_mu);
+    return NULL;
+}
+
+void modbus_server_detach(modbus_server_t* s){
+    if (!s) return;
+    pthread_mutex_lock(&g_mu);
+    if (--s->refs > 0) { pthread_mutex_unlock(&g_mu); return; }
+    for (struct modbus_server** pp = &g_servers; *pp; pp = &(*pp)->next)
+        if (*pp == s) { *pp = s->next; break; }
+    pthread_mutex_unlock(&g_mu);
+
+    s->stop = 1;
+    uint64_t one = 1;
+    ssize_t r = write(s->efd, &one, sizeof(one));
+    (void)r;
+    pthread_join(s->thread, NULL);
+    server_free(s);
+}
+
+void modbus_server_log_stats(modbus_server_t* s, const char* tag){
+    if (!s) return;
+    log_info("[%s] modbus-server %s: %zu client(s), %lu accepted, %lu rejected, %lu idle closed; "
+             "%lu requests, %lu exceptions (%lu stale), rx %lu / tx %lu bytes, %lu bridge msg(s), "
+             "%lu unit conflict(s)",
+             tag ? tag : "modbus", s->key, s->nclients, s->accepted, s->rejected, s->idle_closed,
+             s->requests, s->exceptions, s->stale, s->bytes_rx, s->bytes_tx,
+             __atomic_load_n(&s->msgs, __ATOMIC_RELAXED), modbus_image_conflicts(s->image));
+}
+
+modbus_image_t* modbus_server_image(modbus_server_t* s){
+    return s ? s->image : NULL;
+}
+
+int modbus_server_send_adapter(const gw_msg_t* msg, void* ctx){
+    (void)msg;
+    struct modbus_server* s = (struct modbus_server*)ctx;
+    if (!s) return -1;
+    __atomic_add_fetch(&s->msgs, 1, __ATOMIC_RELAXED);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+/**
+ * @file modbus_server.h
+ * @brief Serveur Modbus TCP « façade » : lectures servies depuis modbus_image.
+ *
+ * Un thread epoll par adresse d'écoute (bind), partagé par tous les bridges qui
+ * ont ce connecteur pour destination (compteur de références, comme spi_bus).
+ * Sockets non bloquantes, jusqu'à max_clients connexions ; plusieurs requêtes
+ * d'un même client (pipelinées) sont traitées dans le même réveil et leurs
+ * réponses envoyées en un send(). FC 0x01..0x04 répondus depuis l'image des
+ * registres, avec max_age_ms comme garde de fraîcheur ; les autres fonctions
+ * reçoivent l'exception 0x01. Aucune requête n'atteint le bus série.
+ * L'image appartient au serveur : seuls les maîtres des bridges dont il est
+ * la destination l'alimentent (modbus_server_image()).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "gw_msg.h"
+#include "modbus_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct modbus_server modbus_server_t;
+
+// Démarre (ou partage) le serveur de cfg->bind. Retour NULL si bind/listen échoue.
+modbus_server_t* modbus_server_attach(const modbus_server_params_t* cfg,
+                                      const gateway_realtime_t* realtime);
+// Relâche une référence ; la dernière arrête le thread et ferme les clients
+void modbus_server_detach(modbus_server_t* s);
+
+void modbus_server_log_stats(modbus_server_t* s, const char* tag);
+
+// Image des registres servie, à passer au maître source du bridge (modbus_rtu/tcp_open)
+modbus_image_t* modbus_server_image(modbus_server_t* s);
+
+/* gw_send_fn du bridge (ctx = modbus_server_t*) : les valeurs arrivent par
+ * l'image (blocs bruts recopiés par les maîtres) ; le message est compté. */
+int  modbus_server_send_adapter(const gw_msg_t* msg, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
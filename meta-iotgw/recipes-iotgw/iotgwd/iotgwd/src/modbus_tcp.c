@@ -0,0 +1,539 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "modbus_tcp.h"
+#include "modbus_image.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#define RECONNECT_MIN_MS 500
+#define RECONNECT_MAX_MS 30000
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec ns_to_ts(uint64_t ns){
+    struct timespec ts = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+    return ts;
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---- file des blocs à émettre (anneau, chaque bloc au plus une fois) ----
+static void queue_push(modbus_tcp_t* m, size_t b){
+    m->queue[(m->queue_head + m->queue_n++) % m->plan.nblocks] = b;
+}
+
+static size_t queue_pop(modbus_tcp_t* m){
+    size_t b = m->queue[m->queue_head];
+    m->queue_head = (m->queue_head + 1) % m->plan.nblocks;
+    m->queue_n--;
+    return b;
+}
+
+// Fin de cycle abandonnée (déconnexion) : le cycle suivant part dès la reconnexion
+static void cycle_abort(modbus_tcp_t* m){
+    if (!m->in_cycle) return;
+    m->in_cycle = false;
+    m->queue_n = 0;
+    m->due_ns = 0;
+}
+
+// Écritures en vol, à réémettre ou en attente : terminées avec rc
+static void fail_writes(modbus_tcp_t* m, int rc){
+    for (unsigned i = 0; i < MODBUS_TCP_MAX_INFLIGHT; ++i) {
+        modbus_tcp_slot_t* s = &m->slots[i];
+        if (!s->used || !s->wr) continue;
+        modbus_wreq_done(&m->wq, s->wr, rc);
+        free(s->wr);
+        s->wr = NULL;
+    }
+    while (m->wretry) {
+        modbus_wreq_t* r = m->wretry;
+        m->wretry = r->next;
+        modbus_wreq_done(&m->wq, r, rc);
+        free(r);
+    }
+    modbus_wr_fail_all(&m->wq, m->wpend, rc);
+    m->wpend = NULL;
+}
+
+static void drop_connection(modbus_tcp_t* m, const char* why){
+    if (m->fd >= 0) {
+        close(m->fd);
+        if (!m->connecting) {
+            m->disconnects++;
+            log_warn("modbus-tcp %s:%u: %s, reconnecting", m->cfg->host,
+                     (unsigned)(m->cfg->port_set ? m->cfg->port : 502), why);
+        }
+    }
+    m->fd = -1;
+    m->connecting = false;
+    fail_writes(m, MODBUS_ERR_IO);
+    memset(m->slots, 0, sizeof(m->slots));
+    m->inflight = 0;
+    m->tx_len = m->tx_off = 0;
+    m->rx_len = 0;
+    cycle_abort(m);
+
+    m->reconnect_ms = m->reconnect_ms ? m->reconnect_ms * 2 : RECONNECT_MIN_MS;
+    if (m->reconnect_ms > RECONNECT_MAX_MS) m->reconnect_ms = RECONNECT_MAX_MS;
+    m->reconnect_ns = mono_ns() + (uint64_t)m->reconnect_ms * 1000000ULL;
+}
+
+static void connected(modbus_tcp_t* m){
+    m->connecting = false;
+    m->connects++;
+    m->reconnect_ms = 0;
+    log_info("modbus-tcp %s:%u: connected", m->cfg->host,
+             (unsigned)(m->cfg->port_set ? m->cfg->port : 502));
+}
+
+// connect() non bloquant ; la fin est détectée par POLLOUT dans la boucle
+static void start_connect(modbus_tcp_t* m){
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)(m->cfg->port_set ? m->cfg->port : 502));
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int gai = getaddrinfo(m->cfg->host, port, &hints, &res);
+    if (gai != 0 || !res) {
+        if (!m->reconnect_ms)
+            log_warn("modbus-tcp %s: resolve failed: %s", m->cfg->host, gai_strerror(gai));
+        drop_connection(m, "resolve failed");
+        return;
+    }
+
+    int fd = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { freeaddrinfo(res); drop_connection(m, "socket failed"); return; }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+
+    int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    m->fd = fd;
+    m->connecting = true;
+    if (rc == 0) { connected(m); return; }
+    if (errno != EINPROGRESS) {
+        if (!m->reconnect_ms)
+            log_warn("modbus-tcp %s:%s: connect: %s", m->cfg->host, port, strerror(errno));
+        drop_connection(m, "connect failed");
+        return;
+    }
+    uint64_t to = m->timeout_ns > 1000000000ULL ? m->timeout_ns : 1000000000ULL;
+    m->connect_deadline_ns = mono_ns() + to;
+}
+
+static void cycle_begin(modbus_tcp_t* m, uint64_t now){
+    m->in_cycle = true;
+    m->cycle_start_ns = now;
+    m->cycles++;
+    m->resolved = 0;
+    m->queue_head = m->queue_n = 0;
+    for (size_t b = 0; b < m->plan.nblocks; ++b) {
+        m->tries[b] = 0;
+        m->state[b] = 0;
+        queue_push(m, b);
+    }
+}
+
+static void cycle_end(modbus_tcp_t* m, uint64_t now){
+    m->in_cycle = false;
+    bool all = true;
+    for (size_t b = 0; b < m->plan.nblocks; ++b) if (m->state[b] != 1) { all = false; break; }
+    if (all) {
+        m->cycles_ok++;
+        m->cycle_sum_ns += now - m->cycle_start_ns;
+        int nm = decode_plan_run(&m->plan.plan, m->plan.image, m->plan.image_len);
+        int jl = nm > 0 ? decode_plan_json(&m->plan.plan) : -1;
+        uint8_t unit = m->cfg->unit_id_set ? m->cfg->unit_id : 1;
+        if (jl > 0 && m->on_data)
+            m->on_data(unit, m->plan.plan.metrics, (size_t)nm, m->plan.plan.json, (size_t)jl,
+                       now_s(), m->user);
+    }
+    // cadence fixe depuis le début du cycle ; pas de rafale de rattrapage
+    m->due_ns = (m->due_ns ? m->due_ns : m->cycle_start_ns) + m->period_ns;
+    if (m->due_ns < now) { m->overruns++; m->due_ns = now; }
+}
+
+static bool tid_in_use(const modbus_tcp_t* m, uint16_t tid){
+    for (unsigned i = 0; i < MODBUS_TCP_MAX_INFLIGHT; ++i)
+        if (m->slots[i].used && m->slots[i].tid == tid) return true;
+    return false;
+}
+
+// Écriture suivante : réémission d'abord, puis requête fusionnée des écritures en attente
+static modbus_wreq_t* next_write(modbus_tcp_t* m){
+    modbus_wreq_t* r = m->wretry;
+    if (r) {
+        m->wretry = r->next;
+        r->next = NULL;
+        return r;
+    }
+    if (!m->wpend || !(r = (modbus_wreq_t*)malloc(sizeof(*r)))) return NULL;
+    modbus_wreq_next(&m->wpend, r);
+    return r;
+}
+
+// Écritures puis file des lectures -> requêtes en vol, tant que la fenêtre max_inflight le permet
+static void fill_pipeline(modbus_tcp_t* m, uint64_t now){
+    if (m->tx_off == m->tx_len) m->tx_off = m->tx_len = 0;
+    uint8_t unit = m->cfg->unit_id_set ? m->cfg->unit_id : 1;
+    while (m->inflight < m->max_inflight && sizeof(m->tx) - m->tx_len >= MODBUS_TCP_MAX_ADU) {
+        modbus_wreq_t* wr = next_write(m);
+        if (!wr && !(m->in_cycle && m->queue_n)) break;
+        unsigned k = 0;
+        while (m->slots[k].used) ++k;
+        do { m->next_tid++; } while (tid_in_use(m, m->next_tid));
+
+        modbus_tcp_slot_t* s = &m->slots[k];
+        if (wr) {
+            m->tx_len += modbus_tcp_adu(m->next_tid, wr->unit, wr->pdu, wr->pdu_len, m->tx + m->tx_len);
+            wr->tries++;
+            s->block = 0;
+        } else {
+            size_t b = queue_pop(m);
+            uint8_t pdu[8];
+            size_t n = modbus_pdu_read(&m->plan.blocks[b], pdu);
+            m->tx_len += modbus_tcp_adu(m->next_tid, unit, pdu, n, m->tx + m->tx_len);
+            m->tries[b]++;
+            s->block = b;
+        }
+        s->used = true;
+        s->wr = wr;
+        s->tid = m->next_tid;
+        s->sent_ns = now;
+        s->deadline_ns = now + m->timeout_ns;
+        m->inflight++;
+        m->requests++;
+        if (m->inflight > m->max_seen_inflight) m->max_seen_inflight = m->inflight;
+    }
+}
+
+// Vide le tampon d'émission (toutes les requêtes du lot en un send si possible)
+static int flush_tx(modbus_tcp_t* m){
+    while (m->tx_off < m->tx_len) {
+        ssize_t w = send(m->fd, m->tx + m->tx_off, m->tx_len - m->tx_off, MSG_NOSIGNAL);
+        if (w > 0) { m->tx_off += (size_t)w; m->bytes_tx += (unsigned long)w; continue; }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void release_slot(modbus_tcp_t* m, modbus_tcp_slot_t* s){
+    s->used = false;
+    s->wr = NULL;
+    m->inflight--;
+}
+
+// Rapproche chaque ADU reçue de sa requête par identifiant de transaction
+static int parse_rx(modbus_tcp_t* m, uint64_t now){
+    size_t off = 0;
+    uint8_t unit = m->cfg->unit_id_set ? m->cfg->unit_id : 1;
+    while (m->rx_len - off >= MODBUS_MBAP_LEN) {
+        const uint8_t* f = m->rx + off;
+        size_t flen = modbus_tcp_frame_len(f, m->rx_len - off);
+        // protocole != 0 ou longueur aberrante : flux désynchronisé
+        if (f[2] || f[3] || flen < MODBUS_MBAP_LEN + 2 || flen > MODBUS_TCP_MAX_ADU) {
+            m->frame_errors++;
+            return -1;
+        }
+        if (m->rx_len - off < flen) break;
+        off += flen;
+        m->responses++;
+
+        uint16_t tid = (uint16_t)((f[0] << 8) | f[1]);
+        modbus_tcp_slot_t* s = NULL;
+        for (unsigned i = 0; i < MODBUS_TCP_MAX_INFLIGHT; ++i)
+            if (m->slots[i].used && m->slots[i].tid == tid) { s = &m->slots[i]; break; }
+        if (!s || f[6] != (s->wr ? s->wr->unit : unit)) { m->stale++; continue; }   // réponse à une requête réémise
+
+        uint64_t rtt = now - s->sent_ns;
+        m->rtt_sum_ns += rtt;
+        if (rtt > m->rtt_max_ns) m->rtt_max_ns = rtt;
+
+        if (s->wr) {
+            modbus_wreq_t* wr = s->wr;
+            release_slot(m, s);
+            int wrc = modbus_wreq_check(wr, f + MODBUS_MBAP_LEN, flen - MODBUS_MBAP_LEN);
+            if (wrc != MODBUS_OK)
+                log_warn("modbus-tcp %s: write (fc 0x%02x) failed: %s", m->cfg->host, wr->pdu[0],
+                         modbus_exception_str(wrc));
+            modbus_wreq_done(&m->wq, wr, wrc);
+            free(wr);
+            continue;
+        }
+
+        size_t b = s->block;
+        release_slot(m, s);
+        int rc = modbus_pdu_store(&m->plan, &m->plan.blocks[b], f + MODBUS_MBAP_LEN,
+                                  flen - MODBUS_MBAP_LEN);
+        if (rc == MODBUS_OK) {
+            m->state[b] = 1;
+            if (m->image)
+                (void)modbus_image_store(m->image, m->image_src, unit, &m->plan.blocks[b],
+                                         m->plan.image + m->plan.blocks[b].img_off, now);
+        } else {
+            if (rc > 0) m->exceptions++;
+            else        m->frame_errors++;
+            m->state[b] = -1;
+        }
+        m->resolved++;
+    }
+    if (off) {
+        memmove(m->rx, m->rx + off, m->rx_len - off);
+        m->rx_len -= off;
+    }
+    return 0;
+}
+
+static int read_rx(modbus_tcp_t* m, uint64_t now){
+    for (;;) {
+        ssize_t k = recv(m->fd, m->rx + m->rx_len, sizeof(m->rx) - m->rx_len, 0);
+        if (k > 0) {
+            m->rx_len += (size_t)k;
+            m->bytes_rx += (unsigned long)k;
+            if (parse_rx(m, now) != 0) return -1;
+            continue;
+        }
+        if (k < 0 && errno == EINTR) continue;
+        if (k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return -1;                       // EOF ou erreur
+    }
+}
+
+/* Requêtes sans réponse : réémises (nouvel identifiant) tant que retries le
+ * permet ; au-delà, la connexion est considérée perdue. */
+static int check_timeouts(modbus_tcp_t* m, uint64_t now){
+    for (unsigned i = 0; i < MODBUS_TCP_MAX_INFLIGHT; ++i) {
+        modbus_tcp_slot_t* s = &m->slots[i];
+        if (!s->used || now < s->deadline_ns) continue;
+        m->timeouts++;
+        if (s->wr) {
+            modbus_wreq_t* wr = s->wr;
+            release_slot(m, s);
+            if (wr->tries > m->retries) {
+                modbus_wreq_done(&m->wq, wr, MODBUS_ERR_TIMEOUT);
+                free(wr);
+                return -1;
+            }
+            m->retried++;
+            wr->next = m->wretry;
+            m->wretry = wr;
+            continue;
+        }
+        size_t b = s->block;
+        release_slot(m, s);
+        if (m->tries[b] > m->retries) return -1;
+        m->retried++;
+        queue_push(m, b);
+    }
+    return 0;
+}
+
+// Réveil du thread (nouvelle commande) ; appelé sous le verrou du registre
+static void tcp_kick(void* owner){
+    modbus_tcp_t* m = (modbus_tcp_t*)owner;
+    uint64_t one = 1;
+    ssize_t r = write(m->efd, &one, sizeof(one));
+    (void)r;
+}
+
+static void* modbus_tcp_thread(void* arg){
+    modbus_tcp_t* m = (modbus_tcp_t*)arg;
+    rt_sched_thread_enter(m->realtime, "iotgw-mbtcp");
+
+    while (!m->stop) {
+        uint64_t now = mono_ns();
+        if (m->fd < 0 && now >= m->reconnect_ns) start_connect(m);
+
+        bool up = m->fd >= 0 && !m->connecting;
+        if (m->fd < 0 && modbus_wq_pending(&m->wq))          // hors ligne : pas de consigne différée
+            modbus_wr_fail_all(&m->wq, modbus_wq_take(&m->wq), MODBUS_ERR_IO);
+        if (up) {
+            if (!m->wpend && modbus_wq_pending(&m->wq)) m->wpend = modbus_wq_take(&m->wq);
+            if (!m->in_cycle && now >= m->due_ns) cycle_begin(m, now);
+            if (m->in_cycle || m->wpend || m->wretry) {
+                fill_pipeline(m, now);
+                if (flush_tx(m) != 0) { drop_connection(m, "send failed"); continue; }
+            }
+        }
+
+        // prochaine échéance : connexion, requête en vol ou cycle suivant
+        uint64_t wake = UINT64_MAX;
+        if (m->fd < 0) wake = m->reconnect_ns;
+        else if (m->connecting) wake = m->connect_deadline_ns;
+        else {
+            if (!m->in_cycle) wake = m->due_ns;
+            for (unsigned i = 0; i < MODBUS_TCP_MAX_INFLIGHT; ++i)
+                if (m->slots[i].used && m->slots[i].deadline_ns < wake) wake = m->slots[i].deadline_ns;
+        }
+
+        struct pollfd pf[2] = {
+            { .fd = m->efd, .events = POLLIN },
+            { .fd = m->fd, .events = 0 },
+        };
+        if (m->fd >= 0) {
+            pf[1].events = POLLIN;
+            if (m->connecting || m->tx_off < m->tx_len) pf[1].events |= POLLOUT;
+        }
+        now = mono_ns();
+        struct timespec to = ns_to_ts(wake > now ? wake - now : 0);
+        int r = ppoll(pf, m->fd >= 0 ? 2 : 1, wake == UINT64_MAX ? NULL : &to, NULL);
+        if (r < 0 && errno != EINTR) { log_err("modbus-tcp: ppoll: %s", strerror(errno)); break; }
+        if (m->stop) break;
+        if (pf[0].revents & POLLIN) {                       // commande d'écriture
+            uint64_t v;
+            ssize_t rd = read(m->efd, &v, sizeof(v));
+            (void)rd;
+        }
+        now = mono_ns();
+
+        if (m->fd >= 0 && m->connecting) {
+            if (pf[1].revents & (POLLOUT | POLLERR | POLLHUP)) {
+                int err = 0;
+                socklen_t el = sizeof(err);
+                getsockopt(m->fd, SOL_SOCKET, SO_ERROR, &err, &el);
+                if (err) {
+                    if (!m->reconnect_ms)
+                        log_warn("modbus-tcp %s: connect: %s", m->cfg->host, strerror(err));
+                    drop_connection(m, "connect failed");
+                } else {
+                    connected(m);
+                }
+            } else if (now >= m->connect_deadline_ns) {
+                if (!m->reconnect_ms) log_warn("modbus-tcp %s: connect timeout", m->cfg->host);
+                drop_connection(m, "connect timeout");
+            }
+            continue;
+        }
+        if (m->fd < 0) continue;
+
+        if ((pf[1].revents & POLLOUT) && flush_tx(m) != 0) { drop_connection(m, "send failed"); continue; }
+        if ((pf[1].revents & (POLLIN | POLLERR | POLLHUP)) && read_rx(m, now) != 0) {
+            drop_connection(m, "connection lost");
+            continue;
+        }
+        if (check_timeouts(m, now) != 0) { drop_connection(m, "no response"); continue; }
+        if (m->in_cycle && m->resolved == m->plan.nblocks) cycle_end(m, now);
+    }
+    return NULL;
+}
+
+int modbus_tcp_open(modbus_tcp_t* m, const modbus_tcp_params_t* cfg,
+                    const gateway_realtime_t* realtime, modbus_data_cb on_data, void* user,
+                    modbus_image_t* image, const char* image_src){
+    if (!m || !cfg || !cfg->host || cfg->map_count == 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->fd = m->efd = -1;
+    m->cfg = cfg;
+    m->realtime = realtime;
+    m->on_data = on_data;
+    m->user = user;
+    m->image = image;
+    m->image_src = image_src;
+
+    m->period_ns = (uint64_t)(cfg->poll_ms ? cfg->poll_ms : 1000) * 1000000ULL;
+    m->timeout_ns = (uint64_t)(cfg->timeout_ms > 0 ? cfg->timeout_ms : 1000) * 1000000ULL;
+    m->retries = cfg->retries_set && cfg->retries >= 0 ? (unsigned)cfg->retries : 2;
+    if (m->retries > UINT8_MAX - 1) m->retries = UINT8_MAX - 1;    // tries[] : uint8_t
+    m->max_inflight = cfg->max_inflight > 0 ? (unsigned)cfg->max_inflight : 4;
+    if (m->max_inflight > MODBUS_TCP_MAX_INFLIGHT) m->max_inflight = MODBUS_TCP_MAX_INFLIGHT;
+
+    if (modbus_plan_build(&m->plan, cfg->map, cfg->map_count, cfg->max_gap) != 0) {
+        log_err("modbus-tcp %s: invalid map", cfg->host);
+        return -1;
+    }
+    m->queue = (size_t*)calloc(m->plan.nblocks, sizeof(*m->queue));
+    m->tries = (uint8_t*)calloc(m->plan.nblocks, 1);
+    m->state = (int8_t*)calloc(m->plan.nblocks, 1);
+    m->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!m->queue || !m->tries || !m->state || m->efd < 0) goto fail;
+
+    m->wmap.unit = cfg->unit_id_set ? cfg->unit_id : 1;
+    m->wmap.map = cfg->map;
+    m->wmap.n = cfg->map_count;
+    modbus_wq_init(&m->wq, cfg, &m->wmap, 1, tcp_kick, m);
+
+    m->running = true;
+    if (pthread_create(&m->thread, NULL, modbus_tcp_thread, m) != 0) {
+        perror("pthread_create(modbus_tcp_thread)");
+        m->running = false;
+        modbus_wq_close(&m->wq);
+        goto fail;
+    }
+    log_info("modbus-tcp %s:%u: %zu point(s) in %zu request(s), up to %u in flight",
+             cfg->host, (unsigned)(cfg->port_set ? cfg->port : 502), m->plan.points,
+             m->plan.nblocks, m->max_inflight);
+    return 0;
+
+fail:
+    if (m->efd >= 0) close(m->efd);
+    m->efd = -1;
+    free(m->queue);
+    free(m->tries);
+    free(m->state);
+    m->queue = NULL;
+    m->tries = NULL;
+    m->state = NULL;
+    modbus_plan_free(&m->plan);
+    return -1;
+}
+
+void modbus_tcp_log_stats(modbus_tcp_t* m, const char* tag){
+    if (!m || !m->running) return;
+    log_info("[%s] modbus-tcp %s: %lu/%lu cycles ok (avg %.1f ms), %lu requests, %lu responses, "
+             "rtt avg %.1f max %.1f ms, in flight max %u/%u",
+             tag ? tag : "modbus", m->cfg->host, m->cycles_ok, m->cycles,
+             m->cycles_ok ? (double)m->cycle_sum_ns / (double)m->cycles_ok / 1e6 : 0.0,
+             m->requests, m->responses,
+             m->responses ? (double)m->rtt_sum_ns / (double)m->responses / 1e6 : 0.0,
+             (double)m->rtt_max_ns / 1e6, m->max_seen_inflight, m->max_inflight);
+    log_info("[%s]   timeouts %lu, retried %lu, stale %lu, exceptions %lu, bad frames %lu, "
+             "overruns %lu, connects %lu, disconnects %lu, tx %lu / rx %lu bytes",
+             tag ? tag : "modbus", m->timeouts, m->retried, m->stale, m->exceptions,
+             m->frame_errors, m->overruns, m->connects, m->disconnects, m->bytes_tx, m->bytes_rx);
+    modbus_wq_log_stats(&m->wq, tag);
+}
+
+void modbus_tcp_close(modbus_tcp_t* m){
+    if (!m) return;
+    if (m->running) {
+        m->stop = 1;
+        uint64_t one = 1;
+        ssize_t r = write(m->efd, &one, sizeof(one));
+        (void)r;
+        pthread_join(m->thread, NULL);
+        m->running = false;
+    }
+    fail_writes(m, MODBUS_ERR_IO);
+    modbus_wq_close(&m->wq);
+    if (m->fd >= 0) close(m->fd);
+    if (m->efd >= 0) close(m->efd);
+    free(m->queue);
+    free(m->tries);
+    free(m->state);
+    modbus_plan_free(&m->plan);
+    memset(m, 0, sizeof(*m));
+    m->fd = m->efd = -1;
+}
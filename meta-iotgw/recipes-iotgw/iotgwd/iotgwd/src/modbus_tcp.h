@@ -0,0 +1,120 @@
+#pragma once
+/**
+ * @file modbus_tcp.h
+ * @brief Maître Modbus TCP pipeliné (polling de la map d'un connecteur modbus-tcp).
+ *
+ * Un thread par connecteur, une socket TCP non bloquante (TCP_NODELAY). La map
+ * est compilée en plan de lecture (modbus.h : blocs coalescés <= 125
+ * registres). À chaque cycle (poll_ms), jusqu'à max_inflight requêtes sont
+ * envoyées sans attendre les réponses, chacune avec son identifiant de
+ * transaction MBAP ; les réponses sont rapprochées par cet identifiant, dans
+ * n'importe quel ordre. Sur un lien à forte latence (VPN), un cycle coûte donc
+ * ~1 RTT au lieu d'un RTT par bloc.
+ *
+ * Une requête sans réponse après timeout_ms est réémise (nouvel identifiant,
+ * la réponse tardive éventuelle est ignorée) jusqu'à retries fois ; au-delà,
+ * ou sur erreur socket, la connexion est refermée et rouverte avec un délai
+ * doublé à chaque échec (500 ms .. 30 s), sans intervention de l'appelant.
+ * Quand tous les blocs du cycle ont répondu, l'image est décodée et remise à
+ * on_data (metrics + JSON).
+ *
+ * Écritures (modbus_write.h) : les commandes des bridges vers ce connecteur
+ * prennent les places libres de la fenêtre avant les lectures du cycle, sans
+ * attendre le cycle suivant ; même politique de réémission. Connexion perdue :
+ * les écritures en vol ou en attente sont confirmées en échec (pas de consigne
+ * rejouée en retard).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "modbus.h"
+#include "modbus_write.h"
+#include "modbus_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MODBUS_TCP_MAX_INFLIGHT 32
+
+typedef struct {
+    bool     used;
+    uint16_t tid;
+    size_t   block;                 // indice dans plan.blocks
+    modbus_wreq_t* wr;              // écriture (NULL : lecture du bloc)
+    uint64_t sent_ns;               // CLOCK_MONOTONIC
+    uint64_t deadline_ns;           // sent_ns + timeout_ms
+} modbus_tcp_slot_t;
+
+typedef struct {
+    const modbus_tcp_params_t* cfg;
+    const gateway_realtime_t* realtime;
+    modbus_data_cb on_data;
+    void*          user;
+    modbus_image_t* image;          // image du serveur destination du bridge, NULL sinon
+    const char*     image_src;      // nom du connecteur (propriétaire des units dans l'image)
+
+    modbus_plan_t  plan;
+    int            fd;              // -1 : déconnecté
+    bool           connecting;      // connect() non bloquant en cours
+    uint64_t       connect_deadline_ns;
+    uint64_t       reconnect_ns;    // prochaine tentative de connexion
+    uint32_t       reconnect_ms;    // délai courant (doublé à chaque échec)
+
+    // cycle de scrutation
+    uint64_t       period_ns, timeout_ns, due_ns;
+    uint64_t       cycle_start_ns;
+    unsigned       max_inflight, retries;
+    bool           in_cycle;
+    size_t*        queue;           // blocs à (ré)émettre (anneau de plan.nblocks)
+    size_t         queue_head, queue_n;
+    uint8_t*       tries;           // émissions par bloc dans le cycle
+    int8_t*        state;           // 0 en attente, 1 OK, -1 échec (exception)
+    size_t         resolved;
+    modbus_tcp_slot_t slots[MODBUS_TCP_MAX_INFLIGHT];
+
+    // écritures : file du maître -> écritures détachées -> requêtes fusionnées
+    modbus_wq_t    wq;
+    modbus_wmap_t  wmap;
+    modbus_wr_t*   wpend;
+    modbus_wreq_t* wretry;          // requêtes à réémettre (timeout)
+    unsigned       inflight;
+    uint16_t       next_tid;
+
+    // tampons socket
+    uint8_t        tx[MODBUS_TCP_MAX_INFLIGHT * MODBUS_TCP_MAX_ADU];
+    size_t         tx_len, tx_off;
+    uint8_t        rx[4 * MODBUS_TCP_MAX_ADU];
+    size_t         rx_len;
+
+    pthread_t      thread;
+    int            efd;             // eventfd : arrêt
+    bool           running;
+    volatile int   stop;
+
+    unsigned long  cycles, cycles_ok, requests, responses, retried, timeouts,
+                   exceptions, frame_errors, stale, connects, disconnects, overruns;
+    unsigned long  bytes_tx, bytes_rx;
+    uint64_t       rtt_sum_ns, rtt_max_ns;     // par réponse
+    uint64_t       cycle_sum_ns;               // durée des cycles complets
+    unsigned       max_seen_inflight;
+} modbus_tcp_t;
+
+/* Construit le plan et lance le thread (la connexion est établie par le
+ * thread, avec reprise automatique). image (NULL : aucune) reçoit chaque bloc
+ * lu, au nom de image_src. Retour 0, -1 (map invalide, thread). */
+int  modbus_tcp_open(modbus_tcp_t* m, const modbus_tcp_params_t* cfg,
+                     const gateway_realtime_t* realtime, modbus_data_cb on_data, void* user,
+                     modbus_image_t* image, const char* image_src);
+
+void modbus_tcp_log_stats(modbus_tcp_t* m, const char* tag);
+
+void modbus_tcp_close(modbus_tcp_t* m);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,612 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include "modbus_write.h"
+#include "log.h"
+
+struct modbus_wr {
+    modbus_wr_t*  next;
+    modbus_cmd_t* cmd;
+    const char*   name;          // point de la map (config)
+    uint64_t      seq;           // ordre d'arrivée : la plus récente gagne
+    uint8_t       unit;
+    bool          coil;
+    uint16_t      addr;
+    uint16_t      count;         // registres, ou bits (coil)
+    uint16_t      val[4];        // registres big-endian du point, ou 0/1 par bit
+};
+
+struct modbus_cmd {
+    modbus_writer_t* w;
+    char*        topic;
+    char*        id;             // jeton JSON de "id", recopié tel quel
+    unsigned     points;
+    unsigned     pending;        // écritures non terminées (thread du maître)
+    int          status;         // MODBUS_OK, exception (>0) ou MODBUS_ERR_*
+    const char*  error;          // commande rejetée avant émission
+    char         err_point[64];
+    uint8_t      unit;           // 0 : plusieurs units
+    uint64_t     t0_ns, lat_ns;
+};
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static modbus_wq_t* g_queues;
+static uint64_t g_seq;           // sous g_mu
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ---- objet JSON plat {"clé": nombre | booléen | chaîne, ...} ----
+
+enum { JV_NUM, JV_BOOL, JV_STR };
+
+typedef struct {
+    const char* k;  size_t klen;
+    const char* v;  size_t vlen;     // jeton brut de la valeur
+    double      num;
+    int         kind;
+} jpair_t;
+
+static const char* skip_ws(const char* p, const char* e){
+    while (p < e && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    return p;
+}
+
+static const char* scan_str(const char* p, const char* e, const char** s, size_t* n){
+    if (p >= e || *p != '"') return NULL;
+    const char* b = ++p;
+    while (p < e && *p != '"') {
+        if (*p == '\\' && ++p >= e) return NULL;
+        ++p;
+    }
+    if (p >= e) return NULL;
+    *s = b;
+    *n = (size_t)(p - b);
+    return p + 1;
+}
+
+// Retour : nombre de paires, -1 si la syntaxe n'est pas reconnue
+static int parse_flat(const char* p, const char* e, jpair_t* out, int max){
+    int n = 0;
+    p = skip_ws(p, e);
+    if (p >= e || *p++ != '{') return -1;
+    p = skip_ws(p, e);
+    if (p < e && *p == '}') return 0;
+    for (;;) {
+        if (n >= max) return -1;
+        jpair_t* j = &out[n];
+        p = scan_str(skip_ws(p, e), e, &j->k, &j->klen);
+        if (!p) return -1;
+        p = skip_ws(p, e);
+        if (p >= e || *p++ != ':') return -1;
+        p = skip_ws(p, e);
+        if (p >= e) return -1;
+        j->v = p;
+        if (*p == '"') {
+            const char* s; size_t sl;
+            if (!(p = scan_str(p, e, &s, &sl))) return -1;
+            j->kind = JV_STR;
+        } else if (e - p >= 4 && !memcmp(p, "true", 4)) {
+            j->kind = JV_BOOL; j->num = 1; p += 4;
+        } else if (e - p >= 5 && !memcmp(p, "false", 5)) {
+            j->kind = JV_BOOL; j->num = 0; p += 5;
+        } else {
+            char tmp[64], *end;
+            size_t l = 0;
+            while (p + l < e && l < sizeof(tmp) - 1 && p[l] && strchr("+-0123456789.eE", p[l])) {
+                tmp[l] = p[l];
+                ++l;
+            }
+            tmp[l] = '\0';
+            j->num = strtod(tmp, &end);
+            if (!l || *end) return -1;
+            j->kind = JV_NUM;
+            p += l;
+        }
+        j->vlen = (size_t)(p - j->v);
+        n++;
+        p = skip_ws(p, e);
+        if (p < e && *p == ',') { ++p; continue; }
+        if (p < e && *p == '}') return n;
+        return -1;
+    }
+}
+
+static bool key_is(const jpair_t* j, const char* s){
+    return strlen(s) == j->klen && !memcmp(j->k, s, j->klen);
+}
+
+// ---- encodage : valeur d'ingénierie -> registres (inverse de decode_plan) ----
+
+static bool point_signed(const modbus_point_t* pt){
+    bool s = pt->type == MODBUS_TYPE_S16 || pt->type == MODBUS_TYPE_S32;
+    return pt->has_signed ? pt->signed_flag : s;
+}
+
+// Retour NULL si OK, sinon le motif du refus
+static const char* encode_point(const modbus_point_t* pt, const jpair_t* j, modbus_wr_t* w){
+    if (j->kind == JV_STR) return "value must be a number or a boolean";
+    double v = j->num;
+
+    if (pt->func == MODBUS_FUNC_COIL) {
+        w->coil = true;
+        w->count = pt->count ? pt->count : 1;
+        if (w->count > 4) return "point too wide";
+        if (j->kind == JV_BOOL || w->count == 1) {
+            for (uint16_t i = 0; i < w->count; ++i) w->val[i] = v != 0;
+            return NULL;
+        }
+        // plusieurs bobines : masque, bit 0 = addr
+        if (v < 0 || v != floor(v) || v >= (double)(1u << w->count)) return "value out of range";
+        for (uint16_t i = 0; i < w->count; ++i) w->val[i] = (uint16_t)(((unsigned)v >> i) & 1u);
+        return NULL;
+    }
+    if (pt->func != MODBUS_FUNC_HOLDING) return "point is read-only";
+
+    if (pt->has_scale) {
+        if (pt->scale == 0) return "invalid scale";
+        v /= pt->scale;
+    }
+    if (!isfinite(v)) return "value out of range";
+
+    uint64_t raw;
+    unsigned regs;
+    switch (pt->type) {
+    case MODBUS_TYPE_FLOAT: {
+        float f = (float)v;
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        raw = u;
+        regs = 2;
+        break;
+    }
+    case MODBUS_TYPE_DOUBLE:
+        memcpy(&raw, &v, sizeof(raw));
+        regs = 4;
+        break;
+    default: {
+        regs = (pt->type == MODBUS_TYPE_U32 || pt->type == MODBUS_TYPE_S32) ? 2 : 1;
+        int bits = 16 * (int)regs;
+        double r = round(v);
+        double lo = point_signed(pt) ? -ldexp(1.0, bits - 1) : 0.0;
+        double hi = point_signed(pt) ? ldexp(1.0, bits - 1) - 1.0 : ldexp(1.0, bits) - 1.0;
+        if (r < lo || r > hi) return "value out of range";
+        raw = (uint64_t)(int64_t)r & ((1ULL << bits) - 1);
+        break;
+    }
+    }
+    for (unsigned i = 0; i < regs; ++i) w->val[i] = (uint16_t)(raw >> (16 * (regs - 1 - i)));
+    if (pt->word_swap && regs == 2) {
+        uint16_t t = w->val[0];
+        w->val[0] = w->val[1];
+        w->val[1] = t;
+    }
+    w->count = (uint16_t)regs;
+    return NULL;
+}
+
+static const modbus_point_t* find_point(const modbus_wq_t* q, const jpair_t* j, int unit, uint8_t* unit_out){
+    for (size_t m = 0; m < q->nmaps; ++m) {
+        const modbus_wmap_t* wm = &q->maps[m];
+        if (unit >= 0 && wm->unit != unit) continue;
+        for (size_t i = 0; i < wm->n; ++i) {
+            if (wm->map[i].name && key_is(j, wm->map[i].name)) {
+                *unit_out = wm->unit;
+                return &wm->map[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+static void set_err_point(modbus_cmd_t* c, const char* s, size_t n){
+    size_t k = 0;
+    for (size_t i = 0; i < n && k < sizeof(c->err_point) - 1; ++i)
+        if (isalnum((unsigned char)s[i]) || s[i] == '_' || s[i] == '-' || s[i] == '.') c->err_point[k++] = s[i];
+    c->err_point[k] = '\0';
+}
+
+// ---- fin d'écriture / de commande ----
+
+static void cmd_finish(modbus_cmd_t* c){
+    modbus_writer_t* w = c->w;
+    c->lat_ns = mono_ns() - c->t0_ns;
+    if (w->done) w->done(c, w->user);
+
+    pthread_mutex_lock(&w->mu);
+    if (!c->error && c->status == MODBUS_OK) w->ok++;
+    else                                      w->failed++;
+    if (!c->error) {
+        w->lat_sum_ns += c->lat_ns;
+        w->lat_n++;
+        if (c->lat_ns > w->lat_max_ns) w->lat_max_ns = c->lat_ns;
+    }
+    w->pending--;
+    pthread_cond_broadcast(&w->cv);
+    pthread_mutex_unlock(&w->mu);
+
+    free(c->topic);
+    free(c->id);
+    free(c);
+}
+
+static void wr_finish(modbus_wq_t* q, modbus_wr_t* w, int rc){
+    modbus_cmd_t* c = w->cmd;
+    q->writes++;
+    if (rc != MODBUS_OK && c->status == MODBUS_OK) {
+        c->status = rc;
+        set_err_point(c, w->name, strlen(w->name));
+    }
+    free(w);
+    if (--c->pending == 0) cmd_finish(c);
+}
+
+// ---- file d'un maître ----
+
+int modbus_wq_init(modbus_wq_t* q, const void* key, const modbus_wmap_t* maps, size_t nmaps,
+                   void (*kick)(void* owner), void* owner){
+    if (!q || !key || !kick) return -1;
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->mu, NULL);
+    q->tail = &q->head;
+    q->key = key;
+    q->maps = maps;
+    q->nmaps = nmaps;
+    q->kick = kick;
+    q->owner = owner;
+
+    pthread_mutex_lock(&g_mu);
+    for (modbus_wq_t* o = g_queues; o; o = o->next) {
+        if (o->key == key) {
+            pthread_mutex_unlock(&g_mu);
+            log_warn("modbus: connector polled by several bridges, commands go to the first master");
+            return 0;
+        }
+    }
+    q->next = g_queues;
+    g_queues = q;
+    q->registered = true;
+    pthread_mutex_unlock(&g_mu);
+    return 0;
+}
+
+void modbus_wq_close(modbus_wq_t* q){
+    if (!q || !q->tail) return;
+    pthread_mutex_lock(&g_mu);
+    if (q->registered) {
+        for (modbus_wq_t** pp = &g_queues; *pp; pp = &(*pp)->next)
+            if (*pp == q) { *pp = q->next; break; }
+        q->registered = false;
+    }
+    pthread_mutex_unlock(&g_mu);
+
+    modbus_wr_fail_all(q, modbus_wq_take(q), MODBUS_ERR_IO);
+    pthread_mutex_destroy(&q->mu);
+    q->tail = NULL;
+}
+
+bool modbus_wq_pending(modbus_wq_t* q){
+    return q && q->tail && __atomic_load_n(&q->n, __ATOMIC_ACQUIRE) != 0;
+}
+
+modbus_wr_t* modbus_wq_take(modbus_wq_t* q){
+    pthread_mutex_lock(&q->mu);
+    modbus_wr_t* list = q->head;
+    q->head = NULL;
+    q->tail = &q->head;
+    __atomic_store_n(&q->n, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&q->mu);
+    return list;
+}
+
+void modbus_wr_fail_all(modbus_wq_t* q, modbus_wr_t* list, int rc){
+    while (list) {
+        modbus_wr_t* next = list->next;
+        q->failed++;
+        wr_finish(q, list, rc);
+        list = next;
+    }
+}
+
+bool modbus_wreq_next(modbus_wr_t** list, modbus_wreq_t* r){
+    if (!list || !*list || !r) return false;
+    const uint8_t unit = (*list)->unit;
+    const bool coil = (*list)->coil;
+
+    // écritures du même unit / de la même table, triées par adresse (tri stable)
+    modbus_wr_t* cand[MODBUS_WREQ_MAX_WRITES];
+    size_t nc = 0;
+    for (modbus_wr_t* w = *list; w && nc < MODBUS_WREQ_MAX_WRITES; w = w->next)
+        if (w->unit == unit && w->coil == coil) cand[nc++] = w;
+    for (size_t i = 1; i < nc; ++i) {
+        modbus_wr_t* x = cand[i];
+        size_t j = i;
+        while (j && cand[j - 1]->addr > x->addr) { cand[j] = cand[j - 1]; --j; }
+        cand[j] = x;
+    }
+
+    // plus longue suite contiguë (ou chevauchante) depuis la plus basse adresse
+    uint32_t limit = coil ? MODBUS_MAX_WRITE_BITS : MODBUS_MAX_WRITE_REGS;
+    uint32_t start = cand[0]->addr, end = start + cand[0]->count;
+    size_t nw = 1;
+    while (nw < nc && cand[nw]->addr <= end) {
+        uint32_t e = (uint32_t)cand[nw]->addr + cand[nw]->count;
+        if (e > end && e - start > limit) break;
+        if (e > end) end = e;
+        nw++;
+    }
+
+    // valeurs dans l'ordre d'arrivée : la plus récente écrase les précédentes
+    uint16_t buf[MODBUS_WREQ_MAX_WRITES * 4];
+    modbus_wr_t* by_seq[MODBUS_WREQ_MAX_WRITES];
+    memcpy(by_seq, cand, nw * sizeof(*by_seq));
+    for (size_t i = 1; i < nw; ++i) {
+        modbus_wr_t* x = by_seq[i];
+        size_t j = i;
+        while (j && by_seq[j - 1]->seq > x->seq) { by_seq[j] = by_seq[j - 1]; --j; }
+        by_seq[j] = x;
+    }
+    for (size_t i = 0; i < nw; ++i)
+        memcpy(buf + (by_seq[i]->addr - start), by_seq[i]->val, by_seq[i]->count * sizeof(uint16_t));
+
+    for (size_t i = 0; i < nw; ++i) {
+        for (modbus_wr_t** pp = list; *pp; pp = &(*pp)->next)
+            if (*pp == cand[i]) { *pp = cand[i]->next; break; }
+        cand[i]->next = NULL;
+        r->w[i] = cand[i];
+    }
+    r->nw = nw;
+    r->next = NULL;
+    r->tries = 0;
+    r->unit = unit;
+
+    uint16_t count = (uint16_t)(end - start);
+    uint8_t* p = r->pdu;
+    p[1] = (uint8_t)(start >> 8);
+    p[2] = (uint8_t)start;
+    if (count == 1) {
+        p[0] = coil ? MODBUS_FC_WRITE_SINGLE_COIL : MODBUS_FC_WRITE_SINGLE_REG;
+        p[3] = coil ? (buf[0] ? 0xFF : 0x00) : (uint8_t)(buf[0] >> 8);
+        p[4] = coil ? 0x00 : (uint8_t)buf[0];
+        r->pdu_len = 5;
+        return true;
+    }
+    p[0] = coil ? MODBUS_FC_WRITE_MULTI_COILS : MODBUS_FC_WRITE_MULTI_REGS;
+    p[3] = (uint8_t)(count >> 8);
+    p[4] = (uint8_t)count;
+    if (coil) {
+        uint8_t nb = (uint8_t)((count + 7u) / 8u);
+        p[5] = nb;
+        memset(p + 6, 0, nb);
+        for (uint16_t i = 0; i < count; ++i)
+            if (buf[i]) p[6 + (i >> 3)] |= (uint8_t)(1u << (i & 7));
+        r->pdu_len = 6u + nb;
+    } else {
+        p[5] = (uint8_t)(2u * count);
+        for (uint16_t i = 0; i < count; ++i) {
+            p[6 + 2 * i]     = (uint8_t)(buf[i] >> 8);
+            p[6 + 2 * i + 1] = (uint8_t)buf[i];
+        }
+        r->pdu_len = 6u + 2u * count;
+    }
+    return true;
+}
+
+int modbus_wreq_check(const modbus_wreq_t* r, const uint8_t* pdu, size_t n){
+    if (!r || !pdu || n < 2) return MODBUS_ERR_FRAME;
+    if (pdu[0] == (uint8_t)(r->pdu[0] | 0x80)) return pdu[1] ? pdu[1] : MODBUS_ERR_FRAME;
+    // 0x05/0x06 : écho de la requête ; 0x0F/0x10 : écho adresse + quantité
+    if (n != 5 || pdu[0] != r->pdu[0] || memcmp(pdu + 1, r->pdu + 1, 4) != 0) return MODBUS_ERR_FRAME;
+    return MODBUS_OK;
+}
+
+void modbus_wreq_done(modbus_wq_t* q, modbus_wreq_t* r, int rc){
+    q->requests++;
+    if (r->nw > 1) q->merged += r->nw - 1;
+    if (rc != MODBUS_OK) q->failed += r->nw;
+    for (size_t i = 0; i < r->nw; ++i) wr_finish(q, r->w[i], rc);
+    r->nw = 0;
+}
+
+void modbus_wq_log_stats(modbus_wq_t* q, const char* tag){
+    if (!q || !q->tail || !q->requests) return;
+    log_info("[%s]   writes %lu in %lu request(s) (%lu merged), %lu failed",
+             tag ? tag : "modbus", q->writes, q->requests, q->merged, q->failed);
+}
+
+// ---- côté bridge ----
+
+int modbus_writer_init(modbus_writer_t* w, const void* target, modbus_cmd_done_fn done, void* user){
+    if (!w || !target) return -1;
+    memset(w, 0, sizeof(*w));
+    pthread_mutex_init(&w->mu, NULL);
+    pthread_cond_init(&w->cv, NULL);
+    w->target = target;
+    w->done = done;
+    w->user = user;
+    return 0;
+}
+
+void modbus_writer_close(modbus_writer_t* w){
+    if (!w || !w->target) return;
+    pthread_mutex_lock(&w->mu);
+    w->closing = true;
+    while (w->pending) pthread_cond_wait(&w->cv, &w->mu);   // le maître termine ou échoue chaque écriture
+    pthread_mutex_unlock(&w->mu);
+    pthread_cond_destroy(&w->cv);
+    pthread_mutex_destroy(&w->mu);
+    w->target = NULL;
+}
+
+void modbus_writer_log_stats(modbus_writer_t* w, const char* tag){
+    if (!w || !w->target) return;
+    pthread_mutex_lock(&w->mu);
+    log_info("[%s] modbus commands: %lu received, %lu ok, %lu failed, %lu ignored, %u pending, "
+             "latency avg %.1f max %.1f ms",
+             tag ? tag : "modbus", w->cmds, w->ok, w->failed, w->ignored, w->pending,
+             w->lat_n ? (double)w->lat_sum_ns / (double)w->lat_n / 1e6 : 0.0, (double)w->lat_max_ns / 1e6);
+    pthread_mutex_unlock(&w->mu);
+}
+
+/* Résout et encode toute la commande puis la met en file du maître. Retour 0,
+ * -1 : commande rejetée (c->error), rien n'est écrit. */
+static int submit(modbus_writer_t* w, modbus_cmd_t* c, const char* p, size_t len){
+    size_t cap = 1;
+    for (size_t i = 0; i < len; ++i) if (p[i] == ':') cap++;
+    jpair_t* jp = (jpair_t*)malloc(cap * sizeof(*jp));
+    if (!jp) { c->error = "out of memory"; return -1; }
+    int np = parse_flat(p, p + len, jp, (int)cap);
+    if (np < 0) { c->error = "invalid JSON object"; free(jp); return -1; }
+
+    int unit = -1;
+    for (int i = 0; i < np; ++i) {
+        if (key_is(&jp[i], "unit")) {
+            if (jp[i].kind != JV_NUM || jp[i].num < 0 || jp[i].num > 255 || jp[i].num != floor(jp[i].num)) {
+                c->error = "invalid unit";
+                free(jp);
+                return -1;
+            }
+            unit = (int)jp[i].num;
+        } else if (key_is(&jp[i], "id") && !c->id) {
+            c->id = strndup(jp[i].v, jp[i].vlen);
+        } else {
+            c->points++;
+        }
+    }
+
+    modbus_wr_t* head = NULL;
+    modbus_wr_t** tail = &head;
+    unsigned nw = 0;
+    int units = -1;
+
+    pthread_mutex_lock(&g_mu);
+    modbus_wq_t* q = g_queues;
+    while (q && q->key != w->target) q = q->next;
+    if (!q) { c->error = "connector is not polled by a running bridge"; goto fail; }
+
+    for (int i = 0; i < np; ++i) {
+        if (key_is(&jp[i], "unit") || key_is(&jp[i], "id")) continue;
+        uint8_t u = 0;
+        const modbus_point_t* pt = find_point(q, &jp[i], unit, &u);
+        if (!pt) {
+            c->error = "unknown point";
+            set_err_point(c, jp[i].k, jp[i].klen);
+            goto fail;
+        }
+        modbus_wr_t* wr = (modbus_wr_t*)calloc(1, sizeof(*wr));
+        if (!wr) { c->error = "out of memory"; goto fail; }
+        wr->cmd = c;
+        wr->name = pt->name;
+        wr->unit = u;
+        wr->addr = pt->addr;
+        const char* why = encode_point(pt, &jp[i], wr);
+        if (why || (uint32_t)wr->addr + wr->count > 65536) {
+            c->error = why ? why : "point beyond address space";
+            set_err_point(c, pt->name, strlen(pt->name));
+            free(wr);
+            goto fail;
+        }
+        wr->seq = ++g_seq;
+        units = (units < 0 || units == u) ? u : 0;
+        *tail = wr;
+        tail = &wr->next;
+        nw++;
+    }
+    if (!nw) { c->error = "no point to write"; goto fail; }
+
+    // c appartient au maître dès l'ajout en file : plus aucun accès ensuite
+    c->pending = nw;
+    c->unit = (uint8_t)units;
+    pthread_mutex_lock(&q->mu);
+    *q->tail = head;
+    q->tail = tail;
+    __atomic_store_n(&q->n, q->n + nw, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&q->mu);
+    q->kick(q->owner);
+    pthread_mutex_unlock(&g_mu);
+    free(jp);
+    return 0;
+
+fail:
+    pthread_mutex_unlock(&g_mu);
+    while (head) { modbus_wr_t* n = head->next; free(head); head = n; }
+    free(jp);
+    return -1;
+}
+
+int modbus_write_send_adapter(const gw_msg_t* msg, void* ctx){
+    modbus_writer_t* w = (modbus_writer_t*)ctx;
+    if (!w || !w->target || !msg || !msg->pl.data) return -1;
+
+    const char* topic = msg->pl.topic;
+    size_t tl = topic ? strlen(topic) : 0;
+    if (tl >= 4 && !strcmp(topic + tl - 4, "/ack")) {
+        pthread_mutex_lock(&w->mu);
+        w->ignored++;
+        pthread_mutex_unlock(&w->mu);
+        return 0;
+    }
+
+    modbus_cmd_t* c = (modbus_cmd_t*)calloc(1, sizeof(*c));
+    if (!c) return -1;
+    c->w = w;
+    c->t0_ns = mono_ns();
+    c->topic = topic ? strdup(topic) : NULL;
+
+    pthread_mutex_lock(&w->mu);
+    if (w->closing) {
+        pthread_mutex_unlock(&w->mu);
+        free(c->topic);
+        free(c);
+        return -1;
+    }
+    w->pending++;
+    w->cmds++;
+    pthread_mutex_unlock(&w->mu);
+
+    if (submit(w, c, (const char*)msg->pl.data, msg->pl.len) == 0) return 0;
+    log_warn("modbus command%s%s rejected: %s%s%s", topic ? " on " : "", topic ? topic : "",
+             c->error, c->err_point[0] ? " " : "", c->err_point);
+    cmd_finish(c);                     // confirmation d'échec immédiate
+    return -1;
+}
+
+const char* modbus_cmd_topic(const modbus_cmd_t* c){
+    return c ? c->topic : NULL;
+}
+
+int modbus_cmd_json(const modbus_cmd_t* c, char* buf, size_t cap){
+    if (!c || !buf || !cap) return -1;
+    bool ok = !c->error && c->status == MODBUS_OK;
+    size_t n = 0;
+    int k = snprintf(buf, cap, "{%s%s%s\"ok\":%s,\"points\":%u", c->id ? "\"id\":" : "",
+                     c->id ? c->id : "", c->id ? "," : "", ok ? "true" : "false", c->points);
+    if (k < 0 || (size_t)k >= cap) return -1;
+    n = (size_t)k;
+    if (c->unit) {
+        k = snprintf(buf + n, cap - n, ",\"unit\":%u", (unsigned)c->unit);
+        if (k < 0 || (size_t)k >= cap - n) return -1;
+        n += (size_t)k;
+    }
+    if (!ok) {
+        k = snprintf(buf + n, cap - n, ",\"error\":\"%s\"",
+                     c->error ? c->error : modbus_exception_str(c->status));
+        if (k < 0 || (size_t)k >= cap - n) return -1;
+        n += (size_t)k;
+        if (c->err_point[0]) {
+            k = snprintf(buf + n, cap - n, ",\"point\":\"%s\"", c->err_point);
+            if (k < 0 || (size_t)k >= cap - n) return -1;
+            n += (size_t)k;
+        }
+    }
+    k = snprintf(buf + n, cap - n, ",\"latency_ms\":%.3f}", (double)c->lat_ns / 1e6);
+    if (k < 0 || (size_t)k >= cap - n) return -1;
+    return (int)(n + (size_t)k);
+}
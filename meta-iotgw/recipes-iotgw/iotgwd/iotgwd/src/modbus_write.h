@@ -0,0 +1,135 @@
+#pragma once
+/**
+ * @file modbus_write.h
+ * @brief Chemin d'écriture Modbus : commandes JSON -> FC 0x05/0x06/0x0F/0x10.
+ *
+ * Une commande est un objet JSON plat {"point": valeur, ...} reçu par un bridge
+ * dont la destination est un connecteur modbus-rtu/modbus-tcp (p.ex. topic MQTT
+ * de commande). Chaque nom est résolu dans la map du connecteur (points holding
+ * et coil seulement), la valeur encodée à l'inverse du décodage (scale, type,
+ * signed, word_swap). Une commande invalide est rejetée entière : rien n'est
+ * écrit. Clés réservées : "unit" (restreint la recherche à ce slave) et "id"
+ * (renvoyé tel quel dans la confirmation).
+ *
+ * Les écritures passent par le maître qui scrute déjà le connecteur : une file
+ * par maître (registre indexé par les params du connecteur), servie avant les
+ * lectures (RTU : entre deux requêtes de lecture ; TCP : devant les lectures
+ * dans la fenêtre pipelinée). Les écritures en attente d'un même unit sont
+ * fusionnées : registres contigus ou qui se recouvrent (la plus récente gagne)
+ * en un FC 0x10 de 123 registres au plus, bobines en un FC 0x0F ; isolées,
+ * FC 0x06 / 0x05. Quand toutes les écritures d'une commande sont acquittées
+ * (ou en erreur), la confirmation est rendue au bridge (modbus_cmd_done_fn).
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "connectors.h"
+#include "gw_msg.h"
+#include "modbus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MODBUS_MAX_WRITE_REGS   123
+#define MODBUS_MAX_WRITE_BITS   1968
+#define MODBUS_WREQ_MAX_WRITES  32     // écritures fusionnées dans une requête
+
+typedef struct modbus_wr  modbus_wr_t;   // écriture d'un point (opaque)
+typedef struct modbus_cmd modbus_cmd_t;  // commande reçue (opaque)
+
+// Map d'un unit : noms de points -> adresses pour les commandes
+typedef struct {
+    uint8_t               unit;
+    const modbus_point_t* map;
+    size_t                n;
+} modbus_wmap_t;
+
+// Requête d'écriture fusionnée, prête à émettre (PDU) ; chaînable par next
+typedef struct modbus_wreq {
+    struct modbus_wreq* next;
+    uint8_t      unit;
+    uint8_t      pdu[MODBUS_MAX_PDU];
+    size_t       pdu_len;
+    unsigned     tries;                 // émissions (maître TCP)
+    modbus_wr_t* w[MODBUS_WREQ_MAX_WRITES];
+    size_t       nw;
+} modbus_wreq_t;
+
+// File d'écriture d'un maître (une par connecteur ouvert)
+typedef struct modbus_wq {
+    struct modbus_wq*    next;          // registre
+    pthread_mutex_t      mu;
+    modbus_wr_t*         head;          // ordre d'arrivée
+    modbus_wr_t**        tail;
+    size_t               n;
+    const void*          key;           // params du connecteur
+    const modbus_wmap_t* maps;
+    size_t               nmaps;
+    void               (*kick)(void* owner);   // réveille le thread du maître
+    void*                owner;
+    bool                 registered;
+
+    // thread du maître uniquement
+    unsigned long requests, writes, merged, failed;
+} modbus_wq_t;
+
+/* Initialise la file et l'enregistre sous key (params du connecteur) : les
+ * commandes des bridges vers ce connecteur y arrivent dès le retour. Retour 0, -1. */
+int  modbus_wq_init(modbus_wq_t* q, const void* key, const modbus_wmap_t* maps, size_t nmaps,
+                    void (*kick)(void* owner), void* owner);
+/* Désenregistre puis termine en erreur (MODBUS_ERR_IO) les écritures restantes.
+ * Après l'arrêt du thread du maître. */
+void modbus_wq_close(modbus_wq_t* q);
+
+bool         modbus_wq_pending(modbus_wq_t* q);
+// Détache toute la file (thread du maître)
+modbus_wr_t* modbus_wq_take(modbus_wq_t* q);
+// Termine toutes les écritures de list avec rc (déconnexion, arrêt)
+void         modbus_wr_fail_all(modbus_wq_t* q, modbus_wr_t* list, int rc);
+
+/* Prochaine requête fusionnée (premier unit/table de list) ; les écritures
+ * couvertes sont retirées de list. Retour false si list est vide. */
+bool modbus_wreq_next(modbus_wr_t** list, modbus_wreq_t* r);
+// PDU de réponse -> MODBUS_OK, MODBUS_ERR_FRAME ou code d'exception (>0)
+int  modbus_wreq_check(const modbus_wreq_t* r, const uint8_t* pdu, size_t n);
+// Résultat de la requête pour chacune de ses écritures (confirmations)
+void modbus_wreq_done(modbus_wq_t* q, modbus_wreq_t* r, int rc);
+
+void modbus_wq_log_stats(modbus_wq_t* q, const char* tag);
+
+// ---- côté bridge : destination modbus-rtu / modbus-tcp ----
+
+typedef void (*modbus_cmd_done_fn)(const modbus_cmd_t* c, void* user);
+
+typedef struct {
+    const void*        target;          // params du connecteur destination
+    modbus_cmd_done_fn done;
+    void*              user;
+    pthread_mutex_t    mu;
+    pthread_cond_t     cv;
+    unsigned           pending;         // commandes en cours
+    bool               closing;
+    unsigned long      cmds, ok, failed, ignored;
+    uint64_t           lat_sum_ns, lat_max_ns;    // commandes émises (hors rejets)
+    unsigned long      lat_n;
+} modbus_writer_t;
+
+int  modbus_writer_init(modbus_writer_t* w, const void* target, modbus_cmd_done_fn done, void* user);
+// Refuse les nouvelles commandes et attend les confirmations en cours
+void modbus_writer_close(modbus_writer_t* w);
+void modbus_writer_log_stats(modbus_writer_t* w, const char* tag);
+
+/* gw_send_fn du bridge (ctx = modbus_writer_t*) : payload = commande JSON.
+ * Les messages dont le topic finit par "/ack" sont ignorés (confirmations
+ * republiées sous un abonnement joker). */
+int  modbus_write_send_adapter(const gw_msg_t* msg, void* ctx);
+
+// Topic de la commande (NULL si aucun) et confirmation JSON ; retour longueur ou -1
+const char* modbus_cmd_topic(const modbus_cmd_t* c);
+int  modbus_cmd_json(const modbus_cmd_t* c, char* buf, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -38,6 +38,9 @@ static yaml_node_t* ymap_get(yaml_document_t* doc, yaml_node_t* map, const char*
 }
 static const char* yscalar_str(yaml_node_t* n){ return (n && n->type==YAML_SCALAR_NODE) ? (const char*)n->data.scalar.value : NULL; }
 static long yscalar_int(yaml_node_t* n, int* ok){ if(!n||n->type!=YAML_SCALAR_NODE){if(ok)*ok=0;return 0;} char* e=NULL; long v=strtol((char*)n->data.scalar.value,&e,10); if(ok)*ok=(e&&*e=='\0'); return v; }
+// Entier décimal ou hexadécimal (adresses "0x48")
+static long yscalar_int0(yaml_node_t* n, int* ok){ if(!n||n->type!=YAML_SCALAR_NODE){if(ok)*ok=0;return 0;} char* e=NULL; long v=strtol((char*)n->data.scalar.value,&e,0); if(ok)*ok=(e&&*e=='\0'&&e!=(char*)n->data.scalar.value); return v; }
+static double yscalar_num(yaml_node_t* n, int* ok){ if(!n||n->type!=YAML_SCALAR_NODE){if(ok)*ok=0;return 0;} char* e=NULL; double v=strtod((char*)n->data.scalar.value,&e); if(ok)*ok=(e&&*e=='\0'); return v; }
 
 int parse_http_server_params(yaml_document_t* doc, yaml_node_t* params, http_server_connector_t* out){
     memset(out, 0, sizeof(*out));
@@ -111,6 +114,28 @@ int parse_mqtt_params(yaml_document_t* doc, yaml_node_t* params, mqtt_connector_
         s = yscalar_str( ymap_get(doc, tls, "insecure_skip_verify") ); if(s) out->params.tls.insecure_skip_verify = (!strcmp(s,"true")||!strcmp(s,"1"));
     }
 
+    yaml_node_t* brokers = ymap_get(doc, params, "brokers");
+    if(brokers && brokers->type==YAML_SEQUENCE_NODE){
+        size_t nitems = (brokers->data.sequence.items.top - brokers->data.sequence.items.start);
+        out->params.brokers = nitems? calloc(nitems, sizeof(mqtt_broker_t)) : NULL;
+        out->params.brokers_count = 0;
+        for(yaml_node_item_t* it = brokers->data.sequence.items.start; it < brokers->data.sequence.items.top; ++it){
+            yaml_node_t* bn = yaml_document_get_node(doc, *it);
+            if(!bn) continue;
+            mqtt_broker_t* b = &out->params.brokers[out->params.brokers_count];
+            if(bn->type==YAML_SCALAR_NODE){
+                b->url = strdup((const char*)bn->data.scalar.value);
+            } else if(bn->type==YAML_MAPPING_NODE){
+                const char* bu = yscalar_str( ymap_get(doc, bn, "url") );  if(bu) b->url  = strdup(bu);
+                const char* bh = yscalar_str( ymap_get(doc, bn, "host") ); if(bh) b->host = strdup(bh);
+                int ok2=0; long bp = yscalar_int( ymap_get(doc, bn, "port"), &ok2 ); if(ok2) b->port = (int)bp;
+            } else continue;
+            out->params.brokers_count++;
+        }
+    }
+    s = yscalar_str( ymap_get(doc, params, "strategy") );
+    if(s){ out->params.strategy_set=true; out->params.strategy = !strcmp(s,"spread") ? MQTT_STRATEGY_SPREAD : MQTT_STRATEGY_FAILOVER; }
+
     yaml_node_t* topics = ymap_get(doc, params, "topics");
     if(topics && topics->type==YAML_SEQUENCE_NODE){
         size_t nitems = (topics->data.sequence.items.top - topics->data.sequence.items.start);
@@ -137,6 +162,8 @@ int parse_modbus_rtu_params(yaml_document_t* doc, yaml_node_t* params, modbus_rt
     s = yscalar_str( ymap_get(doc, params, "parity") ); if(s) out->params.parity = s[0];
     v = yscalar_int( ymap_get(doc, params, "stopbits"), &ok ); if(ok) out->params.stopbits=(int)v;
     v = yscalar_int( ymap_get(doc, params, "timeout_ms"), &ok ); if(ok) out->params.timeout_ms=(int)v;
+    v = yscalar_int( ymap_get(doc, params, "max_gap"), &ok ); if(ok) out->params.max_gap=(int)v;
+    v = yscalar_int( ymap_get(doc, params, "backoff_max_ms"), &ok ); if(ok) out->params.backoff_max_ms=(int)v;
 
     yaml_node_t* rs = ymap_get(doc, params, "rs485");
     if(rs && rs->type==YAML_MAPPING_NODE){
@@ -158,6 +185,7 @@ int parse_modbus_rtu_params(yaml_document_t* doc, yaml_node_t* params, modbus_rt
             modbus_slave_t* sl = &out->params.slaves[out->params.slaves_count++];
             int ok2=0; long uid = yscalar_int( ymap_get(doc, smap, "unit_id"), &ok2 ); if(ok2) sl->unit_id=(uint8_t)uid;
             ok2=0; long poll = yscalar_int( ymap_get(doc, smap, "poll_ms"), &ok2 ); if(ok2) sl->poll_ms=(uint32_t)poll;
+            ok2=0; long sto = yscalar_int( ymap_get(doc, smap, "timeout_ms"), &ok2 ); if(ok2){ sl->timeout_ms=(int32_t)sto; sl->timeout_set=true; }
 
             yaml_node_t* map = ymap_get(doc, smap, "map");
             if(map && map->type==YAML_SEQUENCE_NODE){
@@ -191,6 +219,8 @@ int parse_modbus_rtu_params(yaml_document_t* doc, yaml_node_t* params, modbus_rt
                     if(sc){ pt->scale = atof(sc); pt->has_scale=true; }
                     const char* sg = yscalar_str( ymap_get(doc, pmap, "signed") );
                     if(sg){ pt->signed_flag = (!strcmp(sg,"true")||!strcmp(sg,"1")); pt->has_signed=true; }
+                    const char* ws = yscalar_str( ymap_get(doc, pmap, "word_swap") );
+                    if(ws) pt->word_swap = (!strcmp(ws,"true")||!strcmp(ws,"1"));
                 }
             }
         }
@@ -217,8 +247,21 @@ int parse_modbus_tcp_params(yaml_document_t* doc, yaml_node_t* params, modbus_tc
     if(ok){ out->params.timeout_ms = (int)v; }
 
     v = yscalar_int( ymap_get(doc, params, "retries"), &ok );
+    if(ok && (v < 0 || v > 10)){
+        fprintf(stderr, "WARN: modbus_tcp: retries %ld out of range [0..10], clamped\n", v);
+        v = v < 0 ? 0 : 10;
+    }
     if(ok){ out->params.retries = (int)v; out->params.retries_set = true; }
 
+    v = yscalar_int( ymap_get(doc, params, "poll_ms"), &ok );
+    if(ok){ out->params.poll_ms = (uint32_t)v; }
+
+    v = yscalar_int( ymap_get(doc, params, "max_inflight"), &ok );
+    if(ok){ out->params.max_inflight = (int)v; }
+
+    v = yscalar_int( ymap_get(doc, params, "max_gap"), &ok );
+    if(ok){ out->params.max_gap = (int)v; }
+
     yaml_node_t* map = ymap_get(doc, params, "map");
     if(map && map->type == YAML_SEQUENCE_NODE){
         size_t mitems = (map->data.sequence.items.top - map->data.sequence.items.start);
@@ -259,11 +302,27 @@ int parse_modbus_tcp_params(yaml_document_t* doc, yaml_node_t* params, modbus_tc
 
             const char* sg = yscalar_str( ymap_get(doc, pmap, "signed") );
             if(sg){ pt->signed_flag = (!strcmp(sg,"true")||!strcmp(sg,"1")); pt->has_signed=true; }
+
+            const char* ws = yscalar_str( ymap_get(doc, pmap, "word_swap") );
+            if(ws) pt->word_swap = (!strcmp(ws,"true")||!strcmp(ws,"1"));
         }
     }
     return 0;
 }
 
+int parse_modbus_server_params(yaml_document_t* doc, yaml_node_t* params, modbus_server_connector_t* out){
+    memset(out, 0, sizeof(*out));
+    if(!params || params->type != YAML_MAPPING_NODE) return 0;
+
+    const char* s; int ok=0; long v;
+    s = yscalar_str( ymap_get(doc, params, "bind") ); if(s) out->params.bind = strdup(s);
+    v = yscalar_int( ymap_get(doc, params, "max_clients"), &ok ); if(ok) out->params.max_clients=(int)v;
+    v = yscalar_int( ymap_get(doc, params, "max_age_ms"), &ok ); if(ok) out->params.max_age_ms=(int)v;
+    v = yscalar_int( ymap_get(doc, params, "idle_timeout_s"), &ok );
+    if(ok){ out->params.idle_timeout_s=(int)v; out->params.idle_timeout_set=true; }
+    return 0;
+}
+
 int parse_uart_params(yaml_document_t* doc, yaml_node_t* params, uart_connector_t* out){
     memset(out, 0, sizeof(*out));
     if(!params || params->type!=YAML_MAPPING_NODE) return 0;
@@ -276,6 +335,7 @@ int parse_uart_params(yaml_document_t* doc, yaml_node_t* params, uart_connector_
     s = yscalar_str( ymap_get(doc, params, "rtscts") ); if(s){ out->params.rtscts=(!strcmp(s,"true")||!strcmp(s,"1")); out->params.rtscts_set=true; }
     s = yscalar_str( ymap_get(doc, params, "xonxoff") ); if(s){ out->params.xonxoff=(!strcmp(s,"true")||!strcmp(s,"1")); out->params.xonxoff_set=true; }
     int ok2=0; long to = yscalar_int( ymap_get(doc, params, "timeout_ms"), &ok2 ); if(ok2){ out->params.timeout_ms=(int)to; out->params.timeout_set=true; }
+    s = yscalar_str( ymap_get(doc, params, "low_latency") ); if(s) out->params.low_latency=(!strcmp(s,"true")||!strcmp(s,"1"));
 
     yaml_node_t* pk = ymap_get(doc, params, "packet");
     if(pk && pk->type==YAML_MAPPING_NODE){
@@ -283,11 +343,38 @@ int parse_uart_params(yaml_document_t* doc, yaml_node_t* params, uart_connector_
         const char* st = yscalar_str( ymap_get(doc, pk, "start") ); if(st) out->params.packet.start = strdup(st);
         const char* en = yscalar_str( ymap_get(doc, pk, "end") );   if(en) out->params.packet.end   = strdup(en);
         int ok3=0; long ln = yscalar_int( ymap_get(doc, pk, "length"), &ok3 ); if(ok3){ out->params.packet.length=(int)ln; out->params.packet.length_set=true; }
+
+        uart_packet_t* pkt = &out->params.packet;
+        s = yscalar_str( ymap_get(doc, pk, "codec") );
+        if(s){
+            static const char* codecs[] = { "delim","slip","cobs","length","gap" };
+            for(size_t i=0;i<sizeof(codecs)/sizeof(codecs[0]);i++)
+                if(strcmp(s,codecs[i])==0) pkt->codec=(uart_codec_kind_t)i;
+        }
+        v = yscalar_int( ymap_get(doc, pk, "len_size"), &ok );   if(ok) pkt->len_size=(int)v;
+        v = yscalar_int( ymap_get(doc, pk, "len_offset"), &ok ); if(ok) pkt->len_offset=(int)v;
+        v = yscalar_int( ymap_get(doc, pk, "len_adjust"), &ok ); if(ok) pkt->len_adjust=(int)v;
+        v = yscalar_int( ymap_get(doc, pk, "gap_us"), &ok );     if(ok) pkt->gap_us=(int)v;
+        s = yscalar_str( ymap_get(doc, pk, "len_endian") );      if(s) pkt->len_le = (strcmp(s,"le")==0);
+        s = yscalar_str( ymap_get(doc, pk, "crc") );
+        if(s){
+            if(strcmp(s,"crc16-modbus")==0)     pkt->crc=UART_CRC16_MODBUS;
+            else if(strcmp(s,"crc16-ccitt")==0) pkt->crc=UART_CRC16_CCITT;
+            else if(strcmp(s,"crc32")==0)       pkt->crc=UART_CRC32;
+        }
     }
     return 0;
 }
 
 
+static int parse_spi_field_type(const char* s, spi_field_type_t* out){
+    static const char* names[] = { "u8","s8","u16","s16","u24","s24","u32","s32",
+                                   "u64","s64","float","double","bytes" };
+    for(size_t i=0;i<sizeof(names)/sizeof(names[0]);i++)
+        if(strcmp(s,names[i])==0){ *out=(spi_field_type_t)i; return 0; }
+    return -1;
+}
+
 int parse_spi_params(yaml_document_t* doc, yaml_node_t* params, spi_connector_t* out){
     memset(out, 0, sizeof(*out));
     if(!params || params->type!= YAML_MAPPING_NODE) return 0;
@@ -320,6 +407,18 @@ int parse_spi_params(yaml_document_t* doc, yaml_node_t* params, spi_connector_t*
         out->params.cs_change_set=true;
     }
 
+    double d=yscalar_num(ymap_get(doc,params,"poll_ms"),&ok);
+    if(ok && d>0){ out->params.poll_us=(uint32_t)(d*1000.0+0.5); out->params.poll_set=true; }
+
+    s=yscalar_str(ymap_get(doc,params, "batched"));
+    if(s){
+        out->params.batched=(!(strcmp(s,"true")) || !(strcmp(s,"1")));
+        out->params.batched_set=true;
+    }
+
+    v=yscalar_int(ymap_get(doc,params,"priority"),&ok);
+    if(ok && v>=0 && v<=99){ out->params.priority=(int)v; out->params.priority_set=true; }
+
     yaml_node_t* transactions=ymap_get(doc, params, "transactions");
     if(transactions && transactions->type==YAML_SEQUENCE_NODE){
         size_t n_items=(transactions->data.sequence.items.top - transactions->data.sequence.items.start);
@@ -361,9 +460,343 @@ int parse_spi_params(yaml_document_t* doc, yaml_node_t* params, spi_connector_t*
                     tr->has_rx_len=true;
                 }
             }
+
+            double pm=yscalar_num(ymap_get(doc,item_node,"period_ms"),&ok);
+            if(ok && pm>0){ tr->period_us=(uint32_t)(pm*1000.0+0.5); tr->has_period=true; }
+
+            yaml_node_t* fields=ymap_get(doc, item_node, "fields");
+            if(fields && fields->type==YAML_MAPPING_NODE){
+                size_t nf=(fields->data.mapping.pairs.top - fields->data.mapping.pairs.start);
+                tr->fields= nf ? calloc(nf, sizeof(spi_field_t)) : NULL;
+                tr->fields_count=0;
+                for(yaml_node_pair_t* fp=fields->data.mapping.pairs.start; fp<fields->data.mapping.pairs.top; ++fp){
+                    const char* fname=yscalar_str(yaml_document_get_node(doc, fp->key));
+                    yaml_node_t* fn=yaml_document_get_node(doc, fp->value);
+                    if(!fname || !fn || fn->type!=YAML_MAPPING_NODE) continue;
+
+                    spi_field_t* f=&tr->fields[tr->fields_count];
+                    v=yscalar_int(ymap_get(doc,fn,"offset"),&ok);
+                    if(!ok || v<0 || v>4095){
+                        fprintf(stderr, "WARN: spi field '%s': invalid offset\n", fname);
+                        continue;
+                    }
+                    f->offset=(uint16_t)v;
+
+                    s=yscalar_str(ymap_get(doc,fn,"type"));
+                    if(!s || parse_spi_field_type(s,&f->type)!=0){
+                        fprintf(stderr, "WARN: spi field '%s': invalid type %s\n", fname, s?s:"(none)");
+                        continue;
+                    }
+                    v=yscalar_int(ymap_get(doc,fn,"len"),&ok);
+                    if(ok && v>=1 && v<=255) f->len=(uint8_t)v;
+                    else if(f->type==SPI_FIELD_BYTES){
+                        fprintf(stderr, "WARN: spi field '%s': bytes needs len\n", fname);
+                        continue;
+                    }
+
+                    s=yscalar_str(ymap_get(doc,fn,"endianness"));
+                    if(s){
+                        f->endianness = (strcmp(s,"le")==0) ? SPI_LE : SPI_BE;
+                        f->endianness_set=true;
+                    }
+                    double sc=yscalar_num(ymap_get(doc,fn,"scale"),&ok);
+                    if(ok){ f->scale=sc; f->has_scale=true; }
+
+                    f->name=strdup(fname);
+                    tr->fields_count++;
+                }
+            }
         }
     }
     
     return 0;
 }
 
+
+static int parse_i2c_point_type(const char* s, i2c_point_type_t* out){
+    static const char* names[] = { "u8","s8","u16","s16","u24","u32","s32","float","bytes" };
+    for(size_t i=0;i<sizeof(names)/sizeof(names[0]);i++)
+        if(strcmp(s,names[i])==0){ *out=(i2c_point_type_t)i; return 0; }
+    return -1;
+}
+
+int parse_i2c_params(yaml_document_t* doc, yaml_node_t* params, i2c_connector_t* out){
+    memset(out, 0, sizeof(*out));
+    if(!params || params->type!=YAML_MAPPING_NODE) return 0;
+    const char* s; int ok=0; long v;
+
+    v=yscalar_int(ymap_get(doc,params,"bus"),&ok);
+    if(ok) out->params.bus=(int)v;
+    v=yscalar_int(ymap_get(doc,params,"speed_hz"),&ok);
+    if(ok){ out->params.speed_hz=(int)v; out->params.speed_set=true; }
+    v=yscalar_int(ymap_get(doc,params,"poll_ms"),&ok);
+    if(ok && v>0) out->params.poll_ms=(uint32_t)v;
+    v=yscalar_int(ymap_get(doc,params,"max_gap"),&ok);
+    if(ok && v>=0 && v<=16) out->params.max_gap=(int)v;
+
+    yaml_node_t* devices=ymap_get(doc,params,"devices");
+    if(!devices || devices->type!=YAML_SEQUENCE_NODE) return 0;
+    size_t nd=(devices->data.sequence.items.top - devices->data.sequence.items.start);
+    out->params.devices= nd ? calloc(nd, sizeof(i2c_device_t)) : NULL;
+    out->params.devices_count=0;
+    for(yaml_node_item_t* it=devices->data.sequence.items.start; it<devices->data.sequence.items.top; ++it){
+        yaml_node_t* dn=yaml_document_get_node(doc,*it);
+        if(!dn || dn->type!=YAML_MAPPING_NODE) continue;
+
+        v=yscalar_int0(ymap_get(doc,dn,"addr"),&ok);
+        if(!ok || v<0x03 || v>0x77){
+            fprintf(stderr, "WARN: i2c device: invalid addr\n");
+            continue;
+        }
+        i2c_device_t* d=&out->params.devices[out->params.devices_count++];
+        d->addr=(uint8_t)v;
+        s=yscalar_str(ymap_get(doc,dn,"name")); if(s) d->name=strdup(s);
+        v=yscalar_int(ymap_get(doc,dn,"poll_ms"),&ok);
+        if(ok && v>0) d->poll_ms=(uint32_t)v;
+        d->auto_increment=true;
+        s=yscalar_str(ymap_get(doc,dn,"auto_increment"));
+        if(s){ d->auto_increment=(!strcmp(s,"true")||!strcmp(s,"1")); d->auto_increment_set=true; }
+
+        yaml_node_t* map=ymap_get(doc,dn,"map");
+        if(!map || map->type!=YAML_SEQUENCE_NODE) continue;
+        size_t nm=(map->data.sequence.items.top - map->data.sequence.items.start);
+        d->map= nm ? calloc(nm, sizeof(i2c_map_point_t)) : NULL;
+        d->map_count=0;
+        for(yaml_node_item_t* it2=map->data.sequence.items.start; it2<map->data.sequence.items.top; ++it2){
+            yaml_node_t* pn=yaml_document_get_node(doc,*it2);
+            if(!pn || pn->type!=YAML_MAPPING_NODE) continue;
+            i2c_map_point_t* pt=&d->map[d->map_count];
+
+            v=yscalar_int0(ymap_get(doc,pn,"reg"),&ok);
+            if(!ok || v<0 || v>255){
+                fprintf(stderr, "WARN: i2c 0x%02x: invalid reg\n", (unsigned)d->addr);
+                continue;
+            }
+            pt->reg=(uint8_t)v;
+            v=yscalar_int(ymap_get(doc,pn,"len"),&ok);
+            if(!ok || v<1 || v>16){
+                fprintf(stderr, "WARN: i2c 0x%02x reg 0x%02x: invalid len\n", (unsigned)d->addr, (unsigned)pt->reg);
+                continue;
+            }
+            pt->len=(uint8_t)v;
+            s=yscalar_str(ymap_get(doc,pn,"type"));
+            if(!s || parse_i2c_point_type(s,&pt->type)!=0){
+                fprintf(stderr, "WARN: i2c 0x%02x reg 0x%02x: invalid type %s\n",
+                        (unsigned)d->addr, (unsigned)pt->reg, s?s:"(none)");
+                continue;
+            }
+            s=yscalar_str(ymap_get(doc,pn,"endianness"));
+            if(s){ pt->endianness=(strcmp(s,"le")==0) ? I2C_LE : I2C_BE; pt->endianness_set=true; }
+            double sc=yscalar_num(ymap_get(doc,pn,"scale"),&ok);
+            if(ok){ pt->scale=sc; pt->has_scale=true; }
+            s=yscalar_str(ymap_get(doc,pn,"writable"));
+            if(s){ pt->writable=(!strcmp(s,"true")||!strcmp(s,"1")); pt->writable_set=true; }
+            s=yscalar_str(ymap_get(doc,pn,"name")); if(s) pt->name=strdup(s);
+            d->map_count++;
+        }
+    }
+    return 0;
+}
+
+int parse_socketcan_params(yaml_document_t* doc, yaml_node_t* params, socketcan_connector_t* out){
+    memset(out, 0, sizeof(*out));
+    if(!params || params->type!=YAML_MAPPING_NODE) return 0;
+    const char* s; int ok=0; long v;
+
+    s=yscalar_str(ymap_get(doc,params,"ifname"));
+    if(s) out->params.ifname=strdup(s);
+    v=yscalar_int(ymap_get(doc,params,"bitrate"),&ok);
+    if(ok){ out->params.bitrate=(int)v; out->params.bitrate_set=true; }
+    double sp=yscalar_num(ymap_get(doc,params,"sample_point"),&ok);
+    if(ok){ out->params.sample_point=sp; out->params.sample_point_set=true; }
+    v=yscalar_int(ymap_get(doc,params,"restart_ms"),&ok);
+    if(ok){ out->params.restart_ms=(int)v; out->params.restart_ms_set=true; }
+    s=yscalar_str(ymap_get(doc,params,"fd"));
+    if(s){ out->params.fd=(!strcmp(s,"true")||!strcmp(s,"1")); out->params.fd_set=true; }
+
+    yaml_node_t* filters=ymap_get(doc,params,"filters");
+    if(filters && filters->type==YAML_SEQUENCE_NODE){
+        size_t n=(filters->data.sequence.items.top - filters->data.sequence.items.start);
+        out->params.filters= n ? calloc(n, sizeof(socketcan_filter_t)) : NULL;
+        out->params.filters_count=0;
+        for(yaml_node_item_t* it=filters->data.sequence.items.start; it<filters->data.sequence.items.top; ++it){
+            yaml_node_t* fn=yaml_document_get_node(doc,*it);
+            if(!fn || fn->type!=YAML_MAPPING_NODE) continue;
+            int ok1=0, ok2=0;
+            long id=yscalar_int0(ymap_get(doc,fn,"id"),&ok1);
+            long mask=yscalar_int0(ymap_get(doc,fn,"mask"),&ok2);
+            if(!ok1 || !ok2 || id<0 || id>0x1FFFFFFF || mask<0 || mask>0x1FFFFFFF){
+                fprintf(stderr, "WARN: socketcan filter: invalid id/mask\n");
+                continue;
+            }
+            socketcan_filter_t* f=&out->params.filters[out->params.filters_count++];
+            f->id=(uint32_t)id;
+            f->mask=(uint32_t)mask;
+        }
+    }
+
+    yaml_node_t* messages=ymap_get(doc,params,"messages");
+    if(messages && messages->type==YAML_SEQUENCE_NODE){
+        size_t n=(messages->data.sequence.items.top - messages->data.sequence.items.start);
+        out->params.messages= n ? calloc(n, sizeof(socketcan_message_t)) : NULL;
+        out->params.messages_count=0;
+        for(yaml_node_item_t* it=messages->data.sequence.items.start; it<messages->data.sequence.items.top; ++it){
+            yaml_node_t* mn=yaml_document_get_node(doc,*it);
+            if(!mn || mn->type!=YAML_MAPPING_NODE) continue;
+            v=yscalar_int0(ymap_get(doc,mn,"id"),&ok);
+            if(!ok || v<0 || v>0x1FFFFFFF){
+                fprintf(stderr, "WARN: socketcan message: invalid id\n");
+                continue;
+            }
+            socketcan_message_t* msg=&out->params.messages[out->params.messages_count++];
+            msg->id=(uint32_t)v;
+            msg->extended=msg->id>0x7FF;
+            s=yscalar_str(ymap_get(doc,mn,"extended"));
+            if(s) msg->extended=(!strcmp(s,"true")||!strcmp(s,"1")) || msg->id>0x7FF;
+            s=yscalar_str(ymap_get(doc,mn,"name")); if(s) msg->name=strdup(s);
+            v=yscalar_int(ymap_get(doc,mn,"rate_ms"),&ok);
+            if(ok && v>0) msg->rate_ms=(uint32_t)v;
+
+            yaml_node_t* sigs=ymap_get(doc,mn,"signals");
+            if(!sigs || sigs->type!=YAML_SEQUENCE_NODE) continue;
+            size_t ns=(sigs->data.sequence.items.top - sigs->data.sequence.items.start);
+            msg->signals= ns ? calloc(ns, sizeof(socketcan_signal_t)) : NULL;
+            msg->signals_count=0;
+            for(yaml_node_item_t* it2=sigs->data.sequence.items.start; it2<sigs->data.sequence.items.top; ++it2){
+                yaml_node_t* sn=yaml_document_get_node(doc,*it2);
+                if(!sn || sn->type!=YAML_MAPPING_NODE) continue;
+                const char* nm=yscalar_str(ymap_get(doc,sn,"name"));
+                int ok1=0, ok2=0;
+                long st=yscalar_int(ymap_get(doc,sn,"start"),&ok1);
+                long ln=yscalar_int(ymap_get(doc,sn,"length"),&ok2);
+                if(!nm || !ok1 || !ok2 || st<0 || st>511 || ln<1 || ln>64){
+                    fprintf(stderr, "WARN: socketcan message 0x%X: invalid signal %s\n",
+                            (unsigned)msg->id, nm?nm:"(unnamed)");
+                    continue;
+                }
+                socketcan_signal_t* sg=&msg->signals[msg->signals_count++];
+                sg->name=strdup(nm);
+                sg->start=(uint16_t)st;
+                sg->length=(uint8_t)ln;
+                s=yscalar_str(ymap_get(doc,sn,"byte_order"));
+                sg->byte_order=(s && !strcmp(s,"big_endian")) ? CAN_SIG_BIG_ENDIAN : CAN_SIG_LITTLE_ENDIAN;
+                s=yscalar_str(ymap_get(doc,sn,"signed"));
+                sg->is_signed=s && (!strcmp(s,"true")||!strcmp(s,"1"));
+                double d=yscalar_num(ymap_get(doc,sn,"factor"),&ok);
+                sg->factor= ok ? d : 1.0;
+                d=yscalar_num(ymap_get(doc,sn,"offset"),&ok);
+                sg->offset= ok ? d : 0.0;
+            }
+        }
+    }
+
+    yaml_node_t* isotp=ymap_get(doc,params,"isotp");
+    if(isotp && isotp->type==YAML_SEQUENCE_NODE){
+        size_t n=(isotp->data.sequence.items.top - isotp->data.sequence.items.start);
+        out->params.isotp= n ? calloc(n, sizeof(socketcan_isotp_t)) : NULL;
+        out->params.isotp_count=0;
+        for(yaml_node_item_t* it=isotp->data.sequence.items.start; it<isotp->data.sequence.items.top; ++it){
+            yaml_node_t* tn=yaml_document_get_node(doc,*it);
+            if(!tn || tn->type!=YAML_MAPPING_NODE) continue;
+            int ok1=0, ok2=0;
+            long rx=yscalar_int0(ymap_get(doc,tn,"rx_id"),&ok1);
+            long tx=yscalar_int0(ymap_get(doc,tn,"tx_id"),&ok2);
+            if(!ok1 || !ok2 || rx<0 || rx>0x1FFFFFFF || tx<0 || tx>0x1FFFFFFF){
+                fprintf(stderr, "WARN: socketcan isotp: invalid rx_id/tx_id\n");
+                continue;
+            }
+            socketcan_isotp_t* t=&out->params.isotp[out->params.isotp_count++];
+            t->rx_id=(uint32_t)rx;
+            t->tx_id=(uint32_t)tx;
+            t->extended=t->rx_id>0x7FF || t->tx_id>0x7FF;
+            s=yscalar_str(ymap_get(doc,tn,"extended"));
+            if(s) t->extended=(!strcmp(s,"true")||!strcmp(s,"1")) || t->rx_id>0x7FF || t->tx_id>0x7FF;
+            s=yscalar_str(ymap_get(doc,tn,"name")); if(s) t->name=strdup(s);
+        }
+    }
+
+    yaml_node_t* j1939=ymap_get(doc,params,"j1939");
+    if(j1939 && j1939->type==YAML_MAPPING_NODE){
+        socketcan_j1939_t* j=&out->params.j1939;
+        j->enabled=true;
+        j->promisc=true;
+        v=yscalar_int0(ymap_get(doc,j1939,"addr"),&ok);
+        if(ok && v>=0 && v<=253){ j->addr=(int)v; j->addr_set=true; }
+        else if(ok) fprintf(stderr, "WARN: socketcan j1939: addr out of range [0..253]\n");
+        s=yscalar_str(ymap_get(doc,j1939,"promisc"));
+        if(s) j->promisc=(!strcmp(s,"true")||!strcmp(s,"1"));
+        yaml_node_t* pgns=ymap_get(doc,j1939,"pgns");
+        if(pgns && pgns->type==YAML_SEQUENCE_NODE){
+            size_t n=(pgns->data.sequence.items.top - pgns->data.sequence.items.start);
+            j->pgns= n ? calloc(n, sizeof(uint32_t)) : NULL;
+            j->pgns_count=0;
+            for(yaml_node_item_t* it=pgns->data.sequence.items.start; it<pgns->data.sequence.items.top; ++it){
+                v=yscalar_int0(yaml_document_get_node(doc,*it),&ok);
+                if(!ok || v<0 || v>0x3FFFF){
+                    fprintf(stderr, "WARN: socketcan j1939: invalid pgn\n");
+                    continue;
+                }
+                j->pgns[j->pgns_count++]=(uint32_t)v;
+            }
+        }
+    }
+    return 0;
+}
+
+int parse_onewire_params(yaml_document_t* doc, yaml_node_t* params, onewire_connector_t* out){
+    memset(out, 0, sizeof(*out));
+    if(!params || params->type!=YAML_MAPPING_NODE) return 0;
+    const char* s; int ok=0; long v;
+
+    s=yscalar_str(ymap_get(doc,params,"backend"));
+    if(s && !strcmp(s,"owfs")){
+        onewire_owfs_params_t* o=&out->params.u.owfs;
+        out->params.backend=o->backend=ONEWIRE_OWFS;
+        s=yscalar_str(ymap_get(doc,params,"host")); if(s) o->host=strdup(s);
+        v=yscalar_int(ymap_get(doc,params,"port"),&ok);
+        if(ok){ o->port=(int)v; o->port_set=true; } else o->port=4304;
+        v=yscalar_int(ymap_get(doc,params,"poll_ms"),&ok);
+        if(ok){ o->poll_ms=(int)v; o->poll_set=true; } else o->poll_ms=1000;
+        yaml_node_t* devs=ymap_get(doc,params,"devices");
+        if(devs && devs->type==YAML_SEQUENCE_NODE){
+            size_t n=(devs->data.sequence.items.top - devs->data.sequence.items.start);
+            o->devices= n ? calloc(n, sizeof(char*)) : NULL;
+            o->devices_count=0;
+            for(yaml_node_item_t* it=devs->data.sequence.items.start; it<devs->data.sequence.items.top; ++it){
+                s=yscalar_str(yaml_document_get_node(doc,*it));
+                if(s) o->devices[o->devices_count++]=strdup(s);
+            }
+        }
+        return 0;
+    }
+
+    onewire_sysfs_params_t* w=&out->params.u.sysfs;
+    out->params.backend=w->backend=ONEWIRE_SYSFS;
+    s=yscalar_str(ymap_get(doc,params,"sysfs_path"));
+    w->sysfs_path=strdup(s ? s : "/sys/bus/w1/devices");
+    v=yscalar_int(ymap_get(doc,params,"poll_ms"),&ok);
+    if(ok){ w->poll_ms=(int)v; w->poll_set=true; } else w->poll_ms=1000;
+    w->bulk_read=true;
+    s=yscalar_str(ymap_get(doc,params,"bulk_read"));
+    if(s){ w->bulk_read=(!strcmp(s,"true")||!strcmp(s,"1")); w->bulk_read_set=true; }
+
+    yaml_node_t* devs=ymap_get(doc,params,"devices");
+    if(devs && devs->type==YAML_SEQUENCE_NODE){
+        size_t n=(devs->data.sequence.items.top - devs->data.sequence.items.start);
+        w->devices= n ? calloc(n, sizeof(onewire_sysfs_device_t)) : NULL;
+        w->devices_count=0;
+        for(yaml_node_item_t* it=devs->data.sequence.items.start; it<devs->data.sequence.items.top; ++it){
+            yaml_node_t* dn=yaml_document_get_node(doc,*it);
+            if(!dn || dn->type!=YAML_MAPPING_NODE) continue;
+            s=yscalar_str(ymap_get(doc,dn,"id"));
+            if(!s){
+                fprintf(stderr, "WARN: onewire device without id\n");
+                continue;
+            }
+            onewire_sysfs_device_t* d=&w->devices[w->devices_count++];
+            d->id=strdup(s);
+            s=yscalar_str(ymap_get(doc,dn,"name")); if(s) d->name=strdup(s);
+        }
+    }
+    return 0;
+}
@@ -8,5 +8,9 @@ int parse_mqtt_params(yaml_document_t* doc, yaml_node_t* params, mqtt_connector_
 int parse_http_server_params(yaml_document_t* doc, yaml_node_t* params, http_server_connector_t* out);
 int parse_modbus_rtu_params(yaml_document_t* doc, yaml_node_t* params, modbus_rtu_connector_t* out);
 int parse_modbus_tcp_params(yaml_document_t* doc, yaml_node_t* params, modbus_tcp_connector_t* out);
+int parse_modbus_server_params(yaml_document_t* doc, yaml_node_t* params, modbus_server_connector_t* out);
 int parse_uart_params(yaml_document_t* doc, yaml_node_t* params, uart_connector_t* out);
 int parse_spi_params(yaml_document_t* doc, yaml_node_t* params, spi_connector_t* out);
+int parse_i2c_params(yaml_document_t* doc, yaml_node_t* params, i2c_connector_t* out);
+int parse_socketcan_params(yaml_document_t* doc, yaml_node_t* params, socketcan_connector_t* out);
+int parse_onewire_params(yaml_document_t* doc, yaml_node_t* params, onewire_connector_t* out);
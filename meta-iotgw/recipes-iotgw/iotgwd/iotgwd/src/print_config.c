@@ -8,6 +8,7 @@ static const char* kind_str(kind_t k) {
     case KIND_MQTT:        return "mqtt";
     case KIND_MODBUS_RTU:  return "modbus-rtu";
     case KIND_MODBUS_TCP:  return "modbus-tcp";
+    case KIND_MODBUS_SERVER: return "modbus-tcp-server";
     case KIND_SOCKETCAN:   return "socketcan";
     case KIND_OPCUA:       return "opcua";
     case KIND_HTTP_SERVER: return "http-server";
@@ -52,6 +53,9 @@ void print_connector_detail(const connector_any_t* c) {
         printf("      host: %s\n", c->u.modbus_tcp.params.host ? c->u.modbus_tcp.params.host : "(null)");
         printf("      map: %zu\n", c->u.modbus_tcp.params.map_count);
         break;
+    case KIND_MODBUS_SERVER:
+        printf("      bind: %s\n", c->u.modbus_server.params.bind ? c->u.modbus_server.params.bind : "(null)");
+        break;
     case KIND_UART:
         printf("      port: %s\n", c->u.uart.params.port ? c->u.uart.params.port : "(null)");
         printf("      baudrate: %d\n", c->u.uart.params.baudrate);
@@ -61,12 +65,53 @@ void print_connector_detail(const connector_any_t* c) {
         printf("      speed_hz: %d\n", c->u.spi.params.speed_hz);
         break;
     case KIND_I2C:
+        printf("      bus: /dev/i2c-%d\n", c->u.i2c.params.bus);
+        printf("      devices: %zu\n", c->u.i2c.params.devices_count);
+        for (size_t i = 0; i < c->u.i2c.params.devices_count; i++) {
+            const i2c_device_t* d = &c->u.i2c.params.devices[i];
+            printf("        - 0x%02x %s: %zu point(s)\n", (unsigned)d->addr,
+                   d->name ? d->name : "", d->map_count);
+        }
+        break;
+    case KIND_SOCKETCAN:
+        printf("      ifname: %s\n", c->u.socketcan.params.ifname ? c->u.socketcan.params.ifname : "(null)");
+        if (c->u.socketcan.params.bitrate_set) printf("      bitrate: %d\n", c->u.socketcan.params.bitrate);
+        printf("      fd: %s, filters: %zu\n", c->u.socketcan.params.fd ? "true" : "false",
+               c->u.socketcan.params.filters_count);
+        for (size_t i = 0; i < c->u.socketcan.params.messages_count; i++) {
+            const socketcan_message_t* m = &c->u.socketcan.params.messages[i];
+            printf("        - 0x%X %s: %zu signal(s)%s\n", (unsigned)m->id, m->name ? m->name : "",
+                   m->signals_count, m->rate_ms ? " (rate)" : "");
+        }
+        for (size_t i = 0; i < c->u.socketcan.params.isotp_count; i++) {
+            const socketcan_isotp_t* t = &c->u.socketcan.params.isotp[i];
+            printf("        - isotp %s rx 0x%X tx 0x%X\n", t->name ? t->name : "",
+                   (unsigned)t->rx_id, (unsigned)t->tx_id);
+        }
+        if (c->u.socketcan.params.j1939.enabled) {
+            const socketcan_j1939_t* j = &c->u.socketcan.params.j1939;
+            if (j->addr_set) printf("      j1939: addr 0x%02X", (unsigned)j->addr);
+            else printf("      j1939: listen only");
+            printf(", promisc %s, pgns: %zu\n", j->promisc ? "true" : "false", j->pgns_count);
+        }
+        break;
+    case KIND_ONEWIRE:
+        if (c->u.onewire.params.backend == ONEWIRE_OWFS) {
+            const onewire_owfs_params_t* o = &c->u.onewire.params.u.owfs;
+            printf("      backend: owfs %s:%d, poll_ms: %d, devices: %zu\n",
+                   o->host ? o->host : "(null)", o->port, o->poll_ms, o->devices_count);
+        } else {
+            const onewire_sysfs_params_t* w = &c->u.onewire.params.u.sysfs;
+            printf("      backend: sysfs %s, poll_ms: %d, bulk_read: %s\n",
+                   w->sysfs_path ? w->sysfs_path : "(null)", w->poll_ms, w->bulk_read ? "true" : "false");
+            for (size_t i = 0; i < w->devices_count; i++)
+                printf("        - %s %s\n", w->devices[i].id, w->devices[i].name ? w->devices[i].name : "");
+        }
+        break;
     case KIND_BLE:
     case KIND_COAP:
     case KIND_LORAWAN:
-    case KIND_ONEWIRE:
     case KIND_OPCUA:
-    case KIND_SOCKETCAN:
     case KIND_ZIGBEE:
         /* If not yet parsed to typed structs, we fall back to opaque */
         if (c->u.opaque.json_params) {
@@ -93,6 +138,12 @@ void print_config_summary(const config_t* cfg) {
     if (cfg->gateway.loglevel) printf("  loglevel: %s\n", cfg->gateway.loglevel);
     if (cfg->gateway.logfile)  printf("  logfile: %s\n",  cfg->gateway.logfile);
     if (cfg->gateway.metrics_port_set) printf("  metrics_port: %d\n", cfg->gateway.metrics_port);
+    if (cfg->gateway.realtime.enabled)
+        printf("  realtime: priority=%d cpu_mask=0x%llx lock_memory=%s stack_prefault_kb=%d\n",
+               cfg->gateway.realtime.priority,
+               (unsigned long long)cfg->gateway.realtime.cpu_mask,
+               cfg->gateway.realtime.lock_memory ? "true" : "false",
+               cfg->gateway.realtime.stack_prefault_kb);
 
     printf("\nincludes: %zu\n", cfg->includes.count);
     for (size_t i=0;i<cfg->includes.count;i++)
@@ -109,7 +160,8 @@ void print_config_summary(const config_t* cfg) {
         if (b->mapping.topic)   printf("      mapping.topic: %s\n", b->mapping.topic);
         printf("      mapping.format: %s\n",
                (b->mapping.format==MAP_FMT_JSON)?"json":
-               (b->mapping.format==MAP_FMT_KV)?"kv":"raw");
+               (b->mapping.format==MAP_FMT_KV)?"kv":
+               (b->mapping.format==MAP_FMT_SPARKPLUG)?"sparkplug":"raw");
         if (b->mapping.fields_count) {
             printf("      mapping.fields: [");
             for (size_t j=0;j<b->mapping.fields_count;j++)
@@ -128,6 +180,12 @@ void print_config_summary(const config_t* cfg) {
             printf("      rate_limit.max_msgs_per_sec: %.3f\n", b->rate_limit.max_msgs_per_sec);
         if (b->rate_limit.has_burst)
             printf("      rate_limit.burst: %d\n", b->rate_limit.burst);
+        if (b->batch.present)
+            printf("      batch: max_ms=%d max_bytes=%d compress=%s\n",
+                   b->batch.has_max_ms ? b->batch.max_ms : 100,
+                   b->batch.has_max_bytes ? b->batch.max_bytes : 8192,
+                   b->batch.compress == BATCH_COMPRESS_LZ4  ? "lz4"  :
+                   b->batch.compress == BATCH_COMPRESS_ZSTD ? "zstd" : "none");
         if (b->buffer.has_size || b->buffer.has_policy) {
             printf("      buffer.size: %s%d\n",
                    b->buffer.has_size?"":"(unset) ", b->buffer.has_size?b->buffer.size:0);
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "rt_sched.h"
+#include "log.h"
+
+int rt_sched_process_init(const gateway_realtime_t* cfg)
+{
+    if (!cfg || !cfg->enabled || !cfg->lock_memory) return 0;
+
+    /* Pas de mmap/munmap ni de trim : la mémoire libérée reste verrouillée et
+     * déjà fautée pour les allocations suivantes */
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_TRIM_THRESHOLD, -1);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        log_warn("realtime: mlockall failed (%s), page faults may add latency", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Touche la pile sur `kb` Kio pour que les pages soient fautées (et verrouillées) maintenant */
+static void prefault_stack(int kb)
+{
+    if (kb <= 0) return;
+    volatile unsigned char* buf = alloca((size_t)kb * 1024);
+    for (int i = 0; i < kb * 1024; i += 4096) buf[i] = 0;
+    buf[kb * 1024 - 1] = 0;
+}
+
+int rt_sched_thread_enter(const gateway_realtime_t* cfg, const char* name)
+{
+    if (name) {
+        char n[16];
+        snprintf(n, sizeof(n), "%s", name);   // 15 caractères max pour le noyau
+        pthread_setname_np(pthread_self(), n);
+    }
+    if (!cfg || !cfg->enabled) return 0;
+
+    int rc = 0;
+    if (cfg->cpu_mask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c = 0; c < 64; ++c)
+            if (cfg->cpu_mask & ((uint64_t)1 << c)) CPU_SET(c, &set);
+        int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (e) { log_warn("realtime: %s affinity failed (%s)", name ? name : "thread", strerror(e)); rc = -1; }
+    }
+    if (cfg->priority > 0) {
+        struct sched_param sp = { .sched_priority = cfg->priority };
+        int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (e) { log_warn("realtime: %s SCHED_FIFO %d failed (%s)", name ? name : "thread",
+                          cfg->priority, strerror(e)); rc = -1; }
+    }
+    prefault_stack(cfg->stack_prefault_kb);
+    return rc;
+}
+
+void rt_jitter_reset(rt_jitter_t* j)
+{
+    memset(j, 0, sizeof(*j));
+}
+
+void rt_jitter_add(rt_jitter_t* j, int64_t late_ns)
+{
+    static const int64_t edges[RT_JITTER_BUCKETS - 1] = { 10000, 50000, 100000, 500000, 1000000 };
+    if (late_ns < 0) late_ns = 0;
+    if (j->count == 0 || late_ns < j->min_ns) j->min_ns = late_ns;
+    if (late_ns > j->max_ns) j->max_ns = late_ns;
+    j->sum_ns += (double)late_ns;
+    j->count++;
+    int b = 0;
+    while (b < RT_JITTER_BUCKETS - 1 && late_ns >= edges[b]) b++;
+    j->hist[b]++;
+}
+
+void rt_jitter_log(const rt_jitter_t* j, const char* tag)
+{
+    if (!j || j->count == 0) return;
+    log_info("[%s] wakeup latency us: min=%.1f avg=%.1f max=%.1f  <10:%llu <50:%llu <100:%llu <500:%llu <1000:%llu >=1000:%llu",
+             tag ? tag : "rt", j->min_ns / 1e3, j->sum_ns / (double)j->count / 1e3, j->max_ns / 1e3,
+             (unsigned long long)j->hist[0], (unsigned long long)j->hist[1],
+             (unsigned long long)j->hist[2], (unsigned long long)j->hist[3],
+             (unsigned long long)j->hist[4], (unsigned long long)j->hist[5]);
+}
+
+#ifdef IOTGWD_ALLOC_CHECK
+/* Interposition malloc (glibc) : les symboles du binaire priment sur ceux de la libc.
+ * Un compteur atomique + un message write(2) (sans allocation) par violation. */
+extern void* __libc_malloc(size_t);
+extern void* __libc_calloc(size_t, size_t);
+extern void* __libc_realloc(void*, size_t);
+extern void* __libc_memalign(size_t, size_t);
+
+static __thread int t_hot;
+static unsigned long g_violations;
+
+/* Profondeur : les sections chaudes peuvent s'imbriquer (tick entier > ioctl) */
+void rt_hot_enter(void) { t_hot++; }
+void rt_hot_leave(void) { if (t_hot > 0) t_hot--; }
+unsigned long rt_alloc_violations(void) { return __atomic_load_n(&g_violations, __ATOMIC_RELAXED); }
+
+static void violation(const char* what)
+{
+    if (__atomic_fetch_add(&g_violations, 1, __ATOMIC_RELAXED) < 16) {
+        static const char pfx[] = "iotgwd: allocation in realtime hot path: ";
+        ssize_t r = write(2, pfx, sizeof(pfx) - 1);
+        r = write(2, what, strlen(what));
+        r = write(2, "\n", 1);
+        (void)r;
+    }
+}
+
+void* malloc(size_t n)            { if (t_hot) violation("malloc");  return __libc_malloc(n); }
+void* calloc(size_t a, size_t b)  { if (t_hot) violation("calloc");  return __libc_calloc(a, b); }
+void* realloc(void* p, size_t n)  { if (t_hot) violation("realloc"); return __libc_realloc(p, n); }
+
+/* Allocations alignées : glibc n'exporte que __libc_memalign */
+void* memalign(size_t al, size_t n)      { if (t_hot) violation("memalign");      return __libc_memalign(al, n); }
+void* aligned_alloc(size_t al, size_t n) { if (t_hot) violation("aligned_alloc"); return __libc_memalign(al, n); }
+
+int posix_memalign(void** out, size_t al, size_t n)
+{
+    if (t_hot) violation("posix_memalign");
+    if (al < sizeof(void*) || (al & (al - 1))) return EINVAL;
+    void* p = __libc_memalign(al, n);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+#endif
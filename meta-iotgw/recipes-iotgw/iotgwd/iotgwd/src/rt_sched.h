@@ -0,0 +1,51 @@
+#pragma once
+/**
+ * @file rt_sched.h
+ * @brief Mode temps réel des threads d'acquisition (gateway.realtime).
+ *
+ *  - rt_sched_process_init() : mlockall + malloc sans mmap/trim (une fois par config)
+ *  - rt_sched_thread_enter() : SCHED_FIFO, affinité CPU, pile pré-touchée,
+ *    à appeler en tête de chaque thread d'acquisition
+ *  - rt_jitter_t : statistiques de latence de réveil (échéance -> réveil effectif)
+ *  - rt_hot_enter()/rt_hot_leave() : bornes du chemin chaud. Compilé avec
+ *    -DIOTGWD_ALLOC_CHECK, tout malloc/calloc/realloc (et memalign,
+ *    aligned_alloc, posix_memalign) entre les deux est compté
+ *    (rt_alloc_violations) ; sinon ce sont des no-op.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "config_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  rt_sched_process_init(const gateway_realtime_t* cfg);
+int  rt_sched_thread_enter(const gateway_realtime_t* cfg, const char* name);
+
+/* Histogramme de latence : <10us <50us <100us <500us <1ms >=1ms */
+#define RT_JITTER_BUCKETS 6
+typedef struct {
+    uint64_t count;
+    int64_t  min_ns, max_ns;
+    double   sum_ns;
+    uint64_t hist[RT_JITTER_BUCKETS];
+} rt_jitter_t;
+
+void rt_jitter_reset(rt_jitter_t* j);
+void rt_jitter_add(rt_jitter_t* j, int64_t late_ns);
+void rt_jitter_log(const rt_jitter_t* j, const char* tag);
+
+#ifdef IOTGWD_ALLOC_CHECK
+void rt_hot_enter(void);
+void rt_hot_leave(void);
+unsigned long rt_alloc_violations(void);
+#else
+static inline void rt_hot_enter(void) {}
+static inline void rt_hot_leave(void) {}
+static inline unsigned long rt_alloc_violations(void) { return 0; }
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,621 @@
+/**
+ * @file sparkplug.c
+ * @brief Sparkplug B : writer protobuf minimal + gestion birth/death/alias.
+ *
+ * Seuls les champs utilisés par la passerelle sont encodés (cf. sparkplug_b.proto) :
+ *   Payload { timestamp=1, metrics=2, seq=3 }
+ *   Metric  { name=1, alias=2, timestamp=3, datatype=4, is_null=7,
+ *             int_value=10, long_value=11, float_value=12, double_value=13,
+ *             boolean_value=14, string_value=15, bytes_value=16 }
+ * et, en lecture (NCMD), Metric.name + boolean_value ; le reste est sauté.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sparkplug.h"
+#include "log.h"
+
+/* Sparkplug DataType */
+enum {
+    SPB_INT64   = 4,
+    SPB_UINT64  = 8,
+    SPB_DOUBLE  = 10,
+    SPB_BOOLEAN = 11,
+    SPB_STRING  = 12,
+    SPB_BYTES   = 17
+};
+
+/* protobuf wire types */
+enum { WT_VARINT = 0, WT_FIXED64 = 1, WT_LEN = 2, WT_FIXED32 = 5 };
+
+#define REBIRTH_METRIC "Node Control/Rebirth"
+
+// ------------------ protobuf writer ------------------
+
+/* p == NULL => passe de comptage (calcul de taille des sous-messages) */
+typedef struct {
+    uint8_t* p;
+    size_t   len;
+    size_t   cap;
+    int      overflow;
+} pbw_t;
+
+static inline void pb_raw(pbw_t* w, const void* src, size_t n)
+{
+    if (w->p) {
+        if (w->len + n > w->cap) { w->overflow = 1; return; }
+        memcpy(w->p + w->len, src, n);
+    }
+    w->len += n;
+}
+
+static inline void pb_varint(pbw_t* w, uint64_t v)
+{
+    uint8_t tmp[10];
+    size_t n = 0;
+    do {
+        uint8_t b = (uint8_t)(v & 0x7F);
+        v >>= 7;
+        tmp[n++] = v ? (uint8_t)(b | 0x80) : b;
+    } while (v);
+    pb_raw(w, tmp, n);
+}
+
+static inline void pb_tag(pbw_t* w, unsigned field, unsigned wt)
+{
+    pb_varint(w, ((uint64_t)field << 3) | wt);
+}
+
+static inline void pb_field_varint(pbw_t* w, unsigned field, uint64_t v)
+{
+    pb_tag(w, field, WT_VARINT);
+    pb_varint(w, v);
+}
+
+static inline void pb_field_double(pbw_t* w, unsigned field, double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    uint8_t le[8];
+    for (int i = 0; i < 8; ++i) le[i] = (uint8_t)(u >> (8 * i));
+    pb_tag(w, field, WT_FIXED64);
+    pb_raw(w, le, sizeof(le));
+}
+
+static inline void pb_field_bytes(pbw_t* w, unsigned field, const void* data, size_t len)
+{
+    pb_tag(w, field, WT_LEN);
+    pb_varint(w, len);
+    pb_raw(w, data, len);
+}
+
+// ------------------ protobuf reader (NCMD) ------------------
+
+static int pb_get_varint(const uint8_t** p, const uint8_t* end, uint64_t* v)
+{
+    uint64_t r = 0;
+    for (int sh = 0; sh < 64 && *p < end; sh += 7) {
+        uint8_t b = *(*p)++;
+        r |= (uint64_t)(b & 0x7F) << sh;
+        if (!(b & 0x80)) { *v = r; return 0; }
+    }
+    return -1;
+}
+
+/* Champ suivant : numéro, type ; pour WT_LEN, data/len du contenu. */
+static int pb_next(const uint8_t** p, const uint8_t* end, unsigned* field, unsigned* wt,
+                   uint64_t* val, const uint8_t** data)
+{
+    uint64_t tag;
+    if (pb_get_varint(p, end, &tag) != 0) return -1;
+    *field = (unsigned)(tag >> 3);
+    *wt    = (unsigned)(tag & 7);
+    switch (*wt) {
+    case WT_VARINT:  return pb_get_varint(p, end, val);
+    case WT_FIXED64: if (end - *p < 8) return -1; *p += 8; return 0;
+    case WT_FIXED32: if (end - *p < 4) return -1; *p += 4; return 0;
+    case WT_LEN:
+        if (pb_get_varint(p, end, val) != 0 || *val > (uint64_t)(end - *p)) return -1;
+        *data = *p;
+        *p += *val;
+        return 0;
+    default: return -1;
+    }
+}
+
+/* Payload NCMD : une métrique "Node Control/Rebirth" à true ? */
+static bool ncmd_wants_rebirth(const uint8_t* p, size_t n)
+{
+    const uint8_t* end = p + n;
+    while (p < end) {
+        unsigned f, wt; uint64_t v = 0; const uint8_t* d = NULL;
+        if (pb_next(&p, end, &f, &wt, &v, &d) != 0) return false;
+        if (f != 2 || wt != WT_LEN) continue;               // Payload.metrics
+
+        const uint8_t* q = d, *qend = d + v;
+        bool named = false, set = false;
+        while (q < qend) {
+            unsigned mf, mwt; uint64_t mv = 0; const uint8_t* md = NULL;
+            if (pb_next(&q, qend, &mf, &mwt, &mv, &md) != 0) return false;
+            if (mf == 1 && mwt == WT_LEN)
+                named = mv == sizeof(REBIRTH_METRIC) - 1 && memcmp(md, REBIRTH_METRIC, mv) == 0;
+            else if (mf == 14 && mwt == WT_VARINT)
+                set = mv != 0;
+        }
+        if (named && set) return true;
+    }
+    return false;
+}
+
+// ------------------ helpers ------------------
+
+static uint32_t fnv1a(const char* s)
+{
+    uint32_t h = 2166136261u;
+    for (; *s; ++s) { h ^= (uint8_t)*s; h *= 16777619u; }
+    return h;
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)(ts.tv_nsec / 1000000);
+}
+
+static unsigned datatype_of(gw_value_type_t t)
+{
+    switch (t) {
+    case GW_VAL_BOOL:  return SPB_BOOLEAN;
+    case GW_VAL_I64:   return SPB_INT64;
+    case GW_VAL_U64:   return SPB_UINT64;
+    case GW_VAL_F64:   return SPB_DOUBLE;
+    case GW_VAL_STR:   return SPB_STRING;
+    case GW_VAL_BYTES:
+    default:           return SPB_BYTES;
+    }
+}
+
+static void pb_metric_value(pbw_t* w, const gw_metric_t* m)
+{
+    switch (m->type) {
+    case GW_VAL_BOOL:  pb_field_varint(w, 14, m->v.b ? 1 : 0); break;
+    case GW_VAL_I64:   pb_field_varint(w, 11, (uint64_t)m->v.i64); break;
+    case GW_VAL_U64:   pb_field_varint(w, 11, m->v.u64); break;
+    case GW_VAL_F64:   pb_field_double(w, 13, m->v.f64); break;
+    case GW_VAL_STR:   pb_field_bytes(w, 15, m->v.bytes.data, m->v.bytes.len); break;
+    case GW_VAL_BYTES: pb_field_bytes(w, 16, m->v.bytes.data, m->v.bytes.len); break;
+    }
+}
+
+/* Corps d'une Metric. name == NULL => forme compacte (alias seul, DDATA). */
+static void pb_metric_body(pbw_t* w, const char* name, uint64_t alias, uint64_t ts,
+                           unsigned datatype, const gw_metric_t* value)
+{
+    if (name) pb_field_bytes(w, 1, name, strlen(name));
+    pb_field_varint(w, 2, alias);
+    pb_field_varint(w, 3, ts);
+    if (name) pb_field_varint(w, 4, datatype);
+    if (value) pb_metric_value(w, value);
+    else       pb_field_varint(w, 7, 1); // is_null
+}
+
+static void pb_metric(pbw_t* w, const char* name, uint64_t alias, uint64_t ts,
+                      unsigned datatype, const gw_metric_t* value)
+{
+    pbw_t cnt = {0};
+    pb_metric_body(&cnt, name, alias, ts, datatype, value);
+    pb_tag(w, 2, WT_LEN);
+    pb_varint(w, cnt.len);
+    pb_metric_body(w, name, alias, ts, datatype, value);
+}
+
+/* Métrique nommée sans alias (bdSeq, Node Control/Rebirth) */
+static void pb_named_metric(pbw_t* w, const char* name, uint64_t ts,
+                            unsigned datatype, const gw_metric_t* value)
+{
+    pbw_t cnt = {0};
+    pb_field_bytes(&cnt, 1, name, strlen(name));
+    pb_field_varint(&cnt, 3, ts);
+    pb_field_varint(&cnt, 4, datatype);
+    pb_metric_value(&cnt, value);
+
+    pb_tag(w, 2, WT_LEN);
+    pb_varint(w, cnt.len);
+    pb_field_bytes(w, 1, name, strlen(name));
+    pb_field_varint(w, 3, ts);
+    pb_field_varint(w, 4, datatype);
+    pb_metric_value(w, value);
+}
+
+// ------------------ alias table ------------------
+
+static long slot_find(const sparkplug_sink_t* s, const char* name, uint32_t h)
+{
+    for (size_t i = 0; i < s->slots_count; ++i)
+        if (s->slots[i].hash == h && strcmp(s->slots[i].name, name) == 0)
+            return (long)i;
+    return -1;
+}
+
+static long slot_add(sparkplug_sink_t* s, const char* name, uint32_t h, gw_value_type_t type)
+{
+    if (s->slots_count == s->slots_cap) {
+        size_t ncap = s->slots_cap ? s->slots_cap * 2 : 16;
+        sparkplug_slot_t* n = (sparkplug_slot_t*)realloc(s->slots, ncap * sizeof(*n));
+        if (!n) return -1;
+        s->slots = n;
+        s->slots_cap = ncap;
+    }
+    sparkplug_slot_t* sl = &s->slots[s->slots_count];
+    sl->name = strdup(name);
+    if (!sl->name) return -1;
+    sl->hash  = h;
+    sl->alias = s->slots_count;
+    sl->type  = type;
+    sl->has_value = false;
+    sl->vbuf = NULL;
+    sl->vcap = 0;
+    return (long)s->slots_count++;
+}
+
+/* Dernière valeur d'une métrique, reprise par les DBIRTH suivants */
+static void slot_store(sparkplug_slot_t* sl, const gw_metric_t* m)
+{
+    sl->last = *m;
+    sl->last.name = sl->name;
+    if (m->type == GW_VAL_STR || m->type == GW_VAL_BYTES) {
+        size_t n = m->v.bytes.len;
+        if (n > sl->vcap) {
+            uint8_t* nb = (uint8_t*)realloc(sl->vbuf, n);
+            if (!nb) { sl->has_value = false; return; }
+            sl->vbuf = nb;
+            sl->vcap = n;
+        }
+        if (n) memcpy(sl->vbuf, m->v.bytes.data, n);
+        sl->last.v.bytes.data = sl->vbuf;
+    }
+    sl->has_value = true;
+}
+
+// ------------------ publication ------------------
+
+static int publish(sparkplug_sink_t* s, const char* topic, const pbw_t* w)
+{
+    if (w->overflow) {
+        s->encode_errors++;
+        log_err("sparkplug: payload > %zu bytes, dropped (%s)", w->cap, topic);
+        return -1;
+    }
+    gw_msg_t out;
+    memset(&out, 0, sizeof(out));
+    out.protocole       = KIND_MQTT;
+    out.pl.topic        = topic;
+    out.pl.data         = w->p;
+    out.pl.len          = w->len;
+    out.pl.content_type = "application/x-protobuf";
+    return s->inner_send(&out, s->inner_ctx);
+}
+
+static void node_topic(const sparkplug_sink_t* s, const char* type, char* out, size_t sz)
+{
+    snprintf(out, sz, "spBv1.0/%s/%s/%s", s->group_id, type, s->edge_node_id);
+}
+
+static void device_topic(const sparkplug_sink_t* s, const char* type, char* out, size_t sz)
+{
+    snprintf(out, sz, "spBv1.0/%s/%s/%s/%s", s->group_id, type, s->edge_node_id, s->device_id);
+}
+
+static int publish_nbirth(sparkplug_sink_t* s, uint8_t* buf)
+{
+    char topic[256];
+    node_topic(s, "NBIRTH", topic, sizeof(topic));
+
+    uint64_t ts = now_ms();
+    gw_metric_t bd = { .name = "bdSeq", .type = GW_VAL_U64, .v.u64 = s->bd_seq };
+    gw_metric_t rb = { .name = REBIRTH_METRIC, .type = GW_VAL_BOOL, .v.b = false };
+
+    s->seq = 0;
+    pbw_t w = { .p = buf, .cap = s->pool.block_size };
+    pb_field_varint(&w, 1, ts);
+    pb_named_metric(&w, bd.name, ts, SPB_UINT64, &bd);
+    pb_named_metric(&w, rb.name, ts, SPB_BOOLEAN, &rb);
+    pb_field_varint(&w, 3, s->seq);
+    return publish(s, topic, &w);
+}
+
+/* DBIRTH : toutes les métriques connues ; celles absentes du message courant
+ * reprennent leur dernière valeur, is_null si elles n'en ont pas encore. */
+static int publish_dbirth(sparkplug_sink_t* s, uint8_t* buf, uint64_t ts,
+                          const gw_metric_t* m, const long* idx, size_t n)
+{
+    char topic[256];
+    device_topic(s, "DBIRTH", topic, sizeof(topic));
+
+    s->seq = (uint8_t)(s->seq + 1);
+    pbw_t w = { .p = buf, .cap = s->pool.block_size };
+    pb_field_varint(&w, 1, ts);
+    for (size_t a = 0; a < s->slots_count; ++a) {
+        const sparkplug_slot_t* sl = &s->slots[a];
+        const gw_metric_t* val = sl->has_value ? &sl->last : NULL;
+        for (size_t i = 0; i < n; ++i)
+            if (idx[i] == (long)a) { val = &m[i]; break; }
+        pb_metric(&w, sl->name, sl->alias, ts, datatype_of(sl->type), val);
+    }
+    pb_field_varint(&w, 3, s->seq);
+    return publish(s, topic, &w);
+}
+
+static int publish_ddata(sparkplug_sink_t* s, uint8_t* buf, uint64_t ts,
+                         const gw_metric_t* m, const long* idx, size_t n)
+{
+    char topic[256];
+    device_topic(s, "DDATA", topic, sizeof(topic));
+
+    s->seq = (uint8_t)(s->seq + 1);
+    pbw_t w = { .p = buf, .cap = s->pool.block_size };
+    pb_field_varint(&w, 1, ts);
+    for (size_t i = 0; i < n; ++i) {
+        if (idx[i] < 0) continue;
+        pb_metric(&w, NULL, s->slots[idx[i]].alias, ts, 0, &m[i]);
+    }
+    pb_field_varint(&w, 3, s->seq);
+    return publish(s, topic, &w);
+}
+
+// ------------------ API ------------------
+
+static void copy_id(char* dst, const char* src, const char* def)
+{
+    snprintf(dst, SPARKPLUG_ID_MAX, "%s", (src && src[0]) ? src : def);
+}
+
+int sparkplug_sink_init(sparkplug_sink_t* s,
+                        const char* group_id,
+                        const char* edge_node_id,
+                        const char* device_id,
+                        const char* default_metric,
+                        gw_send_fn inner_send, void* inner_ctx,
+                        const volatile unsigned* session_gen)
+{
+    if (!s || !inner_send) return -1;
+    memset(s, 0, sizeof(*s));
+    copy_id(s->group_id,       group_id,       "iotgw");
+    copy_id(s->edge_node_id,   edge_node_id,   "gateway");
+    copy_id(s->device_id,      device_id,      "device");
+    copy_id(s->default_metric, default_metric, "data");
+    s->inner_send  = inner_send;
+    s->inner_ctx   = inner_ctx;
+    s->session_gen = session_gen;
+    s->bd_seq      = (uint64_t)(time(NULL) & 0xFF);
+    s->will_bd_seq = s->bd_seq;
+
+    if (buf_pool_init(&s->pool, SPARKPLUG_BUF_SIZE, SPARKPLUG_BUF_COUNT) != 0) return -1;
+    pthread_mutex_init(&s->mu, NULL);
+    return 0;
+}
+
+static int encode_ndeath(const sparkplug_sink_t* s, uint64_t bd_seq,
+                         char* topic, size_t topic_sz,
+                         uint8_t* out, size_t cap, size_t* out_len)
+{
+    node_topic(s, "NDEATH", topic, topic_sz);
+
+    uint64_t ts = now_ms();
+    gw_metric_t bd = { .name = "bdSeq", .type = GW_VAL_U64, .v.u64 = bd_seq };
+    pbw_t w = { .p = out, .cap = cap };
+    pb_field_varint(&w, 1, ts);
+    pb_named_metric(&w, bd.name, ts, SPB_UINT64, &bd);
+    if (w.overflow) return -1;
+    *out_len = w.len;
+    return 0;
+}
+
+int sparkplug_encode_ndeath(sparkplug_sink_t* s,
+                            char* topic, size_t topic_sz,
+                            uint8_t* out, size_t cap, size_t* out_len)
+{
+    if (!s || !topic || !out || !out_len) return -1;
+    return encode_ndeath(s, s->will_bd_seq, topic, topic_sz, out, cap, out_len);
+}
+
+void sparkplug_sink_set_will_fn(sparkplug_sink_t* s, sparkplug_will_fn fn, void* ctx)
+{
+    if (!s) return;
+    s->will_fn  = fn;
+    s->will_ctx = ctx;
+}
+
+/* Après un NBIRTH (sous s->mu) : bdSeq suivant armé comme will de la
+ * prochaine connexion. */
+static void rearm_will(sparkplug_sink_t* s, uint8_t* buf)
+{
+    if (!s->will_fn) return;
+    char topic[256];
+    size_t len = 0;
+    uint64_t next = (s->bd_seq + 1) & 0xFF;
+    if (encode_ndeath(s, next, topic, sizeof(topic), buf, s->pool.block_size, &len) != 0) return;
+    if (s->will_fn(s->will_ctx, topic, buf, (int)len) == 0) s->will_bd_seq = next;
+    else log_warn("sparkplug: NDEATH will re-arm failed (bdSeq %llu kept)",
+                  (unsigned long long)s->bd_seq);
+}
+
+/* NBIRTH (+ DBIRTH des métriques connues), sous s->mu. new_session : bdSeq
+ * du will de la connexion, puis réarmement ; sinon (rebirth) bdSeq inchangé. */
+static int birth(sparkplug_sink_t* s, uint8_t* buf, unsigned gen, bool new_session)
+{
+    if (new_session) s->bd_seq = s->will_bd_seq;
+    int rc = publish_nbirth(s, buf);
+    if (rc != 0) return rc;
+    s->node_born   = true;
+    s->birth_gen   = gen;
+    s->device_born = false;
+    if (new_session) rearm_will(s, buf);
+    if (s->slots_count) {
+        rc = publish_dbirth(s, buf, now_ms(), NULL, NULL, 0);
+        if (rc == 0) s->device_born = true;
+    }
+    return rc;
+}
+
+static unsigned current_gen(const sparkplug_sink_t* s)
+{
+    return s->session_gen ? *s->session_gen : 0;
+}
+
+int sparkplug_sink_session(sparkplug_sink_t* s)
+{
+    if (!s || !s->pool.arena) return -1;
+    uint8_t* buf = buf_pool_get(&s->pool);
+    if (!buf) return -1;                // le premier envoi fera le NBIRTH
+
+    int rc = 0;
+    pthread_mutex_lock(&s->mu);
+    unsigned gen = current_gen(s);
+    if (!s->closed && (!s->node_born || gen != s->birth_gen))
+        rc = birth(s, buf, gen, true);
+    pthread_mutex_unlock(&s->mu);
+    buf_pool_put(&s->pool, buf);
+    return rc;
+}
+
+void sparkplug_sink_ncmd_topic(const sparkplug_sink_t* s, char* out, size_t sz)
+{
+    node_topic(s, "NCMD", out, sz);
+}
+
+int sparkplug_sink_command(sparkplug_sink_t* s, const char* topic,
+                           const void* payload, int len)
+{
+    if (!s || !topic || len < 0 || (len && !payload)) return -1;
+    char ncmd[256];
+    node_topic(s, "NCMD", ncmd, sizeof(ncmd));
+    if (strcmp(topic, ncmd) != 0 || !ncmd_wants_rebirth((const uint8_t*)payload, (size_t)len))
+        return 0;
+
+    uint8_t* buf = buf_pool_get(&s->pool);
+    if (!buf) return -1;
+    int rc = 0;
+    pthread_mutex_lock(&s->mu);
+    if (!s->closed) {
+        unsigned gen = current_gen(s);
+        /* pas encore née (ou session changée) : birth normal de la session */
+        bool same = s->node_born && gen == s->birth_gen;
+        rc = birth(s, buf, gen, !same);
+        if (rc == 0) {
+            s->rebirths++;
+            log_info("sparkplug: rebirth requested by host (bdSeq %llu)", (unsigned long long)s->bd_seq);
+        }
+    }
+    pthread_mutex_unlock(&s->mu);
+    buf_pool_put(&s->pool, buf);
+    return rc == 0 ? 1 : -1;
+}
+
+int sparkplug_send_adapter(const gw_msg_t* msg, void* ctx)
+{
+    sparkplug_sink_t* s = (sparkplug_sink_t*)ctx;
+    if (!s || !msg) return -1;
+
+    /* Message brut => une seule métrique synthétique */
+    gw_metric_t raw;
+    const gw_metric_t* m = msg->metrics;
+    size_t n = msg->metrics_count;
+    if (!m || n == 0) {
+        memset(&raw, 0, sizeof(raw));
+        raw.name = s->default_metric;
+        raw.type = msg->pl.is_text ? GW_VAL_STR : GW_VAL_BYTES;
+        raw.v.bytes.data = msg->pl.data;
+        raw.v.bytes.len  = msg->pl.len;
+        m = &raw; n = 1;
+    }
+    if (n > SPARKPLUG_MAX_MSG_METRICS) n = SPARKPLUG_MAX_MSG_METRICS;
+
+    uint64_t ts = msg->timestamp > 0 ? (uint64_t)(msg->timestamp * 1000.0) : now_ms();
+    long idx[SPARKPLUG_MAX_MSG_METRICS];
+
+    uint8_t* buf = buf_pool_get(&s->pool);
+    if (!buf) return -1;
+
+    int rc = 0;
+    pthread_mutex_lock(&s->mu);
+
+    /* nouvelle session pas encore annoncée par le callback de connexion :
+     * sa connexion porte le will de will_bd_seq */
+    unsigned gen = current_gen(s);
+    if (!s->node_born || gen != s->birth_gen) rc = birth(s, buf, gen, true);
+
+    for (size_t i = 0; rc == 0 && i < n; ++i) {
+        if (!m[i].name) { idx[i] = -1; continue; }
+        uint32_t h = fnv1a(m[i].name);
+        idx[i] = slot_find(s, m[i].name, h);
+        if (idx[i] < 0) {
+            idx[i] = slot_add(s, m[i].name, h, m[i].type);
+            s->device_born = false;   // nouvelle métrique => re-DBIRTH
+        } else if (s->slots[idx[i]].type != m[i].type) {
+            idx[i] = -1;              // type incohérent avec le DBIRTH : ignorée
+        }
+    }
+
+    if (rc == 0) {
+        if (!s->device_born) {
+            rc = publish_dbirth(s, buf, ts, m, idx, n);
+            if (rc == 0) s->device_born = true;
+        } else {
+            rc = publish_ddata(s, buf, ts, m, idx, n);
+        }
+    }
+    for (size_t i = 0; rc == 0 && i < n; ++i)
+        if (idx[i] >= 0) slot_store(&s->slots[idx[i]], &m[i]);
+
+    pthread_mutex_unlock(&s->mu);
+    buf_pool_put(&s->pool, buf);
+    return rc;
+}
+
+void sparkplug_sink_shutdown(sparkplug_sink_t* s)
+{
+    if (!s || !s->pool.arena) return;
+
+    pthread_mutex_lock(&s->mu);
+    if (s->node_born) {
+        uint8_t* buf = buf_pool_get(&s->pool);
+        if (buf) {
+            char topic[256];
+            if (s->device_born) {
+                device_topic(s, "DDEATH", topic, sizeof(topic));
+                s->seq = (uint8_t)(s->seq + 1);
+                pbw_t w = { .p = buf, .cap = s->pool.block_size };
+                pb_field_varint(&w, 1, now_ms());
+                pb_field_varint(&w, 3, s->seq);
+                (void)publish(s, topic, &w);
+            }
+            size_t len = 0;
+            if (encode_ndeath(s, s->bd_seq, topic, sizeof(topic), buf, s->pool.block_size, &len) == 0) {
+                pbw_t w = { .p = buf, .len = len, .cap = s->pool.block_size };
+                (void)publish(s, topic, &w);
+            }
+            buf_pool_put(&s->pool, buf);
+        }
+    }
+    s->closed = true;
+    pthread_mutex_unlock(&s->mu);
+}
+
+void sparkplug_sink_free(sparkplug_sink_t* s)
+{
+    if (!s || !s->pool.arena) return;
+    if (s->rebirths)
+        log_info("sparkplug: %lu rebirth(s) on host request", s->rebirths);
+    for (size_t i = 0; i < s->slots_count; ++i) {
+        free(s->slots[i].name);
+        free(s->slots[i].vbuf);
+    }
+    free(s->slots);
+    s->slots = NULL;
+    s->slots_count = s->slots_cap = 0;
+    pthread_mutex_destroy(&s->mu);
+    buf_pool_destroy(&s->pool);
+}
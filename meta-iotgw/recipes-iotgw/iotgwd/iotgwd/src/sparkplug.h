@@ -0,0 +1,129 @@
+#pragma once
+/**
+ * @file sparkplug.h
+ * @brief Encodeur Sparkplug B (protobuf écrit à la main) + sink MQTT.
+ *
+ * Le sink s'insère devant un gw_send_fn existant (ex: mqtt_send_adapter) :
+ *   - NBIRTH à chaque (re)connexion (sparkplug_sink_session, appelé depuis le
+ *     callback de connexion ; à défaut au premier envoi de la session), suivi
+ *     du DBIRTH des métriques déjà connues (dernières valeurs)
+ *   - DBIRTH avec noms, alias et types dès qu'une nouvelle métrique apparaît
+ *   - DDATA compacts ensuite : alias + timestamp + valeur, sans nom ni type
+ *   - NDEATH posé comme "will" MQTT (sparkplug_encode_ndeath) et publié
+ *     explicitement à l'arrêt, précédé d'un DDEATH.
+ *   - NCMD "Node Control/Rebirth" = true (sparkplug_sink_command, topic
+ *     spBv1.0/<group>/NCMD/<node> souscrit par le bridge) : NBIRTH + DBIRTH
+ *     republiés avec le même bdSeq.
+ *
+ * bdSeq : le NBIRTH d'une session reprend le bdSeq du will enregistré à sa
+ * connexion ; juste après, bdSeq+1 est réarmé (will_fn) pour la connexion
+ * suivante, de sorte qu'un NDEATH tardif d'une ancienne session ne tue pas
+ * la nouvelle côté Host Application.
+ *
+ * Les messages sans métriques (trames brutes) deviennent une métrique unique
+ * (Bytes, ou String si pl.is_text) nommée `default_metric`.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "gw_msg.h"
+#include "buf_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPARKPLUG_ID_MAX        64
+#define SPARKPLUG_MAX_MSG_METRICS 256   // métriques max par message source
+#define SPARKPLUG_BUF_SIZE      16384   // taille d'un buffer du pool
+#define SPARKPLUG_BUF_COUNT     4
+
+typedef struct {
+    char*    name;
+    uint32_t hash;           // FNV-1a du nom (filtre avant strcmp)
+    uint64_t alias;
+    gw_value_type_t type;
+    bool        has_value;   // dernière valeur publiée (DBIRTH de reconnexion/rebirth)
+    gw_metric_t last;
+    uint8_t*    vbuf;        // copie des octets de last (STR/BYTES)
+    size_t      vcap;
+} sparkplug_slot_t;
+
+/* Réarme le will MQTT (NDEATH du bdSeq suivant), pris en compte à la
+ * prochaine connexion. Retour 0 = OK. */
+typedef int (*sparkplug_will_fn)(void* ctx, const char* topic, const void* payload, int len);
+
+typedef struct {
+    char group_id[SPARKPLUG_ID_MAX];
+    char edge_node_id[SPARKPLUG_ID_MAX];
+    char device_id[SPARKPLUG_ID_MAX];
+    char default_metric[SPARKPLUG_ID_MAX];
+
+    gw_send_fn inner_send;   // publication réelle (topic + octets)
+    void*      inner_ctx;
+    const volatile unsigned* session_gen;  // incrémenté à chaque (re)connexion MQTT
+    sparkplug_will_fn will_fn;   // NULL : will posé une seule fois
+    void*      will_ctx;
+
+    pthread_mutex_t mu;
+    buf_pool_t pool;
+    unsigned birth_gen;      // session_gen au dernier NBIRTH
+    bool     node_born;
+    bool     device_born;
+    bool     closed;         // après sparkplug_sink_shutdown : sessions/commandes ignorées
+    uint8_t  seq;            // 0..255, NBIRTH = 0
+    uint64_t bd_seq;         // session courante (NBIRTH, NDEATH d'arrêt)
+    uint64_t will_bd_seq;    // will armé pour la prochaine connexion
+
+    sparkplug_slot_t* slots; // table des alias (index == alias)
+    size_t   slots_count;
+    size_t   slots_cap;
+
+    unsigned long encode_errors, rebirths;
+} sparkplug_sink_t;
+
+/* Retour 0 = OK. group/edge/device NULL => "iotgw"/"gateway"/"device". */
+int  sparkplug_sink_init(sparkplug_sink_t* s,
+                         const char* group_id,
+                         const char* edge_node_id,
+                         const char* device_id,
+                         const char* default_metric,
+                         gw_send_fn inner_send, void* inner_ctx,
+                         const volatile unsigned* session_gen);
+
+/* Branche le réarmement du will (à appeler avant la première connexion). */
+void sparkplug_sink_set_will_fn(sparkplug_sink_t* s, sparkplug_will_fn fn, void* ctx);
+
+/* (Re)connexion de la destination (callback MQTT) : NBIRTH, puis DBIRTH si
+ * des métriques sont connues, si la session n'est pas encore née.
+ * Retour 0 = OK/déjà née. */
+int  sparkplug_sink_session(sparkplug_sink_t* s);
+
+/* Topic NCMD du noeud, à souscrire : spBv1.0/<group>/NCMD/<node> */
+void sparkplug_sink_ncmd_topic(const sparkplug_sink_t* s, char* out, size_t sz);
+
+/* Message reçu (callback MQTT). NCMD avec Node Control/Rebirth = true :
+ * NBIRTH + DBIRTH republiés, même bdSeq. Retour 1 = rebirth, 0 = ignoré, -1. */
+int  sparkplug_sink_command(sparkplug_sink_t* s, const char* topic,
+                            const void* payload, int len);
+
+/* Publie DDEATH + NDEATH (si une session est née) ; ensuite sessions et
+ * commandes sont ignorées. */
+void sparkplug_sink_shutdown(sparkplug_sink_t* s);
+
+/* Libère le sink, une fois le client MQTT arrêté (ses callbacks l'appellent). */
+void sparkplug_sink_free(sparkplug_sink_t* s);
+
+/* gw_send_fn : encode `msg` en DBIRTH/DDATA et le passe à inner_send. */
+int  sparkplug_send_adapter(const gw_msg_t* msg, void* ctx);
+
+/* Encode le NDEATH (topic + payload avec le bdSeq de la prochaine connexion)
+ * pour l'enregistrer comme will. */
+int  sparkplug_encode_ndeath(sparkplug_sink_t* s,
+                             char* topic, size_t topic_sz,
+                             uint8_t* out, size_t cap, size_t* out_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include "spi_bus.h"
+#include "rt_sched.h"
+#include "log.h"
+
+struct spi_bus {
+    char key[64];                      // "/dev/spidev0" : device sans ".<CS>"
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;                // CLOCK_MONOTONIC : attente d'échéance + attache/détache
+    pthread_t thread;
+    bool running;
+    spi_runtime_t* devs[SPI_BUS_MAX_DEVS];
+    size_t ndev;
+    spi_runtime_t* active;             // device dont le tick est en cours (hors mu)
+    uint64_t busy_ns;
+    struct timespec started;
+    struct spi_bus* next;
+};
+
+static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+static struct spi_bus* g_buses;
+
+static int64_t ts_diff_ns(const struct timespec* a, const struct timespec* b){
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+// Fin d'échéance du tick courant (next + tick) : clé EDF
+static struct timespec deadline_of(const spi_runtime_t* rt){
+    struct timespec d = rt->next;
+    uint64_t ns = (uint64_t)d.tv_nsec + rt->prog.tick_ns;
+    d.tv_sec += (time_t)(ns / 1000000000ULL);
+    d.tv_nsec = (long)(ns % 1000000000ULL);
+    return d;
+}
+
+// a passe avant b ?
+static bool runs_before(const spi_runtime_t* a, const spi_runtime_t* b){
+    if (a->priority != b->priority) return a->priority > b->priority;
+    struct timespec da = deadline_of(a), db = deadline_of(b);
+    return ts_diff_ns(&da, &db) < 0;
+}
+
+static bool bus_has(const struct spi_bus* b, const spi_runtime_t* rt){
+    for (size_t i = 0; i < b->ndev; ++i) if (b->devs[i] == rt) return true;
+    return false;
+}
+
+static void* spi_bus_thread(void* arg){
+    struct spi_bus* b = (struct spi_bus*)arg;
+    const char* base = strrchr(b->key, '/');
+    char name[80];                      // tronqué à 15 caractères par rt_sched_thread_enter
+    snprintf(name, sizeof(name), "iotgw-%s", base ? base + 1 : b->key);
+
+    pthread_mutex_lock(&b->mu);
+    rt_sched_thread_enter(b->ndev ? b->devs[0]->realtime : NULL, name);
+
+    while (b->running) {
+        if (b->ndev == 0) { pthread_cond_wait(&b->cv, &b->mu); continue; }
+
+        struct timespec wake = b->devs[0]->next, now;
+        for (size_t i = 1; i < b->ndev; ++i)
+            if (ts_diff_ns(&b->devs[i]->next, &wake) < 0) wake = b->devs[i]->next;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (ts_diff_ns(&wake, &now) > 0) {
+            // réveillé avant l'échéance (attache/détache/arrêt) : on recalcule
+            if (pthread_cond_timedwait(&b->cv, &b->mu, &wake) != ETIMEDOUT) continue;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        }
+
+        // devices échus, triés priorité puis EDF (insertion, N petit)
+        spi_runtime_t* due[SPI_BUS_MAX_DEVS];
+        size_t nd = 0;
+        for (size_t i = 0; i < b->ndev; ++i) {
+            spi_runtime_t* d = b->devs[i];
+            if (ts_diff_ns(&now, &d->next) < 0) continue;
+            size_t k = nd++;
+            while (k > 0 && runs_before(d, due[k - 1])) { due[k] = due[k - 1]; --k; }
+            due[k] = d;
+        }
+
+        for (size_t i = 0; i < nd && b->running; ++i) {
+            spi_runtime_t* d = due[i];
+            if (!bus_has(b, d)) continue;          // détaché pendant un tick précédent
+            b->active = d;
+            pthread_mutex_unlock(&b->mu);
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            uint64_t busy = spi_poll_due(d, &now);
+
+            pthread_mutex_lock(&b->mu);
+            b->active = NULL;
+            d->busy_ns += busy;
+            b->busy_ns += busy;
+            pthread_cond_broadcast(&b->cv);        // spi_bus_detach() en attente
+        }
+    }
+    pthread_mutex_unlock(&b->mu);
+    return NULL;
+}
+
+static void bus_key(const char* dev, char* key, size_t n){
+    snprintf(key, n, "%s", dev ? dev : "?");
+    char* dot = strrchr(key, '.');
+    if (dot && dot > strrchr(key, '/')) *dot = '\0';
+}
+
+int spi_bus_attach(spi_runtime_t* rt)
+{
+    if (!rt || rt->prog.tick_ns == 0) return -1;
+    char key[64];
+    bus_key(rt->cfg.device, key, sizeof(key));
+
+    pthread_mutex_lock(&g_mu);
+    struct spi_bus* b = g_buses;
+    while (b && strcmp(b->key, key) != 0) b = b->next;
+
+    if (!b) {
+        b = (struct spi_bus*)calloc(1, sizeof(*b));
+        if (!b) { pthread_mutex_unlock(&g_mu); return -1; }
+        snprintf(b->key, sizeof(b->key), "%s", key);
+        pthread_condattr_t ca;
+        pthread_condattr_init(&ca);
+        pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+        pthread_cond_init(&b->cv, &ca);
+        pthread_condattr_destroy(&ca);
+        pthread_mutexattr_t ma;
+        pthread_mutexattr_init(&ma);
+        pthread_mutexattr_setprotocol(&ma, PTHREAD_PRIO_INHERIT);
+        pthread_mutex_init(&b->mu, &ma);
+        pthread_mutexattr_destroy(&ma);
+        clock_gettime(CLOCK_MONOTONIC, &b->started);
+
+        // premier device attaché avant le démarrage : le thread lit son realtime
+        b->devs[b->ndev++] = rt;
+        clock_gettime(CLOCK_MONOTONIC, &rt->next);
+        rt->attached = rt->next;
+        rt->busy_ns = 0;
+        rt->bus = b;
+        b->running = true;
+        if (pthread_create(&b->thread, NULL, spi_bus_thread, b) != 0) {
+            perror("pthread_create(spi_bus_thread)");
+            pthread_cond_destroy(&b->cv);
+            pthread_mutex_destroy(&b->mu);
+            free(b);
+            rt->bus = NULL;
+            pthread_mutex_unlock(&g_mu);
+            return -1;
+        }
+        b->next = g_buses;
+        g_buses = b;
+        pthread_mutex_unlock(&g_mu);
+        return 0;
+    }
+
+    pthread_mutex_lock(&b->mu);
+    if (b->ndev == SPI_BUS_MAX_DEVS) {
+        pthread_mutex_unlock(&b->mu);
+        pthread_mutex_unlock(&g_mu);
+        log_err("spi bus %s: more than %d devices", key, SPI_BUS_MAX_DEVS);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &rt->next);
+    rt->attached = rt->next;
+    rt->busy_ns = 0;
+    rt->bus = b;
+    b->devs[b->ndev++] = rt;
+    pthread_cond_broadcast(&b->cv);
+    pthread_mutex_unlock(&b->mu);
+    pthread_mutex_unlock(&g_mu);
+    return 0;
+}
+
+void spi_bus_detach(spi_runtime_t* rt)
+{
+    if (!rt || !rt->bus) return;
+    struct spi_bus* b = rt->bus;
+
+    pthread_mutex_lock(&g_mu);
+    pthread_mutex_lock(&b->mu);
+    for (size_t i = 0; i < b->ndev; ++i) {
+        if (b->devs[i] != rt) continue;
+        b->devs[i] = b->devs[--b->ndev];
+        break;
+    }
+    while (b->active == rt) pthread_cond_wait(&b->cv, &b->mu);
+    bool last = (b->ndev == 0);
+    if (last) b->running = false;
+    pthread_cond_broadcast(&b->cv);
+    pthread_mutex_unlock(&b->mu);
+    rt->bus = NULL;
+
+    if (last) {
+        pthread_join(b->thread, NULL);
+        for (struct spi_bus** pp = &g_buses; *pp; pp = &(*pp)->next)
+            if (*pp == b) { *pp = b->next; break; }
+        pthread_cond_destroy(&b->cv);
+        pthread_mutex_destroy(&b->mu);
+        free(b);
+    }
+    pthread_mutex_unlock(&g_mu);
+}
+
+void spi_bus_log_stats(spi_runtime_t* rt, const char* tag)
+{
+    if (!rt || !rt->bus) return;
+    struct spi_bus* b = rt->bus;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&b->mu);
+    double dev_win = (double)ts_diff_ns(&now, &rt->attached);
+    double bus_win = (double)ts_diff_ns(&now, &b->started);
+    double dev_busy = (double)rt->busy_ns, bus_busy = (double)b->busy_ns;
+    size_t ndev = b->ndev;
+    pthread_mutex_unlock(&b->mu);
+
+    log_info("[%s] spi bus %s: prio=%d util=%.2f%% (bus total %.2f%%, %zu device(s))",
+             tag ? tag : "spi", b->key, rt->priority,
+             dev_win > 0 ? 100.0 * dev_busy / dev_win : 0.0,
+             bus_win > 0 ? 100.0 * bus_busy / bus_win : 0.0, ndev);
+}
@@ -0,0 +1,37 @@
+#pragma once
+/**
+ * @file spi_bus.h
+ * @brief Scheduler par contrôleur SPI : un seul thread possède tous les CS d'un
+ *        bus (/dev/spidevB.*) et entrelace leurs programmes de transactions.
+ *
+ * Chaque device garde sa grille d'échéances absolues (spi_runtime_t.next, tick
+ * = PGCD de ses périodes). Le thread du bus dort jusqu'à l'échéance la plus
+ * proche puis exécute les devices échus, dans l'ordre :
+ *   1. params.priority décroissante,
+ *   2. échéance de fin (next + tick) la plus proche (EDF).
+ * Le noyau ne voit donc jamais deux CS du même bus en concurrence et l'ordre
+ * d'accès est déterministe. Le temps de bus de chaque device est cumulé pour
+ * le rapport d'utilisation.
+ */
+#include "conn_spi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_BUS_MAX_DEVS 16
+
+/* Attache un device (programme compilé, tick planifié) au scheduler de son bus ;
+ * démarre le thread au premier device. Premier tick immédiat. Retour 0 = OK. */
+int  spi_bus_attach(spi_runtime_t* rt);
+
+/* Détache le device (attend la fin de son tick en cours) ; le thread s'arrête
+ * avec le dernier device du bus. */
+void spi_bus_detach(spi_runtime_t* rt);
+
+/* Utilisation du bus par ce device et au total depuis l'attache */
+void spi_bus_log_stats(spi_runtime_t* rt, const char* tag);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,350 @@
+// ================================
+// File: uart_codec.c
+// ================================
+#include "uart_codec.h"
+#include "conn_uart.h"
+#include "crc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+static const char* const g_names[] = { "delim", "slip", "cobs", "length", "gap" };
+
+const char* uart_codec_name(uart_codec_kind_t k) {
+    return (unsigned)k < sizeof(g_names) / sizeof(g_names[0]) ? g_names[k] : "?";
+}
+
+int uart_codec_init(uart_codec_t* c, const uart_params_t* cfg,
+                    uart_codec_emit_cb emit, void* user) {
+    if (!c || !cfg) return UART_ERR_ARG;
+    memset(c, 0, sizeof(*c));
+    const uart_packet_t* pk = &cfg->packet;
+    c->kind = cfg->has_packet ? pk->codec : UART_CODEC_DELIM;
+    c->crc = cfg->has_packet ? pk->crc : UART_CRC_NONE;
+    c->crc_len = c->crc == UART_CRC_NONE ? 0 : (c->crc == UART_CRC32 ? 4 : 2);
+    c->emit = emit;
+    c->user = user;
+
+    // 1 start + data + parité + stop (1,5 compté 2), arrondi par excès
+    int bits = 1 + (cfg->bytesize_set ? cfg->bytesize : 8)
+                 + ((cfg->parity_set && cfg->parity != 'N') ? 1 : 0)
+                 + ((cfg->stopbits_set && cfg->stopbits > 1.0) ? 2 : 1);
+    int baud = cfg->baudrate > 0 ? cfg->baudrate : 9600;
+    c->char_ns = ((uint64_t)bits * 1000000000ULL + (uint64_t)baud - 1) / (uint64_t)baud;
+
+    if (c->kind == UART_CODEC_DELIM) return UART_OK;   // découpage : uart_framer
+
+    c->max = (pk->length_set && pk->length > 0) ? (size_t)pk->length : UART_CODEC_DEFAULT_MAX;
+    if (c->kind == UART_CODEC_LENGTH) {
+        c->len_size = pk->len_size ? (size_t)pk->len_size : 1;
+        if (c->len_size != 1 && c->len_size != 2 && c->len_size != 4) return UART_ERR_PACKET_CFG;
+        if (pk->len_offset < 0) return UART_ERR_PACKET_CFG;
+        c->len_offset = (size_t)pk->len_offset;
+        c->len_le = pk->len_le;
+        c->len_adjust = pk->len_adjust;
+        if (c->len_offset + c->len_size + c->crc_len > c->max) return UART_ERR_PACKET_CFG;
+    }
+    if (c->kind == UART_CODEC_GAP) {
+        if (pk->gap_us > 0)          c->gap_ns = (uint64_t)pk->gap_us * 1000ULL;
+        else if (baud > 19200)       c->gap_ns = 1750000ULL;          // valeur fixe Modbus au-delà de 19200
+        else                         c->gap_ns = c->char_ns * 7 / 2;  // t3.5
+    }
+    c->buf = (uint8_t*)malloc(c->max);
+    return c->buf ? UART_OK : UART_ERR_ARG;
+}
+
+void uart_codec_free(uart_codec_t* c) {
+    if (!c) return;
+    free(c->buf);
+    memset(c, 0, sizeof(*c));
+}
+
+// ---- CRC ----
+static void put_crc(const uart_codec_t* c, const uint8_t* p, size_t n, uint8_t* out) {
+    switch (c->crc) {
+    case UART_CRC16_MODBUS: { uint16_t v = crc16_modbus(p, n);
+        out[0] = (uint8_t)v; out[1] = (uint8_t)(v >> 8); break; }
+    case UART_CRC16_CCITT:  { uint16_t v = crc16_ccitt(p, n);
+        out[0] = (uint8_t)(v >> 8); out[1] = (uint8_t)v; break; }
+    case UART_CRC32:        { uint32_t v = crc32_ieee(p, n);
+        out[0] = (uint8_t)v; out[1] = (uint8_t)(v >> 8);
+        out[2] = (uint8_t)(v >> 16); out[3] = (uint8_t)(v >> 24); break; }
+    default: break;
+    }
+}
+
+void uart_codec_frame(uart_codec_t* c, const uint8_t* frame, size_t n) {
+    if (!c || !n) return;
+    if (c->crc_len) {
+        uint8_t want[4];
+        if (n <= c->crc_len) { c->crc_errors++; return; }
+        n -= c->crc_len;
+        put_crc(c, frame, n, want);
+        if (memcmp(want, frame + n, c->crc_len) != 0) { c->crc_errors++; return; }
+    }
+    c->frames++;
+    if (c->emit) c->emit(frame, n, c->user);
+}
+
+// ---- trame en cours ----
+static void drop(uart_codec_t* c) {
+    c->discarded_bytes += c->len;
+    c->len = 0;
+    c->discard = true;
+}
+
+static void append(uart_codec_t* c, const uint8_t* d, size_t k) {
+    if (!k) return;
+    if (c->discard) { c->discarded_bytes += k; return; }
+    if (c->len + k > c->max) {
+        c->overflows++;
+        c->discarded_bytes += k;
+        drop(c);
+        return;
+    }
+    memcpy(c->buf + c->len, d, k);
+    c->len += k;
+}
+
+// Frontière de trame : rend la trame en cours (sauf si invalide) et repart à zéro
+static void finish(uart_codec_t* c) {
+    size_t n = c->len;
+    bool bad = c->discard;
+    c->len = 0;
+    c->discard = false;
+    if (!bad) uart_codec_frame(c, c->buf, n);
+}
+
+// ---- décodeurs ----
+static void slip_decode(uart_codec_t* c, const uint8_t* d, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        if (c->esc) {
+            uint8_t b = d[i++];
+            c->esc = false;
+            if (b == SLIP_ESC_END)      { uint8_t v = SLIP_END; append(c, &v, 1); }
+            else if (b == SLIP_ESC_ESC) { uint8_t v = SLIP_ESC; append(c, &v, 1); }
+            else {
+                drop(c);                            // séquence d'échappement invalide
+                if (b == SLIP_END) finish(c);       // ... qui termine aussi la trame
+            }
+            continue;
+        }
+        size_t j = i;
+        while (j < n && d[j] != SLIP_END && d[j] != SLIP_ESC) ++j;
+        append(c, d + i, j - i);
+        if (j == n) break;
+        if (d[j] == SLIP_END) finish(c);
+        else                  c->esc = true;
+        i = j + 1;
+    }
+}
+
+static void cobs_decode(uart_codec_t* c, const uint8_t* d, size_t n) {
+    static const uint8_t zero = 0;
+    size_t i = 0;
+    while (i < n) {
+        const uint8_t* z = (const uint8_t*)memchr(d + i, 0, n - i);
+        size_t end = z ? (size_t)(z - d) : n;
+        while (i < end) {
+            if (c->cobs_left == 0) {              // octet de code
+                if (c->cobs_zero) append(c, &zero, 1);
+                uint8_t code = d[i++];
+                c->cobs_left = (size_t)code - 1;
+                c->cobs_zero = code != 0xFF;
+                continue;
+            }
+            size_t k = end - i;
+            if (k > c->cobs_left) k = c->cobs_left;
+            append(c, d + i, k);
+            i += k;
+            c->cobs_left -= k;
+        }
+        if (!z) break;
+        if (c->cobs_left) drop(c);                // bloc tronqué par le délimiteur
+        finish(c);
+        c->cobs_left = 0;
+        c->cobs_zero = false;
+        i = end + 1;
+    }
+}
+
+static uint64_t read_len_field(const uart_codec_t* c) {
+    const uint8_t* p = c->buf + c->len_offset;
+    uint64_t v = 0;
+    for (size_t k = 0; k < c->len_size; ++k) {
+        size_t at = c->len_le ? c->len_size - 1 - k : k;
+        v = (v << 8) | p[at];
+    }
+    return v;
+}
+
+/* Trame length complète : CRC vérifié sur toute la trame, puis champ longueur
+ * retiré. Rendu [len_offset octets][données], la forme que prend
+ * uart_codec_encode() : une trame décodée se ré-encode à l'identique. */
+static void length_finish(uart_codec_t* c) {
+    size_t hdr = c->len_offset + c->len_size;
+    size_t n = c->len;
+    c->len = 0;
+    if (c->crc_len) {
+        uint8_t want[4];
+        if (n < hdr + c->crc_len) { c->crc_errors++; return; }
+        n -= c->crc_len;
+        put_crc(c, c->buf, n, want);
+        if (memcmp(want, c->buf + n, c->crc_len) != 0) { c->crc_errors++; return; }
+    }
+    memmove(c->buf + c->len_offset, c->buf + hdr, n - hdr);
+    n -= c->len_size;
+    c->frames++;
+    if (n && c->emit) c->emit(c->buf, n, c->user);
+}
+
+static void length_decode(uart_codec_t* c, const uint8_t* d, size_t n) {
+    size_t hdr = c->len_offset + c->len_size;
+    size_t i = 0;
+    while (i < n) {
+        if (!c->need) {
+            size_t k = hdr - c->len;
+            if (k > n - i) k = n - i;
+            memcpy(c->buf + c->len, d + i, k);
+            c->len += k;
+            i += k;
+            if (c->len < hdr) break;
+            int64_t total = (int64_t)hdr + (int64_t)read_len_field(c) + c->len_adjust;
+            if (total < (int64_t)hdr || total > (int64_t)c->max) {
+                // en-tête incohérent : on glisse d'un octet
+                c->overflows++;
+                c->discarded_bytes++;
+                memmove(c->buf, c->buf + 1, --c->len);
+                continue;
+            }
+            c->need = (size_t)total;
+        }
+        size_t k = c->need - c->len;
+        if (k > n - i) k = n - i;
+        memcpy(c->buf + c->len, d + i, k);
+        c->len += k;
+        i += k;
+        if (c->len == c->need) {
+            c->need = 0;
+            length_finish(c);
+        }
+    }
+}
+
+static void gap_decode(uart_codec_t* c, const uint8_t* d, size_t n, uint64_t now_ns) {
+    // silence depuis le read() précédent : la trame en cours est terminée
+    if ((c->len || c->discard) && now_ns - c->last_ns >= c->gap_ns) finish(c);
+    append(c, d, n);
+    c->last_ns = now_ns;
+}
+
+void uart_codec_decode(uart_codec_t* c, const uint8_t* data, size_t n, uint64_t now_ns) {
+    if (!c || !c->buf || !data || !n) return;
+    switch (c->kind) {
+    case UART_CODEC_SLIP:   slip_decode(c, data, n); break;
+    case UART_CODEC_COBS:   cobs_decode(c, data, n); break;
+    case UART_CODEC_LENGTH: length_decode(c, data, n); break;
+    case UART_CODEC_GAP:    gap_decode(c, data, n, now_ns); break;
+    default: break;
+    }
+}
+
+int64_t uart_codec_timeout_ns(const uart_codec_t* c, uint64_t now_ns) {
+    if (!c || c->kind != UART_CODEC_GAP || (!c->len && !c->discard)) return -1;
+    uint64_t due = c->last_ns + c->gap_ns;
+    return now_ns >= due ? 0 : (int64_t)(due - now_ns);
+}
+
+void uart_codec_expire(uart_codec_t* c, uint64_t now_ns) {
+    if (uart_codec_timeout_ns(c, now_ns) == 0) finish(c);
+}
+
+// ---- encodeurs ----
+size_t uart_codec_encoded_max(const uart_codec_t* c, size_t n) {
+    size_t m = n + c->crc_len;
+    switch (c->kind) {
+    case UART_CODEC_SLIP:   return 2 * m + 2;
+    case UART_CODEC_COBS:   return m + m / 254 + 3;
+    case UART_CODEC_LENGTH: return m + c->len_size;
+    default:                return m;
+    }
+}
+
+static size_t slip_put(const uint8_t* in, size_t n, uint8_t* out) {
+    size_t o = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (in[i] == SLIP_END)      { out[o++] = SLIP_ESC; out[o++] = SLIP_ESC_END; }
+        else if (in[i] == SLIP_ESC) { out[o++] = SLIP_ESC; out[o++] = SLIP_ESC_ESC; }
+        else                        out[o++] = in[i];
+    }
+    return o;
+}
+
+// COBS sur deux segments (payload puis CRC) vus comme un seul flux
+static size_t cobs_put(const uint8_t* a, size_t na, const uint8_t* b, size_t nb, uint8_t* out) {
+    size_t code_at = 0, o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < na + nb; ++i) {
+        uint8_t v = i < na ? a[i] : b[i - na];
+        if (v) {
+            out[o++] = v;
+            if (++code != 0xFF) continue;
+        }
+        out[code_at] = code;
+        code_at = o++;
+        code = 1;
+    }
+    out[code_at] = code;
+    out[o++] = 0x00;
+    return o;
+}
+
+size_t uart_codec_encode(const uart_codec_t* c, const uint8_t* in, size_t n, uint8_t* out) {
+    if (!c || (!in && n)) return 0;
+    uint8_t crc[4];
+    size_t o = 0;
+
+    switch (c->kind) {
+    case UART_CODEC_SLIP:
+        if (c->crc_len) put_crc(c, in, n, crc);
+        out[o++] = SLIP_END;                     // vide le bruit éventuel côté récepteur
+        o += slip_put(in, n, out + o);
+        o += slip_put(crc, c->crc_len, out + o);
+        out[o++] = SLIP_END;
+        return o;
+
+    case UART_CODEC_COBS:
+        if (c->crc_len) put_crc(c, in, n, crc);
+        out[0] = 0x00;                           // idem : délimiteur en tête
+        return 1 + cobs_put(in, n, crc, c->crc_len, out + 1);
+
+    case UART_CODEC_LENGTH: {
+        // le payload fournit les len_offset premiers octets d'en-tête ; le champ est inséré après
+        if (n < c->len_offset) return 0;
+        int64_t v = (int64_t)(n - c->len_offset + c->crc_len) - c->len_adjust;
+        if (v < 0 || (c->len_size < 8 && (uint64_t)v >> (8 * c->len_size))) return 0;
+        if (c->len_offset + c->len_size + (n - c->len_offset) + c->crc_len > c->max) return 0;
+        memcpy(out, in, c->len_offset);
+        o = c->len_offset;
+        for (size_t k = 0; k < c->len_size; ++k) {
+            size_t sh = c->len_le ? k : c->len_size - 1 - k;
+            out[o++] = (uint8_t)((uint64_t)v >> (8 * sh));
+        }
+        memcpy(out + o, in + c->len_offset, n - c->len_offset);
+        o += n - c->len_offset;
+        if (c->crc_len) put_crc(c, out, o, out + o);
+        return o + c->crc_len;
+    }
+
+    default:                                     // delim (délimiteurs ajoutés par l'appelant), gap
+        memcpy(out, in, n);
+        if (c->crc_len) put_crc(c, in, n, out + n);
+        return n + c->crc_len;
+    }
+}
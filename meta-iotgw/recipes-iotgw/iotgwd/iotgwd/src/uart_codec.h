@@ -0,0 +1,104 @@
+// ================================
+// File: uart_codec.h
+// ================================
+#ifndef UART_CODEC_H
+#define UART_CODEC_H
+
+/*
+ * Codecs de trames UART (params.packet.codec) : delim, slip, cobs, length, gap.
+ *
+ * Décodage incrémental : uart_codec_decode() prend tout un buffer de read()
+ * en une passe (les portions sans octet spécial sont copiées d'un bloc,
+ * memchr pour le 0x00 de COBS) et appelle emit pour chaque trame complète.
+ * Une trame peut s'étendre sur plusieurs appels ; l'état est conservé.
+ *
+ *   slip   : RFC 1055, END 0xC0 / ESC 0xDB (ESC_END 0xDC, ESC_ESC 0xDD)
+ *   cobs   : blocs [code][code-1 octets], trame terminée par 0x00
+ *   length : [len_offset octets][champ len_size octets BE/LE][valeur + len_adjust octets] ;
+ *            la trame rendue est [len_offset octets][données], sans le champ
+ *            longueur ni le CRC : c'est aussi l'entrée de l'encodage, qui
+ *            insère le champ. En-tête incohérent (longueur > length max) :
+ *            on glisse d'un octet et on relit l'en-tête.
+ *   gap    : une trame se termine après gap_us de silence (horodatage
+ *            CLOCK_MONOTONIC de chaque read() ; uart_codec_timeout_ns() donne
+ *            l'échéance à passer au poll, uart_codec_expire() la clôt)
+ *   delim  : le découpage reste à uart_framer, le codec ne fait que le CRC
+ *            (uart_codec_frame())
+ *
+ * CRC optionnel (packet.crc) : calculé sur toute la trame, en fin de trame ;
+ * vérifié puis retiré au décodage (trame rejetée et comptée si faux), ajouté
+ * à l'encodage.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "connectors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_CODEC_DEFAULT_MAX 2048
+
+// Trame décodée (sans CRC), valide pendant l'appel seulement
+typedef void (*uart_codec_emit_cb)(const uint8_t* frame, size_t len, void* user);
+
+typedef struct {
+    uart_codec_kind_t kind;
+    uart_crc_t crc;
+    size_t     crc_len;
+
+    uint8_t* buf;                   // trame en cours de décodage
+    size_t   len, max;
+    bool     discard;               // trame invalide : jeter jusqu'à la prochaine frontière
+
+    bool     esc;                   // slip : ESC reçu
+    size_t   cobs_left;             // cobs : octets restants du bloc courant
+    bool     cobs_zero;             // cobs : 0 implicite à insérer avant le prochain bloc
+
+    size_t   len_size, len_offset;  // length
+    bool     len_le;
+    long     len_adjust;
+    size_t   need;                  // length : taille totale de la trame courante, 0 = en-tête incomplet
+
+    uint64_t char_ns;               // durée d'un caractère à baudrate/format du port
+    uint64_t gap_ns;                // gap
+    uint64_t last_ns;               // horodatage du dernier read() reçu
+
+    uart_codec_emit_cb emit;
+    void* user;
+
+    unsigned long frames, crc_errors, overflows, discarded_bytes;
+} uart_codec_t;
+
+// Prépare le codec selon cfg->packet (et baudrate/format pour gap). emit peut
+// être NULL (port en écriture seule). Retour UART_OK ou UART_ERR_PACKET_CFG / UART_ERR_ARG.
+int  uart_codec_init(uart_codec_t* c, const uart_params_t* cfg,
+                     uart_codec_emit_cb emit, void* user);
+void uart_codec_free(uart_codec_t* c);
+
+// Décode n octets reçus à now_ns (CLOCK_MONOTONIC). Codecs slip/cobs/length/gap.
+void uart_codec_decode(uart_codec_t* c, const uint8_t* data, size_t n, uint64_t now_ns);
+
+// Trame déjà découpée (codec delim) : vérifie/retire le CRC puis emit
+void uart_codec_frame(uart_codec_t* c, const uint8_t* frame, size_t n);
+
+// gap : ns restants avant la clôture de la trame en cours, -1 si rien en attente
+int64_t uart_codec_timeout_ns(const uart_codec_t* c, uint64_t now_ns);
+// gap : clôt la trame en cours si le silence a duré gap_ns
+void uart_codec_expire(uart_codec_t* c, uint64_t now_ns);
+
+// Taille max encodée de n octets de payload (délimiteurs delim exclus)
+size_t uart_codec_encoded_max(const uart_codec_t* c, size_t n);
+// Encode in -> out (out >= uart_codec_encoded_max()). Retour : octets écrits,
+// 0 si le payload ne peut pas être encodé (length : trop court/long pour l'en-tête).
+size_t uart_codec_encode(const uart_codec_t* c, const uint8_t* in, size_t n, uint8_t* out);
+
+const char* uart_codec_name(uart_codec_kind_t k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_CODEC_H
@@ -0,0 +1,189 @@
+// ================================
+// File: uart_framer.c
+// ================================
+#define _GNU_SOURCE
+#include "uart_framer.h"
+#include "conn_uart.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+static int load_delim(const char* hex, uint8_t* buf, size_t* len_io) {
+    if (!hex) { *len_io = 0; return UART_OK; }
+    int n = uart_parse_hex(hex, buf, *len_io);
+    if (n < 0) return n;
+    *len_io = (size_t)n;
+    return UART_OK;
+}
+
+int uart_framer_init(uart_framer_t* f, const uart_packet_t* pkt, size_t cap) {
+    if (!f || !pkt) return UART_ERR_ARG;
+    memset(f, 0, sizeof(*f));
+
+    f->start_len = sizeof(f->start);
+    f->end_len   = sizeof(f->end);
+    if (load_delim(pkt->start, f->start, &f->start_len) < 0) return UART_ERR_PACKET_CFG;
+    if (load_delim(pkt->end, f->end, &f->end_len) < 0)       return UART_ERR_PACKET_CFG;
+    f->length = (pkt->length_set && pkt->length > 0) ? (size_t)pkt->length : 0;
+    // Il faut au moins un délimiteur de fin ou une longueur fixe
+    if (!f->end_len && !f->length) return UART_ERR_PACKET_CFG;
+
+    if (cap == 0) cap = UART_FRAMER_DEFAULT_CAP;
+    size_t need = f->start_len + f->length + f->end_len;
+    if (cap < 2 * need) cap = 2 * need;   // une trame max + la suivante en cours
+    f->buf = (uint8_t*)malloc(cap);
+    if (!f->buf) return UART_ERR_ARG;
+    f->cap = cap;
+    return UART_OK;
+}
+
+void uart_framer_free(uart_framer_t* f) {
+    if (!f) return;
+    free(f->buf);
+    memset(f, 0, sizeof(*f));
+}
+
+void uart_framer_reset(uart_framer_t* f) {
+    if (!f) return;
+    f->discarded_bytes += f->tail - f->head;
+    f->head = f->tail = f->scan = 0;
+    f->in_frame = false;
+    f->resync = false;
+}
+
+static void compact(uart_framer_t* f) {
+    if (f->head == 0) return;
+    size_t n = f->tail - f->head;
+    if (n) memmove(f->buf, f->buf + f->head, n);
+    f->scan = f->scan > f->head ? f->scan - f->head : 0;
+    f->tail = n;
+    f->head = 0;
+}
+
+/* Trame trop longue (length dépassé ou buffer plein sans fin) : on l'abandonne.
+ * Avec start, on repart à la recherche d'un start dans ce qui suit ; sans start,
+ * on jette jusqu'au prochain end (resync) pour ne pas émettre une fin de trame. */
+static void drop_overlong(uart_framer_t* f) {
+    f->overflows++;
+    size_t keep = f->end_len ? f->end_len - 1 : 0;
+    size_t avail = f->tail - f->head;
+    if (f->start_len) {
+        f->in_frame = false;
+        return;
+    }
+    size_t drop = avail > keep ? avail - keep : 0;
+    f->discarded_bytes += drop;
+    f->head += drop;
+    f->scan = f->head;
+    f->resync = true;      // sans start : la trame suivante commence après le prochain end
+}
+
+static bool need_room(uart_framer_t* f) {
+    // Compacte quand moins d'un quart du buffer est libre en fin
+    if (f->cap - f->tail < f->cap / 4) compact(f);
+    if (f->tail < f->cap) return true;
+    // Plein sans trame complète : on jette tout sauf un délimiteur potentiellement coupé
+    if (f->in_frame) {
+        f->overflows++;
+        f->in_frame = false;
+        if (!f->start_len) f->resync = true;
+    }
+    size_t keep = f->start_len ? f->start_len - 1 : (f->end_len ? f->end_len - 1 : 0);
+    f->discarded_bytes += f->tail - f->head - keep;
+    f->head = f->tail - keep;
+    compact(f);
+    return f->tail < f->cap;
+}
+
+ssize_t uart_framer_fill(uart_framer_t* f, int fd) {
+    if (!f || !f->buf) { errno = EINVAL; return -1; }
+    if (!need_room(f)) { errno = ENOBUFS; return -1; }
+    for (;;) {
+        ssize_t n = read(fd, f->buf + f->tail, f->cap - f->tail);
+        if (n < 0 && errno == EINTR) continue;
+        if (n > 0) { f->tail += (size_t)n; f->reads++; }
+        return n;
+    }
+}
+
+size_t uart_framer_feed(uart_framer_t* f, const uint8_t* data, size_t n) {
+    size_t done = 0;
+    while (done < n && need_room(f)) {
+        size_t k = f->cap - f->tail;
+        if (k > n - done) k = n - done;
+        memcpy(f->buf + f->tail, data + done, k);
+        f->tail += k;
+        done += k;
+    }
+    return done;
+}
+
+static const uint8_t* find(const uint8_t* hay, size_t n, const uint8_t* pat, size_t m) {
+    if (n < m) return NULL;
+    if (m == 1) return (const uint8_t*)memchr(hay, pat[0], n);
+    return (const uint8_t*)memmem(hay, n, pat, m);
+}
+
+int uart_framer_next(uart_framer_t* f, const uint8_t** frame, size_t* len) {
+    if (!f || !f->buf || !frame || !len) return 0;
+    for (;;) {
+        if (!f->in_frame) {
+            if (f->start_len) {
+                size_t avail = f->tail - f->head;
+                const uint8_t* p = find(f->buf + f->head, avail, f->start, f->start_len);
+                if (!p) {
+                    // garde un éventuel début de start coupé en fin de buffer
+                    size_t keep = f->start_len - 1;
+                    if (avail > keep) {
+                        f->discarded_bytes += avail - keep;
+                        f->head = f->tail - keep;
+                    }
+                    return 0;
+                }
+                f->discarded_bytes += (size_t)(p - (f->buf + f->head));
+                f->head = (size_t)(p - f->buf) + f->start_len;
+            }
+            f->in_frame = true;
+            f->scan = f->head;
+        }
+
+        size_t avail = f->tail - f->head;
+        if (!f->end_len) {
+            if (avail < f->length) return 0;
+            *frame = f->buf + f->head;
+            *len = f->length;
+            f->head += f->length;
+            f->in_frame = false;
+            f->frames++;
+            return 1;
+        }
+
+        // Reprise là où la recherche précédente s'est arrêtée (pas de re-scan)
+        if (f->scan < f->head) f->scan = f->head;
+        const uint8_t* q = find(f->buf + f->scan, f->tail - f->scan, f->end, f->end_len);
+        if (!q) {
+            size_t keep = f->end_len - 1;
+            f->scan = f->tail - f->head > keep ? f->tail - keep : f->head;
+            if (f->length && avail > f->length + keep) { drop_overlong(f); continue; }
+            return 0;
+        }
+        size_t plen = (size_t)(q - (f->buf + f->head));
+        size_t next = (size_t)(q - f->buf) + f->end_len;
+        if (f->resync || (f->length && plen > f->length)) {
+            if (!f->resync) f->overflows++;
+            f->resync = false;
+            f->discarded_bytes += next - f->head;
+            f->head = next;
+            f->in_frame = false;
+            continue;
+        }
+        *frame = f->buf + f->head;
+        *len = plen;
+        f->head = next;
+        f->in_frame = false;
+        f->frames++;
+        return 1;
+    }
+}
@@ -0,0 +1,73 @@
+// ================================
+// File: uart_framer.h
+// ================================
+#ifndef UART_FRAMER_H
+#define UART_FRAMER_H
+
+/*
+ * Réception UART bufferisée + découpage en trames (params.packet).
+ *
+ * Le buffer de réception est rempli par de gros read() (tout ce que le driver
+ * a en stock) ; les délimiteurs sont cherchés par memchr/memmem (vectorisés
+ * par la libc) sur des octets contigus, jamais octet par octet. Les octets
+ * reçus après une trame restent dans le buffer pour la suivante.
+ *
+ * Le buffer est linéaire et compacté (un memmove par remplissage, pas par
+ * octet) : une trame est toujours contiguë et rendue sans copie.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "connectors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_FRAMER_DELIM_MAX 32
+#define UART_FRAMER_DEFAULT_CAP 8192
+
+typedef struct {
+    uint8_t* buf;
+    size_t   cap;
+    size_t   head;            // début des octets non consommés
+    size_t   tail;            // fin des octets reçus
+    size_t   scan;            // position de reprise de la recherche du délimiteur de fin
+
+    uint8_t  start[UART_FRAMER_DELIM_MAX];
+    size_t   start_len;
+    uint8_t  end[UART_FRAMER_DELIM_MAX];
+    size_t   end_len;
+    size_t   length;          // longueur fixe (sans end) ou maximum (avec end), 0 = aucune
+    bool     in_frame;        // start trouvé, head = début du payload
+    bool     resync;          // sans start, après une trame trop longue : jeter jusqu'au prochain end
+
+    unsigned long frames, discarded_bytes, overflows, reads;
+} uart_framer_t;
+
+// Prépare le découpage selon pkt (start/end/length). cap = 0 => défaut.
+// Retour UART_OK ou UART_ERR_PACKET_CFG / UART_ERR_ARG.
+int  uart_framer_init(uart_framer_t* f, const uart_packet_t* pkt, size_t cap);
+void uart_framer_free(uart_framer_t* f);
+
+// Oublie la trame en cours (réouverture du port) ; octets comptés dans discarded_bytes.
+void uart_framer_reset(uart_framer_t* f);
+
+// Un read() de tout l'espace libre. Retour : octets lus, 0 (EOF/timeout VTIME),
+// <0 erreur (errno ; EAGAIN si fd non bloquant sans données).
+ssize_t uart_framer_fill(uart_framer_t* f, int fd);
+
+// Ajoute des octets déjà reçus (autre source, tests). Retour : octets pris.
+size_t uart_framer_feed(uart_framer_t* f, const uint8_t* data, size_t n);
+
+// Extrait la prochaine trame complète. Retour 1 (trame, *frame valide jusqu'au
+// prochain appel fill/feed/next) ou 0 (il faut plus d'octets).
+int  uart_framer_next(uart_framer_t* f, const uint8_t** frame, size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_FRAMER_H
@@ -0,0 +1,435 @@
+// ================================
+// File: uart_port.c
+// ================================
+#define _GNU_SOURCE
+#include "uart_port.h"
+#include "conn_uart.h"
+#include "bridge.h"
+#include "rt_sched.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#define UART_RAW_READ 4096
+#define UART_REOPEN_MIN_MS 250
+#define UART_REOPEN_MAX_MS 30000
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void wake(uart_port_t* p) {
+    uint64_t one = 1;
+    ssize_t r = write(p->efd, &one, sizeof(one));
+    (void)r;
+}
+
+static int load_delim(const char* hex, uint8_t* buf, size_t* len_io) {
+    if (!hex) { *len_io = 0; return UART_OK; }
+    int n = uart_parse_hex(hex, buf, *len_io);
+    if (n < 0) return n;
+    *len_io = (size_t)n;
+    return UART_OK;
+}
+
+// Trame rendue par le codec (CRC vérifié et retiré)
+static void port_emit(const uint8_t* frame, size_t len, void* user) {
+    uart_port_t* p = (uart_port_t*)user;
+    p->rx_frames++;
+    rt_hot_leave();                 // transform/publication : hors chemin chaud du lecteur
+    p->on_rx(frame, len, p->rx_ts, p->user);
+    rt_hot_enter();
+}
+
+// ---- Réception : read() jusqu'à EAGAIN, toutes les trames du réveil ----
+static int uart_port_rx(uart_port_t* p) {
+    bool coded = p->codec.kind != UART_CODEC_DELIM;
+    for (;;) {
+        ssize_t n = p->framed ? uart_framer_fill(&p->framer, p->fd)
+                              : read(p->fd, p->raw, UART_RAW_READ);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if (n == 0) { errno = 0; return -1; }   // hangup (adaptateur USB retiré, ...)
+        p->rx_bytes += (unsigned long)n;
+        p->rx_ts = now_s();
+        if (coded) {
+            uart_codec_decode(&p->codec, p->raw, (size_t)n, mono_ns());
+            continue;
+        }
+        if (!p->framed) {
+            p->rx_frames++;
+            rt_hot_leave();
+            p->on_rx(p->raw, (size_t)n, p->rx_ts, p->user);
+            rt_hot_enter();
+            continue;
+        }
+        const uint8_t* frame;
+        size_t len;
+        while (uart_framer_next(&p->framer, &frame, &len))
+            uart_codec_frame(&p->codec, frame, len);
+    }
+}
+
+// ---- Émission : vide la file tant que le fd accepte (non bloquant) ----
+static void q_get(uart_port_t* p, uint8_t* d, size_t n) {
+    for (size_t i = 0; i < n; ++i) d[i] = p->q[(p->q_head + i) % p->q_cap];
+    p->q_head = (p->q_head + n) % p->q_cap;
+    p->q_len -= n;
+}
+
+// codec gap : ns à attendre avant la trame suivante (0 = prêt, -1 = rien en file). Sous qmu.
+static int64_t tx_wait_ns(const uart_port_t* p, uint64_t now) {
+    if (!p->q_len) return -1;
+    if (!p->tx_gap || p->tx_left || now >= p->tx_ready_ns) return 0;
+    return (int64_t)(p->tx_ready_ns - now);
+}
+
+// Retour -1 : erreur d'écriture autre que EAGAIN (errno), file vidée
+static int uart_port_tx(uart_port_t* p) {
+    int rc = 0;
+    pthread_mutex_lock(&p->qmu);
+    while (p->q_len) {
+        if (p->tx_gap && !p->tx_left) {
+            uint64_t now = mono_ns();
+            if (now < p->tx_ready_ns) break;       // silence inter-trames pas encore écoulé
+            uint32_t flen;
+            q_get(p, (uint8_t*)&flen, sizeof(flen));
+            p->tx_left = flen;
+            // fin de la trame sur la ligne (estimée) + gap
+            p->tx_ready_ns = now + (uint64_t)flen * p->codec.char_ns + p->codec.gap_ns;
+            if (!flen) continue;
+        }
+        size_t chunk = p->q_cap - p->q_head;
+        if (chunk > p->q_len) chunk = p->q_len;
+        if (p->tx_gap && chunk > p->tx_left) chunk = p->tx_left;
+        ssize_t n = write(p->fd, p->q + p->q_head, chunk);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                int e = errno;
+                p->tx_errors++;
+                log_warn("uart %s: write failed (%s), dropping %zu queued bytes",
+                         p->cfg->port, strerror(e), p->q_len);
+                p->q_head = p->q_len = 0;
+                p->tx_left = 0;
+                errno = e;
+                rc = -1;
+            }
+            break;
+        }
+        p->q_head = (p->q_head + (size_t)n) % p->q_cap;
+        p->q_len -= (size_t)n;
+        if (p->tx_gap) p->tx_left -= (size_t)n;
+        p->tx_bytes += (unsigned long)n;
+    }
+    pthread_mutex_unlock(&p->qmu);
+    return rc;
+}
+
+// ---- Perte du port (adaptateur USB retiré, EIO, POLLHUP/POLLERR) ----
+// Le fd est fermé : un fd en hangup reste signalé par poll() quels que soient
+// les events demandés. Seul le thread I/O touche p->fd. Une trame à moitié
+// écrite est perdue ; la file continue d'accepter des trames (jusqu'à q_cap).
+static void port_lost(uart_port_t* p, const char* what, int err) {
+    log_warn("uart %s: %s (%s), port closed, reopening every %d..%d ms",
+             p->cfg->port, what, err ? strerror(err) : "EOF",
+             UART_REOPEN_MIN_MS, UART_REOPEN_MAX_MS);
+    uart_close(p->fd);
+    p->fd = -1;
+    p->lost++;
+    pthread_mutex_lock(&p->qmu);
+    if (p->tx_left) {
+        // reste de la trame en cours : ne pas l'envoyer en tête du prochain fd
+        size_t k = p->tx_left < p->q_len ? p->tx_left : p->q_len;
+        p->q_head = (p->q_head + k) % p->q_cap;
+        p->q_len -= k;
+        p->tx_left = 0;
+    }
+    pthread_mutex_unlock(&p->qmu);
+}
+
+static int port_reopen(uart_port_t* p) {
+    int fd = -1;
+    if (uart_open(p->cfg, &fd) != UART_OK) return -1;
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) { uart_close(fd); return -1; }
+    if (p->framed) uart_framer_reset(&p->framer);   // trame interrompue par la perte
+    p->fd = fd;
+    p->reopens++;
+    log_info("uart %s: port reopened", p->cfg->port);
+    return 0;
+}
+
+static void* uart_io_thread(void* arg) {
+    uart_port_t* p = (uart_port_t*)arg;
+    rt_sched_thread_enter(p->on_rx ? p->realtime : NULL, "iotgw-uart");
+
+    const bool rx = p->on_rx != NULL;
+    int backoff_ms = UART_REOPEN_MIN_MS;
+    uint64_t reopen_ns = 0;
+    while (!p->stop) {
+        uint64_t now = mono_ns();
+
+        if (p->fd < 0) {
+            // port perdu : seul l'eventfd (arrêt) est surveillé jusqu'à la prochaine tentative
+            if (now >= reopen_ns) {
+                if (port_reopen(p) == 0) { backoff_ms = UART_REOPEN_MIN_MS; continue; }
+                reopen_ns = now + (uint64_t)backoff_ms * 1000000ULL;
+                backoff_ms = backoff_ms * 2 > UART_REOPEN_MAX_MS ? UART_REOPEN_MAX_MS : backoff_ms * 2;
+            }
+            int64_t w = (int64_t)(reopen_ns - now);
+            struct timespec to = { (time_t)(w / 1000000000LL), (long)(w % 1000000000LL) };
+            struct pollfd pe = { .fd = p->efd, .events = POLLIN };
+            if (ppoll(&pe, 1, &to, NULL) > 0 && (pe.revents & POLLIN)) {
+                uint64_t v;
+                ssize_t k = read(p->efd, &v, sizeof(v));
+                (void)k;
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&p->qmu);
+        int64_t tx_wait = tx_wait_ns(p, now);
+        pthread_mutex_unlock(&p->qmu);
+        bool want_out = tx_wait == 0;
+
+        // échéance la plus proche : fin de trame gap (réception) ou silence avant émission
+        int64_t wait = rx ? uart_codec_timeout_ns(&p->codec, now) : -1;
+        if (tx_wait > 0 && (wait < 0 || tx_wait < wait)) wait = tx_wait;
+        struct timespec to = { (time_t)(wait / 1000000000LL), (long)(wait % 1000000000LL) };
+        uint64_t deadline = wait >= 0 ? now + (uint64_t)wait : 0;
+
+        struct pollfd pf[2] = {
+            { .fd = p->fd,  .events = (short)((rx ? POLLIN : 0) | (want_out ? POLLOUT : 0)) },
+            { .fd = p->efd, .events = POLLIN },
+        };
+        int r = ppoll(pf, 2, wait >= 0 ? &to : NULL, NULL);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            log_err("uart %s: poll failed (%s)", p->cfg->port, strerror(errno));
+            break;
+        }
+        p->wakeups++;
+        // réveil sur échéance (fin de trame gap, silence avant émission) : retard
+        if (r == 0 && deadline) rt_jitter_add(&p->jitter, (int64_t)(mono_ns() - deadline));
+
+        rt_hot_enter();
+        const char* why = NULL;
+        int err = 0;
+        if (pf[1].revents & POLLIN) {
+            uint64_t v;
+            ssize_t k = read(p->efd, &v, sizeof(v));
+            (void)k;
+        }
+        const short bad = pf[0].revents & (POLLERR | POLLHUP | POLLNVAL);
+        // les octets encore en tampon sont remis avant de constater la perte
+        if (rx && (pf[0].revents & (POLLIN | POLLERR | POLLHUP)) && uart_port_rx(p) != 0) {
+            why = "read failed or hangup";
+            err = errno;
+        } else if (bad) {
+            why = (pf[0].revents & POLLHUP) ? "hangup" : "poll error";
+        } else {
+            if (rx) uart_codec_expire(&p->codec, mono_ns());
+            if (((pf[0].revents & POLLOUT) || (r == 0 && tx_wait > 0)) && uart_port_tx(p) != 0) {
+                why = "write failed";
+                err = errno;
+            }
+        }
+        rt_hot_leave();
+        if (why) port_lost(p, why, err);
+    }
+    if (p->fd >= 0) (void)uart_port_tx(p);   // dernier vidage, au mieux
+    return NULL;
+}
+
+int uart_port_open(uart_port_t* p, const uart_params_t* cfg,
+                   const gateway_realtime_t* realtime, uart_rx_cb on_rx, void* user) {
+    if (!p || !cfg) return UART_ERR_ARG;
+    memset(p, 0, sizeof(*p));
+    p->fd = p->efd = -1;
+    p->cfg = cfg;
+    p->realtime = realtime;
+    p->on_rx = on_rx;
+    p->user = user;
+
+    p->start_len = sizeof(p->start);
+    p->end_len = sizeof(p->end);
+    if (cfg->has_packet &&
+        (load_delim(cfg->packet.start, p->start, &p->start_len) < 0 ||
+         load_delim(cfg->packet.end, p->end, &p->end_len) < 0))
+        return UART_ERR_PACKET_CFG;
+    int rc = uart_codec_init(&p->codec, cfg, on_rx ? port_emit : NULL, p);
+    if (rc != UART_OK) return rc;
+    bool delim = p->codec.kind == UART_CODEC_DELIM;
+    if (!cfg->has_packet || !delim) p->start_len = p->end_len = 0;
+    p->tx_gap = p->codec.kind == UART_CODEC_GAP;
+
+    if (on_rx) {
+        p->framed = cfg->has_packet && delim;
+        rc = p->framed ? uart_framer_init(&p->framer, &cfg->packet, 0) : UART_OK;
+        if (rc != UART_OK) goto fail;
+        if (!p->framed && !(p->raw = (uint8_t*)malloc(UART_RAW_READ))) { rc = UART_ERR_ARG; goto fail; }
+    }
+
+    p->q_cap = UART_PORT_TXQ_DEFAULT;
+    p->q = (uint8_t*)malloc(p->q_cap);
+    p->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!p->q || p->efd < 0) { rc = UART_ERR_ARG; goto fail; }
+
+    rc = uart_open(cfg, &p->fd);
+    if (rc != UART_OK) goto fail;
+    int fl = fcntl(p->fd, F_GETFL);
+    if (fl < 0 || fcntl(p->fd, F_SETFL, fl | O_NONBLOCK) < 0) { rc = UART_ERR_OPEN; goto fail; }
+
+    pthread_mutex_init(&p->qmu, NULL);
+    if (pthread_create(&p->thread, NULL, uart_io_thread, p) != 0) {
+        pthread_mutex_destroy(&p->qmu);
+        rc = UART_ERR_OPEN;
+        goto fail;
+    }
+    p->running = true;
+    return UART_OK;
+
+fail:
+    if (p->fd >= 0) uart_close(p->fd);
+    if (p->efd >= 0) close(p->efd);
+    free(p->q);
+    free(p->raw);
+    uart_framer_free(&p->framer);
+    uart_codec_free(&p->codec);
+    p->fd = p->efd = -1;
+    p->q = p->raw = NULL;
+    return rc;
+}
+
+static void q_put(uart_port_t* p, const uint8_t* d, size_t n) {
+    if (!n) return;
+    size_t at = (p->q_head + p->q_len) % p->q_cap;
+    size_t k = p->q_cap - at;
+    if (k > n) k = n;
+    memcpy(p->q + at, d, k);
+    if (n > k) memcpy(p->q, d + k, n - k);
+    p->q_len += n;
+}
+
+int uart_port_send(uart_port_t* p, const uint8_t* data, size_t len) {
+    if (!p || !p->running || (!data && len)) return -1;
+    // delim sans CRC : le payload va tel quel dans la file, sinon encodé dans p->enc
+    bool plain = p->codec.kind == UART_CODEC_DELIM && !p->codec.crc_len;
+    pthread_mutex_lock(&p->qmu);
+    const uint8_t* body = data;
+    size_t blen = len;
+    if (!plain) {
+        size_t max = uart_codec_encoded_max(&p->codec, len);
+        if (max > p->enc_cap) {
+            uint8_t* e = (uint8_t*)realloc(p->enc, max);
+            if (!e) { p->tx_dropped++; pthread_mutex_unlock(&p->qmu); return -1; }
+            p->enc = e;
+            p->enc_cap = max;
+        }
+        blen = uart_codec_encode(&p->codec, data, len, p->enc);
+        body = p->enc;
+        if (!blen) { p->tx_errors++; pthread_mutex_unlock(&p->qmu); return -1; }
+    }
+    uint32_t flen = (uint32_t)(p->start_len + blen + p->end_len);
+    size_t need = (p->tx_gap ? sizeof(flen) : 0) + flen;
+    if (p->q_len + need > p->q_cap) {
+        p->tx_dropped++;
+        pthread_mutex_unlock(&p->qmu);
+        return -1;
+    }
+    bool was_empty = p->q_len == 0;
+    if (p->tx_gap) q_put(p, (const uint8_t*)&flen, sizeof(flen));
+    q_put(p, p->start, p->start_len);
+    q_put(p, body, blen);
+    q_put(p, p->end, p->end_len);
+    p->tx_frames++;
+    pthread_mutex_unlock(&p->qmu);
+    if (was_empty) wake(p);   // le thread ajoute POLLOUT
+    return 0;
+}
+
+int uart_send_adapter(const gw_msg_t* msg, void* ctx) {
+    if (!msg) return -1;
+    return uart_port_send((uart_port_t*)ctx, msg->pl.data, msg->pl.len);
+}
+
+void uart_port_log_stats(uart_port_t* p, const char* tag) {
+    if (!p || !p->running) return;
+    pthread_mutex_lock(&p->qmu);
+    size_t queued = p->q_len;
+    unsigned long txb = p->tx_bytes, txf = p->tx_frames, drop = p->tx_dropped, err = p->tx_errors;
+    pthread_mutex_unlock(&p->qmu);
+    log_info("[%s] uart %s (%s): rx %lu frames / %lu bytes in %lu wakeups (discarded %lu, overlong %lu, "
+             "bad crc %lu); tx %lu frames / %lu bytes, queued %zu, dropped %lu, errors %lu; lost %lu, reopened %lu",
+             tag ? tag : "uart", p->cfg->port, uart_codec_name(p->codec.kind),
+             p->rx_frames, p->rx_bytes, p->wakeups,
+             p->framer.discarded_bytes + p->codec.discarded_bytes,
+             p->framer.overflows + p->codec.overflows, p->codec.crc_errors,
+             txf, txb, queued, drop, err, p->lost, p->reopens);
+    rt_jitter_log(&p->jitter, tag ? tag : "uart");
+    if (rt_alloc_violations())
+        log_warn("[%s] %lu allocation(s) in realtime hot paths", tag ? tag : "uart", rt_alloc_violations());
+}
+
+void uart_port_close(uart_port_t* p) {
+    if (!p) return;
+    if (p->running) {
+        p->stop = 1;
+        wake(p);
+        pthread_join(p->thread, NULL);
+        pthread_mutex_destroy(&p->qmu);
+        p->running = false;
+    }
+    if (p->fd >= 0) uart_close(p->fd);
+    if (p->efd >= 0) close(p->efd);
+    free(p->q);
+    free(p->raw);
+    free(p->enc);
+    uart_framer_free(&p->framer);
+    uart_codec_free(&p->codec);
+    memset(p, 0, sizeof(*p));
+    p->fd = p->efd = -1;
+}
+
+// Trame UART -> gw_msg -> transform -> send_fn (thread I/O du port)
+void on_uart_rx(const uint8_t* frame, size_t len, double ts, void* user) {
+    gw_bridge_runtime_t* rt = (gw_bridge_runtime_t*)user;
+    if (!rt || !rt->send_fn || !frame || len == 0) return;
+
+    gw_msg_t in;
+    memset(&in, 0, sizeof(in));
+    in.protocole = KIND_UART;
+    in.pl.data = frame;
+    in.pl.len = len;
+    in.pl.is_text = 0;
+    in.pl.content_type = "application/octet-stream";
+    in.timestamp = ts;
+
+    if (rt->transform) {
+        gw_msg_t out;
+        memset(&out, 0, sizeof(out));
+        int trc = rt->transform(&in, &out, rt->transform_user);
+        rt->send_fn(trc == 0 ? &out : &in, rt->send_ctx);
+    } else {
+        rt->send_fn(&in, rt->send_ctx);
+    }
+}
@@ -0,0 +1,106 @@
+// ================================
+// File: uart_port.h
+// ================================
+#ifndef UART_PORT_H
+#define UART_PORT_H
+
+/*
+ * Runtime UART pour les bridges (source et/ou destination).
+ *
+ * Un thread I/O par port, piloté par poll() :
+ *   - fd en O_NONBLOCK : sur POLLIN, read() jusqu'à EAGAIN, chaque remplissage
+ *     est découpé (uart_framer pour le codec delim, uart_codec sinon) et toutes
+ *     les trames complètes sont remises à on_rx dans le même réveil ; avec le
+ *     codec gap, l'échéance de silence est passée à ppoll() ;
+ *   - écritures : uart_port_send()/uart_send_adapter() encodent (délimiteurs
+ *     packet.start/end ou codec, CRC) dans une file (anneau d'octets) et
+ *     réveillent le thread par eventfd ; la file est vidée quand le fd est
+ *     inscriptible (POLLOUT), sans select() par morceau ni blocage de
+ *     l'appelant. Avec le codec gap, une trame à la fois, séparées par gap_us
+ *     de silence (durée estimée à partir du baudrate).
+ *   - perte du port (read() == 0, EIO, POLLHUP/POLLERR, écriture en échec) :
+ *     fd fermé puis rouvert par le thread avec back-off (250 ms .. 30 s).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "connectors.h"
+#include "config_types.h"
+#include "uart_framer.h"
+#include "uart_codec.h"
+#include "rt_sched.h"
+#include "gw_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_PORT_TXQ_DEFAULT (64 * 1024)
+
+// Trame reçue (payload sans délimiteurs), valide pendant l'appel seulement
+typedef void (*uart_rx_cb)(const uint8_t* frame, size_t len, double ts, void* user);
+
+typedef struct {
+    int fd;                         // -1 : port perdu, réouverture en cours (thread I/O)
+    int efd;                        // eventfd : file non vide / arrêt
+    const uart_params_t* cfg;
+    const gateway_realtime_t* realtime;
+
+    uart_rx_cb on_rx;               // NULL : port en écriture seule
+    void*      user;
+    uart_framer_t framer;
+    bool       framed;              // params.packet présent, codec delim
+    uart_codec_t codec;             // CRC (delim) ou décodage/encodage slip/cobs/length/gap
+    uint8_t*   raw;                 // sans packet : chaque read() est une trame ; sinon entrée du codec
+    double     rx_ts;               // horodatage du read() en cours (trames émises par le codec)
+
+    // file d'écriture (anneau d'octets, sous qmu)
+    pthread_mutex_t qmu;
+    uint8_t* q;
+    size_t   q_cap, q_head, q_len;
+    uint8_t  start[UART_FRAMER_DELIM_MAX], end[UART_FRAMER_DELIM_MAX];
+    size_t   start_len, end_len;
+    uint8_t* enc;                   // trame encodée avant copie dans la file
+    size_t   enc_cap;
+    bool     tx_gap;                // codec gap : chaque trame précédée de sa longueur (u32) dans la file
+    size_t   tx_left;               // octets restants de la trame en cours d'écriture
+    uint64_t tx_ready_ns;           // CLOCK_MONOTONIC : début au plus tôt de la trame suivante
+
+    pthread_t thread;
+    volatile int stop;
+    bool running;
+
+    // stats
+    unsigned long rx_bytes, rx_frames, wakeups;
+    unsigned long tx_bytes, tx_frames, tx_dropped, tx_errors;
+    unsigned long lost, reopens;
+    rt_jitter_t   jitter;           // réveils sur échéance (gap, silence tx) : retard
+} uart_port_t;
+
+// Ouvre le port (termios de conn_uart.c), passe le fd en O_NONBLOCK et lance le
+// thread I/O. on_rx NULL => destination seule. Retour UART_OK ou code UART_ERR_*.
+int  uart_port_open(uart_port_t* p, const uart_params_t* cfg,
+                    const gateway_realtime_t* realtime, uart_rx_cb on_rx, void* user);
+
+// Met une trame en file (délimiteurs ou codec, CRC). Retour 0, -1 si file
+// pleine ou payload non encodable.
+int  uart_port_send(uart_port_t* p, const uint8_t* data, size_t len);
+
+// gw_send_fn : msg->pl vers le port (ctx = uart_port_t*)
+int  uart_send_adapter(const gw_msg_t* msg, void* ctx);
+
+void uart_port_log_stats(uart_port_t* p, const char* tag);
+
+// Arrête le thread (la file restante est vidée au mieux) et ferme le port
+void uart_port_close(uart_port_t* p);
+
+// Callback bridge : trame UART -> transform -> send_fn (user = gw_bridge_runtime_t*)
+void on_uart_rx(const uint8_t* frame, size_t len, double ts, void* user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_PORT_H
@@ -0,0 +1,54 @@
+// ================================
+// File: uart_termios2.c
+// ================================
+// Pas de <termios.h> ici : struct termios2 vient de <asm/termbits.h>.
+#include "uart_termios2.h"
+#include "conn_uart.h"
+
+#ifdef __linux__
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include <linux/serial.h>
+#include <errno.h>
+
+// <sys/ioctl.h> tire la struct termios de la libc : prototype seul
+extern int ioctl(int fd, unsigned long request, ...);
+
+int uart_set_baud_other(int fd, int baudrate, int* actual) {
+    if (baudrate <= 0) return UART_ERR_BAUD;
+    struct termios2 t2;
+    if (ioctl(fd, TCGETS2, &t2) < 0) return UART_ERR_TCGETS;
+    t2.c_cflag &= ~(tcflag_t)(CBAUD | (CBAUD << IBSHIFT));
+    t2.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    t2.c_ispeed = (speed_t)baudrate;
+    t2.c_ospeed = (speed_t)baudrate;
+    if (ioctl(fd, TCSETS2, &t2) < 0) return errno == EINVAL ? UART_ERR_BAUD : UART_ERR_TCSETS;
+    if (actual) {
+        if (ioctl(fd, TCGETS2, &t2) < 0) return UART_ERR_TCGETS;
+        *actual = (int)t2.c_ospeed;
+    }
+    return UART_OK;
+}
+
+int uart_set_low_latency(int fd, bool on) {
+    struct serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) < 0) return UART_ERR_UNSUPPORTED;
+    if (on) ss.flags |= ASYNC_LOW_LATENCY;
+    else    ss.flags &= ~ASYNC_LOW_LATENCY;
+    if (ioctl(fd, TIOCSSERIAL, &ss) < 0) return UART_ERR_UNSUPPORTED;
+    return UART_OK;
+}
+
+#else
+
+int uart_set_baud_other(int fd, int baudrate, int* actual) {
+    (void)fd; (void)baudrate; (void)actual;
+    return UART_ERR_UNSUPPORTED;
+}
+
+int uart_set_low_latency(int fd, bool on) {
+    (void)fd; (void)on;
+    return UART_ERR_UNSUPPORTED;
+}
+
+#endif
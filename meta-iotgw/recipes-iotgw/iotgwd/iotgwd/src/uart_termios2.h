@@ -0,0 +1,32 @@
+// ================================
+// File: uart_termios2.h
+// ================================
+#ifndef UART_TERMIOS2_H
+#define UART_TERMIOS2_H
+
+/*
+ * ioctl série propres à Linux, isolés dans leur propre unité de compilation :
+ * <asm/termbits.h> (struct termios2) entre en conflit avec <termios.h> de la libc.
+ */
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Débit quelconque (TCGETS2/TCSETS2, CBAUD = BOTHER), entrée = sortie.
+// *actual reçoit le débit relu après application (arrondi du driver), peut être NULL.
+// Retour UART_OK, UART_ERR_TCGETS/TCSETS, UART_ERR_UNSUPPORTED hors Linux.
+int uart_set_baud_other(int fd, int baudrate, int* actual);
+
+// ASYNC_LOW_LATENCY (TIOCGSERIAL/TIOCSSERIAL) : le driver pousse chaque octet
+// reçu sans attendre (ftdi_sio : latency timer 16 ms -> 1 ms).
+// Retour UART_OK ou UART_ERR_UNSUPPORTED (driver sans serial_struct : CDC ACM, pty).
+int uart_set_low_latency(int fd, bool on);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_TERMIOS2_H